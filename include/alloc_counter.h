@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Contagem das alocações do processo, para verificar que um caminho quente
+// não passa pelo heap (os microbenchmarks com 'steady_state', microbench.h).
+//
+// src/alloc_counter.cpp substitui os operator new e delete globais por
+// versões que chamam malloc e free e contam cada chamada. Ele só é ligado
+// aos microbenchmarks: o cliente e o servidor continuam com os operadores
+// da biblioteca. Chamadas diretas a malloc (de bibliotecas em C) não são
+// contadas.
+
+// Alocações e liberações feitas até agora, por todas as threads
+uint64_t allocation_count();
+uint64_t deallocation_count();
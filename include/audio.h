@@ -1,53 +1,66 @@
 #pragma once
 
-#include <portaudio.h>
+#include <memory>
 
-// Classe que encapsula o tratamento de áudio usando a biblioteca PortAudio
-// Utilizada para facilitar a captura e reprodução de áudio no projeto.
+#include "common.h"
+
+// Interface de entrada e saída de áudio do cliente.
+// Utilizada para facilitar a captura e reprodução de áudio no projeto, sem
+// que o resto do cliente dependa de onde o áudio vem ou para onde vai: a
+// implementação padrão usa os dispositivos do sistema através da PortAudio
+// (portaudio_handler.h), e as implementações em audio_backends.h permitem
+// rodar o cliente inteiro sem placa de som (testes e benchmarks).
+//
+// Todos os blocos são PCM de 16 bits na taxa da rede (SAMPLE_RATE), e os
+// métodos read() e write() retornam 0 em caso de sucesso.
 class AudioHandler {
-   private:
-    // O tipo de dado 'PaStream' é utilizado para representar um fluxo de áudio
-    // na biblioteca PortAudio. Ele é usado tanto para capturar áudio do
-    // microfone quanto para reproduzir áudio nos alto-falantes.
+   public:
+    // Destrutor da classe
+    virtual ~AudioHandler() = default;
 
-    // Ponteiro para o fluxo de captura de áudio (microfone)
-    PaStream* inputStream;
+    // Prepara o backend para ser usado
+    // Retorna true se a inicialização for bem-sucedida, false caso contrário
+    virtual bool init() = 0;
 
-    // Ponteiro para o fluxo de reprodução de áudio (alto-falantes)
-    PaStream* outputStream;
+    // Desaloca os recursos utilizados pelo backend
+    virtual void terminate() = 0;
 
-   public:
-    // Construtor da classe
-    AudioHandler();
+    // Abre o fluxo de captura sem iniciá-lo, para que o trabalho lento
+    // (escolha do dispositivo, configuração do driver, alocação dos buffers)
+    // aconteça antes da chamada começar. Retorna true em caso de sucesso.
+    virtual bool openCapture() { return true; }
 
-    // Destrutor da classe
-    ~AudioHandler();
+    // Abre o fluxo de reprodução sem iniciá-lo, como openCapture()
+    virtual bool openPlayback() { return true; }
 
-    // Prepara o biblioteca PortAudio para ser usada
-    // Retorna true se a inicialização for bem-sucedida, false caso contrário
-    bool init();
+    // Inicia o fluxo de captura de áudio (abrindo-o, se ainda não foi aberto)
+    virtual void startCapture() = 0;
 
-    // Desaloca os recursos utilizados pela biblioteca PortAudio
-    void terminate();
+    // Inicia o fluxo de reprodução de áudio (abrindo-o, se ainda não foi
+    // aberto)
+    virtual void startPlayback() = 0;
 
-    // Abre e inicia o fluxo de captura de áudio
-    void startCapture();
-    
-    // Abre e inicia o fluxo de reprodução de áudio
-    void startPlayback();
-    
     // Para o fluxo de captura de áudio
-    void stopCapture();
+    virtual void stopCapture() = 0;
 
     // Para o fluxo de reprodução
-    void stopPlayback();
+    virtual void stopPlayback() = 0;
 
-    // Lê um bloco de áudio do microfone e armazena no 'buffer' fornecido.
-    // O 'buffer' é um ponteiro para um array de caracteres onde os dados de
-    // áudio serão armazenados.
-    int read(char* buffer);
+    // Lê um bloco de FRAMES_PER_BUFFER amostras e armazena no 'buffer'
+    // fornecido. Bloqueia até o bloco estar disponível, como um microfone.
+    virtual int read(char* buffer) = 0;
 
     // Pega um bloco de áudio armazenado no 'buffer' e o envia para a saída de
-    // áudio.
-    int write(const char* buffer);
-};
\ No newline at end of file
+    // áudio. 'frames' pode variar um pouco em torno de FRAMES_PER_BUFFER
+    // (compensação de deriva de relógio), até 2 * FRAMES_PER_BUFFER.
+    virtual int write(const char* buffer, int frames = FRAMES_PER_BUFFER) = 0;
+};
+
+// Cria o backend de áudio escolhido pela variável de ambiente VOIP_AUDIO:
+//   (vazia) ou "portaudio"  dispositivos padrão do sistema
+//   "null"                  descarta a saída e captura silêncio, no ritmo real
+//   "loopback"              o que é tocado volta pelo microfone
+//   "wav:<entrada>,<saida>" captura de um arquivo WAV e grava a saída em outro
+//                           (qualquer um dos dois pode ficar vazio)
+// Retorna nullptr se a variável for inválida.
+std::unique_ptr<AudioHandler> create_audio_handler();
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "audio.h"
+#include "wav.h"
+
+// Backends de áudio que não precisam de placa de som. Todos respeitam o
+// ritmo real de um dispositivo (um bloco a cada 20 ms), então o cliente se
+// comporta como com hardware, mas pode rodar em servidores e testes.
+
+// Simula o relógio de um dispositivo de áudio.
+// wait() bloqueia até o instante em que o dispositivo teria consumido ou
+// produzido os quadros anteriores, menos 'buffered' de folga (a saída de um
+// dispositivo real aceita escritas enquanto o buffer não enche).
+class FramePacer {
+   private:
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::microseconds buffered;
+    bool started = false;
+
+   public:
+    explicit FramePacer(std::chrono::microseconds buffered =
+                            std::chrono::microseconds(0))
+        : buffered(buffered) {}
+
+    // Avança o relógio em 'frames' amostras e espera por ele
+    void wait(int frames);
+
+    // Reinicia o relógio (próxima chamada começa a contar do zero)
+    void reset() { started = false; }
+};
+
+// Captura silêncio e descarta o que seria tocado
+class NullAudioHandler : public AudioHandler {
+   private:
+    FramePacer capture_pacer;
+    FramePacer playback_pacer;
+
+   public:
+    NullAudioHandler();
+
+    bool init() override { return true; }
+    void terminate() override {}
+    void startCapture() override { capture_pacer.reset(); }
+    void startPlayback() override { playback_pacer.reset(); }
+    void stopCapture() override {}
+    void stopPlayback() override {}
+    int read(char* buffer) override;
+    int write(const char* buffer, int frames = FRAMES_PER_BUFFER) override;
+};
+
+// Captura de um arquivo WAV (mono, SAMPLE_RATE) e grava a saída em outro.
+// Terminado o arquivo de entrada, a captura segue com silêncio.
+class WavAudioHandler : public AudioHandler {
+   private:
+    std::string input_path;
+    std::string output_path;
+    WavReader reader;
+    WavWriter writer;
+    bool has_input = false;
+    bool has_output = false;
+    FramePacer capture_pacer;
+    FramePacer playback_pacer;
+
+   public:
+    // Caminhos vazios desativam a entrada ou a saída
+    WavAudioHandler(const std::string& input_path,
+                    const std::string& output_path);
+
+    bool init() override;
+    void terminate() override;
+    void startCapture() override { capture_pacer.reset(); }
+    void startPlayback() override { playback_pacer.reset(); }
+    void stopCapture() override {}
+    void stopPlayback() override {}
+    int read(char* buffer) override;
+    int write(const char* buffer, int frames = FRAMES_PER_BUFFER) override;
+};
+
+// Tudo o que é tocado volta pela captura, como um alto-falante colado ao
+// microfone. Útil para exercitar o cancelador de eco e o caminho completo
+// do cliente dentro de um único processo.
+class LoopbackAudioHandler : public AudioHandler {
+   private:
+    // Fila circular de amostras tocadas ainda não capturadas
+    std::vector<char> ring;
+    size_t read_pos = 0;
+    size_t count = 0;
+    std::mutex ring_mutex;
+    FramePacer capture_pacer;
+    FramePacer playback_pacer;
+
+   public:
+    LoopbackAudioHandler();
+
+    bool init() override { return true; }
+    void terminate() override {}
+    void startCapture() override { capture_pacer.reset(); }
+    void startPlayback() override { playback_pacer.reset(); }
+    void stopCapture() override {}
+    void stopPlayback() override {}
+    int read(char* buffer) override;
+    int write(const char* buffer, int frames = FRAMES_PER_BUFFER) override;
+};
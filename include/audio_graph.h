@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Pequeno grafo de processamento de áudio.
+// Um grafo é uma cadeia fixa de nós que processam, um após o outro e no
+// mesmo buffer (in-place), blocos de 'Frames' amostras com 'Channels'
+// canais. Como o tamanho do bloco é parâmetro de template, os laços dos nós
+// têm limites conhecidos em tempo de compilação e são desenrolados e
+// vetorizados pelo compilador.
+//
+// Toda a memória é reservada na montagem do grafo (add()); process() não
+// aloca, então pode rodar nas threads de áudio.
+
+// Bloco de áudio que atravessa o grafo.
+// 'pcm' aponta para o buffer PCM de 16 bits externo (por exemplo, o payload
+// do pacote UDP), evitando cópias; 'samples' é a versão em ponto flutuante
+// usada pelos nós de processamento, intercalada por canal.
+template <int Frames, int Channels>
+struct AudioBlock {
+    static constexpr int FRAMES = Frames;
+    static constexpr int CHANNELS = Channels;
+    static constexpr int SAMPLES = Frames * Channels;
+
+    char* pcm = nullptr;
+    alignas(16) float samples[SAMPLES] = {};
+};
+
+// Nó de processamento do grafo
+template <int Frames, int Channels>
+class AudioNode {
+   public:
+    using Block = AudioBlock<Frames, Channels>;
+
+    virtual ~AudioNode() = default;
+
+    // Nome exibido nas estatísticas
+    virtual const char* name() const = 0;
+
+    // Processa o bloco in-place
+    virtual void process(Block& block) = 0;
+
+    // Atraso algorítmico adicionado pelo nó, em amostras
+    virtual int latency_samples() const { return 0; }
+};
+
+// Cadeia de nós executada bloco a bloco, com medição de tempo por nó
+template <int Frames, int Channels>
+class AudioGraph {
+   public:
+    using Node = AudioNode<Frames, Channels>;
+    using Block = AudioBlock<Frames, Channels>;
+
+   private:
+    // Nó e seu tempo de processamento acumulado
+    struct NodeSlot {
+        std::unique_ptr<Node> node;
+        std::chrono::nanoseconds total_time{0};
+        std::chrono::nanoseconds max_time{0};
+    };
+
+    std::vector<NodeSlot> nodes;
+    Block block;
+    long frames = 0;
+
+   public:
+    // Acrescenta um nó ao final da cadeia (somente na montagem do grafo) e
+    // devolve uma referência a ele
+    template <typename N, typename... Args>
+    N& add(Args&&... args) {
+        auto node = std::make_unique<N>(std::forward<Args>(args)...);
+        N& ref = *node;
+        nodes.push_back(NodeSlot{std::move(node)});
+        return ref;
+    }
+
+    // Processa um bloco PCM de 'Frames' amostras in-place
+    void process(char* pcm) {
+        block.pcm = pcm;
+        for (NodeSlot& slot : nodes) {
+            auto start = std::chrono::steady_clock::now();
+            slot.node->process(block);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            slot.total_time += elapsed;
+            if (elapsed > slot.max_time) slot.max_time = elapsed;
+        }
+        ++frames;
+    }
+
+    // Soma do atraso algorítmico de todos os nós, em amostras
+    int latency_samples() const {
+        int total = 0;
+        for (const NodeSlot& slot : nodes) {
+            total += slot.node->latency_samples();
+        }
+        return total;
+    }
+
+    // Imprime o tempo médio e máximo de cada nó por bloco
+    void print_stats(const char* label) const {
+        if (frames == 0) return;
+        std::cout << label << ": " << frames << " blocos, atraso algorítmico "
+                  << latency_samples() << " amostras" << std::endl;
+        for (const NodeSlot& slot : nodes) {
+            std::cout << "  " << slot.node->name() << ": média "
+                      << std::chrono::duration<double, std::micro>(
+                             slot.total_time)
+                                 .count() /
+                             frames
+                      << " us, máximo "
+                      << std::chrono::duration<double, std::micro>(
+                             slot.max_time)
+                             .count()
+                      << " us" << std::endl;
+        }
+    }
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "audio_graph.h"
+#include "echo_canceller.h"
+#include "noise_suppressor.h"
+
+// Nós de processamento usados pelos grafos de áudio do cliente.
+
+// Converte o PCM de 16 bits do bloco para ponto flutuante em [-1, 1)
+template <int Frames, int Channels>
+class PcmDecodeNode : public AudioNode<Frames, Channels> {
+   public:
+    const char* name() const override { return "pcm_decode"; }
+
+    void process(AudioBlock<Frames, Channels>& block) override {
+        for (int i = 0; i < Frames * Channels; ++i) {
+            int16_t sample;
+            std::memcpy(&sample, block.pcm + i * sizeof(int16_t),
+                        sizeof(sample));
+            block.samples[i] = sample * (1.0f / 32768.0f);
+        }
+    }
+};
+
+// Converte as amostras de volta para PCM de 16 bits, com saturação
+template <int Frames, int Channels>
+class PcmEncodeNode : public AudioNode<Frames, Channels> {
+   public:
+    const char* name() const override { return "pcm_encode"; }
+
+    void process(AudioBlock<Frames, Channels>& block) override {
+        for (int i = 0; i < Frames * Channels; ++i) {
+            float scaled =
+                std::clamp(block.samples[i] * 32768.0f, -32768.0f, 32767.0f);
+            int16_t sample = static_cast<int16_t>(std::lrint(scaled));
+            std::memcpy(block.pcm + i * sizeof(int16_t), &sample,
+                        sizeof(sample));
+        }
+    }
+};
+
+// Ganho fixo
+template <int Frames, int Channels>
+class GainNode : public AudioNode<Frames, Channels> {
+   private:
+    float gain;
+
+   public:
+    explicit GainNode(float gain) : gain(gain) {}
+
+    const char* name() const override { return "gain"; }
+
+    void set_gain(float value) { gain = value; }
+
+    void process(AudioBlock<Frames, Channels>& block) override {
+        for (int i = 0; i < Frames * Channels; ++i) block.samples[i] *= gain;
+    }
+};
+
+// Filtro passa-altas de um polo por canal, remove o nível DC e ruídos muito
+// graves do microfone (corte em torno de 40 Hz a 48 kHz)
+template <int Frames, int Channels>
+class HighPassNode : public AudioNode<Frames, Channels> {
+   private:
+    static constexpr float POLE = 0.995f;
+    float last_input[Channels] = {};
+    float last_output[Channels] = {};
+
+   public:
+    const char* name() const override { return "high_pass"; }
+
+    void process(AudioBlock<Frames, Channels>& block) override {
+        for (int i = 0; i < Frames; ++i) {
+            for (int c = 0; c < Channels; ++c) {
+                float x = block.samples[i * Channels + c];
+                float y = x - last_input[c] + POLE * last_output[c];
+                last_input[c] = x;
+                last_output[c] = y;
+                block.samples[i * Channels + c] = y;
+            }
+        }
+    }
+};
+
+// Controle automático de ganho (AGC).
+// Aproxima o nível RMS da fala de um alvo (-20 dBFS) com ganho limitado, só
+// adapta quando o bloco tem sinal suficiente (não amplifica o silêncio) e
+// interpola o ganho ao longo do bloco para não gerar estalos.
+template <int Frames, int Channels>
+class AgcNode : public AudioNode<Frames, Channels> {
+   private:
+    static constexpr float TARGET_RMS = 0.1f;
+    static constexpr float MIN_GAIN = 0.25f;
+    static constexpr float MAX_GAIN = 4.0f;
+    static constexpr float GATE_RMS = 0.005f;
+    static constexpr float SMOOTHING = 0.1f;
+    float gain = 1.0f;
+
+   public:
+    const char* name() const override { return "agc"; }
+
+    void process(AudioBlock<Frames, Channels>& block) override {
+        float energy = 0.0f;
+        for (int i = 0; i < Frames * Channels; ++i) {
+            energy += block.samples[i] * block.samples[i];
+        }
+        const float rms = std::sqrt(energy / (Frames * Channels));
+
+        float target = gain;
+        if (rms > GATE_RMS) {
+            target = std::clamp(TARGET_RMS / rms, MIN_GAIN, MAX_GAIN);
+        }
+        const float next = gain + SMOOTHING * (target - gain);
+        const float ramp = (next - gain) / Frames;
+
+        for (int i = 0; i < Frames; ++i) {
+            const float g = gain + ramp * i;
+            for (int c = 0; c < Channels; ++c) {
+                block.samples[i * Channels + c] *= g;
+            }
+        }
+        gain = next;
+    }
+};
+
+// Remove o eco usando o cancelador compartilhado com o grafo de reprodução
+template <int Frames, int Channels>
+class EchoCancellerNode : public AudioNode<Frames, Channels> {
+    static_assert(Frames == FRAMES_PER_BUFFER && Channels == 1,
+                  "O cancelador de eco processa quadros mono completos");
+
+   private:
+    EchoCanceller& canceller;
+
+   public:
+    explicit EchoCancellerNode(EchoCanceller& canceller)
+        : canceller(canceller) {}
+
+    const char* name() const override { return "echo_canceller"; }
+
+    void process(AudioBlock<Frames, Channels>& block) override {
+        canceller.process(block.samples);
+    }
+};
+
+// Entrega o áudio tocado ao cancelador de eco como referência
+template <int Frames, int Channels>
+class EchoReferenceNode : public AudioNode<Frames, Channels> {
+    static_assert(Frames == FRAMES_PER_BUFFER && Channels == 1,
+                  "O cancelador de eco processa quadros mono completos");
+
+   private:
+    EchoCanceller& canceller;
+
+   public:
+    explicit EchoReferenceNode(EchoCanceller& canceller)
+        : canceller(canceller) {}
+
+    const char* name() const override { return "echo_reference"; }
+
+    void process(AudioBlock<Frames, Channels>& block) override {
+        canceller.push_reference(block.samples);
+    }
+};
+
+// Supressão de ruído espectral
+template <int Frames, int Channels>
+class NoiseSuppressorNode : public AudioNode<Frames, Channels> {
+    static_assert(Frames == FRAMES_PER_BUFFER && Channels == 1,
+                  "O supressor de ruído processa quadros mono completos");
+
+   private:
+    NoiseSuppressor suppressor;
+
+   public:
+    const char* name() const override { return "noise_suppressor"; }
+
+    void process(AudioBlock<Frames, Channels>& block) override {
+        suppressor.process(block.samples);
+    }
+
+    int latency_samples() const override { return NS_DELAY_SAMPLES; }
+};
@@ -7,38 +7,169 @@
 #endif
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <future>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <vector>
 
 #include "audio.h"
+#include "audio_graph.h"
+#include "clock_drift.h"
+#include "common.h"
+#include "congestion.h"
+#include "dsp_simd.h"
+#include "echo_canceller.h"
+#include "frame_pool.h"
+#include "simulcast.h"
 
 // Interruptor geral de todas as threads
 extern std::atomic<bool> running;
 
-// Armazena os pacotes de áudio recebidos do servidor.
-extern std::queue<std::vector<char>> jitter_buffer;
+// Backend de áudio usado pelas threads de envio e reprodução
+extern std::unique_ptr<AudioHandler> audio_handler;
 
-// A variável mutex bloqueia o acesso ao jitter_buffer enquanto uma
+// Instante em que o cliente foi iniciado, base da métrica de tempo até o
+// primeiro áudio (definido no início de main()).
+extern std::chrono::steady_clock::time_point startup_time;
+
+// Milissegundos desde startup_time
+double ms_since_startup();
+
+// Quadros guardados por locutor (1,28 s de áudio). Com o buffer cheio, o
+// quadro mais antigo é descartado para dar lugar ao novo.
+constexpr int JITTER_BUFFER_CAPACITY = 64;
+
+// Quadro de áudio recebido: timestamp de mídia do emissor e as amostras PCM,
+// num bloco do frame_pool que passa da recepção para a reprodução sem cópia
+struct AudioFrame {
+    uint32_t timestamp = 0;
+    FrameRef samples;
+};
+
+// Fila circular de tamanho fixo dos quadros de um locutor, com a interface
+// de std::queue: colocar e retirar quadros não aloca memória.
+class FrameQueue {
+   private:
+    AudioFrame frames[JITTER_BUFFER_CAPACITY];
+    int head = 0;
+    int count = 0;
+
+   public:
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    AudioFrame& front() { return frames[head]; }
+
+    // Coloca o quadro no final. Retorna false se o mais antigo foi
+    // descartado por falta de espaço.
+    bool push(AudioFrame&& frame) {
+        const bool full = count == JITTER_BUFFER_CAPACITY;
+        if (full) pop();
+        frames[(head + count) % JITTER_BUFFER_CAPACITY] = std::move(frame);
+        ++count;
+        return !full;
+    }
+
+    // Retira o primeiro quadro, devolvendo o bloco ao pool
+    void pop() {
+        frames[head].samples.reset();
+        head = (head + 1) % JITTER_BUFFER_CAPACITY;
+        --count;
+    }
+};
+
+// Áudio de um locutor (outro participante da chamada). O servidor marca
+// cada pacote com o fluxo do emissor, e o cliente mantém um jitter buffer e
+// uma compensação de deriva por fluxo; a thread de reprodução mistura todos.
+struct SpeakerStream {
+    // Armazena os pacotes de áudio recebidos deste locutor.
+    FrameQueue jitter_buffer;
+
+    // Compensa a deriva entre o relógio deste locutor e o dos alto-falantes.
+    DriftCompensator drift;
+
+    // Converte a camada de qualidade recebida (simulcast.h) para 48 kHz.
+    LayerDecoder decoder;
+
+    // Perda, jitter e gradiente do atraso para o RECEIVER_REPORT
+    // (congestion.h), protegidos por jitter_buffer_mutex.
+    ReceiveStats stats;
+
+    // Ganho na mixagem, em Q15 (PCM16_UNITY_GAIN mantém o volume original).
+    std::atomic<int> gain{PCM16_UNITY_GAIN};
+};
+
+// Um fluxo por identificador (slot do emissor no servidor).
+extern SpeakerStream speaker_streams[MAX_STREAMS];
+
+// A variável mutex bloqueia o acesso aos jitter buffers enquanto uma
 // thread está adicionando ou removendo pacotes.
 extern std::mutex jitter_buffer_mutex;
 
 // A variável condition_variable é usada para notificar a thread de
-// reprodução de áudio quando novos pacotes estão disponíveis no jitter_buffer.
+// reprodução de áudio quando novos pacotes estão disponíveis em algum
+// jitter buffer.
 extern std::condition_variable jitter_buffer_cond;
 
-// Função para descobrir o IP do servidor na rede local.
-std::string discover_server_on_network();
+// Identificador do nosso fluxo, recebido no LOGIN_OK e enviado em cada
+// pacote de áudio.
+extern std::atomic<int> local_stream_id;
+
+// Token da sessão, recebido no LOGIN_OK e acrescentado ao final de cada
+// pacote de áudio; com ele o servidor reconhece a sessão mesmo se o NAT
+// trocar o nosso endereço (session_token.h)
+extern std::atomic<uint64_t> session_token;
+
+// Cookie de login recebido de um servidor sob inundação (0 se nenhum); os
+// reenvios do login o devolvem em um LOGIN_WITH_COOKIE (rate_limit.h)
+extern std::atomic<uint64_t> login_cookie;
+
+// Adiciona 'frames' quadros PCM de 48 kHz consecutivos ('pcm', o primeiro
+// com o timestamp de mídia 'timestamp') ao jitter buffer do locutor e
+// acorda a thread de reprodução.
+void enqueue_frames(SpeakerStream& speaker, uint32_t timestamp,
+                    const char* pcm, int frames);
+
+// Retira o primeiro quadro do jitter buffer do locutor para 'samples'
+// (AUDIO_BUFFER_SIZE bytes). Retorna false se o buffer estiver vazio; senão
+// preenche o timestamp do quadro e quantos quadros ficaram na fila.
+bool dequeue_frame(SpeakerStream& speaker, char* samples, uint32_t& timestamp,
+                   int& depth);
+
+// Ajusta o volume de um locutor, em porcentagem (0 a 100).
+// Retorna false se o fluxo não existir.
+bool set_speaker_volume(int stream, int percent);
+
+// Cancelador de eco, alimentado pelo grafo de reprodução (referência) e
+// aplicado pelo grafo de captura.
+extern EchoCanceller echo_canceller;
+
+// Relógio dos alto-falantes, comum a todos os fluxos.
+extern PlaybackClock playback_clock;
+
+// Grafo de processamento com blocos do tamanho do quadro de áudio do projeto
+using ClientAudioGraph = AudioGraph<FRAMES_PER_BUFFER, NUM_CHANNELS>;
+
+// Processa o áudio entre o microfone e o envio (usado pela thread de envio)
+extern ClientAudioGraph capture_graph;
+
+// Processa o áudio mixado antes dos alto-falantes (usado pela thread de
+// reprodução)
+extern ClientAudioGraph playback_graph;
+
+// Monta os grafos de captura e reprodução. Deve ser chamada antes de iniciar
+// as threads de áudio, pois é onde os nós são alocados.
+void build_audio_graphs();
 
 // Declaração da função para suprimir erros, necessário para os erros  que o
 // PortAudio lança ao tentar encontrar os dispositivos de áudio
 void suppress_alsa_errors(bool suppress);
 
 // Função responsável por receber pacotes de áudio do servidor e
-// colocá-los no jitter buffer, que é uma fila de pacotes a serem
+// colocá-los no jitter buffer do locutor, que é uma fila de pacotes a serem
 // reproduzidos. Ela recebe o socket como parâmetro.
 void receive_thread_func(int sock, std::promise<void> connection_promise);
 
@@ -46,7 +177,7 @@ void receive_thread_func(int sock, std::promise<void> connection_promise);
 // servidor, recebe o socket e o endereço do servidor como parâmetros.
 void send_thread_func(int sock, const sockaddr_in& server_addr);
 
-// Função responsável por tocar o áudio recebido do jitter buffer.
-// Ela não recebe parâmetros, pois acessa o jitter buffer e o motor de áudio
+// Função responsável por misturar e tocar o áudio dos jitter buffers.
+// Ela não recebe parâmetros, pois acessa os jitter buffers e o motor de áudio
 // diretamente.
 void playback_thread_func();
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "resampler.h"
+
+// Estima a deriva entre um relógio de mídia (amostras de áudio) e o relógio
+// local (steady_clock).
+// Para cada amostra (tempo local, tempo de mídia) calcula o deslocamento
+// local - mídia. O atraso da rede só aumenta esse deslocamento, então o
+// mínimo em janelas de DRIFT_WINDOW_SEC segundos acompanha o relógio sem o
+// jitter. A inclinação desses mínimos, obtida por regressão linear com
+// esquecimento exponencial, é a deriva: -100e-6 significa que o relógio de
+// mídia anda 100 ppm mais rápido do que o local.
+//
+// Uma interrupção no relógio de mídia (o dispositivo ficou sem áudio para
+// tocar) soma um degrau permanente ao deslocamento, que a regressão leria
+// como deriva. Depois de mark_gap() os pontos são ignorados até o relógio
+// estabilizar, e a primeira janela seguinte é deslocada para continuar a
+// reta já estimada: só a inclinação dentro de cada trecho conta.
+class ClockDriftEstimator {
+   private:
+    // Primeiro tempo local e primeiro deslocamento (origem da regressão);
+    // o deslocamento de origem absorve os degraus das interrupções
+    double origin_time = -1.0;
+    double origin_offset = 0.0;
+
+    // Depois de uma interrupção: pontos ignorados até 'resume_time' e a
+    // próxima janela é alinhada à reta
+    double resume_time = -1.0;
+    bool anchor_pending = false;
+
+    // Janela atual: início e menor deslocamento visto
+    double window_start = -1.0;
+    double window_min = 0.0;
+
+    // Somatórios da regressão linear ponderada
+    double weight = 0.0, sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_xy = 0.0;
+    int windows = 0;
+
+   public:
+    // Registra um par (tempo local, tempo de mídia), ambos em segundos
+    void add(double local_seconds, double media_seconds);
+
+    // Descarta o histórico (por exemplo, quando o emissor reinicia)
+    void reset();
+
+    // Informa uma interrupção do relógio de mídia entre o último ponto e o
+    // próximo
+    void mark_gap();
+
+    // Deriva estimada (adimensional), 0 enquanto não houver janelas suficientes
+    double slope() const;
+};
+
+// Relógio do dispositivo de saída: amostras entregues vs tempo local.
+// Usado pela thread de reprodução e compartilhado por todos os fluxos, já
+// que todos tocam no mesmo dispositivo.
+class PlaybackClock {
+   private:
+    ClockDriftEstimator clock;
+    int64_t played_samples = 0;
+    double last_played = -1.0;
+    int last_frames = 0;
+
+   public:
+    // Informa que 'frames' amostras foram entregues ao dispositivo. Uma
+    // espera muito maior que a duração do bloco anterior (os jitter
+    // buffers esvaziaram e nada foi tocado) é uma interrupção.
+    void on_played(int frames);
+
+    // Deriva estimada do dispositivo (mesma convenção de ClockDriftEstimator)
+    double slope() const { return clock.slope(); }
+};
+
+// Compensação da deriva de relógio na reprodução de um fluxo.
+// Compara o relógio de quem envia (timestamps dos pacotes vs chegada) e o
+// relógio do dispositivo de saída (PlaybackClock) com o relógio local, e
+// ajusta um AsyncResampler para tocar exatamente na taxa em que o áudio
+// chega. Um pequeno termo proporcional à profundidade do jitter buffer
+// corrige o erro residual, mantendo a fila estável em chamadas longas sem
+// descartar quadros.
+class DriftCompensator {
+   private:
+    // Relógio do emissor, atualizado pela thread de recebimento
+    ClockDriftEstimator sender_clock;
+    std::atomic<double> sender_slope{0.0};
+    bool has_timestamp = false;
+    uint32_t last_timestamp = 0;
+    int64_t media_samples = 0;
+
+    // Sinaliza para a thread de reprodução que o emissor mudou
+    std::atomic<bool> sender_reset{false};
+
+    // Profundidade média do jitter buffer e a referência a ser mantida
+    double average_depth = -1.0;
+    double baseline_depth = -1.0;
+    int min_depth = -1, max_depth = 0;
+
+    // Razão aplicada no último quadro
+    double ratio = 1.0;
+
+    AsyncResampler resampler;
+    std::vector<float> input, output;
+
+   public:
+    DriftCompensator();
+
+    // Thread de recebimento: registra a chegada de um pacote de áudio com o
+    // timestamp de mídia do emissor
+    void on_packet(uint32_t timestamp);
+
+    // Thread de reprodução: converte um quadro PCM de FRAMES_PER_BUFFER
+    // amostras retirado do jitter buffer (que ficou com 'depth' quadros) e
+    // escreve em 'out'. 'playback_slope' é a deriva do dispositivo de saída
+    // (PlaybackClock::slope). Retorna o número de amostras produzidas, que
+    // varia em uma ou duas amostras em torno de FRAMES_PER_BUFFER.
+    int process(const char* in, char* out, int max_out, int depth,
+                double playback_slope);
+
+    // Imprime a deriva estimada e a faixa de profundidade do jitter buffer
+    // do fluxo 'stream', relativa ao dispositivo de saída
+    void print_stats(int stream, double playback_slope) const;
+};
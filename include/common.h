@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 // Taxa de amostragem, em Hertz (Hz), do áudio.
 constexpr int SAMPLE_RATE = 48000;
 
@@ -16,27 +18,108 @@ constexpr int NUM_CHANNELS = 1;
 constexpr int AUDIO_BUFFER_SIZE =
     FRAMES_PER_BUFFER * NUM_CHANNELS * SAMPLE_SIZE;
 
+// Tamanho do cabeçalho de um pacote de áudio: tipo (1 byte) + identificador
+// do fluxo (1 byte, recebido no LOGIN_OK) + camada (1 byte, AudioLayer) +
+// timestamp (4 bytes, big-endian, em amostras desde o início da captura)
+constexpr int AUDIO_HEADER_SIZE = 1 + 1 + 1 + 4;
+
+// Posição da camada e do timestamp no cabeçalho de um pacote de áudio
+constexpr int AUDIO_LAYER_OFFSET = 2;
+constexpr int AUDIO_TIMESTAMP_OFFSET = 3;
+
+// Camadas de qualidade do áudio (simulcast.h). Quem fala envia as três
+// juntas em um pacote LAYER_SIMULCAST, e o servidor repassa a cada ouvinte
+// só a camada que cabe na banda dele, sem nunca recodificar o áudio.
+enum AudioLayer : uint8_t {
+    LAYER_PCM48 = 0,          // PCM 16 bits a 48 kHz (768 kbit/s)
+    LAYER_PCM16K = 1,         // PCM 16 bits a 16 kHz (256 kbit/s)
+    LAYER_ULAW8K = 2,         // µ-law (8 bits) a 8 kHz (64 kbit/s)
+    LAYER_COUNT = 3,
+    LAYER_SIMULCAST = 3,      // As três camadas, nessa ordem
+    LAYER_SIMULCAST_16K = 4,  // Só as camadas de 16 kHz e 8 kHz
+};
+
+// Quadros de 20 ms em um pacote de áudio. Com a rede congestionada quem
+// fala junta até MAX_FRAMES_PER_PACKET quadros das camadas menores em um
+// pacote (congestion.h); o número de quadros vem do tamanho do áudio.
+constexpr int MAX_FRAMES_PER_PACKET = 3;
+
+// Bytes de um quadro de cada camada
+constexpr int LAYER_BYTES[LAYER_COUNT] = {
+    AUDIO_BUFFER_SIZE, FRAMES_PER_BUFFER / 3 * SAMPLE_SIZE,
+    FRAMES_PER_BUFFER / 6};
+
+// Maior áudio em um pacote: as três camadas juntas (os pacotes com vários
+// quadros nunca passam disso)
+constexpr int MAX_AUDIO_PAYLOAD =
+    LAYER_BYTES[LAYER_PCM48] + LAYER_BYTES[LAYER_PCM16K] +
+    LAYER_BYTES[LAYER_ULAW8K];
+
+// Tamanho máximo de um pacote do protocolo
+constexpr int MAX_PACKET_SIZE = AUDIO_HEADER_SIZE + MAX_AUDIO_PAYLOAD;
+
+// Token da sessão (session_token.h), recebido no LOGIN_OK. O cliente o
+// acrescenta ao final de cada pacote de áudio que envia ao servidor, que o
+// remove antes de repassar o pacote.
+constexpr int SESSION_TOKEN_SIZE = 8;
+
+// Cookie de login (rate_limit.h), enviado no LOGIN_COOKIE por um servidor
+// sob inundação e devolvido antes do nome no LOGIN_WITH_COOKIE
+constexpr int LOGIN_COOKIE_SIZE = 8;
+
+// Número máximo de participantes conectados a um servidor.
+constexpr int MAX_CLIENTS = 16;
+
+// Número máximo de servidores interligados em uma chamada (trunk.h). Cada
+// servidor usa um bloco de MAX_CLIENTS identificadores de fluxo, a partir
+// de VOIP_RELAY_ID * MAX_CLIENTS.
+constexpr int MAX_RELAYS = 4;
+
+// Número de identificadores de fluxo (0 a MAX_STREAMS - 1)
+constexpr int MAX_STREAMS = MAX_RELAYS * MAX_CLIENTS;
+
 // Define a porta padrão para o servidor de áudio
 constexpr int PORT = 12345;
 
 // Tempo máximo de espera para receber pacotes do servidor
 constexpr int CLIENT_TIMEOUT_SEC = 1;
 
+// Intervalo entre os reenvios do login enquanto o LOGIN_OK não chega (o
+// pedido ou a confirmação pode se perder)
+constexpr int LOGIN_RETRY_MS = 200;
+
 // Define o tamanho máximo para o nome do cliente
 constexpr int MAX_NAME_LENGTH = 50;
 
 // Tempo de espera para encontrar o servidor na rede local
 constexpr int DISCOVERY_TIMEOUT_SEC = 10;
 
+// Grupo multicast em que os servidores escutam pedidos de descoberta
+// (escopo local da organização, na mesma porta PORT)
+constexpr const char* DISCOVERY_MULTICAST_GROUP = "239.255.42.99";
+
+// Janela, após a primeira resposta, para coletar os demais servidores
+constexpr int DISCOVERY_WINDOW_MS = 300;
+
+// Identificador aleatório enviado no pedido de descoberta e devolvido pelo
+// servidor na resposta
+constexpr int DISCOVERY_NONCE_SIZE = 8;
+
 // Define um protocolo simples com um cabeçalho de 1 byte
 enum PacketType : char {
     LOGIN_REQUEST = 0x01,       // Cliente envia nome para conectar
     AUDIO_DATA = 0x02,          // Pacote de áudio
     SERVER_MESSAGE = 0x03,      // Servidor envia notificação
-    LOGIN_OK = 0x04,            // Servidor confirma conexão
+    LOGIN_OK = 0x04,            // Servidor confirma (+ id do fluxo e token)
     SERVER_FULL = 0x05,         // Servidor informa que está cheio
     DISCOVERY_REQUEST = 0x06,   // Cliente procura por um servidor
     DISCOVERY_RESPONSE = 0x07,  // Servidor responde que está ativo
     KEEPALIVE_PONG = 0x08,      // Ping para manter a conexão ativa
     LOGOUT_NOTICE = 0x09,       // Cliente avisa desconexão
+    SERVER_BUSY = 0x0A,         // Servidor sobrecarregado recusa o login
+    TRUNK_DATA = 0x0B,          // Quadros de vários locutores entre servidores
+    RECEIVER_REPORT = 0x0C,     // Cliente informa banda e recepção
+    SENDER_FEEDBACK = 0x0D,     // Recepção do fluxo, devolvida a quem fala
+    LOGIN_COOKIE = 0x0E,        // Servidor pede o login de novo com o cookie
+    LOGIN_WITH_COOKIE = 0x0F,   // Cliente repete o login com o cookie
 };
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "common.h"
+
+// Controle de congestionamento.
+// Cada ouvinte mede, por locutor, a perda de quadros (pelos timestamps), o
+// jitter entre chegadas (como no RTCP, RFC 3550) e o gradiente do atraso
+// (quanto o atraso médio de um intervalo cresceu em relação ao anterior:
+// filas enchendo antes de a perda começar). Uma vez por segundo essas
+// estatísticas vão ao servidor no RECEIVER_REPORT.
+//
+// O servidor usa o relatório de duas formas:
+//   - A perda média entre os locutores de um ouvinte estima a perda no
+//     trecho servidor -> ouvinte (comum a todos os fluxos que ele recebe).
+//     Com ela o servidor estima a banda do ouvinte (CapacityEstimator) e
+//     escolhe a camada do simulcast que ele recebe.
+//   - A menor perda de um locutor entre todos os ouvintes é a perda no
+//     trecho locutor -> servidor. O servidor junta os relatórios por fluxo
+//     e devolve o resultado a quem fala (SENDER_FEEDBACK), diretamente ou
+//     pelo servidor de origem, se o locutor estiver em outro servidor.
+//
+// Quem fala roda o CongestionController: com perda ou atraso crescendo,
+// envia menos camadas e junta mais quadros por pacote (menos pacotes e
+// menos cabeçalhos); com a rede limpa por alguns segundos, volta um nível.
+
+// Intervalo entre relatórios
+constexpr int FEEDBACK_INTERVAL_MS = 1000;
+
+// Limites usados para considerar a rede congestionada ou livre
+constexpr double CONGESTION_LOSS = 0.10;
+constexpr double CLEAR_LOSS = 0.02;
+constexpr double OVERUSE_GRADIENT_MS = 10.0;
+
+// Estatísticas de recepção de um fluxo em um intervalo
+struct StreamFeedback {
+    int stream;
+    double loss;         // Fração dos quadros perdidos (0 a 1)
+    double jitter_ms;    // Jitter entre chegadas
+    double gradient_ms;  // Variação do atraso médio desde o intervalo anterior
+};
+
+// Bytes de uma entrada no RECEIVER_REPORT e no SENDER_FEEDBACK:
+// [fluxo][perda (1/255)][jitter (0,1 ms, 2 bytes)][gradiente (0,1 ms, 2 bytes
+// com sinal)], inteiros big-endian
+constexpr int FEEDBACK_ENTRY_SIZE = 1 + 1 + 2 + 2;
+
+// Cabeçalho do RECEIVER_REPORT: [tipo][banda máxima em kbit/s (4 bytes)]
+// [número de entradas], seguido das entradas
+constexpr int RECEIVER_REPORT_HEADER_SIZE = 1 + 4 + 1;
+
+void write_feedback(const StreamFeedback& feedback, char* out);
+StreamFeedback read_feedback(const char* in);
+
+// Lado de quem ouve: estatísticas de recepção de um locutor
+class ReceiveStats {
+   private:
+    bool started = false;
+    // Timestamp de referência e o próximo quadro esperado
+    uint32_t base_timestamp = 0;
+    uint32_t next_timestamp = 0;
+    // Primeiro quadro esperado no intervalo e quadros recebidos nele
+    uint32_t interval_start = 0;
+    int received = 0;
+    // Trânsito (chegada menos timestamp) do último pacote, jitter e soma
+    // dos trânsitos do intervalo, em ms
+    double last_transit = 0.0;
+    double jitter = 0.0;
+    double transit_sum = 0.0;
+    double previous_mean = 0.0;
+    bool has_previous = false;
+
+   public:
+    // Registra um pacote com 'frames' quadros, o primeiro com 'timestamp',
+    // que chegou em 'arrival_ms'
+    void on_packet(uint32_t timestamp, int frames, double arrival_ms);
+
+    // Fecha o intervalo. Retorna false se nenhum pacote chegou nele.
+    bool take_report(int stream, StreamFeedback& report);
+};
+
+// Como quem fala envia: formato do áudio (AudioLayer) e quadros por pacote
+struct SendMode {
+    int format;
+    int frames;
+};
+
+// Camadas que quem fala envia (VOIP_SIMULCAST)
+enum SimulcastMode {
+    SIMULCAST_OFF,  // Uma camada só: PCM de 48 kHz com a rede livre
+    SIMULCAST_16K,  // Camadas de 16 kHz e 8 kHz (padrão, cabe na MTU)
+    SIMULCAST_48K,  // As três camadas, em pacotes fragmentados
+};
+
+// Lado de quem fala: escolhe o modo de envio pela recepção do nosso fluxo
+class CongestionController {
+   private:
+    std::mutex mutex;
+    std::atomic<int> level{0};
+
+    // Relatórios do intervalo atual: a menor perda e o menor gradiente (o
+    // trecho até o servidor é comum a todos os ouvintes)
+    std::chrono::steady_clock::time_point window_start;
+    bool window_has_report = false;
+    double window_loss = 0.0;
+    double window_gradient = 0.0;
+
+    std::chrono::steady_clock::time_point last_change;
+    int clear_windows = 0;
+
+   public:
+    // Registra um SENDER_FEEDBACK do nosso fluxo
+    void on_feedback(const StreamFeedback& feedback,
+                     std::chrono::steady_clock::time_point now);
+
+    // Modo de envio atual para as camadas escolhidas em 'simulcast'
+    SendMode mode(SimulcastMode simulcast) const;
+};
+
+// Lado do servidor: banda estimada de um ouvinte
+class CapacityEstimator {
+   private:
+    // 0 enquanto não houve congestionamento (sem limite)
+    double estimate_kbps = 0.0;
+    uint64_t bytes_sent = 0;
+    std::chrono::steady_clock::time_point interval_start;
+
+   public:
+    // Conta os bytes enviados ao ouvinte
+    void on_sent(size_t bytes) { bytes_sent += bytes; }
+
+    // Atualiza com a perda e o gradiente do trecho servidor -> ouvinte
+    void on_report(double loss, double gradient_ms,
+                   std::chrono::steady_clock::time_point now);
+
+    // Banda estimada em kbit/s (0 = sem limite)
+    int kbps() const { return static_cast<int>(estimate_kbps); }
+
+    void reset();
+};
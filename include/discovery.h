@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+// Servidor encontrado na rede local e o tempo de ida e volta medido
+struct DiscoveredServer {
+    std::string ip;
+    double rtt_ms;
+};
+
+// Procura servidores na rede local.
+// Envia um DISCOVERY_REQUEST para o grupo multicast DISCOVERY_MULTICAST_GROUP
+// (e por broadcast, para redes que filtram multicast) e coleta todas as
+// respostas que chegarem até DISCOVERY_WINDOW_MS após a primeira, esperando
+// no máximo timeout_ms por ela. Retorna os servidores ordenados pelo RTT.
+std::vector<DiscoveredServer> discover_servers(
+    int timeout_ms = DISCOVERY_TIMEOUT_SEC * 1000);
+
+// Pergunta diretamente a cada servidor da lista (unicast) se está ativo e
+// retorna o primeiro que responder em até timeout_ms, ou uma lista vazia
+std::vector<DiscoveredServer> probe_servers(
+    const std::vector<DiscoveredServer>& servers, int timeout_ms);
+
+// Lê e grava a lista de servidores em cache no disco. O arquivo fica em
+// VOIP_SERVER_CACHE, ou em ~/.simple_voip_servers (%APPDATA% no Windows).
+std::vector<DiscoveredServer> load_server_cache();
+bool save_server_cache(const std::vector<DiscoveredServer>& servers);
+
+// Função para descobrir o IP do servidor na rede local.
+// Se algum servidor em cache responder, retorna o primeiro a responder e
+// atualiza o cache em segundo plano; senão faz a descoberta e grava o
+// resultado.
+std::string discover_server_on_network();
+
+// Aguarda a atualização do cache em segundo plano (chamada antes de sair)
+void wait_for_discovery_refresh();
@@ -0,0 +1,192 @@
+#pragma once
+
+// Kernels vetorizados usados no processamento de áudio.
+// Cada função tem uma versão SSE (x86), NEON (ARM) e uma versão escalar de
+// reserva, escolhidas em tempo de compilação. Os espectros usam o formato
+// SoA (reais e imaginários separados), como produzido por FFT; o áudio PCM
+// usa int16_t.
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VOIP_SIMD_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VOIP_SIMD_NEON 1
+#endif
+
+// acc += a * b (multiplicação complexa acumulada)
+inline void complex_mac(float* acc_re, float* acc_im, const float* a_re,
+                        const float* a_im, const float* b_re,
+                        const float* b_im, int n) {
+    int i = 0;
+#if defined(VOIP_SIMD_SSE)
+    for (; i + 4 <= n; i += 4) {
+        __m128 ar = _mm_loadu_ps(a_re + i), ai = _mm_loadu_ps(a_im + i);
+        __m128 br = _mm_loadu_ps(b_re + i), bi = _mm_loadu_ps(b_im + i);
+        __m128 re = _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+        __m128 im = _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+        _mm_storeu_ps(acc_re + i, _mm_add_ps(_mm_loadu_ps(acc_re + i), re));
+        _mm_storeu_ps(acc_im + i, _mm_add_ps(_mm_loadu_ps(acc_im + i), im));
+    }
+#elif defined(VOIP_SIMD_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t ar = vld1q_f32(a_re + i), ai = vld1q_f32(a_im + i);
+        float32x4_t br = vld1q_f32(b_re + i), bi = vld1q_f32(b_im + i);
+        float32x4_t re = vmlsq_f32(vmlaq_f32(vld1q_f32(acc_re + i), ar, br),
+                                   ai, bi);
+        float32x4_t im = vmlaq_f32(vmlaq_f32(vld1q_f32(acc_im + i), ar, bi),
+                                   ai, br);
+        vst1q_f32(acc_re + i, re);
+        vst1q_f32(acc_im + i, im);
+    }
+#endif
+    for (; i < n; ++i) {
+        acc_re[i] += a_re[i] * b_re[i] - a_im[i] * b_im[i];
+        acc_im[i] += a_re[i] * b_im[i] + a_im[i] * b_re[i];
+    }
+}
+
+// acc += conj(a) * b * scale (usado no gradiente dos filtros adaptativos)
+inline void complex_conj_mac_scaled(float* acc_re, float* acc_im,
+                                    const float* a_re, const float* a_im,
+                                    const float* b_re, const float* b_im,
+                                    const float* scale, int n) {
+    int i = 0;
+#if defined(VOIP_SIMD_SSE)
+    for (; i + 4 <= n; i += 4) {
+        __m128 ar = _mm_loadu_ps(a_re + i), ai = _mm_loadu_ps(a_im + i);
+        __m128 br = _mm_loadu_ps(b_re + i), bi = _mm_loadu_ps(b_im + i);
+        __m128 s = _mm_loadu_ps(scale + i);
+        __m128 re = _mm_add_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi));
+        __m128 im = _mm_sub_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br));
+        _mm_storeu_ps(acc_re + i,
+                      _mm_add_ps(_mm_loadu_ps(acc_re + i), _mm_mul_ps(re, s)));
+        _mm_storeu_ps(acc_im + i,
+                      _mm_add_ps(_mm_loadu_ps(acc_im + i), _mm_mul_ps(im, s)));
+    }
+#elif defined(VOIP_SIMD_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t ar = vld1q_f32(a_re + i), ai = vld1q_f32(a_im + i);
+        float32x4_t br = vld1q_f32(b_re + i), bi = vld1q_f32(b_im + i);
+        float32x4_t s = vld1q_f32(scale + i);
+        float32x4_t re = vmlaq_f32(vmulq_f32(ar, br), ai, bi);
+        float32x4_t im = vmlsq_f32(vmulq_f32(ar, bi), ai, br);
+        vst1q_f32(acc_re + i, vmlaq_f32(vld1q_f32(acc_re + i), re, s));
+        vst1q_f32(acc_im + i, vmlaq_f32(vld1q_f32(acc_im + i), im, s));
+    }
+#endif
+    for (; i < n; ++i) {
+        acc_re[i] += (a_re[i] * b_re[i] + a_im[i] * b_im[i]) * scale[i];
+        acc_im[i] += (a_re[i] * b_im[i] - a_im[i] * b_re[i]) * scale[i];
+    }
+}
+
+// re *= gain, im *= gain (aplica um ganho real a cada raia do espectro)
+inline void apply_spectral_gain(float* re, float* im, const float* gain,
+                                int n) {
+    int i = 0;
+#if defined(VOIP_SIMD_SSE)
+    for (; i + 4 <= n; i += 4) {
+        __m128 g = _mm_loadu_ps(gain + i);
+        _mm_storeu_ps(re + i, _mm_mul_ps(_mm_loadu_ps(re + i), g));
+        _mm_storeu_ps(im + i, _mm_mul_ps(_mm_loadu_ps(im + i), g));
+    }
+#elif defined(VOIP_SIMD_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t g = vld1q_f32(gain + i);
+        vst1q_f32(re + i, vmulq_f32(vld1q_f32(re + i), g));
+        vst1q_f32(im + i, vmulq_f32(vld1q_f32(im + i), g));
+    }
+#endif
+    for (; i < n; ++i) {
+        re[i] *= gain[i];
+        im[i] *= gain[i];
+    }
+}
+
+// Produto escalar de dois vetores (usado pelos filtros FIR)
+inline float dot_product(const float* a, const float* b, int n) {
+    int i = 0;
+    float sum = 0.0f;
+#if defined(VOIP_SIMD_SSE)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm_add_ps(acc,
+                         _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(VOIP_SIMD_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4) {
+        acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, acc);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+// Ganho unitário no formato Q15 usado por mix_pcm16 (1.0 = 32768)
+constexpr int PCM16_UNITY_GAIN = 32768;
+
+// acc += in * gain / 32768, com saturação em 16 bits (mixagem de PCM).
+// Com gain >= PCM16_UNITY_GAIN a soma é direta; abaixo disso o produto é
+// arredondado para baixo, como um deslocamento aritmético de 15 bits.
+inline void mix_pcm16(int16_t* acc, const int16_t* in, int gain, int n) {
+    int i = 0;
+    if (gain >= PCM16_UNITY_GAIN) {
+#if defined(VOIP_SIMD_SSE)
+        for (; i + 8 <= n; i += 8) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i*>(acc + i));
+            __m128i b =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i),
+                             _mm_adds_epi16(a, b));
+        }
+#elif defined(VOIP_SIMD_NEON)
+        for (; i + 8 <= n; i += 8) {
+            vst1q_s16(acc + i,
+                      vqaddq_s16(vld1q_s16(acc + i), vld1q_s16(in + i)));
+        }
+#endif
+        for (; i < n; ++i) {
+            int sum = acc[i] + in[i];
+            acc[i] = static_cast<int16_t>(
+                sum > 32767 ? 32767 : (sum < -32768 ? -32768 : sum));
+        }
+        return;
+    }
+
+    if (gain < 0) gain = 0;
+#if defined(VOIP_SIMD_SSE)
+    // (in * gain) >> 15 a partir das metades alta e baixa do produto
+    const __m128i g = _mm_set1_epi16(static_cast<int16_t>(gain));
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i*>(acc + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i scaled =
+            _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epi16(b, g), 1),
+                         _mm_srli_epi16(_mm_mullo_epi16(b, g), 15));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i),
+                         _mm_adds_epi16(a, scaled));
+    }
+#elif defined(VOIP_SIMD_NEON)
+    // vqdmulh calcula (2 * in * gain) >> 16 = (in * gain) >> 15
+    const int16x8_t g = vdupq_n_s16(static_cast<int16_t>(gain));
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t scaled = vqdmulhq_s16(vld1q_s16(in + i), g);
+        vst1q_s16(acc + i, vqaddq_s16(vld1q_s16(acc + i), scaled));
+    }
+#endif
+    for (; i < n; ++i) {
+        int sum = acc[i] + ((in[i] * gain) >> 15);
+        acc[i] = static_cast<int16_t>(
+            sum > 32767 ? 32767 : (sum < -32768 ? -32768 : sum));
+    }
+}
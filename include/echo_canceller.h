@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "common.h"
+#include "fft.h"
+
+// Tamanho do bloco do filtro adaptativo, em amostras (1,33 ms a 48 kHz).
+// Blocos curtos mantêm o atraso do cancelador baixo; o quadro de 20 ms é
+// dividido em FRAMES_PER_BUFFER / AEC_BLOCK_SIZE blocos.
+constexpr int AEC_BLOCK_SIZE = 64;
+
+// Tamanho da FFT usada pelo filtro (overlap-save com 50% de sobreposição)
+constexpr int AEC_FFT_SIZE = 2 * AEC_BLOCK_SIZE;
+
+// Comprimento máximo do caminho de eco (atraso do dispositivo + reverberação)
+constexpr int AEC_TAIL_MS = 128;
+
+// Número de partições do filtro
+constexpr int AEC_PARTITIONS =
+    AEC_TAIL_MS * SAMPLE_RATE / 1000 / AEC_BLOCK_SIZE;
+
+// Quantidade máxima de amostras de referência guardadas (500 ms)
+constexpr int AEC_REFERENCE_CAPACITY = SAMPLE_RATE / 2;
+
+// Blocos em um quadro de áudio
+constexpr int AEC_FRAME_BLOCKS = FRAMES_PER_BUFFER / AEC_BLOCK_SIZE;
+
+// Maior atraso entre a referência e o eco procurado pelo estimador, nos dois
+// sentidos, em blocos (o tamanho da fila de referência)
+constexpr int AEC_DELAY_MAX_BLOCKS = AEC_REFERENCE_CAPACITY / AEC_BLOCK_SIZE;
+
+// Posição do eco no filtro depois de um alinhamento, em blocos (~10 ms):
+// folga para o atraso variar um pouco sem sair do filtro
+constexpr int AEC_DELAY_TARGET_BLOCKS = 8;
+
+static_assert(FRAMES_PER_BUFFER % AEC_BLOCK_SIZE == 0,
+              "O quadro de áudio deve conter um número inteiro de blocos");
+static_assert(AEC_REFERENCE_CAPACITY % AEC_BLOCK_SIZE == 0,
+              "A fila de referência deve conter um número inteiro de blocos");
+
+// Cancelador de eco acústico (AEC).
+// Remove do áudio capturado pelo microfone o som que saiu dos alto-falantes.
+// Usa um filtro adaptativo NLMS particionado no domínio da frequência
+// (PBFDAF): o caminho de eco é modelado por AEC_PARTITIONS blocos de
+// coeficientes, cada um multiplicado pelo espectro do sinal de referência
+// correspondente. A adaptação é congelada quando o detector de fala dupla
+// (Geigel) percebe que o usuário local está falando ao mesmo tempo.
+//
+// O filtro só cobre AEC_TAIL_MS de atraso, mas o atraso entre a referência
+// e o eco no microfone depende de quando a reprodução começou em relação à
+// captura e dos buffers de cada dispositivo. Um estimador correlaciona a
+// energia de cada bloco do microfone com a da referência em até
+// AEC_DELAY_MAX_BLOCKS blocos de atraso, nos dois sentidos. Com um atraso
+// confirmado fora do filtro, a referência é realinhada: as amostras
+// adiantadas são descartadas da fila, ou a referência é atrasada com
+// silêncio, até o eco cair AEC_DELAY_TARGET_BLOCKS blocos depois do início
+// do filtro, que recomeça a adaptação.
+//
+// push_reference() é chamado pela thread de reprodução, process() pela thread
+// de envio; a fila de referência é protegida por um mutex.
+class EchoCanceller {
+   private:
+    // Fila circular com as amostras enviadas aos alto-falantes
+    std::vector<float> reference_ring;
+    size_t reference_read = 0;
+    size_t reference_count = 0;
+    std::mutex reference_mutex;
+
+    // Amostras de referência entregues desde o início, e as que ainda devem
+    // ser descartadas ou substituídas por silêncio no realinhamento
+    uint64_t reference_pushed = 0;
+    size_t reference_skip = 0;
+    size_t reference_stall = 0;
+
+    // Energia de cada bloco de referência entregue, sem a média recente,
+    // em fila circular pela posição absoluta do bloco
+    std::vector<float> far_envelope;
+    float far_envelope_mean = 0.0f;
+
+    // Estimador de atraso (thread de envio): cópia da energia da referência
+    // em torno do quadro atual, correlação com o microfone em cada atraso e
+    // as potências usadas na normalização
+    std::vector<float> envelope_window;
+    std::vector<float> lag_correlation;
+    float near_envelope_mean = 0.0f;
+    float near_envelope_power = 0.0f;
+    float far_envelope_power = 0.0f;
+    long delay_observations = 0;
+    int delay_candidate = 0;
+    int delay_confirmations = 0;
+
+    // Atraso do eco em relação à referência usada pelo filtro, em blocos,
+    // e o deslocamento total aplicado à referência (positivo = descartada)
+    int echo_delay_blocks = -1;
+    long reference_shift_blocks = 0;
+    int delay_adjustments = 0;
+
+    FFT fft;
+    int bins;
+
+    // Referência do quadro atual e a metade anterior da janela da FFT
+    std::vector<float> far_frame;
+    std::vector<float> far_previous;
+
+    // Espectros das últimas AEC_PARTITIONS janelas de referência, em fila
+    // circular ('far_head' aponta para a mais recente)
+    std::vector<float> far_re, far_im;
+    int far_head = 0;
+
+    // Potência de cada raia em cada partição e a soma delas, que normaliza
+    // o passo do NLMS
+    std::vector<float> far_magnitude;
+    std::vector<float> far_power;
+
+    // Coeficientes do filtro no domínio da frequência, um bloco por partição
+    std::vector<float> weight_re, weight_im;
+
+    // Próxima partição a ter o gradiente restringido (round-robin)
+    int constrain_index = 0;
+
+    // Áreas de trabalho de um bloco
+    std::vector<float> echo_re, echo_im;
+    std::vector<float> error_re, error_im;
+    std::vector<float> step;
+    std::vector<float> time_buffer;
+    std::vector<float> error_block;
+
+    // Pico da referência em cada um dos últimos blocos (detector Geigel)
+    std::vector<float> far_peaks;
+    int far_peak_index = 0;
+
+    // Blocos restantes com a adaptação congelada por fala dupla
+    int double_talk_hold = 0;
+
+    // Estatísticas de atenuação
+    long double_talk_blocks = 0;
+    double near_energy = 0.0;
+    double error_energy = 0.0;
+
+    // Copia um quadro de referência para 'far_frame' (silêncio se faltar) e
+    // a energia da referência em torno dele para 'envelope_window'
+    void pull_reference();
+
+    // Acrescenta à correlação o bloco 'block' do quadro capturado
+    void observe_delay(int block, const float* near);
+
+    // Com um atraso confirmado fora do filtro, realinha a referência
+    void update_alignment();
+
+    // Zera o filtro e o estimador depois de um realinhamento
+    void reset_filter();
+
+    // Processa um bloco de AEC_BLOCK_SIZE amostras
+    void process_block(const float* far, const float* near, float* out);
+
+   public:
+    EchoCanceller();
+
+    // Entrega à fila de referência o quadro de FRAMES_PER_BUFFER amostras
+    // que acabou de ser enviado aos alto-falantes.
+    void push_reference(const float* samples);
+
+    // Remove o eco de um quadro de FRAMES_PER_BUFFER amostras capturadas
+    // (in-place)
+    void process(float* samples);
+
+    // Imprime a atenuação do eco obtida e o alinhamento da referência
+    void print_stats() const;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+// Transformada rápida de Fourier (FFT) para sinais reais.
+// Implementa uma FFT radix-2 de tamanho potência de dois, usada pelos módulos
+// de processamento de áudio (cancelamento de eco, supressão de ruído).
+//
+// O espectro é armazenado em formato "SoA" (partes reais e imaginárias em
+// vetores separados), o que permite que os kernels em dsp_simd.h processem
+// várias raias de frequência por instrução.
+class FFT {
+   private:
+    // Tamanho da transformada (número de amostras reais)
+    int n;
+
+    // Metade do tamanho, a FFT real é calculada com uma FFT complexa de n/2
+    int half;
+
+    // Tabela de inversão de bits para a FFT complexa de tamanho 'half'
+    std::vector<int> bit_reverse;
+
+    // Fatores de rotação (twiddles) da FFT complexa de tamanho 'half'
+    std::vector<float> twiddle_re, twiddle_im;
+
+    // Fatores de rotação usados para separar o espectro real
+    std::vector<float> split_re, split_im;
+
+    // Área de trabalho, alocada uma única vez no construtor
+    std::vector<float> work_re, work_im;
+
+    // FFT complexa in-place de tamanho 'half' (sem normalização)
+    void complex_fft(float* re, float* im) const;
+
+   public:
+    // Cria uma FFT de 'size' amostras (potência de dois, no mínimo 4)
+    explicit FFT(int size);
+
+    // Número de amostras reais da transformada
+    int size() const { return n; }
+
+    // Número de raias do espectro (n/2 + 1)
+    int bins() const { return half + 1; }
+
+    // Calcula o espectro de 'n' amostras reais de 'in' e armazena as
+    // 'bins()' raias em 're' e 'im'.
+    void forward(const float* in, float* re, float* im);
+
+    // Reconstrói 'n' amostras reais a partir de 'bins()' raias.
+    // É o inverso exato de forward(), já normalizado.
+    void inverse(const float* re, const float* im, float* out);
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "common.h"
+
+// Pool de quadros de tamanho fixo, para que o caminho do áudio e das
+// mensagens de controle não passe pelo heap a cada pacote.
+//
+// Todos os blocos são reservados de uma vez no construtor. Cada thread
+// guarda até FRAME_POOL_CACHE_SIZE blocos livres num cache próprio, sem
+// sincronização; quando o cache esvazia ou enche, metade dele é trocada
+// com a lista livre global, uma pilha sem travas (Treiber) cujo topo leva
+// um contador de versão junto do índice, contra o problema ABA. Como os
+// quadros costumam ser alocados por uma thread (recepção) e liberados por
+// outra (reprodução), os blocos circulam entre os caches pela lista global.
+//
+// Um FrameRef é a referência a um bloco, com contagem atômica: cópias
+// compartilham o bloco, movimentos só passam a referência adiante (é assim
+// que um quadro vai de uma thread para outra), e o último a soltar o bloco
+// o devolve ao pool. Com o pool esgotado, o bloco vem do heap e é contado
+// em fallbacks(): o áudio continua, e o número indica que o pool é pequeno.
+//
+// Os caches das threads são devolvidos quando elas terminam. Um pool criado
+// à parte (como nos microbenchmarks) deve sobreviver a todos os seus
+// quadros; o pool global nunca é destruído.
+
+// Bytes de cada bloco: o maior pacote do protocolo
+constexpr int FRAME_POOL_BLOCK_SIZE = MAX_PACKET_SIZE;
+
+// Blocos do pool global: 16 jitter buffers cheios mais os caches
+constexpr int FRAME_POOL_DEFAULT_BLOCKS = 1152;
+
+// Blocos livres guardados por thread
+constexpr int FRAME_POOL_CACHE_SIZE = 32;
+
+class FramePool;
+
+// Bloco do pool: cabeçalho e dados
+struct FrameBlock {
+    std::atomic<uint32_t> refs{0};
+    std::atomic<uint32_t> next{0};  // Próximo na lista livre (índice + 1)
+    uint32_t size = 0;
+    uint32_t index = 0;
+    FramePool* pool = nullptr;  // nullptr: bloco do heap (pool esgotado)
+    char data[FRAME_POOL_BLOCK_SIZE];
+};
+
+// Referência contada a um bloco
+class FrameRef {
+   private:
+    FrameBlock* block = nullptr;
+
+    explicit FrameRef(FrameBlock* block) : block(block) {}
+    friend class FramePool;
+
+   public:
+    FrameRef() = default;
+    FrameRef(const FrameRef& other);
+    FrameRef(FrameRef&& other) noexcept : block(other.block) {
+        other.block = nullptr;
+    }
+    FrameRef& operator=(const FrameRef& other);
+    FrameRef& operator=(FrameRef&& other) noexcept;
+    ~FrameRef() { reset(); }
+
+    // Solta o bloco (devolvido ao pool se esta era a última referência)
+    void reset();
+
+    explicit operator bool() const { return block != nullptr; }
+
+    char* data() { return block->data; }
+    const char* data() const { return block->data; }
+    size_t size() const { return block ? block->size : 0; }
+    static constexpr size_t capacity() { return FRAME_POOL_BLOCK_SIZE; }
+    std::string_view view() const { return {data(), size()}; }
+
+    // Define o tamanho usado (até capacity())
+    void resize(size_t size) {
+        block->size = static_cast<uint32_t>(size < capacity() ? size
+                                                              : capacity());
+    }
+
+    // Acrescenta bytes ao final, cortando no que couber. Retorna false se
+    // algo foi cortado.
+    bool append(std::string_view bytes);
+    bool append(char byte) { return append(std::string_view(&byte, 1)); }
+
+    // Referências ao bloco (para diagnóstico)
+    uint32_t use_count() const {
+        return block ? block->refs.load(std::memory_order_relaxed) : 0;
+    }
+};
+
+class FramePool {
+   private:
+    FrameBlock* blocks;
+    uint32_t block_count;
+
+    // Topo da lista livre: versão nos 32 bits altos, índice + 1 nos baixos
+    // (0 = vazia)
+    std::atomic<uint64_t> free_head{0};
+    std::atomic<uint64_t> heap_blocks{0};
+
+    void push_global(FrameBlock* block);
+    FrameBlock* pop_global();
+
+    friend class FrameRef;
+    friend struct FramePoolCache;
+    void release(FrameBlock* block);
+
+   public:
+    explicit FramePool(uint32_t count = FRAME_POOL_DEFAULT_BLOCKS);
+    ~FramePool();
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Um bloco vazio (size() == 0) com uma referência
+    FrameRef allocate();
+
+    // Um bloco com uma cópia de 'bytes' (cortados em capacity())
+    FrameRef copy(std::string_view bytes);
+
+    uint32_t capacity() const { return block_count; }
+
+    // Blocos que vieram do heap porque o pool estava esgotado
+    uint64_t fallbacks() const {
+        return heap_blocks.load(std::memory_order_relaxed);
+    }
+
+    // Avisa, no encerramento, se o pool se esgotou em algum momento
+    void print_stats() const;
+};
+
+// Pool usado pelo jitter buffer do cliente e pelas mensagens do servidor
+extern FramePool& frame_pool;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+
+#include "common.h"
+#include "server_handler.h"
+
+// Troca do servidor sem derrubar as chamadas.
+// O servidor em execução escuta em um socket Unix (VOIP_HANDOFF_SOCKET, por
+// padrão em XDG_RUNTIME_DIR ou num diretório 0700 do usuário em /tmp). Um
+// novo processo iniciado com VOIP_TAKEOVER=1, do mesmo usuário (verificado
+// pelas credenciais do socket), conecta nele e recebe, em uma única
+// mensagem, o socket UDP já vinculado à porta (SCM_RIGHTS) e uma cópia da
+// tabela de sessões. O processo antigo para de ler o socket no instante da
+// entrega e encerra; os pacotes que chegam nesse meio tempo esperam no
+// buffer do próprio socket, que é o mesmo nos dois processos, e são lidos
+// pelo novo.
+//
+// Disponível apenas em sistemas Unix; no Windows as funções falham.
+
+// Caminho do socket Unix de troca
+std::string handoff_socket_path();
+
+// Caminho em que o processo novo abre o seu socket de troca antes de
+// assumir (o caminho normal ainda é do processo antigo)
+std::string handoff_staging_path(const std::string& path);
+
+// Abre o socket Unix em que este processo aceita um sucessor. Retorna o
+// descritor (não bloqueante) ou -1 em caso de erro.
+int handoff_listen(const std::string& path);
+
+// Processo novo: depois de assumir, move o socket aberto em 'staging' para
+// o caminho normal, substituindo o do processo antigo
+bool handoff_activate(const std::string& staging, const std::string& path);
+
+// Processo antigo: aceita o sucessor conectado em 'listener' e entrega o
+// socket UDP e as sessões. Espera a confirmação por no máximo alguns
+// milissegundos, já que roda na thread do servidor. Retorna true se a
+// entrega foi concluída; nesse caso o processo deve parar de usar o socket
+// e encerrar.
+bool handoff_send(int listener, int udp_sock,
+                  const ClientInfo clients[MAX_CLIENTS]);
+
+// Processo novo: conecta ao processo antigo em 'path' e recebe o socket UDP
+// e as sessões. Deve ser chamada com o processo já pronto para servir, para
+// confirmar logo após receber. Retorna o descritor do socket UDP ou -1 em
+// caso de erro.
+int handoff_receive(const std::string& path, ClientInfo clients[MAX_CLIENTS]);
+
+// Fecha o socket de troca; 'remove_path' apaga o arquivo (encerramento
+// normal, sem sucessor)
+void handoff_close(int listener, const std::string& path, bool remove_path);
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Emulação de uma rede ruim para testes (perda, atraso, jitter, reordenação,
+// duplicação e limite de banda), usada pelo emulador_rede entre os clientes
+// e o servidor.
+//
+// Cada sentido do tráfego é um ImpairedLink: o pacote passa primeiro pela
+// perda (aleatória e/ou em rajadas, pelo modelo de Gilbert-Elliott), depois
+// pela fila do gargalo (limite de banda, com descarte quando a fila passa de
+// 'queue_ms') e por fim pelo atraso de propagação com jitter. A ordem dos
+// pacotes é mantida, exceto os escolhidos para reordenação, que chegam
+// IMPAIR_REORDER_MS depois e são ultrapassados pelos seguintes.
+//
+// Todas as decisões aleatórias saem de um gerador com semente fixa, na
+// ordem dos pacotes: a mesma semente e o mesmo tráfego produzem as mesmas
+// perdas, atrasos e reordenações, o que torna os testes reproduzíveis.
+
+// Atraso extra de um pacote reordenado: um quadro de áudio e meio
+constexpr int IMPAIR_REORDER_MS = 30;
+
+// Intervalo entre um pacote e a sua cópia duplicada
+constexpr int IMPAIR_DUPLICATE_MS = 1;
+
+// Fila máxima do gargalo, se o perfil não definir
+constexpr int IMPAIR_DEFAULT_QUEUE_MS = 200;
+
+// Condições de um sentido da rede
+struct ImpairmentProfile {
+    std::string name;
+
+    // Perda aleatória, no estado bom do modelo de Gilbert-Elliott (0 a 1)
+    double loss = 0.0;
+
+    // Rajadas (Gilbert-Elliott): probabilidade, por pacote, de passar do
+    // estado bom para o ruim e de voltar, e a perda no estado ruim
+    double burst_enter = 0.0;
+    double burst_exit = 1.0;
+    double burst_loss = 1.0;
+
+    // Atraso de propagação e jitter (desvio padrão), em ms
+    double delay_ms = 0.0;
+    double jitter_ms = 0.0;
+
+    // Probabilidade de reordenar e de duplicar um pacote (0 a 1)
+    double reorder = 0.0;
+    double duplicate = 0.0;
+
+    // Banda do gargalo em kbit/s (0 = sem limite) e a fila dele, em ms
+    double rate_kbps = 0.0;
+    double queue_ms = IMPAIR_DEFAULT_QUEUE_MS;
+    // Intervalo, em segundos, entre duas trocas do mapeamento do NAT de
+    // cada cliente (0 = mapeamento fixo). Usado pelo proxy do emulador_rede.
+    double nat_s = 0.0;
+};
+
+// Lê um perfil pelo nome (IMPAIRMENT_PRESETS) ou pela descrição
+// "chave=valor,..." com as chaves perda, rajada (entrada:saída, em %),
+// perda_rajada, atraso, jitter, reordem, dup, banda, fila e nat. As
+// probabilidades são em porcentagem. Retorna false (com mensagem) se a
+// descrição for inválida.
+bool parse_impairment_profile(const std::string& text,
+                              ImpairmentProfile& profile);
+
+// Nomes e descrições dos perfis prontos
+struct ImpairmentPreset {
+    const char* name;
+    const char* spec;
+};
+extern const ImpairmentPreset IMPAIRMENT_PRESETS[];
+extern const int IMPAIRMENT_PRESET_COUNT;
+
+// Contadores de um sentido
+struct ImpairmentStats {
+    uint64_t packets = 0;         // Pacotes que entraram
+    uint64_t delivered = 0;       // Entregues (com as cópias)
+    uint64_t random_drops = 0;    // Perdidos no estado bom
+    uint64_t burst_drops = 0;     // Perdidos no estado ruim (rajada)
+    uint64_t queue_drops = 0;     // Descartados pela fila do gargalo
+    uint64_t reordered = 0;
+    uint64_t duplicated = 0;
+    uint64_t bytes = 0;           // Bytes entregues
+    std::vector<double> added_delay_ms;  // Atraso somado a cada pacote
+};
+
+// Um sentido da rede emulada
+class ImpairedLink {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    // Pacote à espera da hora de ser entregue; 'tag' identifica o destino
+    // para quem usa o link
+    struct Packet {
+        Clock::time_point due;
+        uint64_t order;
+        int tag;
+        std::vector<char> data;
+    };
+
+   private:
+    struct Later {
+        bool operator()(const Packet& a, const Packet& b) const {
+            return a.due != b.due ? a.due > b.due : a.order > b.order;
+        }
+    };
+
+    ImpairmentProfile profile;
+    std::mt19937_64 random;
+    std::uniform_real_distribution<double> uniform{0.0, 1.0};
+    std::normal_distribution<double> normal{0.0, 1.0};
+    bool bad_state = false;
+    Clock::time_point link_free;
+    Clock::time_point last_due;
+    uint64_t next_order = 0;
+    std::priority_queue<Packet, std::vector<Packet>, Later> pending;
+    ImpairmentStats counters;
+
+    void schedule(Clock::time_point due, int tag, std::string_view data);
+
+   public:
+    ImpairedLink(const ImpairmentProfile& profile, uint64_t seed);
+
+    // Entrega um pacote ao link no instante 'now'
+    void submit(std::string_view data, int tag, Clock::time_point now);
+
+    // Retira o próximo pacote cuja hora chegou; false se não houver
+    bool pop_due(Clock::time_point now, Packet& packet);
+
+    // Hora do próximo pacote (Clock::time_point::max() se vazio)
+    Clock::time_point next_due() const;
+
+    const ImpairmentStats& stats() const { return counters; }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include <cstdint>
+#include <string_view>
+
+// Registro assíncrono de mensagens do servidor.
+// Escrever no terminal com std::endl força um flush e, muitas vezes, uma
+// escrita bloqueante, na mesma thread que repassa o áudio; uma rajada de
+// mensagens (por exemplo, muitos clientes caindo juntos) atrasava todas as
+// chamadas. Aqui cada thread copia o registro (nível, instante, texto e
+// endereço do cliente) para o seu próprio anel sem travas, e uma thread em
+// segundo plano formata e escreve tudo de uma vez. Com o anel cheio o
+// registro é descartado e contado, nunca esperado.
+//
+// O nível mínimo vem de VOIP_LOG_LEVEL (debug, info, warn, error ou off;
+// padrão info). Uma mensagem abaixo do nível custa só uma comparação.
+
+// Níveis de severidade, do menos ao mais grave
+enum LogLevel : uint8_t {
+    LOG_DEBUG = 0,
+    LOG_INFO = 1,
+    LOG_WARN = 2,
+    LOG_ERROR = 3,
+    LOG_OFF = 4,
+};
+
+// Registros que cabem no anel de cada thread
+constexpr int LOG_RING_SIZE = 1024;
+
+// Tamanho máximo do texto de um registro (o resto é cortado)
+constexpr int LOG_TEXT_SIZE = 120;
+
+// Nível mínimo registrado (definido por log_init)
+extern LogLevel log_level;
+
+// Lê VOIP_LOG_LEVEL e inicia a thread de escrita. Deve ser chamada antes de
+// iniciar as threads que registram mensagens.
+void log_init();
+
+// Escreve os registros pendentes e encerra a thread de escrita
+void log_shutdown();
+
+// Indica se mensagens do nível dado são registradas
+inline bool log_enabled(LogLevel level) { return level >= log_level; }
+
+// Enfileira um registro (chamadas só quando log_enabled)
+void log_push(LogLevel level, std::string_view text,
+              const sockaddr_in* address, std::string_view name);
+
+// Registra uma mensagem
+inline void log_message(LogLevel level, std::string_view text) {
+    if (log_enabled(level)) log_push(level, text, nullptr, {});
+}
+
+// Registra uma mensagem seguida do endereço e do nome de um cliente
+inline void log_client(LogLevel level, std::string_view text,
+                       const sockaddr_in& address,
+                       std::string_view name = {}) {
+    if (log_enabled(level)) log_push(level, text, &address, name);
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "alloc_counter.h"
+
+// Harness dos microbenchmarks (bench_servidor e bench_cliente).
+// Cada benchmark é uma função que executa a operação medida 'n' vezes. O
+// harness aumenta 'n' até uma execução durar pelo menos o tempo mínimo,
+// repete a medida BENCH_REPETITIONS vezes e reporta a mediana, por
+// operação, do tempo de relógio e do tempo de CPU do processo (com threads,
+// a CPU de todas elas).
+//
+// Os resultados podem ser gravados em JSON, no mesmo formato do Google
+// Benchmark (as ferramentas de comparação dele funcionam), e comparados
+// com os de outro commit: uma operação mais lenta que a referência além do
+// limite é marcada como regressão e o programa termina com código 1.
+//
+// As alocações no heap feitas durante as repetições (alloc_counter.h) são
+// contadas e impressas por operação. Um benchmark marcado como de regime
+// permanente ('steady_state') não pode alocar nada: se alocar, é marcado e
+// o programa também termina com código 1.
+//
+// Opções: [--filter <texto>] [--min-time <s>] [--json <arquivo>]
+//         [--baseline <arquivo>] [--threshold <%>]
+//
+// Disponível apenas em sistemas Unix.
+
+// Duração mínima de cada repetição, em segundos
+constexpr double BENCH_DEFAULT_MIN_TIME = 0.2;
+
+// Repetições de cada medida; a mediana é reportada
+constexpr int BENCH_REPETITIONS = 5;
+
+// Diferença a partir da qual uma operação é considerada mais lenta que a
+// referência, em porcentagem
+constexpr double BENCH_DEFAULT_THRESHOLD = 10.0;
+
+// Impede o compilador de descartar um valor calculado só para ser medido
+template <class T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Impede o compilador de descartar ou reordenar escritas na memória
+inline void clobber_memory() { asm volatile("" : : : "memory"); }
+
+// Resultado de um benchmark, em nanossegundos por operação
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    double real_ns;
+    double cpu_ns;
+    double min_ns;
+    double allocs_per_op;
+    bool steady_state;
+};
+
+class BenchRunner {
+   private:
+    std::string filter;
+    double min_time = BENCH_DEFAULT_MIN_TIME;
+    std::string json_path;
+    std::string baseline_path;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    std::string executable;
+    std::vector<BenchResult> results;
+
+    static double cpu_seconds();
+
+    // Guarda e imprime o resultado de um benchmark
+    void report(const std::string& name, uint64_t iterations,
+                std::vector<double>& real, std::vector<double>& cpu,
+                uint64_t allocations, bool steady_state);
+
+    bool write_json() const;
+
+    // Compara com a referência; retorna o número de regressões (-1 se a
+    // referência não pôde ser lida)
+    int compare() const;
+
+   public:
+    // Lê as opções; false (com a mensagem de uso) se forem inválidas
+    bool parse(int argc, char* argv[]);
+
+    // Mede 'body(n)', que executa a operação 'name' n vezes. Com
+    // 'steady_state', a operação não deve alocar depois da calibração.
+    template <class Body>
+    void run(const std::string& name, Body&& body, bool steady_state = false);
+
+    // Grava o JSON e compara com a referência. Retorna o código de saída
+    // do programa: 1 se houve regressão, alocação em regime permanente ou
+    // erro, 0 caso contrário.
+    int finish();
+};
+
+template <class Body>
+void BenchRunner::run(const std::string& name, Body&& body,
+                      bool steady_state) {
+    if (!filter.empty() && name.find(filter) == std::string::npos) return;
+
+    // Calibração: cresce 'n' até uma execução durar o tempo mínimo
+    uint64_t n = 1;
+    while (true) {
+        const auto start = std::chrono::steady_clock::now();
+        body(n);
+        const double elapsed = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+        if (elapsed >= min_time || n >= (uint64_t(1) << 40)) break;
+        const double factor = elapsed > 0 ? 1.4 * min_time / elapsed : 100.0;
+        n = static_cast<uint64_t>(n * (factor > 100.0 ? 100.0 : factor)) + 1;
+    }
+
+    // Reservados antes, para que só as alocações de 'body' sejam contadas
+    std::vector<double> real, cpu;
+    real.reserve(BENCH_REPETITIONS);
+    cpu.reserve(BENCH_REPETITIONS);
+    uint64_t allocations = 0;
+    for (int r = 0; r < BENCH_REPETITIONS; ++r) {
+        const double cpu_start = cpu_seconds();
+        const uint64_t allocations_start = allocation_count();
+        const auto start = std::chrono::steady_clock::now();
+        body(n);
+        const double elapsed = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+        allocations += allocation_count() - allocations_start;
+        real.push_back(elapsed * 1e9 / n);
+        cpu.push_back((cpu_seconds() - cpu_start) * 1e9 / n);
+    }
+    report(name, n, real, cpu, allocations, steady_state);
+}
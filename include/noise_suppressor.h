@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+
+#include "common.h"
+#include "fft.h"
+
+// Avanço da análise (hop) em amostras, 5 ms a 48 kHz
+constexpr int NS_HOP_SIZE = 240;
+
+// Tamanho da janela de análise (50% de sobreposição)
+constexpr int NS_WINDOW_SIZE = 2 * NS_HOP_SIZE;
+
+// Tamanho da FFT (janela completada com zeros até a potência de dois)
+constexpr int NS_FFT_SIZE = 512;
+
+// Atraso algorítmico adicionado pelo supressor, em amostras
+constexpr int NS_DELAY_SAMPLES = NS_WINDOW_SIZE - NS_HOP_SIZE;
+
+static_assert(FRAMES_PER_BUFFER % NS_HOP_SIZE == 0,
+              "O quadro de áudio deve conter um número inteiro de hops");
+
+// Hops em cada sub-janela do rastreio do mínimo (400 ms) e sub-janelas
+// guardadas: o piso de ruído é o mínimo dos últimos ~1,6 s
+constexpr int NS_SUBWINDOW_HOPS = 80;
+constexpr int NS_SUBWINDOWS = 4;
+
+// Supressor de ruído espectral.
+// Analisa o áudio capturado com uma STFT (janela raiz de Hann, 50% de
+// sobreposição), acompanha o piso de ruído de cada raia pelo mínimo da
+// potência suavizada numa janela deslizante (estatística de mínimos) e
+// aplica um ganho de Wiener com SNR a priori
+// "decision-directed" (Ephraim-Malah). O sinal é reconstruído por
+// overlap-add, o que atrasa a saída em NS_DELAY_SAMPLES amostras.
+class NoiseSuppressor {
+   private:
+    FFT fft;
+    int bins;
+
+    // Janela raiz de Hann, usada na análise e na síntese
+    std::vector<float> window;
+
+    // Metade anterior da janela de análise e cauda do overlap-add
+    std::vector<float> input_history;
+    std::vector<float> overlap;
+
+    // Áreas de trabalho
+    std::vector<float> frame;
+    std::vector<float> spectrum_re, spectrum_im;
+    std::vector<float> power;
+
+    // Estado por raia: potência suavizada, SNR a priori e ganho do hop
+    // anterior
+    std::vector<float> smoothed_power;
+    std::vector<float> previous_snr;
+    std::vector<float> gain;
+
+    // Rastreio do mínimo por raia: mínimo da sub-janela em andamento, das
+    // NS_SUBWINDOWS anteriores (raia a raia, uma sub-janela após a outra) e
+    // o menor destas. O mínimo de um trecho de silêncio digital no início
+    // sai da janela depois de ~1,6 s, como qualquer outro.
+    std::vector<float> current_min;
+    std::vector<float> subwindow_min;
+    std::vector<float> window_min;
+    int subwindow = 0;
+
+    // Hops processados (a potência suavizada é inicializada no primeiro)
+    long hops = 0;
+
+    // Processa NS_HOP_SIZE amostras in-place
+    void process_hop(float* samples);
+
+   public:
+    NoiseSuppressor();
+
+    // Remove o ruído de fundo de um quadro de FRAMES_PER_BUFFER amostras
+    // (in-place). A saída fica atrasada em NS_DELAY_SAMPLES amostras.
+    void process(float* samples);
+};
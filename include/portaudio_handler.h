@@ -0,0 +1,60 @@
+#pragma once
+
+#include <portaudio.h>
+
+#include <memory>
+#include <vector>
+
+#include "audio.h"
+#include "resampler.h"
+
+// Backend de áudio que usa a biblioteca PortAudio e os dispositivos padrão
+// de entrada (microfone) e saída (alto-falantes) do sistema.
+class PortAudioHandler : public AudioHandler {
+   private:
+    // O tipo de dado 'PaStream' é utilizado para representar um fluxo de áudio
+    // na biblioteca PortAudio. Ele é usado tanto para capturar áudio do
+    // microfone quanto para reproduzir áudio nos alto-falantes.
+
+    // Ponteiro para o fluxo de captura de áudio (microfone)
+    PaStream* inputStream;
+
+    // Ponteiro para o fluxo de reprodução de áudio (alto-falantes)
+    PaStream* outputStream;
+
+    // Os dispositivos são abertos na sua taxa nativa (por exemplo 44100 Hz
+    // em headsets USB) e o áudio é convertido para a taxa da rede
+    // (SAMPLE_RATE). Os conversores só existem quando as taxas diferem.
+    std::unique_ptr<Resampler> captureResampler;
+    std::unique_ptr<Resampler> playbackResampler;
+
+    // Amostras por bloco de 20 ms na taxa de cada dispositivo
+    int captureFrames;
+    int playbackFrames;
+
+    // Buffers da conversão: áudio do dispositivo (float) e na taxa da rede
+    std::vector<float> captureDeviceBuffer, captureNetworkBuffer;
+    std::vector<float> playbackDeviceBuffer, playbackNetworkBuffer;
+
+   public:
+    // Construtor da classe
+    PortAudioHandler();
+
+    // Destrutor da classe
+    ~PortAudioHandler() override;
+
+    // Prepara o biblioteca PortAudio para ser usada
+    bool init() override;
+
+    // Desaloca os recursos utilizados pela biblioteca PortAudio
+    void terminate() override;
+
+    bool openCapture() override;
+    bool openPlayback() override;
+    void startCapture() override;
+    void startPlayback() override;
+    void stopCapture() override;
+    void stopPlayback() override;
+    int read(char* buffer) override;
+    int write(const char* buffer, int frames = FRAMES_PER_BUFFER) override;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Avaliação objetiva da qualidade do áudio: compara a fala de referência
+// com o que saiu do outro lado da chamada (captura -> camadas -> servidor ->
+// jitter buffer -> reprodução) e dá notas que podem ser acompanhadas de um
+// commit para outro.
+//
+// O sinal recebido é primeiro alinhado à referência, por correlação cruzada
+// de cada bloco de QUALITY_ALIGN_BLOCK_MS com fala: o atraso muda no meio da
+// chamada, porque a reprodução só escreve quando há quadros (um quadro
+// perdido some da gravação) e a compensação de deriva estica ou encolhe o
+// áudio. Cada bloco é procurado a até QUALITY_ALIGN_SEARCH_MS do atraso do
+// anterior, e a mudança entre dois blocos fica no ponto de menor erro. Com o
+// sinal alinhado são calculados:
+//  - SNR: relação sinal-ruído da forma de onda, com o ganho ajustado por
+//    mínimos quadrados (até QUALITY_SNR_MAX);
+//  - SNR segmentado: média do SNR de cada trecho de QUALITY_SEGMENT_MS com
+//    fala, limitado a [QUALITY_SEG_SNR_MIN, QUALITY_SEG_SNR_MAX] dB;
+//  - MOS perceptual: uma aproximação no espírito do PESQ (ITU-T P.862).
+//    Os espectros dos dois sinais são agrupados em bandas críticas,
+//    convertidos em sonoridade (lei de Zwicker) e comparados quadro a
+//    quadro, com perturbação simétrica e assimétrica (ruído acrescentado
+//    pesa mais que sinal perdido), agregadas como no PESQ e levadas para a
+//    escala MOS-LQO. Não é o PESQ nem o POLQA: a nota serve para comparar
+//    versões e perfis de rede entre si, não com números publicados.
+
+// Bloco do alinhamento e a busca em torno do atraso anterior
+constexpr int QUALITY_ALIGN_BLOCK_MS = 200;
+constexpr int QUALITY_ALIGN_SEARCH_MS = 200;
+
+// Maior SNR informado (sinais idênticos dariam infinito)
+constexpr double QUALITY_SNR_MAX = 100.0;
+
+// Trecho do SNR segmentado e os limites de cada trecho
+constexpr int QUALITY_SEGMENT_MS = 20;
+constexpr double QUALITY_SEG_SNR_MIN = -10.0;
+constexpr double QUALITY_SEG_SNR_MAX = 35.0;
+
+// Notas de uma comparação
+struct QualityScores {
+    bool valid = false;
+
+    // Atraso do sinal recebido em relação à referência no primeiro bloco
+    // com fala, no arquivo, e a variação dele ao longo do arquivo
+    double delay_ms = 0.0;
+    double delay_spread_ms = 0.0;
+
+    double snr_db = 0.0;
+    double seg_snr_db = 0.0;
+
+    // Perturbações médias e a nota perceptual (1 a 4,64)
+    double symmetric_disturbance = 0.0;
+    double asymmetric_disturbance = 0.0;
+    double mos = 1.0;
+};
+
+// Lê um WAV PCM de 16 bits como amostras em [-1, 1), misturando os canais.
+// Retorna false (com mensagem) se o arquivo não puder ser lido.
+bool read_wav_samples(const std::string& path, std::vector<float>& samples,
+                      int& sample_rate);
+
+// Compara o sinal recebido 'degraded' com a referência, os dois na mesma
+// taxa de amostragem. 'valid' fica false se não houver fala na referência
+// ou se os sinais não se sobrepuserem.
+QualityScores score_quality(const std::vector<float>& reference,
+                            const std::vector<float>& degraded,
+                            int sample_rate);
+
+// Escreve as notas como um objeto JSON, sem quebra de linha
+void write_quality_json(std::ostream& out, const QualityScores& scores);
+
+// Escreve 'text' entre aspas, com as aspas e barras escapadas
+void write_json_string(std::ostream& out, const std::string& text);
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "common.h"
+
+// Proteção do servidor contra excesso de pacotes.
+// Cada sessão tem um balde de fichas (TokenBucket) para os seus pacotes, e
+// pacotes de endereços sem sessão (login e descoberta) passam por baldes
+// por IP de origem (SourceRateLimiter). O que passa do limite é descartado
+// antes de qualquer processamento, então um cliente que inunda o servidor
+// só perde os próprios pacotes. Além disso, novos logins são recusados
+// enquanto a thread do servidor estiver sobrecarregada (RelayLoad).
+//
+// Os baldes por IP são compartilhados (hash), então uma inundação com
+// endereços de origem forjados esvazia todos. Para que ela não impeça novos
+// logins, um LOGIN_REQUEST recusado pelo balde recebe um cookie
+// (LoginCookie) ligado ao endereço de origem, e o LOGIN_WITH_COOKIE que o
+// repete não passa pelos baldes: só quem recebe os pacotes no endereço
+// consegue devolver o cookie.
+
+// Pacotes por segundo aceitos de uma sessão: o dobro do ritmo do áudio (um
+// pacote a cada FRAMES_PER_BUFFER amostras), com folga para rajadas de até
+// meio segundo após uma pausa da rede
+constexpr double SESSION_PACKET_RATE =
+    2.0 * SAMPLE_RATE / FRAMES_PER_BUFFER;
+constexpr double SESSION_PACKET_BURST = 25;
+
+// Pacotes por segundo aceitos de um IP sem sessão (pedidos de login e de
+// descoberta)
+constexpr double SOURCE_PACKET_RATE = 5;
+constexpr double SOURCE_PACKET_BURST = 10;
+
+// Número de baldes por IP. IPs diferentes podem cair no mesmo balde e
+// dividi-lo; trocar de IP de origem não renova as fichas de um atacante.
+constexpr int SOURCE_BUCKETS = 1024;
+
+// Validade do cookie de login: ele vale do seu período até o fim do
+// seguinte
+constexpr int LOGIN_COOKIE_PERIOD_SEC = 10;
+
+// Limites padrão da admissão de novos logins (VOIP_MAX_CPU e VOIP_MAX_QUEUE,
+// em porcentagem)
+constexpr double DEFAULT_MAX_CPU_PERCENT = 80;
+constexpr double DEFAULT_MAX_QUEUE_PERCENT = 50;
+
+// Balde de fichas: enche 'rate' fichas por segundo até 'burst', e cada
+// pacote aceito gasta uma ficha
+class TokenBucket {
+   private:
+    double rate;
+    double burst;
+    double tokens;
+    std::chrono::steady_clock::time_point last_refill;
+
+   public:
+    TokenBucket(double rate_per_second = SESSION_PACKET_RATE,
+                double burst_size = SESSION_PACKET_BURST)
+        : rate(rate_per_second),
+          burst(burst_size),
+          tokens(burst_size),
+          last_refill() {}
+
+    // Tenta gastar uma ficha; false se o balde estiver vazio
+    bool consume(std::chrono::steady_clock::time_point now);
+
+    // Enche o balde (nova sessão no mesmo slot)
+    void reset() {
+        tokens = burst;
+        last_refill = std::chrono::steady_clock::time_point();
+    }
+};
+
+// Baldes por IP de origem para os pacotes de quem não tem sessão
+class SourceRateLimiter {
+   private:
+    TokenBucket buckets[SOURCE_BUCKETS];
+
+   public:
+    SourceRateLimiter();
+
+    // Tenta gastar uma ficha do balde do IP (na ordem da rede)
+    bool consume(uint32_t ip, std::chrono::steady_clock::time_point now);
+};
+
+// Cookies de login sem estado: o SipHash-2-4 do endereço de origem e do
+// período atual, com uma chave sorteada quando o servidor inicia
+class LoginCookie {
+   private:
+    uint8_t key[16];
+
+    uint64_t compute(uint32_t ip, uint16_t port, int64_t period) const;
+
+   public:
+    LoginCookie();
+
+    // Cookie para o endereço (IP e porta na ordem da rede)
+    uint64_t issue(uint32_t ip, uint16_t port,
+                   std::chrono::steady_clock::time_point now) const;
+
+    // Verifica um cookie devolvido pelo endereço
+    bool check(uint64_t cookie, uint32_t ip, uint16_t port,
+               std::chrono::steady_clock::time_point now) const;
+};
+
+// Carga da thread do servidor, medida uma vez por segundo: uso de CPU da
+// própria thread e ocupação do buffer de recepção do socket (Linux)
+class RelayLoad {
+   private:
+    double max_cpu_percent;
+    double max_queue_percent;
+    double cpu = 0.0;
+    double queue = 0.0;
+
+    std::chrono::steady_clock::time_point last_sample;
+    double last_cpu_seconds = -1.0;
+
+   public:
+    // Lê os limites de VOIP_MAX_CPU e VOIP_MAX_QUEUE
+    RelayLoad();
+
+    // Atualiza as medidas se já passou um segundo desde a última.
+    // Deve ser chamada pela thread do servidor.
+    void sample(int sock, std::chrono::steady_clock::time_point now);
+
+    // Uso de CPU e ocupação da fila, em porcentagem
+    double cpu_percent() const { return cpu; }
+    double queue_percent() const { return queue; }
+
+    // Indica se novos logins devem ser recusados
+    bool overloaded() const {
+        return cpu > max_cpu_percent || queue > max_queue_percent;
+    }
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifdef _WIN32
+#include <winsock2.h>
+using socklen_t = int;
+#else
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif
+
+// Modo de baixa latência.
+// Em máquinas carregadas as threads de áudio e de rede são preemptadas por
+// outros processos e o áudio falha. Ativado pela variável de ambiente
+// VOIP_LOW_LATENCY=1, este modo:
+//   - coloca as threads de tempo real em SCHED_FIFO (ou SCHED_RR, ou só
+//     aumenta a prioridade, conforme as permissões do usuário);
+//   - fixa cada thread em uma CPU da lista VOIP_CPUS (por exemplo "2,3");
+//   - trava a memória do processo com mlockall, evitando page faults;
+//   - ativa SO_BUSY_POLL nos sockets e faz a recepção girar por até
+//     VOIP_BUSY_POLL_US microssegundos (padrão 50) antes de dormir.
+// Cada passo que falhar por falta de permissão é avisado e ignorado.
+
+// Prioridades SCHED_FIFO (1 a 99) das threads. A reprodução tem a maior:
+// um atraso ali é ouvido na hora.
+constexpr int RT_PRIORITY_PLAYBACK = 80;
+constexpr int RT_PRIORITY_CAPTURE = 75;
+constexpr int RT_PRIORITY_NETWORK = 70;
+
+// Indica se o modo de baixa latência está ativo (definido por realtime_init)
+extern bool low_latency_enabled;
+
+// Lê as variáveis de ambiente e trava a memória do processo. Deve ser
+// chamada no início de main(), antes de criar as threads.
+void realtime_init();
+
+// Configura a thread atual: nome (visível no top/perf), política de tempo
+// real com a prioridade dada e a CPU de índice 'cpu_slot' em VOIP_CPUS.
+// Sem o modo de baixa latência só define o nome.
+void realtime_thread(const char* name, int priority, int cpu_slot);
+
+// Ativa SO_BUSY_POLL no socket (com o modo de baixa latência)
+void enable_busy_poll(int sock);
+
+// Tenta receber um pacote sem bloquear, girando por até VOIP_BUSY_POLL_US.
+// Retorna o tamanho do pacote, ou -1 se nada chegou nesse tempo (ou o modo
+// de baixa latência está desligado); aí o chamador usa a espera normal.
+ssize_t spin_recvfrom(int sock, char* buffer, size_t size, sockaddr* from,
+                      socklen_t* from_len);
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "simulcast.h"
+
+// Gravação de salas (cada servidor é uma sala) para fins de registro.
+// O gravador recebe os pacotes AUDIO_DATA repassados pelo servidor (pelo
+// anel de memória compartilhada, shm_ring.h) e, para cada sala:
+//   - Coloca os quadros de cada fluxo em um buffer de jitter indexado pelo
+//     timestamp de mídia, com um atraso fixo (RECORD_DELAY_FRAMES), para
+//     que pacotes atrasados ou fora de ordem entrem no lugar certo.
+//   - A cada 20 ms retira o quadro de cada fluxo (silêncio se ele não
+//     chegou) e grava a mixagem da sala e/ou uma trilha por participante.
+//
+// Nada disso toca o disco: os WAV são montados em blocos grandes
+// (RECORD_BLOCK_SIZE bytes, alinhados à página) e uma thread de escrita
+// (DiskWriter) os grava com write(). Um disco lento só atrasa essa thread;
+// se os blocos pendentes passarem de RECORD_MAX_PENDING, os novos são
+// descartados e contados, nunca esperados. No lugar de um bloco descartado
+// a thread de escrita avança o arquivo sem escrever (um trecho de zeros,
+// silêncio no PCM), para o áudio seguinte continuar no tempo certo. O
+// bloco com o cabeçalho do WAV nunca é descartado.
+//
+// Disponível apenas em sistemas Unix.
+
+// Atraso do buffer de jitter de cada fluxo: 200 ms
+constexpr int RECORD_DELAY_FRAMES = 10;
+
+// Quadros guardados por fluxo: atraso mais folga para rajadas
+constexpr int RECORD_SLOTS = 32;
+
+// Tamanho e alinhamento dos blocos entregues à thread de escrita: 64 KiB
+// são cerca de 0,7 s de uma trilha
+constexpr size_t RECORD_BLOCK_SIZE = 64 * 1024;
+constexpr size_t RECORD_BLOCK_ALIGNMENT = 4096;
+
+// Blocos na fila da thread de escrita a partir dos quais os novos são
+// descartados (256 MiB)
+constexpr size_t RECORD_MAX_PENDING = 4096;
+
+// Thread de escrita: grava os blocos na ordem em que foram entregues
+class DiskWriter {
+   private:
+    // Um bloco a gravar no fim do arquivo (sem bloco, 'length' bytes de
+    // um bloco descartado, que são pulados); 'last' corrige o cabeçalho do
+    // WAV e fecha o arquivo depois
+    struct Job {
+        int fd;
+        char* block;
+        size_t length;
+        bool last;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> jobs;
+    std::vector<char*> free_blocks;
+    bool running = false;
+    std::thread thread;
+
+    // Estatísticas (protegidas por 'mutex')
+    uint64_t bytes_written = 0;
+    uint64_t blocks_dropped = 0;
+    size_t max_pending = 0;
+
+    void run();
+
+   public:
+    ~DiskWriter();
+
+    void start();
+
+    // Grava tudo o que está na fila e encerra a thread
+    void stop();
+
+    // Bloco vazio de RECORD_BLOCK_SIZE bytes, reaproveitado se possível
+    char* acquire_block();
+
+    // Entrega um bloco para ser gravado no fim de 'fd'. Retorna false se o
+    // bloco foi descartado por excesso de fila; com 'keep' (o bloco do
+    // cabeçalho) ele nunca é descartado.
+    bool submit(int fd, char* block, size_t length, bool keep = false);
+
+    // Entrega o último bloco de um WAV (pode ser nulo), que nunca é
+    // descartado: depois dele o cabeçalho é corrigido e 'fd' é fechado
+    void finish(int fd, char* block, size_t length);
+
+    // Estatísticas, válidas depois de stop()
+    uint64_t written() const { return bytes_written; }
+    uint64_t dropped() const { return blocks_dropped; }
+    size_t pending_peak() const { return max_pending; }
+};
+
+// Arquivo WAV PCM de 16 bits gravado pela DiskWriter
+class RecordingFile {
+   private:
+    DiskWriter* writer = nullptr;
+    int fd = -1;
+    int channel_count = 0;
+    char* block = nullptr;
+    size_t used = 0;
+    // O bloco atual é o primeiro, com o cabeçalho
+    bool first_block = false;
+
+    void submit_block();
+
+   public:
+    ~RecordingFile();
+
+    // Cria o arquivo; o cabeçalho vai no primeiro bloco
+    bool open(DiskWriter& disk, const std::string& path, int sample_rate,
+              int channels);
+
+    // Acrescenta 'frames' quadros de 'samples'
+    void write(const int16_t* samples, int frames);
+
+    // Entrega o resto, corrige os tamanhos no cabeçalho e fecha
+    void close();
+};
+
+// Como uma sala é gravada
+enum RecordMode : uint8_t {
+    RECORD_MIX = 1,     // Um WAV com a mixagem da sala
+    RECORD_TRACKS = 2,  // Um WAV por participante
+    RECORD_BOTH = RECORD_MIX | RECORD_TRACKS,
+};
+
+// Gravação de uma sala
+class RoomRecorder {
+   private:
+    // Buffer de jitter e trilha de um fluxo
+    struct Track {
+        LayerDecoder decoder;
+        bool started = false;
+        // Timestamp do quadro tocado na posição atual da sala
+        uint32_t next_timestamp = 0;
+        uint32_t last_timestamp = 0;
+        int late_in_row = 0;
+        std::vector<int16_t> samples;
+        uint32_t slot_timestamp[RECORD_SLOTS] = {};
+        bool slot_full[RECORD_SLOTS] = {};
+        RecordingFile file;
+        uint64_t frames = 0, missing = 0, late = 0;
+    };
+
+    DiskWriter& disk;
+    std::string prefix;
+    int mode;
+    std::unique_ptr<Track> tracks[MAX_STREAMS];
+    RecordingFile mix_file;
+    bool mix_open = false;
+
+    // Quadros de 20 ms já gravados desde o início da sala
+    uint64_t position = 0;
+
+    std::vector<char> decoded;
+    std::vector<int32_t> accumulator;
+    std::vector<int16_t> mixed;
+
+    // Recomeça o buffer de jitter para que 'timestamp' toque daqui a
+    // RECORD_DELAY_FRAMES quadros
+    void anchor(Track& track, uint32_t timestamp);
+    void store(Track& track, uint32_t timestamp, const char* pcm);
+
+   public:
+    // Os arquivos são '<prefix>_mix.wav' e '<prefix>_fluxo<N>.wav'
+    RoomRecorder(DiskWriter& disk, std::string prefix, int mode);
+
+    // Recebe um pacote AUDIO_DATA completo (cabeçalho e áudio). Retorna
+    // false se não foi possível criar o arquivo de um participante novo.
+    bool on_packet(const char* packet, size_t length);
+
+    // Grava o próximo quadro de 20 ms da sala
+    void tick();
+
+    // Fecha os arquivos e imprime o resumo da sala
+    void close();
+};
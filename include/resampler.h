@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+
+// Conversor de taxa de amostragem polifásico.
+// Converte entre duas taxas com razão racional L/M (por exemplo 44100 ->
+// 48000 = 160/147) usando um filtro passa-baixas FIR de fase linear (sinc
+// com janela de Kaiser) decomposto em L fases. Cada amostra de saída é um
+// único produto escalar vetorizado entre uma fase e o histórico de entrada.
+//
+// Como o filtro tem fase linear, o atraso de grupo é constante e conhecido
+// (delay_seconds()). Toda a memória é reservada no construtor.
+class Resampler {
+   private:
+    // Fator de interpolação (L) e de decimação (M)
+    int up;
+    int down;
+
+    // Coeficientes por fase, cada fase com 'taps' coeficientes invertidos
+    // para que o produto escalar percorra a entrada em ordem crescente
+    int taps;
+    std::vector<float> phases;
+
+    // Atraso de grupo do filtro, em segundos
+    double delay;
+
+    // Histórico de entrada (taps - 1 amostras) seguido do bloco atual
+    std::vector<float> buffer;
+
+    // Posição da próxima saída na taxa intermediária (entrada * L),
+    // relativa ao início do bloco atual
+    long position = 0;
+
+   public:
+    // Cria um conversor de 'input_rate' para 'output_rate' Hz que aceita até
+    // 'max_input' amostras por chamada de process().
+    Resampler(int input_rate, int output_rate, int max_input);
+
+    // Converte 'count' amostras de 'in' (no máximo 'max_input'; o excesso
+    // é ignorado) e escreve em 'out'.
+    // Retorna o número de amostras produzidas: em média count * L / M, e
+    // exatamente isso quando count * L é múltiplo de M.
+    int process(const float* in, int count, float* out);
+
+    // Maior número de amostras que process() pode produzir para 'count'
+    int max_output(int count) const { return count * up / down + 1; }
+
+    // Atraso de grupo introduzido pela conversão, em segundos
+    double delay_seconds() const { return delay; }
+};
+
+// Conversor de taxa assíncrono, com razão fracionária ajustável.
+// Usado para compensar pequenas diferenças (dezenas a centenas de ppm) entre
+// o relógio de quem envia o áudio e o relógio do dispositivo que o toca.
+// Interpola o sinal em posições fracionárias com um sinc com janela de
+// Kaiser tabelado em RESAMPLER_ASYNC_PHASES fases, interpolando linearmente
+// entre fases vizinhas.
+class AsyncResampler {
+   private:
+    // Tabela com (fases + 1) conjuntos de 'taps' coeficientes
+    std::vector<float> table;
+
+    // Histórico de entrada (taps - 1 amostras), a entrada que sobrou da
+    // chamada anterior ('pending' amostras) e o bloco atual
+    std::vector<float> buffer;
+    int pending = 0;
+
+    // Posição da próxima saída no buffer, em amostras de entrada (nunca
+    // negativa: a entrada ainda não usada fica no buffer)
+    double position = 0.0;
+
+    // Amostras de entrada consumidas por amostra de saída (1 / razão)
+    double step = 1.0;
+
+   public:
+    // Cria um conversor que aceita até 'max_input' amostras por chamada
+    explicit AsyncResampler(int max_input);
+
+    // Define a razão saída/entrada (por exemplo 1.0001 produz 0,01% a mais
+    // de amostras do que recebe)
+    void set_ratio(double ratio) { step = 1.0 / ratio; }
+
+    // Converte 'count' amostras de 'in' (no máximo 'max_input'; o excesso
+    // é ignorado) e escreve até 'max_out' em 'out'. Retorna o número de
+    // amostras produzidas (aproximadamente count * razão). Se 'max_out'
+    // interromper a conversão, a entrada restante é usada na próxima
+    // chamada; se ela passar de 'max_input' amostras, a mais antiga é
+    // descartada.
+    int process(const float* in, int count, float* out, int max_out);
+
+    // Atraso introduzido pela interpolação, em amostras
+    double delay_samples() const;
+};
@@ -14,6 +14,11 @@ using socklen_t = int;
 #include <vector>
 
 #include "common.h"
+#include "congestion.h"
+#include "rate_limit.h"
+#include "shm_ring.h"
+#include "trunk.h"
+#include "xdp_path.h"
 
 // Estrutura para armazenar informações do cliente
 struct ClientInfo {
@@ -22,25 +27,62 @@ struct ClientInfo {
     std::string name;        // Nome do cliente
     bool is_active = false;  // Indica se o cliente está ativo
 
+    // Token entregue no LOGIN_OK e exigido no final de cada pacote de áudio
+    // (session_token.h); permite achar a sessão quando o endereço muda
+    uint64_t session_token = 0;
+
     // Armazena o tempo do último pacote recebido do cliente
     std::chrono::steady_clock::time_point last_packet_time;
+
+    // Limita os pacotes aceitos da sessão
+    TokenBucket packet_bucket;
+
+    // Banda de recepção informada no RECEIVER_REPORT, em kbit/s (0 = sem
+    // limite), e a camada de qualidade (simulcast.h) repassada ao cliente
+    int capacity_kbps = 0;
+    int layer = LAYER_PCM48;
+
+    // Banda estimada pelas perdas nos relatórios (congestion.h)
+    CapacityEstimator estimator;
 };
 
 // Interruptor para controlar o loop do servidor
 extern std::atomic<bool> running;
 
-// Gerencia o loop principal do servidor
-void server_loop(int sock);
+// Indica que o loop terminou porque o servidor foi entregue a um novo
+// processo (handoff.h); o socket e as sessões agora pertencem a ele
+extern std::atomic<bool> handed_off;
+
+// Anel de memória compartilhada para consumidores na mesma máquina
+// (shm_ring.h), aberto em main() quando VOIP_SHM está definida
+extern ShmRingWriter local_ring;
+
+// Tronco com os servidores interligados (trunk.h), configurado em main()
+extern Trunk trunk;
+
+// Caminho AF_XDP para o áudio (xdp_path.h), aberto em main() quando
+// VOIP_XDP está definida
+extern XdpPath xdp_path;
+
+// Gerencia o loop principal do servidor. 'clients' é a tabela de sessões
+// (vazia, ou recebida do processo anterior), e 'handoff_listener' o socket
+// em que um novo processo pode pedir a troca (-1 para desativar).
+void server_loop(int sock, int handoff_listener,
+                 ClientInfo clients[MAX_CLIENTS]);
 
 // Processa um pacote recebido de um cliente.
 void handle_received_packet(int sock, const std::string_view& buffer,
                             const sockaddr_in& sender_addr,
-                            socklen_t sender_len, ClientInfo clients[2]);
+                            socklen_t sender_len, ClientInfo clients[MAX_CLIENTS]);
 
-// Verifica se o cliente está inativo e desconecta se necessário
-void check_client_timeouts(int sock, ClientInfo clients[2]);
+// Encontra o slot da sessão com o endereço dado (-1 se não houver)
+int find_client(const sockaddr_in& address, ClientInfo clients[MAX_CLIENTS]);
 
-//  Imprime informações do cliente
-void print_client_info(const std::string& message,
-                       const sockaddr_in& client_addr,
-                       const std::string& name = "");
\ No newline at end of file
+// Envia um SERVER_MESSAGE a todas as sessões, exceto 'exclude_client_index',
+// e o publica para os consumidores locais
+void broadcast_server_message(int sock, std::string_view message,
+                              ClientInfo clients[MAX_CLIENTS],
+                              int exclude_client_index = -1);
+
+// Verifica se o cliente está inativo e desconecta se necessário
+void check_client_timeouts(int sock, ClientInfo clients[MAX_CLIENTS]);
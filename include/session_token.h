@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common.h"
+
+// Tokens de retomada de sessão.
+// As sessões do servidor são identificadas pelo endereço do cliente. Quando
+// o NAT de um cliente (típico em redes móveis) troca o mapeamento, os
+// pacotes passam a chegar de outro endereço e, sem o token, seriam
+// descartados até a sessão expirar e o participante entrar de novo.
+//
+// No login, o servidor entrega ao cliente um token de SESSION_TOKEN_SIZE
+// bytes no LOGIN_OK, e o cliente o acrescenta ao final de cada pacote de
+// áudio que envia. Um pacote de áudio de um endereço desconhecido indica a
+// sessão pelo identificador do fluxo (o slot, acesso direto na tabela); se
+// o token no final for o dessa sessão, ela passa para o novo endereço já
+// nesse pacote, sem novo login e sem perder o quadro. O servidor remove o
+// token antes de repassar o áudio, então os ouvintes, o tronco e os
+// consumidores locais recebem o pacote como antes.
+//
+// O token é o SipHash-2-4 do fluxo e de um contador de logins, com uma
+// chave aleatória do processo: não dá para adivinhar o token de outra
+// sessão, e um slot reaproveitado recebe outro token. Ele não é cifrado;
+// quem observa o tráfego da chamada consegue copiá-lo (ver "Criptografia"
+// no README).
+
+// SipHash-2-4 de 'size' bytes de 'data' com a chave de 128 bits 'key'
+uint64_t siphash24(const uint8_t key[16], const void* data, size_t size);
+
+// Emite os tokens das sessões de um servidor
+class SessionTokenIssuer {
+   private:
+    uint8_t key[16];
+    uint64_t counter = 0;
+
+   public:
+    // Sorteia a chave (std::random_device)
+    SessionTokenIssuer();
+
+    // Token para um novo login no fluxo 'stream' (nunca 0, que indica a
+    // ausência de token)
+    uint64_t issue(int stream);
+};
+
+// Escreve e lê o token em SESSION_TOKEN_SIZE bytes (big-endian)
+void write_session_token(uint64_t token, char* out);
+uint64_t read_session_token(const char* in);
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "common.h"
+
+// Transporte por memória compartilhada para consumidores na mesma máquina.
+// Gravadores, bots de transcrição e monitores que rodam junto do servidor
+// não precisam receber o áudio por UDP: com VOIP_SHM=<nome> o servidor
+// publica cada pacote AUDIO_DATA recebido, sem alterações, em um anel na
+// memória compartilhada (shm_open). Cada consumidor mapeia o anel e lê no
+// seu próprio ritmo, com o seu próprio cursor; publicar custa uma cópia
+// para o anel, qualquer que seja o número de consumidores, e o servidor
+// nunca espera por eles.
+//
+// Cada posição do anel é protegida por um número de sequência (seqlock):
+// par quando o pacote está completo, ímpar durante a escrita. Um
+// consumidor lento demais é ultrapassado pelo servidor; ele percebe pela
+// sequência, conta os pacotes perdidos e continua do ponto atual.
+//
+// Disponível apenas em sistemas Unix.
+
+// Posições do anel: cerca de 1,3 s de áudio com 16 participantes falando
+constexpr int SHM_RING_SLOTS = 1024;
+
+// Identifica o formato do anel
+constexpr uint32_t SHM_RING_MAGIC = 0x56534852;  // "VSHR"
+constexpr uint32_t SHM_RING_VERSION = 2;
+
+// Uma posição do anel
+struct ShmSlot {
+    std::atomic<uint64_t> sequence;
+    uint32_t length;
+    char data[MAX_PACKET_SIZE];
+};
+
+// Cabeçalho do anel, no início da memória compartilhada
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    // Número do próximo pacote a ser publicado
+    std::atomic<uint64_t> next_sequence;
+    // Diferente de 0 quando o servidor fechou o anel (encerrou ou foi
+    // substituído); o consumidor deve abrir o anel de novo
+    std::atomic<uint32_t> closed;
+};
+
+// Lado do servidor: cria o anel e publica os pacotes
+class ShmRingWriter {
+   private:
+    ShmRingHeader* header = nullptr;
+    ShmSlot* slots = nullptr;
+    std::string name;
+    uint64_t next = 0;
+
+   public:
+    ~ShmRingWriter() { close(); }
+
+    // Cria (ou substitui) o anel com o nome dado, por exemplo "/simple_voip".
+    // Permissão 0600, ou 0640 com o grupo de VOIP_SHM_GROUP.
+    bool create(const std::string& ring_name);
+
+    bool is_open() const { return header != nullptr; }
+
+    // Publica um pacote (no máximo MAX_PACKET_SIZE bytes)
+    void publish(const char* data, size_t length);
+
+    // Avisa os consumidores e desfaz o mapeamento. 'remove' apaga o nome
+    // (encerramento normal; numa troca do servidor o sucessor já o recriou)
+    void close(bool remove = false);
+};
+
+// Lado do consumidor: mapeia o anel e lê os pacotes em ordem
+class ShmRingReader {
+   private:
+    const ShmRingHeader* header = nullptr;
+    const ShmSlot* slots = nullptr;
+    uint64_t cursor = 0;
+    uint64_t lost = 0;
+
+   public:
+    ~ShmRingReader() { close(); }
+
+    // Abre o anel existente. O primeiro pacote lido é o próximo publicado
+    // ou, com 'from_oldest' (reabertura depois que o servidor fechou o
+    // anel anterior), o mais antigo ainda no anel, para não pular o que foi
+    // publicado enquanto o consumidor procurava o anel novo; os pacotes que
+    // já saíram dele contam como perdidos.
+    bool open(const std::string& ring_name, bool from_oldest = false);
+
+    // Copia o próximo pacote para 'out'. Retorna o tamanho, 0 se ainda não
+    // há pacote novo, ou -1 se o servidor fechou o anel.
+    int read(char* out, size_t capacity);
+
+    // Pacotes perdidos por o consumidor ter ficado para trás, somados em
+    // todas as aberturas
+    uint64_t lost_packets() const { return lost; }
+
+    void close();
+};
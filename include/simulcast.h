@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "resampler.h"
+
+// Simulcast: cada participante envia o mesmo quadro em várias qualidades.
+// Em vez de mandar a todos o PCM de 48 kHz (768 kbit/s por locutor), quem
+// fala codifica cada quadro também em PCM de 16 kHz e em µ-law de 8 kHz
+// (G.711) e envia as três camadas juntas em um pacote LAYER_SIMULCAST. O
+// servidor escolhe, para cada ouvinte, a melhor camada que cabe na banda
+// que ele informou (RECEIVER_REPORT) e repassa só essa fatia do pacote: o
+// servidor nunca decodifica nem recodifica áudio. O ouvinte converte a
+// camada recebida de volta para PCM de 48 kHz antes do buffer de jitter.
+//
+// O áudio de um pacote LAYER_SIMULCAST é [PCM48][PCM16K][µ-law 8K], com os
+// tamanhos de LAYER_BYTES; LAYER_SIMULCAST_16K omite o PCM48, e um pacote
+// de uma camada só traz apenas ela. Um pacote com vários quadros repete o
+// formato para cada quadro, em ordem.
+
+// Taxa do áudio de cada camada, em kbit/s
+constexpr int layer_kbps(int layer) {
+    return LAYER_BYTES[layer] * 8 * (SAMPLE_RATE / FRAMES_PER_BUFFER) / 1000;
+}
+
+// Folga exigida para subir de camada (evita alternar a cada relatório)
+constexpr double LAYER_UPGRADE_MARGIN = 1.25;
+
+// Codifica e decodifica uma amostra em µ-law (G.711)
+uint8_t ulaw_encode(int16_t sample);
+int16_t ulaw_decode(uint8_t code);
+
+// Melhor e pior camada presentes em um formato (o byte de camada do
+// cabeçalho); false se o formato for inválido
+bool format_layers(int format, int& first, int& last);
+
+// Formato com as camadas de 'first' a 'last'. Não há formato só com 48 kHz
+// e 16 kHz: esse intervalo vira as três camadas.
+int layers_format(int first, int last);
+
+// Camadas e quadros presentes no áudio de um pacote
+struct AudioLayout {
+    int first_layer;  // Melhor camada presente
+    int last_layer;   // Pior camada presente
+    int frames;       // Quadros de 20 ms
+    int frame_bytes;  // Bytes de um quadro (todas as camadas presentes)
+};
+
+// Interpreta o áudio de um pacote com o formato 'format' (o byte de camada
+// do cabeçalho). Retorna false se o tamanho não bater com o formato.
+bool parse_audio_layout(int format, size_t payload_size, AudioLayout& layout);
+
+// Copia para 'out' a camada 'layer' de todos os quadros do áudio. Retorna
+// o número de bytes escritos.
+int extract_layer(const AudioLayout& layout, std::string_view payload,
+                  int layer, char* out);
+
+// Copia para 'out' as camadas do formato 'format' de todos os quadros do
+// áudio. Retorna o número de bytes escritos (0 se o áudio não tiver todas
+// essas camadas).
+int extract_layers(const AudioLayout& layout, std::string_view payload,
+                   int format, char* out);
+
+// Copia de um quadro com as três camadas ('bundle', escrito pelo
+// SimulcastEncoder) as camadas do formato 'format'. Retorna os bytes escritos.
+int copy_layers(int format, const char* bundle, char* out);
+
+// Escolhe a camada para um ouvinte que suporta 'capacity_kbps' (0 = sem
+// limite) e recebe 'streams' locutores: a melhor cujo total cabe. Para
+// subir acima de 'current' é preciso folga de LAYER_UPGRADE_MARGIN.
+int choose_layer(int capacity_kbps, int streams, int current);
+
+// Lado de quem fala: gera as três camadas de um quadro
+class SimulcastEncoder {
+   private:
+    Resampler to_16k;
+    Resampler to_8k;
+    std::vector<float> input;
+    std::vector<float> output;
+
+   public:
+    SimulcastEncoder();
+
+    // Completa um pacote LAYER_SIMULCAST: 'payload' (MAX_AUDIO_PAYLOAD
+    // bytes) já começa com o quadro PCM de 48 kHz, e as outras camadas são
+    // escritas logo depois dele. Retorna o tamanho do áudio.
+    int encode(char* payload);
+};
+
+// Lado de quem ouve: converte qualquer camada de um locutor para PCM de
+// 48 kHz. Um por locutor, porque os conversores guardam histórico.
+class LayerDecoder {
+   private:
+    std::unique_ptr<Resampler> from_16k;
+    std::unique_ptr<Resampler> from_8k;
+    int last_layer = LAYER_PCM48;
+    std::vector<float> input;
+    std::vector<float> output;
+
+   public:
+    LayerDecoder();
+
+    // Decodifica o áudio de um pacote com o formato 'format' (de um pacote
+    // com várias camadas usa a melhor) para 'pcm48', com espaço para
+    // MAX_FRAMES_PER_PACKET quadros. Retorna o número de quadros
+    // decodificados, 0 se o áudio for inválido.
+    int decode(int format, std::string_view payload, char* pcm48);
+
+    // Camada do último quadro decodificado
+    int layer() const { return last_layer; }
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Rastreamento de latência ponta a ponta (boca-ouvido).
+// Cada etapa do caminho do áudio registra um evento com o instante
+// (steady_clock, monotônico), a etapa, o fluxo e o timestamp de mídia do
+// quadro, que identifica o mesmo quadro no cliente que fala, no servidor e
+// no cliente que ouve. Os eventos vão para um anel sem travas e, ao final,
+// são exportados no formato Chrome Trace (aberto no Perfetto ou em
+// chrome://tracing). O programa trace_report junta os arquivos de vários
+// processos e calcula os percentis de cada etapa.
+//
+// Ativado pela variável de ambiente VOIP_TRACE=<arquivo.json>. Desativado,
+// cada ponto de rastreio custa apenas a leitura de um booleano.
+
+// Etapas rastreadas, na ordem em que um quadro passa por elas
+enum TraceStage : uint8_t {
+    TRACE_CAPTURE = 0,        // read() do microfone retornou
+    TRACE_SEND = 1,           // sendto() do cliente que fala retornou
+    TRACE_RELAY_RECEIVE = 2,  // servidor recebeu o pacote
+    TRACE_RELAY_FORWARD = 3,  // servidor repassou o pacote
+    TRACE_RECEIVE = 4,        // cliente que ouve recebeu o pacote
+    TRACE_DEQUEUE = 5,        // quadro saiu do jitter buffer
+    TRACE_PLAYBACK = 6,       // write() nos alto-falantes retornou
+    TRACE_STAGE_COUNT = 7,
+};
+
+// Nome de cada etapa no arquivo exportado
+extern const char* const TRACE_STAGE_NAMES[TRACE_STAGE_COUNT];
+
+// Indica se o rastreamento está ativo (definido por trace_init)
+extern bool trace_enabled;
+
+// Lê VOIP_TRACE e prepara o anel de eventos. 'process_name' identifica o
+// processo no arquivo exportado (por exemplo "cliente" ou "servidor").
+// Deve ser chamada antes de iniciar as threads.
+void trace_init(const char* process_name);
+
+// Registra um evento no anel (implementação do trace_event)
+void trace_record(TraceStage stage, uint32_t stream, uint32_t frame);
+
+// Registra que o quadro 'frame' (timestamp de mídia) do fluxo 'stream'
+// passou pela etapa 'stage' agora
+inline void trace_event(TraceStage stage, uint32_t stream, uint32_t frame) {
+    if (trace_enabled) trace_record(stage, stream, frame);
+}
+
+// Exporta os eventos para o arquivo de VOIP_TRACE e imprime os percentis
+// das etapas observadas neste processo. Deve ser chamada após as threads
+// terminarem.
+void trace_finish();
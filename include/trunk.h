@@ -0,0 +1,205 @@
+#pragma once
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "rate_limit.h"
+#include "simulcast.h"
+
+// Servidores interligados (cascata).
+// Uma chamada pode ter participantes em servidores diferentes, um por
+// região. Cada servidor recebe um VOIP_RELAY_ID (0 a MAX_RELAYS - 1), que
+// define o bloco de identificadores de fluxo dos seus participantes, e a
+// lista dos outros servidores em VOIP_PEERS ("ip:porta,ip:porta"). Os
+// servidores formam uma malha completa: cada um envia o áudio dos seus
+// participantes diretamente a todos os outros, que o repassam só aos seus
+// participantes locais (nunca a outros servidores).
+//
+// Entre dois servidores há um único fluxo, o tronco: os quadros de vários
+// locutores locais que chegam juntos vão em um só datagrama TRUNK_DATA,
+// cada um com um subcabeçalho compacto, e só são separados em pacotes
+// AUDIO_DATA no servidor de destino. O datagrama sai quando já tem um
+// quadro de cada participante local ativo, TRUNK_FLUSH_MS após o primeiro
+// quadro, ou antes de passar da MTU do caminho (VOIP_TRUNK_MTU): um
+// datagrama fragmentado se perde inteiro com qualquer fragmento, então o
+// agrupamento nunca cria fragmentos além dos que um quadro sozinho já
+// teria.
+//
+// Cada quadro segue só com as camadas do simulcast (simulcast.h) que os
+// ouvintes dos vizinhos usam: cada servidor informa, no cabeçalho dos seus
+// TRUNK_DATA, o formato que cobre as camadas dos seus ouvintes (da melhor à
+// pior), e o tronco recorta o quadro para a união dos pedidos. Com os
+// ouvintes em 16 kHz, um quadro de PCM de 16 kHz (640 bytes) deixa dois
+// quadros por datagrama na MTU padrão, e um de µ-law, oito. Um servidor que
+// não envia áudio manda o cabeçalho sozinho uma vez por segundo, para que
+// os vizinhos saibam o que ele pede. O recorte por ouvinte continua sendo
+// feito no destino.
+//
+// Os vizinhos são reconhecidos pelo endereço de VOIP_PEERS, que qualquer um
+// pode forjar num datagrama UDP. Por isso todo datagrama do tronco
+// (TRUNK_DATA e SENDER_FEEDBACK entre servidores) termina com uma marca de
+// TRUNK_TAG_SIZE bytes: o SipHash-2-4 (session_token.h) do resto do
+// datagrama com a chave de VOIP_TRUNK_KEY, a mesma em todos os servidores.
+// Um datagrama sem a marca certa é descartado antes do limite do vizinho,
+// então quem forja pacotes não gasta o balde do servidor verdadeiro. A marca
+// não cifra o áudio nem impede que um datagrama capturado seja reenviado.
+//
+// Formato do TRUNK_DATA:
+//   [TRUNK_DATA][servidor de origem (1 byte)][número de quadros (1 byte)]
+//   [formato pedido pela origem (1 byte)] e, para cada quadro:
+//   [fluxo (1 byte)][camada (1 byte)][timestamp (4 bytes)]
+//   [tamanho (2 bytes)][áudio]
+//   e, no fim, [marca (TRUNK_TAG_SIZE bytes)]
+// (inteiros big-endian).
+
+// Espera máxima de um quadro pelos outros antes de o datagrama sair
+constexpr int TRUNK_FLUSH_MS = 5;
+
+// Cabeçalho do datagrama e subcabeçalho de cada quadro
+constexpr int TRUNK_HEADER_SIZE = 1 + 1 + 1 + 1;
+constexpr int TRUNK_FRAME_HEADER_SIZE = 1 + 1 + 4 + 2;
+
+// Marca de autenticação no fim de cada datagrama do tronco
+constexpr int TRUNK_TAG_SIZE = 8;
+
+// MTU padrão do caminho entre servidores e os cabeçalhos IPv4 + UDP que
+// ela precisa comportar
+constexpr int TRUNK_DEFAULT_MTU = 1500;
+constexpr int TRUNK_IP_UDP_OVERHEAD = 20 + 8;
+
+// Intervalo sem datagramas após o qual o cabeçalho, com o formato pedido,
+// sai sozinho
+constexpr int TRUNK_ANNOUNCE_MS = 1000;
+
+// Maior datagrama do tronco aceito: um quadro de cada participante local
+// (um vizinho pode ter sido configurado com uma MTU maior)
+constexpr int TRUNK_MAX_FRAMES = MAX_CLIENTS;
+constexpr int TRUNK_MAX_SIZE =
+    TRUNK_HEADER_SIZE +
+    TRUNK_MAX_FRAMES * (TRUNK_FRAME_HEADER_SIZE + MAX_AUDIO_PAYLOAD) +
+    TRUNK_TAG_SIZE;
+
+// Porta em que o servidor escuta: VOIP_PORT, ou PORT
+int relay_port();
+
+// Um quadro lido de um datagrama do tronco
+struct TrunkFrame {
+    int stream;
+    int layer;
+    uint32_t timestamp;
+    std::string_view payload;
+};
+
+// Lê o próximo quadro dos dados de um TRUNK_DATA (após o cabeçalho),
+// avançando 'rest'. Retorna false no fim ou se os dados forem inválidos.
+bool read_trunk_frame(std::string_view& rest, TrunkFrame& frame);
+
+// Tronco deste servidor com os demais
+class Trunk {
+   private:
+    int relay_id = 0;
+    std::vector<sockaddr_in> peers;
+
+    // Chave das marcas (VOIP_TRUNK_KEY)
+    uint8_t key[16] = {};
+    std::vector<TokenBucket> peer_buckets;
+
+    // Vizinho de cada VOIP_RELAY_ID, aprendido com os TRUNK_DATA (-1 se
+    // ainda não recebeu nada dele)
+    int relay_peers[MAX_RELAYS];
+
+    // Formato pedido por cada vizinho (todas as camadas até ele informar)
+    // e o pedido pelos ouvintes deste servidor
+    std::vector<int> peer_formats;
+    int wanted_format = LAYER_SIMULCAST;
+    std::chrono::steady_clock::time_point last_announce;
+
+    // Datagrama em montagem e os slots locais que já estão nele
+    std::vector<char> batch;
+    int batch_frames = 0;
+    uint32_t batch_slots = 0;
+    std::chrono::steady_clock::time_point batch_start;
+
+    // Maior datagrama montado sem fragmentar (MTU menos IPv4 e UDP)
+    size_t batch_budget = TRUNK_DEFAULT_MTU - TRUNK_IP_UDP_OVERHEAD;
+
+    // Estatísticas
+    uint64_t datagrams_sent = 0;
+    uint64_t frames_sent = 0;
+    uint64_t bytes_sent = 0;
+
+    // Formato dos quadros enviados: as camadas pedidas por algum vizinho
+    // que o pacote tem
+    int send_format(const AudioLayout& layout) const;
+
+    // Escreve a marca dos 'length' primeiros bytes de 'datagram' logo após
+    // eles (o buffer precisa de TRUNK_TAG_SIZE bytes livres). Retorna o
+    // tamanho com a marca.
+    size_t sign(char* datagram, size_t length) const;
+
+   public:
+    // Lê VOIP_RELAY_ID, VOIP_PEERS, VOIP_TRUNK_KEY e VOIP_TRUNK_MTU.
+    // Retorna false se forem inválidas ou se houver vizinhos sem chave.
+    bool configure();
+
+    bool enabled() const { return !peers.empty(); }
+
+    int id() const { return relay_id; }
+
+    // Primeiro identificador de fluxo dos participantes deste servidor
+    int stream_base() const { return relay_id * MAX_CLIENTS; }
+
+    // Índice do servidor vizinho com o endereço dado (-1 se não for um)
+    int find_peer(const sockaddr_in& address) const;
+
+    // Confere a marca no fim de um datagrama do tronco e a retira de
+    // 'datagram'; false se ela faltar ou não for a da chave
+    bool verify(std::string_view& datagram) const;
+
+    // Limite de pacotes de um vizinho; false se passou do limite
+    bool accept(int peer, std::chrono::steady_clock::time_point now);
+
+    // Registra, pelo cabeçalho de um TRUNK_DATA, que o vizinho 'peer' é o
+    // servidor 'relay' e o formato que os ouvintes dele pedem
+    void learn_relay(int peer, int relay, int format);
+
+    // Formato que cobre as camadas dos ouvintes deste servidor, informado
+    // aos vizinhos
+    void set_wanted_format(int format) { wanted_format = format; }
+
+    // Envia um pacote ao servidor 'relay'. Retorna false se ele ainda não
+    // é conhecido.
+    bool send_to_relay(int sock, int relay, const char* packet, size_t length);
+
+    // Acrescenta o quadro (pacote AUDIO_DATA com as camadas de 'layout')
+    // do slot local ao datagrama, só com as camadas que os vizinhos pedem.
+    // 'active_slots' tem um bit por participante local ativo: o datagrama
+    // sai assim que todos estiverem nele. Se o quadro não couber na MTU, o
+    // datagrama em montagem sai antes; um quadro maior que a MTU sai
+    // sozinho.
+    void add_frame(int sock, int slot, std::string_view audio_packet,
+                   const AudioLayout& layout, uint32_t active_slots,
+                   std::chrono::steady_clock::time_point now);
+
+    // Envia o datagrama se o prazo TRUNK_FLUSH_MS passou, e o cabeçalho
+    // sozinho após TRUNK_ANNOUNCE_MS sem datagramas
+    void poll(int sock, std::chrono::steady_clock::time_point now);
+
+    // Milissegundos até o prazo do datagrama em montagem (-1 se vazio)
+    int ms_until_flush(std::chrono::steady_clock::time_point now) const;
+
+    // Envia o datagrama em montagem a todos os vizinhos
+    void flush(int sock);
+
+    // Imprime quantos datagramas, quadros e bytes foram enviados
+    void print_stats() const;
+};
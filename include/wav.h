@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Leitura e escrita de arquivos WAV com áudio PCM de 16 bits.
+// Usados pelo backend de áudio em arquivo e pelas ferramentas de medição.
+
+// Lê as amostras de um arquivo WAV PCM de 16 bits
+class WavReader {
+   private:
+    std::FILE* file = nullptr;
+    int rate = 0;
+    int channel_count = 0;
+    long remaining_bytes = 0;
+
+   public:
+    ~WavReader();
+
+    // Abre o arquivo e lê o cabeçalho. Retorna false (com mensagem de erro)
+    // se o arquivo não existir ou não for PCM de 16 bits.
+    bool open(const std::string& path);
+
+    // Lê até 'frames' quadros (amostras de todos os canais) para 'buffer'.
+    // Retorna quantos quadros foram lidos, 0 no fim do arquivo.
+    int read(char* buffer, int frames);
+
+    int sample_rate() const { return rate; }
+    int channels() const { return channel_count; }
+};
+
+// Grava amostras PCM de 16 bits em um arquivo WAV
+class WavWriter {
+   private:
+    std::FILE* file = nullptr;
+    int channel_count = 0;
+    uint32_t data_bytes = 0;
+
+   public:
+    ~WavWriter();
+
+    // Cria o arquivo e escreve um cabeçalho provisório
+    bool open(const std::string& path, int sample_rate, int channels);
+
+    // Acrescenta 'frames' quadros de 'buffer' ao arquivo
+    void write(const char* buffer, int frames);
+
+    // Corrige os tamanhos no cabeçalho e fecha o arquivo
+    void close();
+};
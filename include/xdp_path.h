@@ -0,0 +1,141 @@
+#pragma once
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+
+// Caminho rápido AF_XDP para o áudio do servidor (apenas Linux, compilado
+// com -DVOIP_XDP).
+// Com VOIP_XDP=<interface>, um programa XDP carregado na interface desvia
+// para um socket AF_XDP os pacotes AUDIO_DATA que chegam na porta do
+// servidor; o resto (logins, relatórios, o tronco, fragmentos IP) segue
+// pela pilha de rede até o socket UDP de sempre. Os quadros AF_XDP chegam
+// inteiros (Ethernet, IP e UDP) em uma área de memória compartilhada com o
+// kernel (UMEM); o servidor lê o áudio direto de lá, e os pacotes
+// repassados aos clientes são montados em outros quadros da UMEM, com os
+// cabeçalhos reescritos, e enviados em lote: uma chamada de sistema por
+// rodada do loop, em vez de um sendto() por ouvinte.
+//
+// O programa é anexado em modo genérico (XDP_FLAGS_SKB_MODE) e o socket em
+// modo de cópia, que funcionam em qualquer interface, inclusive pares veth
+// (desenvolvimento e benchmarks); em placas com suporte a XDP nativo o
+// mesmo código funciona, só sem o ganho extra do modo zero-copy.
+//
+// Os endereços Ethernet para responder a um cliente são aprendidos dos
+// próprios pacotes dele, mas só depois que o servidor aceita o pacote para
+// a sessão (token e limites conferidos): um pacote forjado não muda a rota
+// de ninguém. As rotas ficam em uma tabela fixa, uma por slot de sessão,
+// sem alocação no caminho do áudio. Até o primeiro AUDIO_DATA aceito de um
+// cliente chegar pelo caminho AF_XDP, o envio para ele usa o socket UDP.
+
+// Tamanho de cada quadro da UMEM e número de quadros (16 MiB)
+constexpr uint32_t XDP_FRAME_SIZE = 4096;
+constexpr uint32_t XDP_FRAME_COUNT = 4096;
+
+// Posições de cada anel (recepção, envio, preenchimento e conclusão)
+constexpr uint32_t XDP_RING_SIZE = 2048;
+
+// Quadros lidos por rodada
+constexpr int XDP_RX_BATCH = 64;
+
+class XdpPath {
+   private:
+    // Anel produtor/consumidor compartilhado com o kernel
+    struct Ring {
+        uint32_t* producer = nullptr;
+        uint32_t* consumer = nullptr;
+        uint32_t* flags = nullptr;
+        void* entries = nullptr;
+        void* map = nullptr;
+        size_t map_size = 0;
+    };
+
+    // Cabeçalhos para responder a um cliente: endereços Ethernet, o IP
+    // local em que ele nos alcançou e o endereço do cliente a que valem
+    struct Route {
+        uint8_t local_mac[6];
+        uint8_t peer_mac[6];
+        uint32_t local_ip;
+        uint32_t peer_ip;
+        uint16_t peer_port;
+        bool known = false;
+    };
+
+    int xsk = -1;
+    int program = -1;
+    int map = -1;
+    int link = -1;
+    uint16_t port = 0;
+    char* umem = nullptr;
+    Ring rx, tx, fill, completion;
+    std::vector<uint64_t> free_frames;
+    uint32_t tx_pending = 0;
+    uint16_t ip_id = 0;
+
+    // Rota de cada slot de sessão, e a do pacote entregue ao handler em
+    // receive() (nula fora dele)
+    Route routes[MAX_CLIENTS];
+    const unsigned char* current_frame = nullptr;
+
+    // Estatísticas
+    uint64_t received = 0, sent = 0, send_fallbacks = 0, kicks = 0;
+
+    // MTU da interface: pacotes maiores vão pelo socket, que fragmenta
+    int mtu = 1500;
+
+    bool load_program(int ifindex);
+    bool create_socket(int ifindex);
+
+    // Devolve quadros livres ao anel de preenchimento e recolhe os quadros
+    // cujo envio terminou
+    void refill();
+    void reclaim();
+
+   public:
+    ~XdpPath() { close(); }
+
+    // Carrega o programa na interface e cria o socket AF_XDP para o áudio
+    // que chega em 'udp_port'. Retorna false (com mensagem) se não for
+    // possível; o servidor continua só com o socket UDP.
+    bool open(const std::string& interface, int udp_port);
+
+    bool is_open() const { return xsk >= 0; }
+
+    // Descritor para select(): legível quando há quadros recebidos
+    int fd() const { return xsk; }
+
+    // Lê até XDP_RX_BATCH pacotes e chama handler(dados UDP, remetente)
+    // para cada um. Retorna quantos foram lidos.
+    int receive(
+        const std::function<void(std::string_view, const sockaddr_in&)>&
+            handler);
+
+    // Chamado pelo handler de receive() quando o pacote foi aceito para a
+    // sessão 'slot': a rota do slot passa a ser a desse pacote. Fora do
+    // handler (pacote vindo do socket UDP) não faz nada.
+    void learn_route(int slot);
+
+    // Monta o pacote para 'to', o cliente da sessão 'slot', em um quadro de
+    // envio. Retorna false se a rota do slot ainda não é conhecida (ou é de
+    // outro endereço) ou não há quadro livre: o chamador envia pelo socket
+    // UDP.
+    bool send(int slot, const sockaddr_in& to, std::string_view payload);
+
+    // Entrega ao kernel os quadros montados desde a última chamada
+    void flush();
+
+    void print_stats() const;
+
+    void close();
+};
@@ -0,0 +1,105 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> deallocations{0};
+
+void* counted_malloc(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* counted_aligned_malloc(std::size_t size, std::align_val_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (align < sizeof(void*)) align = sizeof(void*);
+    void* block = nullptr;
+    if (posix_memalign(&block, align, size ? size : 1) != 0) return nullptr;
+    return block;
+}
+
+void counted_free(void* block) {
+    if (!block) return;
+    deallocations.fetch_add(1, std::memory_order_relaxed);
+    std::free(block);
+}
+}  // namespace
+
+uint64_t allocation_count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t deallocation_count() {
+    return deallocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+    if (void* block = counted_malloc(size)) return block;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return counted_malloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return counted_malloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* block = counted_aligned_malloc(size, alignment)) return block;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+    return counted_aligned_malloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+    return counted_aligned_malloc(size, alignment);
+}
+
+void operator delete(void* block) noexcept { counted_free(block); }
+void operator delete[](void* block) noexcept { counted_free(block); }
+void operator delete(void* block, std::size_t) noexcept { counted_free(block); }
+void operator delete[](void* block, std::size_t) noexcept {
+    counted_free(block);
+}
+void operator delete(void* block, const std::nothrow_t&) noexcept {
+    counted_free(block);
+}
+void operator delete[](void* block, const std::nothrow_t&) noexcept {
+    counted_free(block);
+}
+void operator delete(void* block, std::align_val_t) noexcept {
+    counted_free(block);
+}
+void operator delete[](void* block, std::align_val_t) noexcept {
+    counted_free(block);
+}
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept {
+    counted_free(block);
+}
+void operator delete[](void* block, std::size_t, std::align_val_t) noexcept {
+    counted_free(block);
+}
+void operator delete(void* block, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+    counted_free(block);
+}
+void operator delete[](void* block, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+    counted_free(block);
+}
@@ -1,5 +1,9 @@
-#include "audio.h"
+#include "portaudio_handler.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 #include "common.h"
@@ -20,14 +24,56 @@ PaSampleFormat getPaSampleFormat() {
     }
 }
 
-// Construtor da classe AudioHandler
-AudioHandler::AudioHandler() : inputStream(nullptr), outputStream(nullptr) {}
+// Escolhe a taxa de amostragem usada para abrir o dispositivo.
+// Usa a taxa nativa do dispositivo quando ela é diferente da taxa da rede,
+// aceita amostras em float e tem um número inteiro de amostras em 20 ms;
+// caso contrário usa SAMPLE_RATE (o driver converte, como antes).
+static int chooseDeviceRate(PaStreamParameters& parameters, bool input) {
+    const int native =
+        static_cast<int>(Pa_GetDeviceInfo(parameters.device)->defaultSampleRate);
+    if (SAMPLE_SIZE != 2 || native <= 0 || native == SAMPLE_RATE ||
+        (static_cast<long>(native) * FRAMES_PER_BUFFER) % SAMPLE_RATE != 0) {
+        return SAMPLE_RATE;
+    }
+
+    PaStreamParameters candidate = parameters;
+    candidate.sampleFormat = paFloat32;
+    PaError supported =
+        input ? Pa_IsFormatSupported(&candidate, NULL, native)
+              : Pa_IsFormatSupported(NULL, &candidate, native);
+    return supported == paFormatIsSupported ? native : SAMPLE_RATE;
+}
+
+// Converte amostras float em [-1, 1) para PCM de 16 bits, com saturação
+static void floatToPcm(const float* in, char* out, int count) {
+    for (int i = 0; i < count; ++i) {
+        float scaled = std::clamp(in[i] * 32768.0f, -32768.0f, 32767.0f);
+        int16_t sample = static_cast<int16_t>(std::lrint(scaled));
+        std::memcpy(out + i * sizeof(int16_t), &sample, sizeof(sample));
+    }
+}
+
+// Converte PCM de 16 bits para amostras float em [-1, 1)
+static void pcmToFloat(const char* in, float* out, int count) {
+    for (int i = 0; i < count; ++i) {
+        int16_t sample;
+        std::memcpy(&sample, in + i * sizeof(int16_t), sizeof(sample));
+        out[i] = sample * (1.0f / 32768.0f);
+    }
+}
 
-// Destrutor da classe AudioHandler
-AudioHandler::~AudioHandler() { terminate(); }
+// Construtor da classe PortAudioHandler
+PortAudioHandler::PortAudioHandler()
+    : inputStream(nullptr),
+      outputStream(nullptr),
+      captureFrames(FRAMES_PER_BUFFER),
+      playbackFrames(FRAMES_PER_BUFFER) {}
+
+// Destrutor da classe PortAudioHandler
+PortAudioHandler::~PortAudioHandler() { terminate(); }
 
 // Inicializa a biblioteca PortAudio
-bool AudioHandler::init() {
+bool PortAudioHandler::init() {
     // Tenta inicializar a biblioteca PortAudio
     // A função Pa_Initialize() prepara a biblioteca para ser usada.
     PaError err = Pa_Initialize();
@@ -42,7 +88,7 @@ bool AudioHandler::init() {
 }
 
 // Desaloca os recursos utilizados pela biblioteca PortAudio
-void AudioHandler::terminate() {
+void PortAudioHandler::terminate() {
     // Para o fluxo de captura de áudio, se estiver ativo
     if (inputStream) {
         Pa_StopStream(inputStream);
@@ -61,8 +107,10 @@ void AudioHandler::terminate() {
     Pa_Terminate();
 }
 
-// Inicia o fluxo de captura de áudio
-void AudioHandler::startCapture() {
+// Abre o fluxo de captura de áudio
+bool PortAudioHandler::openCapture() {
+    if (inputStream) return true;  // Já está aberto
+
     // O tipo de dado 'PaStreamParameters' é utilizado para definir os
     // parâmetros de entrada e saída de áudio na biblioteca PortAudio.
     PaStreamParameters inputParameters;
@@ -74,7 +122,7 @@ void AudioHandler::startCapture() {
     if (inputParameters.device == paNoDevice) {
         std::cerr << "Erro: Nenhum dispositivo de entrada padrão encontrado."
                   << std::endl;
-        return;  // Encerra com o erro
+        return false;  // Encerra com o erro
     }
 
     // Preenchemos o número de canais e a profundidade de bits com os valores do
@@ -84,31 +132,59 @@ void AudioHandler::startCapture() {
 
     if (inputParameters.sampleFormat == paCustomFormat) {
         std::cerr << "Erro: Formato de amostra não suportado." << std::endl;
-        return;  // Encerra com o erro
+        return false;  // Encerra com o erro
     }
 
     inputParameters.suggestedLatency =
         Pa_GetDeviceInfo(inputParameters.device)->defaultLowInputLatency;
     inputParameters.hostApiSpecificStreamInfo = NULL;
 
+    // Abre na taxa nativa do microfone quando possível, convertendo para a
+    // taxa da rede com o conversor polifásico
+    const int deviceRate = chooseDeviceRate(inputParameters, true);
+    captureFrames = FRAMES_PER_BUFFER;
+    captureResampler.reset();
+    if (deviceRate != SAMPLE_RATE) {
+        inputParameters.sampleFormat = paFloat32;
+        captureFrames = deviceRate * FRAMES_PER_BUFFER / SAMPLE_RATE;
+        captureResampler = std::make_unique<Resampler>(
+            deviceRate, SAMPLE_RATE, captureFrames);
+        captureDeviceBuffer.assign(captureFrames * NUM_CHANNELS, 0.0f);
+        captureNetworkBuffer.assign(
+            captureResampler->max_output(captureFrames) * NUM_CHANNELS, 0.0f);
+        std::cout << "Microfone em " << deviceRate << " Hz, convertido para "
+                  << SAMPLE_RATE << " Hz (atraso "
+                  << captureResampler->delay_seconds() * 1000.0 << " ms)."
+                  << std::endl;
+    }
+
     // Tenta abrir o fluxo de captura de áudio
     PaError err =
-        Pa_OpenStream(&inputStream, &inputParameters, NULL, SAMPLE_RATE,
-                      FRAMES_PER_BUFFER, paClipOff, NULL, NULL);
+        Pa_OpenStream(&inputStream, &inputParameters, NULL, deviceRate,
+                      captureFrames, paClipOff, NULL, NULL);
 
     // Verifica se houve erro ao abrir o fluxo
     if (err != paNoError) {
         std::cerr << "Erro de PortAudio: Pa_OpenStream() falhou: "
                   << Pa_GetErrorText(err) << std::endl;
-        return;  // Encerra com o erro
+        return false;  // Encerra com o erro
     }
 
+    return true;
+}
+
+// Inicia o fluxo de captura de áudio
+void PortAudioHandler::startCapture() {
+    if (!openCapture()) return;
+
     // Se o stream foi aberto com sucesso, o Pa_StartStream o ativa
     Pa_StartStream(inputStream);  // Microfone começa a capturar áudio
 }
 
-// Inicia o fluxo de reprodução de áudio
-void AudioHandler::startPlayback() {
+// Abre o fluxo de reprodução de áudio
+bool PortAudioHandler::openPlayback() {
+    if (outputStream) return true;  // Já está aberto
+
     // O tipo de dado 'PaStreamParameters' é utilizado para definir os
     // parâmetros de entrada e saída de áudio na biblioteca PortAudio.
     PaStreamParameters outputParameters;
@@ -120,7 +196,7 @@ void AudioHandler::startPlayback() {
     if (outputParameters.device == paNoDevice) {
         std::cerr << "Erro: Nenhum dispositivo de saída padrão encontrado."
                   << std::endl;
-        return;  // Encerra com o erro
+        return false;  // Encerra com o erro
     }
 
     // Preenchemos o número de canais e a profundidade de bits com os valores do
@@ -130,54 +206,107 @@ void AudioHandler::startPlayback() {
 
     if (outputParameters.sampleFormat == paCustomFormat) {
         std::cerr << "Erro: Formato de amostra não suportado." << std::endl;
-        return;  // Encerra com o erro
+        return false;  // Encerra com o erro
     }
 
     outputParameters.suggestedLatency =
         Pa_GetDeviceInfo(outputParameters.device)->defaultLowOutputLatency;
     outputParameters.hostApiSpecificStreamInfo = NULL;
 
+    // Abre na taxa nativa dos alto-falantes quando possível, convertendo a
+    // partir da taxa da rede com o conversor polifásico
+    const int deviceRate = chooseDeviceRate(outputParameters, false);
+    playbackFrames = FRAMES_PER_BUFFER;
+    playbackResampler.reset();
+    if (deviceRate != SAMPLE_RATE) {
+        outputParameters.sampleFormat = paFloat32;
+        playbackFrames = deviceRate * FRAMES_PER_BUFFER / SAMPLE_RATE;
+        playbackResampler = std::make_unique<Resampler>(
+            SAMPLE_RATE, deviceRate, 2 * FRAMES_PER_BUFFER);
+        playbackNetworkBuffer.assign(2 * FRAMES_PER_BUFFER * NUM_CHANNELS,
+                                     0.0f);
+        playbackDeviceBuffer.assign(
+            playbackResampler->max_output(2 * FRAMES_PER_BUFFER) *
+                NUM_CHANNELS,
+            0.0f);
+        std::cout << "Alto-falantes em " << deviceRate
+                  << " Hz, convertido de " << SAMPLE_RATE << " Hz (atraso "
+                  << playbackResampler->delay_seconds() * 1000.0 << " ms)."
+                  << std::endl;
+    }
+
     // Tenta abrir o fluxo de reprodução de áudio
     PaError err =
-        Pa_OpenStream(&outputStream, NULL, &outputParameters, SAMPLE_RATE,
-                      FRAMES_PER_BUFFER, paClipOff, NULL, NULL);
+        Pa_OpenStream(&outputStream, NULL, &outputParameters, deviceRate,
+                      playbackFrames, paClipOff, NULL, NULL);
 
     // Verifica se houve erro ao abrir o fluxo
     if (err != paNoError) {
         std::cerr << "Erro de PortAudio: Pa_OpenStream() falhou: "
                   << Pa_GetErrorText(err) << std::endl;
 
-        return;  // Encerra com o erro
+        return false;  // Encerra com o erro
     }
 
+    return true;
+}
+
+// Inicia o fluxo de reprodução de áudio
+void PortAudioHandler::startPlayback() {
+    if (!openPlayback()) return;
+
     // Se o stream foi aberto com sucesso, o Pa_StartStream o ativa
     Pa_StartStream(outputStream);  // Alto-falante começa a reproduzir áudio
 }
 
 // Para o fluxo de captura de áudio
-void AudioHandler::stopCapture() {
+void PortAudioHandler::stopCapture() {
     if (inputStream) Pa_StopStream(inputStream);
 }
 
 // Para o fluxo de reprodução de áudio
-void AudioHandler::stopPlayback() {
+void PortAudioHandler::stopPlayback() {
     if (outputStream) Pa_StopStream(outputStream);
 }
 
 // Lê um bloco de áudio do microfone e armazena no 'buffer' fornecido
-int AudioHandler::read(char* buffer) {
+int PortAudioHandler::read(char* buffer) {
     // Retorna erro se o stream não estiver ativo
     if (!inputStream) return paBadStreamPtr;
 
     // A função Pa_ReadStream coleta os dados do hardware de entrada
     // e os armazena no buffer fornecido.
-    return Pa_ReadStream(inputStream, buffer, FRAMES_PER_BUFFER);
+    if (!captureResampler) {
+        return Pa_ReadStream(inputStream, buffer, FRAMES_PER_BUFFER);
+    }
+
+    // Dispositivo em outra taxa: lê 20 ms na taxa nativa e converte
+    PaError err =
+        Pa_ReadStream(inputStream, captureDeviceBuffer.data(), captureFrames);
+    int produced = captureResampler->process(captureDeviceBuffer.data(),
+                                             captureFrames,
+                                             captureNetworkBuffer.data());
+    produced = std::min(produced, FRAMES_PER_BUFFER);
+    std::fill(captureNetworkBuffer.begin() + produced,
+              captureNetworkBuffer.begin() + FRAMES_PER_BUFFER, 0.0f);
+    floatToPcm(captureNetworkBuffer.data(), buffer, FRAMES_PER_BUFFER);
+    return err;
 }
 
 // Pega um bloco de áudio armazenado no 'buffer' e o envia para a saída de áudio
-int AudioHandler::write(const char* buffer) {
+int PortAudioHandler::write(const char* buffer, int frames) {
     // Retorna erro se o stream não estiver ativo
     if (!outputStream) return paBadStreamPtr;
     // A função Pa_WriteStream envia os dados do buffer para o hardware de saída
-    return Pa_WriteStream(outputStream, buffer, FRAMES_PER_BUFFER);
-}
\ No newline at end of file
+    if (!playbackResampler) {
+        return Pa_WriteStream(outputStream, buffer, frames);
+    }
+
+    // Dispositivo em outra taxa: converte o bloco para a taxa nativa
+    frames = std::min(frames, 2 * FRAMES_PER_BUFFER);
+    pcmToFloat(buffer, playbackNetworkBuffer.data(), frames);
+    int produced = playbackResampler->process(playbackNetworkBuffer.data(),
+                                              frames,
+                                              playbackDeviceBuffer.data());
+    return Pa_WriteStream(outputStream, playbackDeviceBuffer.data(), produced);
+}
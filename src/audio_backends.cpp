@@ -0,0 +1,158 @@
+#include "audio_backends.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifndef VOIP_NO_PORTAUDIO
+#include "portaudio_handler.h"
+#endif
+
+namespace {
+// Folga do buffer de saída simulado (dois blocos, como um dispositivo real
+// com latência baixa)
+constexpr std::chrono::microseconds PLAYBACK_BUFFER(40000);
+
+// Se o chamador atrasar mais que isso, o relógio simulado é reiniciado
+// (equivalente a um underrun/overrun do dispositivo)
+constexpr std::chrono::milliseconds PACER_MAX_LAG(100);
+
+// Capacidade do loopback: um segundo de áudio
+constexpr size_t LOOPBACK_CAPACITY = SAMPLE_RATE * SAMPLE_SIZE * NUM_CHANNELS;
+
+// Tamanho em bytes de 'frames' quadros
+constexpr size_t frame_bytes(int frames) {
+    return static_cast<size_t>(frames) * SAMPLE_SIZE * NUM_CHANNELS;
+}
+}  // namespace
+
+void FramePacer::wait(int frames) {
+    const auto now = std::chrono::steady_clock::now();
+    if (!started || now - deadline > PACER_MAX_LAG) {
+        deadline = now;
+        started = true;
+    }
+    deadline += std::chrono::microseconds(
+        static_cast<long long>(frames) * 1000000 / SAMPLE_RATE);
+    std::this_thread::sleep_until(deadline - buffered);
+}
+
+NullAudioHandler::NullAudioHandler() : playback_pacer(PLAYBACK_BUFFER) {}
+
+int NullAudioHandler::read(char* buffer) {
+    capture_pacer.wait(FRAMES_PER_BUFFER);
+    std::memset(buffer, 0, AUDIO_BUFFER_SIZE);
+    return 0;
+}
+
+int NullAudioHandler::write(const char*, int frames) {
+    playback_pacer.wait(frames);
+    return 0;
+}
+
+WavAudioHandler::WavAudioHandler(const std::string& input_path,
+                                 const std::string& output_path)
+    : input_path(input_path),
+      output_path(output_path),
+      playback_pacer(PLAYBACK_BUFFER) {}
+
+bool WavAudioHandler::init() {
+    if (!input_path.empty()) {
+        if (!reader.open(input_path)) return false;
+        if (reader.sample_rate() != SAMPLE_RATE ||
+            reader.channels() != NUM_CHANNELS) {
+            std::cerr << "O arquivo " << input_path << " deve ter "
+                      << SAMPLE_RATE << " Hz e " << NUM_CHANNELS << " canal."
+                      << std::endl;
+            return false;
+        }
+        has_input = true;
+    }
+    if (!output_path.empty()) {
+        if (!writer.open(output_path, SAMPLE_RATE, NUM_CHANNELS)) return false;
+        has_output = true;
+    }
+    return true;
+}
+
+void WavAudioHandler::terminate() {
+    if (has_output) writer.close();
+    has_output = false;
+}
+
+int WavAudioHandler::read(char* buffer) {
+    capture_pacer.wait(FRAMES_PER_BUFFER);
+    int frames = has_input ? reader.read(buffer, FRAMES_PER_BUFFER) : 0;
+    std::memset(buffer + frame_bytes(frames), 0,
+                frame_bytes(FRAMES_PER_BUFFER - frames));
+    return 0;
+}
+
+int WavAudioHandler::write(const char* buffer, int frames) {
+    playback_pacer.wait(frames);
+    if (has_output) writer.write(buffer, frames);
+    return 0;
+}
+
+LoopbackAudioHandler::LoopbackAudioHandler()
+    : ring(LOOPBACK_CAPACITY), playback_pacer(PLAYBACK_BUFFER) {}
+
+int LoopbackAudioHandler::read(char* buffer) {
+    capture_pacer.wait(FRAMES_PER_BUFFER);
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    const size_t wanted = frame_bytes(FRAMES_PER_BUFFER);
+    const size_t available = std::min(count, wanted);
+    for (size_t i = 0; i < available; ++i) {
+        buffer[i] = ring[(read_pos + i) % ring.size()];
+    }
+    read_pos = (read_pos + available) % ring.size();
+    count -= available;
+    std::memset(buffer + available, 0, wanted - available);
+    return 0;
+}
+
+int LoopbackAudioHandler::write(const char* buffer, int frames) {
+    playback_pacer.wait(frames);
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    const size_t bytes = frame_bytes(frames);
+    for (size_t i = 0; i < bytes; ++i) {
+        ring[(read_pos + count) % ring.size()] = buffer[i];
+        if (count < ring.size()) {
+            ++count;
+        } else {
+            read_pos = (read_pos + 1) % ring.size();
+        }
+    }
+    return 0;
+}
+
+std::unique_ptr<AudioHandler> create_audio_handler() {
+    const char* variable = std::getenv("VOIP_AUDIO");
+    const std::string spec = variable ? variable : "";
+
+    if (spec.empty() || spec == "portaudio") {
+#ifdef VOIP_NO_PORTAUDIO
+        std::cerr << "Compilado sem PortAudio, usando o backend nulo."
+                  << std::endl;
+        return std::make_unique<NullAudioHandler>();
+#else
+        return std::make_unique<PortAudioHandler>();
+#endif
+    }
+    if (spec == "null") return std::make_unique<NullAudioHandler>();
+    if (spec == "loopback") return std::make_unique<LoopbackAudioHandler>();
+    if (spec.compare(0, 4, "wav:") == 0) {
+        const std::string paths = spec.substr(4);
+        const size_t comma = paths.find(',');
+        return std::make_unique<WavAudioHandler>(
+            paths.substr(0, comma),
+            comma == std::string::npos ? "" : paths.substr(comma + 1));
+    }
+
+    std::cerr << "VOIP_AUDIO inválida: '" << spec
+              << "' (use portaudio, null, loopback ou wav:<entrada>,<saida>)"
+              << std::endl;
+    return nullptr;
+}
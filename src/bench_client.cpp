@@ -0,0 +1,268 @@
+// Microbenchmarks do cliente (microbench.h): o pool de quadros, o jitter
+// buffer, sozinho e disputado entre uma thread que recebe e outra que toca,
+// e os kernels de áudio (mixagem, camadas do simulcast, cancelamento de eco, supressão de
+// ruído e FFT).
+//
+// Uso: bench_cliente [opções do microbench.h]
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "client_handler.h"
+#include "common.h"
+#include "dsp_simd.h"
+#include "echo_canceller.h"
+#include "fft.h"
+#include "frame_pool.h"
+#include "microbench.h"
+#include "noise_suppressor.h"
+#include "simulcast.h"
+
+namespace {
+// Quadros que a thread de recepção deixa acumular em cada jitter buffer
+// antes de esperar a de reprodução (dez vezes o normal)
+constexpr int CONTENTION_MAX_DEPTH = 50;
+
+// Locutores alimentados pela thread de recepção na disputa
+constexpr int CONTENTION_SPEAKERS = 4;
+
+// Quadro de fala sintética: soma de dois tons com um pouco de ruído
+std::vector<int16_t> make_frame(int seed) {
+    std::vector<int16_t> frame(FRAMES_PER_BUFFER);
+    uint32_t noise = 12345u + seed;
+    for (int i = 0; i < FRAMES_PER_BUFFER; ++i) {
+        noise = noise * 1103515245u + 12345u;
+        const double t = static_cast<double>(i) / SAMPLE_RATE;
+        frame[i] = static_cast<int16_t>(
+            4000 * std::sin(2 * M_PI * (220 + 40 * seed) * t) +
+            2000 * std::sin(2 * M_PI * 1300 * t) +
+            static_cast<int>((noise >> 16) % 600) - 300);
+    }
+    return frame;
+}
+
+std::vector<float> to_float(const std::vector<int16_t>& pcm) {
+    std::vector<float> samples(pcm.size());
+    for (size_t i = 0; i < pcm.size(); ++i) samples[i] = pcm[i] / 32768.0f;
+    return samples;
+}
+
+// Pool de quadros: um bloco alocado e liberado (sempre pelo cache da
+// thread) e rajadas maiores que o cache, que passam pela lista global
+void bench_frame_pool(BenchRunner& bench) {
+    bench.run("cliente/frame_pool/aloca_libera", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            FrameRef frame = frame_pool.allocate();
+            do_not_optimize(frame.data());
+        }
+    }, true);
+
+    constexpr int BURST = 4 * FRAME_POOL_CACHE_SIZE;
+    bench.run("cliente/frame_pool/rajada_" + std::to_string(BURST),
+              [&](uint64_t n) {
+                  FrameRef frames[BURST];
+                  for (uint64_t i = 0; i < n; ++i) {
+                      for (FrameRef& frame : frames) {
+                          frame = frame_pool.allocate();
+                      }
+                      for (FrameRef& frame : frames) frame.reset();
+                  }
+              },
+              true);
+}
+
+// Jitter buffer: cada operação é um quadro colocado e retirado pela mesma
+// thread, sem disputa
+void bench_jitter_buffer(BenchRunner& bench) {
+    const std::vector<int16_t> frame = make_frame(0);
+    const char* pcm = reinterpret_cast<const char*>(frame.data());
+    std::vector<char> out(AUDIO_BUFFER_SIZE);
+    SpeakerStream& speaker = speaker_streams[0];
+
+    bench.run("cliente/jitter_buffer/enqueue_dequeue", [&](uint64_t n) {
+        uint32_t timestamp = 0, popped;
+        int depth;
+        for (uint64_t i = 0; i < n; ++i) {
+            enqueue_frames(speaker, timestamp, pcm, 1);
+            timestamp += FRAMES_PER_BUFFER;
+            dequeue_frame(speaker, out.data(), popped, depth);
+        }
+        do_not_optimize(out.data());
+    }, true);
+
+    // Um pacote com MAX_FRAMES_PER_PACKET quadros: uma operação é o pacote
+    // inteiro colocado e retirado
+    std::vector<char> packet_pcm(MAX_FRAMES_PER_PACKET * AUDIO_BUFFER_SIZE);
+    for (int f = 0; f < MAX_FRAMES_PER_PACKET; ++f) {
+        std::memcpy(packet_pcm.data() + f * AUDIO_BUFFER_SIZE, pcm,
+                    AUDIO_BUFFER_SIZE);
+    }
+    bench.run("cliente/jitter_buffer/enqueue_dequeue_3_quadros",
+              [&](uint64_t n) {
+                  uint32_t timestamp = 0, popped;
+                  int depth;
+                  for (uint64_t i = 0; i < n; ++i) {
+                      enqueue_frames(speaker, timestamp, packet_pcm.data(),
+                                     MAX_FRAMES_PER_PACKET);
+                      timestamp += MAX_FRAMES_PER_PACKET * FRAMES_PER_BUFFER;
+                      while (dequeue_frame(speaker, out.data(), popped, depth)) {
+                      }
+                  }
+                  do_not_optimize(out.data());
+              },
+              true);
+
+    // Disputa: uma thread faz o papel de receive_thread_func() e coloca
+    // quadros nos jitter buffers de CONTENTION_SPEAKERS locutores; esta
+    // thread faz o papel de playback_thread_func(), dorme na variável de
+    // condição e retira um quadro de cada locutor por rodada. Uma operação
+    // é um quadro passado de uma thread para a outra.
+    bench.run("cliente/jitter_buffer/contencao_recepcao_reproducao",
+              [&](uint64_t n) {
+                  const uint64_t rounds = (n + CONTENTION_SPEAKERS - 1) /
+                                          CONTENTION_SPEAKERS;
+                  std::atomic<uint64_t> played{0};
+                  std::thread receiver([&] {
+                      uint32_t timestamp = 0;
+                      for (uint64_t r = 0; r < rounds; ++r) {
+                          // Não deixa as filas crescerem sem limite
+                          while (r - played.load(std::memory_order_relaxed) >
+                                 CONTENTION_MAX_DEPTH) {
+                              std::this_thread::yield();
+                          }
+                          for (int s = 0; s < CONTENTION_SPEAKERS; ++s) {
+                              enqueue_frames(speaker_streams[s], timestamp, pcm,
+                                             1);
+                          }
+                          timestamp += FRAMES_PER_BUFFER;
+                      }
+                  });
+
+                  uint32_t popped;
+                  int depth;
+                  for (uint64_t r = 0; r < rounds; ++r) {
+                      for (int s = 0; s < CONTENTION_SPEAKERS; ++s) {
+                          SpeakerStream& stream = speaker_streams[s];
+                          while (!dequeue_frame(stream, out.data(), popped,
+                                                depth)) {
+                              std::unique_lock<std::mutex> lock(
+                                  jitter_buffer_mutex);
+                              jitter_buffer_cond.wait(lock, [&] {
+                                  return !stream.jitter_buffer.empty();
+                              });
+                          }
+                      }
+                      played.store(r + 1, std::memory_order_relaxed);
+                  }
+                  receiver.join();
+                  do_not_optimize(out.data());
+              });
+}
+
+// Camadas do simulcast: codificação de quem fala e decodificação de quem
+// ouve, para cada camada
+void bench_simulcast(BenchRunner& bench) {
+    const std::vector<int16_t> frame = make_frame(1);
+    std::vector<char> payload(MAX_AUDIO_PAYLOAD);
+    SimulcastEncoder encoder;
+
+    bench.run("dsp/simulcast_encode", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::memcpy(payload.data(), frame.data(), AUDIO_BUFFER_SIZE);
+            do_not_optimize(encoder.encode(payload.data()));
+        }
+    });
+
+    // Um pacote de cada camada, recortado do pacote com as três
+    std::memcpy(payload.data(), frame.data(), AUDIO_BUFFER_SIZE);
+    encoder.encode(payload.data());
+    const char* layers[LAYER_COUNT] = {
+        payload.data(), payload.data() + LAYER_BYTES[LAYER_PCM48],
+        payload.data() + LAYER_BYTES[LAYER_PCM48] + LAYER_BYTES[LAYER_PCM16K]};
+    const char* names[LAYER_COUNT] = {"pcm48", "pcm16k", "ulaw8k"};
+    std::vector<char> pcm48(MAX_FRAMES_PER_PACKET * AUDIO_BUFFER_SIZE);
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        LayerDecoder decoder;
+        const std::string_view audio(layers[layer], LAYER_BYTES[layer]);
+        bench.run(std::string("dsp/layer_decode/") + names[layer],
+                  [&](uint64_t n) {
+                      for (uint64_t i = 0; i < n; ++i) {
+                          do_not_optimize(
+                              decoder.decode(layer, audio, pcm48.data()));
+                      }
+                  });
+    }
+}
+
+// Mixagem e processamento de um quadro de FRAMES_PER_BUFFER amostras
+void bench_dsp(BenchRunner& bench) {
+    const std::vector<int16_t> voice = make_frame(2);
+    std::vector<int16_t> mix(FRAMES_PER_BUFFER, 0);
+    bench.run("dsp/mix_pcm16/quadro", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            mix_pcm16(mix.data(), voice.data(), PCM16_UNITY_GAIN / 2,
+                      FRAMES_PER_BUFFER);
+            clobber_memory();
+        }
+    });
+
+    // O eco é a própria referência atenuada: o filtro tem o que adaptar
+    const std::vector<float> far = to_float(make_frame(3));
+    const std::vector<float> near = to_float(make_frame(4));
+    std::vector<float> captured(FRAMES_PER_BUFFER);
+    EchoCanceller canceller;
+    bench.run("dsp/echo_canceller/quadro", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            canceller.push_reference(far.data());
+            for (int s = 0; s < FRAMES_PER_BUFFER; ++s) {
+                captured[s] = 0.3f * far[s] + 0.5f * near[s];
+            }
+            canceller.process(captured.data());
+        }
+        do_not_optimize(captured.data());
+    });
+
+    NoiseSuppressor suppressor;
+    bench.run("dsp/noise_suppressor/quadro", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::copy(near.begin(), near.end(), captured.begin());
+            suppressor.process(captured.data());
+        }
+        do_not_optimize(captured.data());
+    });
+
+    for (int size : {AEC_FFT_SIZE, NS_FFT_SIZE}) {
+        FFT fft(size);
+        std::vector<float> in(size), re(size / 2 + 1), im(size / 2 + 1),
+            out(size);
+        std::copy(near.begin(), near.begin() + std::min(size, FRAMES_PER_BUFFER),
+                  in.begin());
+        bench.run("dsp/fft/ida_e_volta_" + std::to_string(size),
+                  [&](uint64_t n) {
+                      for (uint64_t i = 0; i < n; ++i) {
+                          fft.forward(in.data(), re.data(), im.data());
+                          fft.inverse(re.data(), im.data(), out.data());
+                      }
+                      do_not_optimize(out.data());
+                  });
+    }
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchRunner bench;
+    if (!bench.parse(argc, argv)) return 1;
+
+    bench_frame_pool(bench);
+    bench_jitter_buffer(bench);
+    bench_simulcast(bench);
+    bench_dsp(bench);
+    return bench.finish();
+}
@@ -0,0 +1,236 @@
+// Microbenchmarks do servidor (microbench.h): despacho de pacotes em
+// handle_received_packet(), busca e retomada de sessão e montagem das
+// mensagens do servidor.
+//
+// As sessões são falsas, com endereços 127.0.0.x numa mesma porta em que
+// um socket "ralo" está vinculado e nunca lê: os pacotes repassados passam
+// pela pilha de rede de verdade e o kernel descarta o excesso. As medidas
+// "sem envio" usam um socket inválido, em que cada sendto() falha na hora,
+// e isolam o processamento do servidor do custo da pilha.
+//
+// Uso: bench_servidor [opções do microbench.h]
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "congestion.h"
+#include "microbench.h"
+#include "server_handler.h"
+#include "session_token.h"
+#include "simulcast.h"
+
+namespace {
+// Socket que só tem o descritor: sendto() falha sem tocar a rede
+constexpr int NO_SOCKET = -1;
+
+// Token da sessão do slot 0 (os outros somam o slot)
+constexpr uint64_t BENCH_SESSION_TOKEN = 0x5e55105e55105e55ULL;
+
+// Cria um socket UDP em 127.0.0.1 numa porta livre. Retorna a porta (na
+// ordem da rede) em 'port'.
+int open_loopback_socket(uint16_t& port, bool any_address) {
+    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(any_address ? INADDR_ANY : INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (sock < 0 || bind(sock, (sockaddr*)&address, length) < 0 ||
+        getsockname(sock, (sockaddr*)&address, &length) < 0) {
+        perror("Erro ao criar o socket do benchmark");
+        return -1;
+    }
+    port = address.sin_port;
+    return sock;
+}
+
+// Preenche as 'count' primeiras sessões, em 127.0.0.10 em diante na porta
+// do ralo. O balde de pacotes é ilimitado: o benchmark envia muito mais
+// rápido que um cliente de verdade.
+void make_sessions(ClientInfo clients[MAX_CLIENTS], int count,
+                   uint16_t sink_port) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        ClientInfo& client = clients[i];
+        client = ClientInfo{};
+        client.address.sin_family = AF_INET;
+        client.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK + 9 + i);
+        client.address.sin_port = sink_port;
+        client.address_len = sizeof(client.address);
+        client.name = "participante" + std::to_string(i);
+        client.session_token = BENCH_SESSION_TOKEN + i;
+        client.is_active = i < count;
+        client.last_packet_time = std::chrono::steady_clock::now();
+        client.packet_bucket = TokenBucket(1e18, 1e18);
+    }
+}
+
+// Pacote AUDIO_DATA com as três camadas e o token 'token' no final, como
+// o cliente do slot 0 envia
+std::vector<char> make_audio_packet(uint64_t token) {
+    std::vector<char> packet(MAX_PACKET_SIZE);
+    packet[0] = AUDIO_DATA;
+    packet[1] = 0;
+    packet[AUDIO_LAYER_OFFSET] = LAYER_SIMULCAST;
+    std::vector<int16_t> tone(FRAMES_PER_BUFFER);
+    for (int i = 0; i < FRAMES_PER_BUFFER; ++i) {
+        tone[i] = static_cast<int16_t>((i % 96) < 48 ? 3000 : -3000);
+    }
+    std::memcpy(packet.data() + AUDIO_HEADER_SIZE, tone.data(),
+                AUDIO_BUFFER_SIZE);
+    SimulcastEncoder encoder;
+    const size_t length =
+        AUDIO_HEADER_SIZE + encoder.encode(packet.data() + AUDIO_HEADER_SIZE);
+    packet.resize(length + SESSION_TOKEN_SIZE);
+    write_session_token(token, packet.data() + length);
+    return packet;
+}
+
+// RECEIVER_REPORT com uma entrada por locutor
+std::vector<char> make_receiver_report(int speakers) {
+    std::vector<char> packet(RECEIVER_REPORT_HEADER_SIZE +
+                             speakers * FEEDBACK_ENTRY_SIZE);
+    packet[0] = RECEIVER_REPORT;
+    const uint32_t capacity = htonl(2000);
+    std::memcpy(packet.data() + 1, &capacity, sizeof(capacity));
+    packet[5] = static_cast<char>(speakers);
+    for (int s = 0; s < speakers; ++s) {
+        write_feedback(StreamFeedback{s, 0.01, 2.0, 0.5},
+                       packet.data() + RECEIVER_REPORT_HEADER_SIZE +
+                           s * FEEDBACK_ENTRY_SIZE);
+    }
+    return packet;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchRunner bench;
+    if (!bench.parse(argc, argv)) return 1;
+
+    uint16_t sink_port, local_port;
+    const int sink = open_loopback_socket(sink_port, true);
+    const int sock = open_loopback_socket(local_port, false);
+    if (sink < 0 || sock < 0) return 1;
+
+    static ClientInfo clients[MAX_CLIENTS];
+    const std::vector<char> audio = make_audio_packet(BENCH_SESSION_TOKEN);
+    const std::string_view audio_view(audio.data(), audio.size());
+
+    // Busca de sessão: o último slot (pior caso) e um endereço sem sessão
+    make_sessions(clients, MAX_CLIENTS, sink_port);
+    bench.run("servidor/find_client/16_sessoes_ultima", [&](uint64_t n) {
+        const sockaddr_in address = clients[MAX_CLIENTS - 1].address;
+        for (uint64_t i = 0; i < n; ++i) {
+            do_not_optimize(find_client(address, clients));
+        }
+    }, true);
+    bench.run("servidor/find_client/16_sessoes_ausente", [&](uint64_t n) {
+        sockaddr_in address = clients[0].address;
+        address.sin_port = htons(1);
+        for (uint64_t i = 0; i < n; ++i) {
+            do_not_optimize(find_client(address, clients));
+        }
+    }, true);
+
+    // Mensagem do servidor (entrada ou saída) para 15 participantes
+    const std::string message = "[SERVER] 'participante0' entrou na chamada.";
+    bench.run("servidor/broadcast_server_message/16_sessoes_sem_envio",
+              [&](uint64_t n) {
+                  for (uint64_t i = 0; i < n; ++i) {
+                      broadcast_server_message(NO_SOCKET, message, clients, 0);
+                  }
+              },
+              true);
+    bench.run("servidor/broadcast_server_message/16_sessoes", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            broadcast_server_message(sock, message, clients, 0);
+        }
+    }, true);
+
+    // Despacho do áudio: cada pacote sai para os outros participantes, na
+    // camada de cada um
+    for (int count : {2, 4, 16}) {
+        make_sessions(clients, count, sink_port);
+        for (int i = 0; i < count; ++i) {
+            clients[i].layer = i % 2 ? LAYER_PCM16K : LAYER_PCM48;
+        }
+        const std::string sessions = std::to_string(count) + "_sessoes";
+        bench.run("servidor/handle_received_packet/audio_" + sessions +
+                      "_sem_envio",
+                  [&](uint64_t n) {
+                      for (uint64_t i = 0; i < n; ++i) {
+                          handle_received_packet(NO_SOCKET, audio_view,
+                                                 clients[0].address,
+                                                 clients[0].address_len,
+                                                 clients);
+                      }
+                  },
+                  true);
+        bench.run("servidor/handle_received_packet/audio_" + sessions,
+                  [&](uint64_t n) {
+                      for (uint64_t i = 0; i < n; ++i) {
+                          handle_received_packet(sock, audio_view,
+                                                 clients[0].address,
+                                                 clients[0].address_len,
+                                                 clients);
+                      }
+                  },
+                  true);
+    }
+
+    // Relatório de recepção de um ouvinte com 15 locutores
+    make_sessions(clients, MAX_CLIENTS, sink_port);
+    const std::vector<char> report = make_receiver_report(MAX_CLIENTS - 1);
+    bench.run("servidor/handle_received_packet/receiver_report",
+              [&](uint64_t n) {
+                  const std::string_view view(report.data(), report.size());
+                  for (uint64_t i = 0; i < n; ++i) {
+                      handle_received_packet(NO_SOCKET, view,
+                                             clients[1].address,
+                                             clients[1].address_len, clients);
+                  }
+              },
+              true);
+
+    // Áudio de um endereço sem sessão, com um token que não é o da sessão:
+    // descartado antes do processamento
+    const std::vector<char> forged = make_audio_packet(BENCH_SESSION_TOKEN - 1);
+    const std::string_view forged_view(forged.data(), forged.size());
+    bench.run("servidor/handle_received_packet/descarte_sem_sessao",
+              [&](uint64_t n) {
+                  sockaddr_in stranger = clients[0].address;
+                  stranger.sin_addr.s_addr = htonl(INADDR_LOOPBACK + 200);
+                  for (uint64_t i = 0; i < n; ++i) {
+                      handle_received_packet(NO_SOCKET, forged_view, stranger,
+                                             sizeof(stranger), clients);
+                  }
+              },
+              true);
+
+    // Retomada de sessão: o NAT do participante troca a porta a cada
+    // pacote, e cada pacote passa a sessão para o novo endereço antes de
+    // ser repassado (compare com audio_2_sessoes_sem_envio)
+    make_sessions(clients, 2, sink_port);
+    bench.run("servidor/handle_received_packet/retomada_sessao_2_sessoes",
+              [&](uint64_t n) {
+                  sockaddr_in moving = clients[0].address;
+                  for (uint64_t i = 0; i < n; ++i) {
+                      moving.sin_port = htons(static_cast<uint16_t>(
+                          20000 + (ntohs(moving.sin_port) + 1) % 2));
+                      handle_received_packet(NO_SOCKET, audio_view, moving,
+                                             sizeof(moving), clients);
+                  }
+              },
+              true);
+
+    close(sock);
+    close(sink);
+    return bench.finish();
+}
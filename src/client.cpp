@@ -11,29 +11,93 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "client_handler.h"
 #include "common.h"
-
-// Instância global do motor de áudio (definida no client_utils.cpp)
-extern AudioHandler audio_handler;
+#include "discovery.h"
+#include "realtime.h"
+#include "session_token.h"
+#include "trace.h"
 
 // Função que aguarda o usuário pressionar Enter para encerrar o programa.
+// Enquanto isso aceita o comando "volume <fluxo> <0-100>", que ajusta o
+// volume de um locutor (o servidor informa o fluxo de cada participante).
+// Com VOIP_DURATION_SEC definida (execuções sem terminal, como testes e
+// benchmarks), encerra após esse número de segundos.
 void wait_for_enter() {
-    std::cin.get();
+    if (const char* duration = std::getenv("VOIP_DURATION_SEC")) {
+        std::this_thread::sleep_for(
+            std::chrono::duration<double>(std::atof(duration)));
+    } else {
+        std::string line;
+        while (std::getline(std::cin, line) && !line.empty()) {
+            std::istringstream command(line);
+            std::string word;
+            int stream = -1, percent = -1;
+            if (command >> word >> stream >> percent && word == "volume" &&
+                set_speaker_volume(stream, percent)) {
+                std::cout << "Volume do fluxo " << stream << ": "
+                          << std::clamp(percent, 0, 100) << "%" << std::endl;
+            } else {
+                std::cout << "Comando desconhecido. Use 'volume <fluxo> "
+                             "<0-100>' ou Enter para encerrar."
+                          << std::endl;
+            }
+        }
+    }
     running = false;
 }
 
+// Inicializa o backend de áudio, abre os fluxos dos dispositivos (sem
+// iniciá-los) e monta os grafos de processamento. Roda em paralelo com a
+// descoberta e o login; a enumeração de dispositivos do ALSA sozinha pode
+// levar centenas de milissegundos.
+bool prepare_audio() {
+    // Inicializa o motor de áudio (Suprime erros que a PortAudio pode gerar).
+    // Enquanto isso, mensagens de erro das outras threads também são
+    // suprimidas.
+#ifdef __linux__
+    suppress_alsa_errors(true);
+#endif
+    bool audio_ok = audio_handler->init();
+#ifdef __linux__
+    suppress_alsa_errors(false);
+#endif
+
+    // Verifica se a inicialização do PortAudio foi bem-sucedida.
+    if (!audio_ok || !audio_handler->openCapture() ||
+        !audio_handler->openPlayback()) {
+        std::cerr << "Erro ao inicializar o áudio." << std::endl;
+        return false;
+    }
+
+    // Monta os grafos de processamento de áudio antes de iniciar as threads.
+    build_audio_graphs();
+
+    std::cout << "Áudio pronto " << ms_since_startup() << " ms após o início."
+              << std::endl;
+    return true;
+}
+
 // Função principal do cliente
 int main(int argc, char* argv[]) {
+    // Marca o início, para medir o tempo até o primeiro áudio.
+    startup_time = std::chrono::steady_clock::now();
+
     // Verifica se tem argumentos suficientes
     if (argc < 2) {
-        std::cerr << "Uso: " << argv[0] << " <seu_nome> [IP do servidor]"
-                  << std::endl;
+        std::cerr << "Uso: " << argv[0]
+                  << " <seu_nome> [IP do servidor[:porta]]" << std::endl;
         std::cerr << "Se o IP do servidor não for fornecido, "
                      "será feita uma busca na rede local."
                   << std::endl;
@@ -52,10 +116,43 @@ int main(int argc, char* argv[]) {
     // Salva o nome do cliente
     const std::string client_name = argv[1];
 
+    // Verifica se o nome do cliente é válido
+    if (client_name.length() > MAX_NAME_LENGTH) {
+        std::cerr << "O nome deve ter no máximo " << MAX_NAME_LENGTH
+                  << " caracteres." << std::endl;
+        return 1;
+    }
+
+    // Lê a configuração do modo de baixa latência (VOIP_LOW_LATENCY).
+    realtime_init();
+
+    // Cria o backend de áudio (dispositivos do sistema ou VOIP_AUDIO)
+    audio_handler = create_audio_handler();
+    if (!audio_handler) {
+        return 1;
+    }
+
+    // Prepara o áudio em paralelo com a descoberta e o login, que são
+    // dominados pela espera da rede.
+    std::future<bool> audio_ready =
+        std::async(std::launch::async, prepare_audio);
+
     // Salva o IP do servidor se fornecido, ou descobre na rede local
     std::string server_ip;
+    int server_port = PORT;
     if (argc > 2) {
         server_ip = argv[2];
+
+        // Porta opcional, para servidores fora da porta padrão
+        const size_t colon = server_ip.find(':');
+        if (colon != std::string::npos) {
+            server_port = std::atoi(server_ip.c_str() + colon + 1);
+            server_ip.resize(colon);
+            if (server_port <= 0 || server_port > 65535) {
+                std::cerr << "Porta inválida." << std::endl;
+                return 1;
+            }
+        }
     } else {
         server_ip = discover_server_on_network();
         if (server_ip.empty()) {
@@ -63,27 +160,8 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    // Verifica se o nome do cliente é válido
-    if (client_name.length() > MAX_NAME_LENGTH) {
-        std::cerr << "O nome deve ter no máximo " << MAX_NAME_LENGTH
-                  << " caracteres." << std::endl;
-        return 1;
-    }
-
-// Inicializa o motor de áudio (Suprime erros que a PortAudio pode gerar)
-#ifdef __linux__
-    suppress_alsa_errors(true);
-#endif
-    bool audio_ok = audio_handler.init();
-#ifdef __linux__
-    suppress_alsa_errors(false);
-#endif
-
-    // Verifica se a inicialização do PortAudio foi bem-sucedida.
-    if (!audio_ok) {
-        std::cerr << "Erro ao inicializar o PortAudio." << std::endl;
-        return 1;
-    }
+    // Ativa o rastreamento de latência se VOIP_TRACE estiver definida.
+    trace_init("cliente");
 
     // Cria o socket
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
@@ -92,6 +170,9 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Recepção com busy polling no modo de baixa latência
+    enable_busy_poll(sock);
+
     // Cria a estrutura para definir o tempo de espera para receber pacotes.
 #ifdef _WIN32
     DWORD timeout = CLIENT_TIMEOUT_SEC * 1000;
@@ -105,7 +186,7 @@ int main(int argc, char* argv[]) {
     // Declara a estrutura para armazenar o endereço do servidor.
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;    // Define o tipo de endereço (IPv4)
-    server_addr.sin_port = htons(PORT);  // Define a porta do servidor
+    server_addr.sin_port = htons(server_port);  // Define a porta do servidor
     inet_pton(AF_INET, server_ip.c_str(), &server_addr.sin_addr);
 
     // Monta o pacote de login que será enviado ao servidor.
@@ -147,8 +228,31 @@ int main(int argc, char* argv[]) {
 
     try {
         // Esperando a thread de recebimento confirmar a conexão com o servidor.
+        // Enquanto ela não chega, reenvia o login: o servidor responde a um
+        // login repetido com o mesmo LOGIN_OK. Se o servidor mandou um
+        // cookie (está sob inundação), o reenvio o leva antes do nome.
         std::cout << "Aguardando confirmação do servidor..." << std::endl;
+        while (connection_future.wait_for(std::chrono::milliseconds(
+                   LOGIN_RETRY_MS)) != std::future_status::ready) {
+            const uint64_t cookie = login_cookie.load();
+            if (cookie != 0 && login_packet[0] == LOGIN_REQUEST) {
+                login_packet[0] = LOGIN_WITH_COOKIE;
+                login_packet.insert(login_packet.begin() + 1,
+                                    LOGIN_COOKIE_SIZE, 0);
+                write_session_token(cookie, login_packet.data() + 1);
+            }
+            sendto(sock, login_packet.data(), login_packet.size(), 0,
+                   (sockaddr*)&server_addr, sizeof(server_addr));
+        }
         connection_future.get();
+        std::cout << "Conectado " << ms_since_startup()
+                  << " ms após o início." << std::endl;
+
+        // Os fluxos de áudio já estão abertos (ou terminando de abrir);
+        // falta só iniciá-los nas threads de áudio.
+        if (!audio_ready.get()) {
+            throw std::runtime_error("Erro ao inicializar o áudio.");
+        }
 
         // Inicia a thread de input
         input_thread = std::thread(wait_for_enter);
@@ -167,10 +271,11 @@ int main(int argc, char* argv[]) {
     } catch (const std::exception& e) {
         // Se ocorrer um erro ao estabelecer a conexão, exibe a mensagem de erro
         // e encerra as threads.
-        std::cerr << "\n[ERRO] Não foi possível estabelecer a conexão."
-                  << std::endl;
+        std::cerr << "\n[ERRO] Não foi possível estabelecer a conexão: "
+                  << e.what() << std::endl;
         running = false;
         receiver.join();
+        wait_for_discovery_refresh();
 
         // Limpa o socket
 #ifdef _WIN32
@@ -197,6 +302,10 @@ int main(int argc, char* argv[]) {
     sender.join();
     receiver.join();
     player.join();
+    frame_pool.print_stats();
+
+    // Aguarda a atualização do cache de servidores (se houver).
+    wait_for_discovery_refresh();
 
 // Fecha o socket
 #ifdef _WIN32
@@ -206,6 +315,9 @@ int main(int argc, char* argv[]) {
     close(sock);
 #endif
 
+    // Exporta o rastreamento de latência (se ativo).
+    trace_finish();
+
     std::cout << "Programa encerrado." << std::endl;
 
     return 0;
@@ -11,114 +11,95 @@ using socklen_t = int;
 #include <cerrno>
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <future>
 #include <iostream>
 #include <mutex>
-#include <queue>
+#include <random>
 #include <string_view>
 #include <vector>
 
+#include "audio_nodes.h"
 #include "common.h"
+#include "realtime.h"
+#include "session_token.h"
+#include "simulcast.h"
+#include "trace.h"
 
 // Definição das variáveis globais (Documentação em client_utils.h)
 
 std::atomic<bool> running(false);
-std::queue<std::vector<char>> jitter_buffer;
+SpeakerStream speaker_streams[MAX_STREAMS];
 std::mutex jitter_buffer_mutex;
 std::condition_variable jitter_buffer_cond;
+std::atomic<int> local_stream_id(0);
+std::atomic<uint64_t> session_token(0);
+std::atomic<uint64_t> login_cookie(0);
 
 // Instância do motor de áudio em audio.h, responsável por capturar e reproduzir
-// áudio.
-AudioHandler audio_handler;
-
-// Função para descobrir o IP do servidor na rede local.
-std::string discover_server_on_network() {
-    std::cout << "IP do servidor não fornecido. Procurando na rede local..."
-              << std::endl;
-
-    // Cria um socket para enviar pacotes de broadcast
-    int broadcast_sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (broadcast_sock < 0) {
-        perror("Erro ao criar socket de broadcast");
-        return "";
-    }
+// áudio. Criada em main() com create_audio_handler().
+std::unique_ptr<AudioHandler> audio_handler;
 
-    // Habilitar a opção de broadcast no socket
-    int broadcast_enable = 1;
-#ifdef _WIN32
-    if (setsockopt(broadcast_sock, SOL_SOCKET, SO_BROADCAST,
-                   (const char*)&broadcast_enable,
-                   sizeof(broadcast_enable)) < 0) {
-#else
-    if (setsockopt(broadcast_sock, SOL_SOCKET, SO_BROADCAST, &broadcast_enable,
-                   sizeof(broadcast_enable)) < 0) {
-#endif
-        perror("Erro ao configurar socket para broadcast");
-#ifdef _WIN32
-        closesocket(broadcast_sock);
-#else
-        close(broadcast_sock);
-#endif
-        return "";
-    }
+std::chrono::steady_clock::time_point startup_time =
+    std::chrono::steady_clock::now();
 
-    // Definir um timeout para a resposta do servidor
-#ifdef _WIN32
-    DWORD timeout = DISCOVERY_TIMEOUT_SEC * 1000;
-    setsockopt(broadcast_sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout,
-               sizeof(timeout));
-#else
-    // Linux espera uma struct timeval
-    struct timeval tv = {DISCOVERY_TIMEOUT_SEC, 0};
-    setsockopt(broadcast_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-#endif
+double ms_since_startup() {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - startup_time)
+        .count();
+}
 
-    // Declara a estrutura de endereço para o broadcast
-    sockaddr_in broadcast_addr{};
-    broadcast_addr.sin_family = AF_INET;    // Define o tipo de endereço (IPv4)
-    broadcast_addr.sin_port = htons(PORT);  // Define a porta do servidor
-    // Endereço de broadcast
-    broadcast_addr.sin_addr.s_addr = inet_addr("255.255.255.255");
-
-    // Monta e envia o pacote de descoberta.
-    // O primeiro byte é o tipo do pacote (DISCOVERY_REQUEST) e o restante é
-    // vazio, pois não há dados adicionais.
-    char discovery_packet = DISCOVERY_REQUEST;
-    sendto(broadcast_sock, &discovery_packet, sizeof(discovery_packet), 0,
-           (sockaddr*)&broadcast_addr, sizeof(broadcast_addr));
-
-    // Monta um buffer para receber a resposta do servidor.
-    char response_buffer[1];
-    // Estrutura para armazenar o endereço do servidor que respondeu.
-    sockaddr_in server_response_addr{};
-    socklen_t server_addr_len = sizeof(server_response_addr);
-
-    // Espera pela resposta do servidor, preenche o buffer de resposta e salva
-    // o endereço do servidor que respondeu.
-    ssize_t n =
-        recvfrom(broadcast_sock, response_buffer, sizeof(response_buffer), 0,
-                 (sockaddr*)&server_response_addr, &server_addr_len);
-
-// Fecha o socket de broadcast após receber a resposta ou timeout.
-#ifdef _WIN32
-    closesocket(broadcast_sock);
-#else
-    close(broadcast_sock);
-#endif
+// Instância do cancelador de eco em echo_canceller.h
+EchoCanceller echo_canceller;
+
+PlaybackClock playback_clock;
+
+ClientAudioGraph capture_graph;
+ClientAudioGraph playback_graph;
+
+// Ajusta o volume de um locutor
+bool set_speaker_volume(int stream, int percent) {
+    if (stream < 0 || stream >= MAX_STREAMS) return false;
+    percent = std::clamp(percent, 0, 100);
+    speaker_streams[stream].gain = percent * PCM16_UNITY_GAIN / 100;
+    return true;
+}
+
+// Verifica se um nó opcional do grafo foi ativado (variável definida e
+// diferente de "0")
+static bool node_enabled(const char* variable) {
+    const char* value = std::getenv(variable);
+    return value && *value && std::strcmp(value, "0") != 0;
+}
 
-    // Se foi um pacote válido e o primeiro byte é DISCOVERY_RESPONSE,
-    // extrai o IP do servidor e retorna.
-    if (n > 0 && response_buffer[0] == DISCOVERY_RESPONSE) {
-        std::string server_ip = inet_ntoa(server_response_addr.sin_addr);
-        std::cout << "Servidor encontrado em: " << server_ip << std::endl;
-        return server_ip;
+// Monta os grafos de áudio do cliente
+void build_audio_graphs() {
+    // Captura: PCM -> cancelador de eco -> supressor de ruído -> PCM, tudo
+    // sobre o payload do pacote de envio. O passa-altas (VOIP_HIGH_PASS=1)
+    // e o AGC (VOIP_AGC=1) alteram o som do microfone e ficam desligados a
+    // menos que sejam pedidos.
+    capture_graph.add<PcmDecodeNode<FRAMES_PER_BUFFER, NUM_CHANNELS>>();
+    if (node_enabled("VOIP_HIGH_PASS")) {
+        capture_graph.add<HighPassNode<FRAMES_PER_BUFFER, NUM_CHANNELS>>();
+    }
+    capture_graph.add<EchoCancellerNode<FRAMES_PER_BUFFER, NUM_CHANNELS>>(
+        echo_canceller);
+    capture_graph.add<NoiseSuppressorNode<FRAMES_PER_BUFFER, NUM_CHANNELS>>();
+    if (node_enabled("VOIP_AGC")) {
+        capture_graph.add<AgcNode<FRAMES_PER_BUFFER, NUM_CHANNELS>>();
     }
+    capture_graph.add<PcmEncodeNode<FRAMES_PER_BUFFER, NUM_CHANNELS>>();
 
-    // Se não foi recebido nenhum pacote válido, imprime uma mensagem de erro.
-    std::cerr << "Nenhum servidor encontrado na rede." << std::endl;
-    return "";
+    // Reprodução: o áudio tocado é só copiado como referência do eco
+    playback_graph.add<PcmDecodeNode<FRAMES_PER_BUFFER, NUM_CHANNELS>>();
+    playback_graph.add<EchoReferenceNode<FRAMES_PER_BUFFER, NUM_CHANNELS>>(
+        echo_canceller);
 }
 
 #ifdef __linux__
@@ -140,45 +121,176 @@ void suppress_alsa_errors(bool suppress) {
 }
 #endif
 
+// Quadros entre dois relatórios RECEIVER_REPORT
+constexpr int RECEIVER_REPORT_FRAMES =
+    FEEDBACK_INTERVAL_MS * SAMPLE_RATE / FRAMES_PER_BUFFER / 1000;
+
+// Ajusta o modo de envio pelos SENDER_FEEDBACK do nosso fluxo
+static CongestionController congestion_controller;
+
+// Envia ao servidor a banda que suportamos para receber (0 = sem limite) e
+// as estatísticas de recepção de cada locutor no último intervalo
+static void send_receiver_report(int sock, const sockaddr_in& server_addr,
+                                 uint32_t capacity_kbps) {
+    char report[RECEIVER_REPORT_HEADER_SIZE +
+                MAX_STREAMS * FEEDBACK_ENTRY_SIZE];
+    report[0] = RECEIVER_REPORT;
+    const uint32_t network_capacity = htonl(capacity_kbps);
+    std::memcpy(report + 1, &network_capacity, sizeof(network_capacity));
+
+    int count = 0;
+    {
+        std::lock_guard<std::mutex> lock(jitter_buffer_mutex);
+        for (int stream = 0; stream < MAX_STREAMS; ++stream) {
+            StreamFeedback feedback;
+            if (!speaker_streams[stream].stats.take_report(stream, feedback)) {
+                continue;
+            }
+            write_feedback(feedback, report + RECEIVER_REPORT_HEADER_SIZE +
+                                         count * FEEDBACK_ENTRY_SIZE);
+            ++count;
+        }
+    }
+    report[RECEIVER_REPORT_HEADER_SIZE - 1] = static_cast<char>(count);
+    sendto(sock, report, RECEIVER_REPORT_HEADER_SIZE + count * FEEDBACK_ENTRY_SIZE,
+           0, (const sockaddr*)&server_addr, sizeof(server_addr));
+}
+
 // Thread que envia áudio para o servidor
 void send_thread_func(int sock, const sockaddr_in& server_addr) {
-    // Buffer para armazenar os dados de áudio capturados.
-    std::vector<char> audio_packet(1 + AUDIO_BUFFER_SIZE);
+    // Por padrão cada pacote leva as camadas de 16 kHz e 8 kHz, que cabem
+    // juntas em um datagrama sem fragmentar. VOIP_SIMULCAST=48 acrescenta o
+    // PCM de 48 kHz (pacotes fragmentados), e VOIP_SIMULCAST=0 envia uma
+    // camada só (o PCM de 48 kHz, enquanto a rede não estiver
+    // congestionada).
+    const char* simulcast_env = std::getenv("VOIP_SIMULCAST");
+    const int simulcast_value = simulcast_env ? std::atoi(simulcast_env) : 1;
+    const SimulcastMode simulcast = simulcast_value == 0    ? SIMULCAST_OFF
+                                    : simulcast_value == 48 ? SIMULCAST_48K
+                                                            : SIMULCAST_16K;
+    SimulcastEncoder encoder;
+
+    // Quadro capturado, seguido das outras camadas geradas pelo encoder
+    std::vector<char> frame(MAX_AUDIO_PAYLOAD);
+
+    // Banda de recepção informada ao servidor, em kbit/s (VOIP_MAX_KBPS)
+    const char* max_kbps_env = std::getenv("VOIP_MAX_KBPS");
+    const int max_kbps = max_kbps_env ? std::max(0, std::atoi(max_kbps_env)) : 0;
+
+    // Pacote em montagem, com espaço para o token da sessão no final. O
+    // modo de envio (camadas e quadros por pacote) só muda entre pacotes.
+    std::vector<char> audio_packet(MAX_PACKET_SIZE + SESSION_TOKEN_SIZE);
     audio_packet[0] = AUDIO_DATA;
+    SendMode mode = congestion_controller.mode(simulcast);
+    int packet_frames = 0;
+    size_t packet_length = AUDIO_HEADER_SIZE;
+    int frames_until_report = 0;
+
+    // Timestamp de mídia: posição do quadro em amostras desde o início da
+    // captura. Permite ao receptor medir a deriva do nosso relógio de áudio.
+    // Começa em um valor aleatório (como no RTP), o que também identifica
+    // os quadros de cada emissor no rastreamento de latência.
+    uint32_t timestamp = std::random_device{}();
+    bool first_packet = true;
+
+    // Com o modo de baixa latência, a captura roda em tempo real
+    realtime_thread("voip-envio", RT_PRIORITY_CAPTURE, 0);
 
     // Inicia a captura de áudio do microfone.
-    audio_handler.startCapture();
+    audio_handler->startCapture();
     std::cout << "Microfone ativado." << std::endl;
 
     // Loop principal
     while (running) {
         // Lê um bloco de áudio do microfone e armazena no buffer.
-        audio_handler.read(audio_packet.data() + 1);
+        audio_handler->read(frame.data());
+        trace_event(TRACE_CAPTURE, 0, timestamp);
+
+        // Processa o áudio capturado (eco, ruído, ganho) no próprio quadro.
+        capture_graph.process(frame.data());
+
+        // Gera as camadas de 16 kHz e 8 kHz depois do quadro original. Roda
+        // em todo quadro, para os conversores não perderem o histórico
+        // quando o modo de envio muda.
+        encoder.encode(frame.data());
+
+        // Primeiro quadro do pacote: escolhe o modo e escreve o formato e o
+        // timestamp do quadro no cabeçalho (big-endian).
+        if (packet_frames == 0) {
+            mode = congestion_controller.mode(simulcast);
+            audio_packet[AUDIO_LAYER_OFFSET] = static_cast<char>(mode.format);
+            uint32_t network_timestamp = htonl(timestamp);
+            std::memcpy(audio_packet.data() + AUDIO_TIMESTAMP_OFFSET,
+                        &network_timestamp, sizeof(network_timestamp));
+            packet_length = AUDIO_HEADER_SIZE;
+        }
+        packet_length += copy_layers(mode.format, frame.data(),
+                                     audio_packet.data() + packet_length);
+
+        // Com o pacote completo, escreve o fluxo e o token da sessão e envia
+        // o buffer de áudio para o servidor via UDP. Os dois são lidos a cada
+        // pacote: um LOGIN_OK repetido pode chegar depois do início.
+        if (++packet_frames == mode.frames) {
+            audio_packet[1] = static_cast<char>(local_stream_id.load());
+            write_session_token(session_token.load(),
+                                audio_packet.data() + packet_length);
+            sendto(sock, audio_packet.data(),
+                   packet_length + SESSION_TOKEN_SIZE, 0,
+                   (sockaddr*)&server_addr, sizeof(server_addr));
+            for (int i = 0; i < packet_frames; ++i) {
+                trace_event(TRACE_SEND, 0,
+                            timestamp - (packet_frames - 1 - i) *
+                                            FRAMES_PER_BUFFER);
+            }
+            packet_frames = 0;
+            if (first_packet) {
+                std::cout << "Primeiro áudio enviado " << ms_since_startup()
+                          << " ms após o início." << std::endl;
+                first_packet = false;
+            }
+        }
+
+        // Uma vez por segundo, informa a banda e a recepção ao servidor.
+        if (--frames_until_report <= 0) {
+            send_receiver_report(sock, server_addr, max_kbps);
+            frames_until_report = RECEIVER_REPORT_FRAMES;
+        }
 
-        // Envia o buffer de áudio para o servidor via UDP.
-        sendto(sock, audio_packet.data(), audio_packet.size(), 0,
-               (sockaddr*)&server_addr, sizeof(server_addr));
+        timestamp += FRAMES_PER_BUFFER;
     }
 
     // Para a captura de áudio quando o loop termina.
-    audio_handler.stopCapture();
+    audio_handler->stopCapture();
     std::cout << "Captura de áudio terminada." << std::endl;
+    capture_graph.print_stats("Grafo de captura");
+    echo_canceller.print_stats();
 }
 
 // Thread que recebe dados do servidor
 void receive_thread_func(int sock, std::promise<void> connection_promise) {
     // Buffer para armazenar os dados recebidos do servidor.
-    std::vector<char> receive_buffer(1 + AUDIO_BUFFER_SIZE);
+    std::vector<char> receive_buffer(MAX_PACKET_SIZE);
+    // Quadros decodificados de um pacote de áudio
+    std::vector<char> decoded(MAX_FRAMES_PER_PACKET * AUDIO_BUFFER_SIZE);
     // Flag para verificar se a conexão foi confirmada.
     bool connection_confirmed = false;
 
+    // Com o modo de baixa latência, a recepção roda em tempo real
+    realtime_thread("voip-recepcao", RT_PRIORITY_NETWORK, 1);
+
     // Loop principal
     while (running) {
         // Recebe pacotes de áudio do servidor via UDP, função 'recvfrom'
         // bloqueia até que um pacote chegue (ou o timeout em client.cpp
         // expirar).
-        ssize_t n = recvfrom(sock, receive_buffer.data(), receive_buffer.size(),
-                             0, nullptr, nullptr);
+        // No modo de baixa latência, gira um pouco esperando o pacote antes
+        // de dormir no recvfrom.
+        ssize_t n = spin_recvfrom(sock, receive_buffer.data(),
+                                  receive_buffer.size(), nullptr, nullptr);
+        if (n < 0) {
+            n = recvfrom(sock, receive_buffer.data(), receive_buffer.size(), 0,
+                         nullptr, nullptr);
+        }
 
         if (!running) {
             break;
@@ -238,10 +350,17 @@ void receive_thread_func(int sock, std::promise<void> connection_promise) {
         std::string_view data_view(receive_buffer.data() + 1, n - 1);
 
         // Verifica se a conexão foi confirmada.
-        // Se o tipo do pacote for LOGIN_OK ou SERVER_MESSAGE, a conexão
-        // é considerada estabelecida.
-        if (!connection_confirmed &&
-            (type == LOGIN_OK || type == SERVER_MESSAGE)) {
+        // Só o LOGIN_OK confirma: ele traz o identificador do nosso fluxo e
+        // o token da sessão, sem os quais o servidor descarta o nosso
+        // áudio. Uma mensagem do servidor pode chegar antes dele (ou sem
+        // ele, se o LOGIN_OK se perder).
+        const bool login_ok = type == LOGIN_OK && n >= 2 + SESSION_TOKEN_SIZE;
+        if (login_ok) {
+            local_stream_id = static_cast<uint8_t>(receive_buffer[1]);
+            session_token = read_session_token(receive_buffer.data() + 2);
+        }
+
+        if (!connection_confirmed && login_ok) {
             connection_confirmed = true;
             std::cout << "\n*** Conexão estabelecida! ***" << std::endl
                       << "Pressione Enter para encerrar." << std::endl;
@@ -252,17 +371,48 @@ void receive_thread_func(int sock, std::promise<void> connection_promise) {
 
         // Com base no tipo do pacote, processa os dados recebidos.
         switch (type) {
-            // Caso seja um pacote de áudio, adiciona ao jitter buffer.
+            // Caso seja um pacote de áudio, adiciona ao jitter buffer do
+            // locutor indicado pelo identificador do fluxo.
             case AUDIO_DATA: {
-                // lock_guard tranca o mutex no início do bloco e destranca
-                // automaticamente no final.
-                std::lock_guard<std::mutex> lock(jitter_buffer_mutex);
-
-                // Adiciona o pacote recebido ao final da fila
-                jitter_buffer.emplace(data_view.begin(), data_view.end());
+                if (n < AUDIO_HEADER_SIZE) break;
+                const int stream = static_cast<uint8_t>(receive_buffer[1]);
+                if (stream >= MAX_STREAMS) break;
+                SpeakerStream& speaker = speaker_streams[stream];
+
+                // Converte a camada recebida para PCM de 48 kHz (um ou
+                // mais quadros).
+                const int format =
+                    static_cast<uint8_t>(receive_buffer[AUDIO_LAYER_OFFSET]);
+                const int frames = speaker.decoder.decode(
+                    format,
+                    std::string_view(receive_buffer.data() + AUDIO_HEADER_SIZE,
+                                     n - AUDIO_HEADER_SIZE),
+                    decoded.data());
+                if (frames == 0) break;
+
+                // Registra a chegada com o timestamp de mídia do emissor.
+                uint32_t network_timestamp;
+                std::memcpy(&network_timestamp,
+                            receive_buffer.data() + AUDIO_TIMESTAMP_OFFSET,
+                            sizeof(network_timestamp));
+                const uint32_t timestamp = ntohl(network_timestamp);
+                for (int i = 0; i < frames; ++i) {
+                    trace_event(TRACE_RECEIVE, stream,
+                                timestamp + i * FRAMES_PER_BUFFER);
+                }
+                speaker.drift.on_packet(timestamp);
 
-                // Avisa a thread de playback que há novos pacotes disponíveis.
-                jitter_buffer_cond.notify_one();
+                enqueue_frames(speaker, timestamp, decoded.data(), frames);
+                break;
+            }
+            // Recepção do nosso fluxo nos outros participantes.
+            case SENDER_FEEDBACK: {
+                if (n < 1 + FEEDBACK_ENTRY_SIZE) break;
+                const StreamFeedback feedback =
+                    read_feedback(receive_buffer.data() + 1);
+                if (feedback.stream != local_stream_id) break;
+                congestion_controller.on_feedback(
+                    feedback, std::chrono::steady_clock::now());
                 break;
             }
             // Imprime uma mensagem do servidor.
@@ -280,6 +430,26 @@ void receive_thread_func(int sock, std::promise<void> connection_promise) {
 
                 running = false;
                 break;
+            // O servidor está sobrecarregado e recusou o login.
+            case SERVER_BUSY:
+                std::cerr << "[INFO] O servidor está sobrecarregado; tente "
+                             "novamente mais tarde."
+                          << std::endl;
+                try {
+                    connection_promise.set_exception(std::make_exception_ptr(
+                        std::runtime_error("Servidor sobrecarregado")));
+                } catch (const std::future_error&) {
+                }
+
+                running = false;
+                break;
+            // O servidor pede o login de novo com o cookie; o próximo
+            // reenvio do login o leva.
+            case LOGIN_COOKIE:
+                if (n >= 1 + LOGIN_COOKIE_SIZE) {
+                    login_cookie = read_session_token(receive_buffer.data() + 1);
+                }
+                break;
             // Caso seja um pacote de ping, ignora.
             case KEEPALIVE_PONG:
                 break;
@@ -291,56 +461,179 @@ void receive_thread_func(int sock, std::promise<void> connection_promise) {
     std::cout << "Recepção de áudio terminada." << std::endl;
 }
 
-// Thread que reproduz o áudio recebido
+// Adiciona os quadros ao jitter buffer do locutor
+void enqueue_frames(SpeakerStream& speaker, uint32_t timestamp,
+                    const char* pcm, int frames) {
+    // Copia os quadros para blocos do pool antes de trancar o mutex, para
+    // não atrasar a thread de reprodução (o decodificador nunca entrega
+    // mais que MAX_FRAMES_PER_PACKET).
+    frames = std::min(frames, MAX_FRAMES_PER_PACKET);
+    FrameRef copies[MAX_FRAMES_PER_PACKET];
+    for (int i = 0; i < frames; ++i) {
+        copies[i] = frame_pool.copy(std::string_view(
+            pcm + i * AUDIO_BUFFER_SIZE, AUDIO_BUFFER_SIZE));
+    }
+
+    {
+        // lock_guard tranca o mutex no início do bloco e destranca
+        // automaticamente no final.
+        std::lock_guard<std::mutex> lock(jitter_buffer_mutex);
+        speaker.stats.on_packet(timestamp, frames, ms_since_startup());
+
+        // Adiciona os quadros decodificados ao final da fila
+        for (int i = 0; i < frames; ++i) {
+            speaker.jitter_buffer.push(AudioFrame{
+                timestamp + i * FRAMES_PER_BUFFER, std::move(copies[i])});
+        }
+    }
+
+    // Avisa a thread de playback que há novos pacotes disponíveis.
+    jitter_buffer_cond.notify_one();
+}
+
+// Retira o primeiro quadro do jitter buffer do locutor
+bool dequeue_frame(SpeakerStream& speaker, char* samples, uint32_t& timestamp,
+                   int& depth) {
+    std::lock_guard<std::mutex> lock(jitter_buffer_mutex);
+    if (speaker.jitter_buffer.empty()) return false;
+
+    // Pega o primeiro pacote da fila.
+    const auto& front = speaker.jitter_buffer.front();
+    timestamp = front.timestamp;
+
+    // Verifica se o pacote tem o tamanho correto.
+    if (front.samples.size() == AUDIO_BUFFER_SIZE) {
+        // Correto: Copia os dados do pacote para o buffer.
+        std::memcpy(samples, front.samples.data(), AUDIO_BUFFER_SIZE);
+    } else {
+        // Incorreto: Copia silêncio para o buffer.
+        std::fill(samples, samples + AUDIO_BUFFER_SIZE, 0);
+    }
+    speaker.jitter_buffer.pop();  // Remove o pacote e devolve o bloco
+    depth = static_cast<int>(speaker.jitter_buffer.size());
+    return true;
+}
+
+// Verifica se algum jitter buffer tem pacotes (com jitter_buffer_mutex
+// trancado)
+static bool has_buffered_frames() {
+    for (const SpeakerStream& speaker : speaker_streams) {
+        if (!speaker.jitter_buffer.empty()) return true;
+    }
+    return false;
+}
+
+// Thread que mistura e reproduz o áudio recebido
 void playback_thread_func() {
-    // Buffer para armazenar os dados de áudio a serem reproduzidos.
+    // Quadro retirado do jitter buffer, em PCM.
     std::vector<char> buffer(AUDIO_BUFFER_SIZE, 0);
 
+    // Áudio de cada locutor após a compensação de deriva, ainda não tocado.
+    // Cada quadro rende uma ou duas amostras a mais ou a menos que
+    // FRAMES_PER_BUFFER, então as sobras ficam para o próximo ciclo.
+    constexpr int PENDING_CAPACITY = 3 * FRAMES_PER_BUFFER;
+    std::vector<int16_t> pending[MAX_STREAMS];
+    int pending_count[MAX_STREAMS] = {};
+    for (auto& samples : pending) samples.resize(PENDING_CAPACITY);
+
+    // Timestamp do último quadro de cada locutor que entrou na mixagem
+    // (para o rastreamento de latência).
+    uint32_t timestamps[MAX_STREAMS] = {};
+    bool mixed[MAX_STREAMS] = {};
+    bool used[MAX_STREAMS] = {};
+    bool first_frame = true;
+
+    // Com o modo de baixa latência, a reprodução roda em tempo real
+    realtime_thread("voip-reproducao", RT_PRIORITY_PLAYBACK, 2);
+
+    // Resultado da mixagem e o mesmo áudio em bytes para o grafo e a saída.
+    std::vector<int16_t> mix(FRAMES_PER_BUFFER);
+    std::vector<char> output(AUDIO_BUFFER_SIZE, 0);
+
     // Inicia a reprodução de áudio nos alto-falantes.
-    audio_handler.startPlayback();
+    audio_handler->startPlayback();
     std::cout << "Alto-falantes ativados." << std::endl;
 
-    while (running || !jitter_buffer.empty()) {
+    while (true) {
         {
-            // lock_guard tranca o mutex no início do bloco e destranca
-            // automaticamente no final.
             std::unique_lock<std::mutex> lock(jitter_buffer_mutex);
 
-            // A thread dorme até ser notificada, quando o buffer não está vazio
-            // ou o programa está encerrando.
+            // A thread dorme até ser notificada, quando algum buffer não está
+            // vazio ou o programa está encerrando.
             jitter_buffer_cond.wait(
-                lock, [] { return !jitter_buffer.empty() || !running; });
-
-            // Se a thread acordou e não está mais rodando, e não contém
-            // pacotes no jitter_buffer, sai do loop.
-            if (!running && jitter_buffer.empty()) break;
-
-            // Se há pacotes no jitter_buffer
-            if (!jitter_buffer.empty()) {
-                // Peega o primeiro pacote da fila.
-                const auto& front = jitter_buffer.front();
-
-                // Verifica se o pacote tem o tamanho correto.
-                if (front.size() == AUDIO_BUFFER_SIZE) {
-                    // Correto: Copia os dados do pacote para o buffer de
-                    // reprodução.
-                    std::copy(front.begin(), front.end(), buffer.begin());
-                } else {
-                    // Incorreto: Copia silêncio para o buffer de reprodução.
-                    std::fill(buffer.begin(), buffer.end(), 0);
+                lock, [] { return has_buffered_frames() || !running; });
+
+            // Se a thread acordou e não está mais rodando, e não há pacotes
+            // nos jitter buffers, sai do loop.
+            if (!running && !has_buffered_frames()) break;
+        }
+
+        std::fill(mix.begin(), mix.end(), 0);
+        const double playback_slope = playback_clock.slope();
+
+        // Cada locutor com áudio entra na mixagem: o custo é um resampler
+        // e uma soma vetorizada por fluxo ativo.
+        for (int s = 0; s < MAX_STREAMS; ++s) {
+            SpeakerStream& speaker = speaker_streams[s];
+            mixed[s] = false;
+
+            // Completa um quadro de saída com os pacotes deste locutor.
+            while (pending_count[s] < FRAMES_PER_BUFFER) {
+                int depth;
+                if (!dequeue_frame(speaker, buffer.data(), timestamps[s],
+                                   depth)) {
+                    break;
                 }
-                jitter_buffer.pop();  // Remove o pacote processado da fila
-            } else {
-                // Se não há pacotes, preenche o buffer com silêncio
-                std::fill(buffer.begin(), buffer.end(), 0);
+                trace_event(TRACE_DEQUEUE, s, timestamps[s]);
+                mixed[s] = used[s] = true;
+
+                // Ajusta a taxa para acompanhar o relógio de quem fala.
+                pending_count[s] += speaker.drift.process(
+                    buffer.data(),
+                    reinterpret_cast<char*>(pending[s].data() +
+                                            pending_count[s]),
+                    PENDING_CAPACITY - pending_count[s], depth,
+                    playback_slope);
             }
+            if (pending_count[s] == 0) continue;
+
+            // Soma o quadro deste locutor (ou o que sobrou dele, se os
+            // pacotes acabaram) com saturação e o ganho escolhido.
+            const int count = std::min(pending_count[s], FRAMES_PER_BUFFER);
+            mix_pcm16(mix.data(), pending[s].data(), speaker.gain.load(),
+                      count);
+            std::copy(pending[s].begin() + count,
+                      pending[s].begin() + pending_count[s],
+                      pending[s].begin());
+            pending_count[s] -= count;
         }
 
+        // Processa o bloco antes de tocar (inclui a referência do eco).
+        std::memcpy(output.data(), mix.data(), AUDIO_BUFFER_SIZE);
+        playback_graph.process(output.data());
+
         // Envia o buffer de áudio para os alto-falantes.
-        audio_handler.write(buffer.data());
+        audio_handler->write(output.data());
+        for (int s = 0; s < MAX_STREAMS; ++s) {
+            if (!mixed[s]) continue;
+            trace_event(TRACE_PLAYBACK, s, timestamps[s]);
+            if (first_frame) {
+                std::cout << "Primeiro áudio recebido tocado "
+                          << ms_since_startup() << " ms após o início."
+                          << std::endl;
+                first_frame = false;
+            }
+        }
+        playback_clock.on_played(FRAMES_PER_BUFFER);
     }
 
     // Para a reprodução de áudio quando o loop termina.
-    audio_handler.stopPlayback();
+    audio_handler->stopPlayback();
     std::cout << "Reprodução de áudio terminada." << std::endl;
-}
\ No newline at end of file
+    playback_graph.print_stats("Grafo de reprodução");
+    for (int s = 0; s < MAX_STREAMS; ++s) {
+        if (used[s]) {
+            speaker_streams[s].drift.print_stats(s, playback_clock.slope());
+        }
+    }
+}
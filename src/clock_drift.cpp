@@ -0,0 +1,216 @@
+#include "clock_drift.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "common.h"
+
+namespace {
+// Duração de cada janela de mínimo, em segundos
+constexpr double DRIFT_WINDOW_SEC = 2.0;
+
+// Tempo inicial ignorado (rajadas de início, buffers do dispositivo enchendo)
+constexpr double DRIFT_WARMUP_SEC = 3.0;
+
+// Constante de tempo do esquecimento exponencial da regressão
+constexpr double DRIFT_TIME_CONSTANT_SEC = 120.0;
+
+// Janelas mínimas antes de confiar na estimativa
+constexpr int DRIFT_MIN_WINDOWS = 5;
+
+// Maior deriva aceita (cristais de áudio ficam bem abaixo disso)
+constexpr double DRIFT_MAX_SLOPE = 1000e-6;
+
+// Correção por quadro de diferença entre a profundidade média do jitter
+// buffer e a referência, e seu limite
+constexpr double DRIFT_DEPTH_GAIN = 50e-6;
+constexpr double DRIFT_DEPTH_LIMIT = 500e-6;
+
+// Suavização da profundidade média do jitter buffer
+constexpr double DRIFT_DEPTH_SMOOTHING = 0.01;
+
+// Espera entre dois blocos tocados, além da duração do bloco, que indica
+// que o dispositivo ficou sem áudio
+constexpr double DRIFT_PLAYBACK_GAP_SEC = 0.06;
+
+// Um salto maior que isso no timestamp indica que o emissor reiniciou
+constexpr int64_t DRIFT_RESET_SAMPLES = 10LL * SAMPLE_RATE;
+
+double now_seconds() {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+}  // namespace
+
+void ClockDriftEstimator::add(double local_seconds, double media_seconds) {
+    const double offset = local_seconds - media_seconds;
+    if (origin_time < 0.0) {
+        origin_time = local_seconds;
+        origin_offset = offset;
+    }
+    const double x = local_seconds - origin_time;
+    const double y = offset - origin_offset;
+    if (anchor_pending && resume_time < 0.0) {
+        resume_time = x + DRIFT_WARMUP_SEC;
+    }
+    if (x < DRIFT_WARMUP_SEC || x < resume_time) return;
+
+    if (window_start < 0.0) {
+        window_start = x;
+        window_min = y;
+        return;
+    }
+    window_min = std::min(window_min, y);
+    if (x - window_start < DRIFT_WINDOW_SEC) return;
+
+    // Primeira janela depois de uma interrupção: o degrau é retirado
+    // deslocando a origem para a janela cair sobre a reta estimada. Sem
+    // estimativa ainda, a regressão recomeça.
+    const double center = window_start + DRIFT_WINDOW_SEC / 2.0;
+    if (anchor_pending) {
+        anchor_pending = false;
+        if (windows < DRIFT_MIN_WINDOWS) {
+            weight = sum_x = sum_y = sum_xx = sum_xy = 0.0;
+            windows = 0;
+        } else {
+            const double denominator = weight * sum_xx - sum_x * sum_x;
+            const double slope =
+                (weight * sum_xy - sum_x * sum_y) / denominator;
+            const double intercept = (sum_y - slope * sum_x) / weight;
+            const double step = window_min - (intercept + slope * center);
+            origin_offset += step;
+            window_min -= step;
+        }
+    }
+
+    // Fecha a janela: entra na regressão com peso 1, as anteriores decaem
+    const double decay =
+        std::exp(-DRIFT_WINDOW_SEC / DRIFT_TIME_CONSTANT_SEC);
+    weight = weight * decay + 1.0;
+    sum_x = sum_x * decay + center;
+    sum_y = sum_y * decay + window_min;
+    sum_xx = sum_xx * decay + center * center;
+    sum_xy = sum_xy * decay + center * window_min;
+    ++windows;
+
+    window_start = x;
+    window_min = y;
+}
+
+void ClockDriftEstimator::reset() { *this = ClockDriftEstimator(); }
+
+void ClockDriftEstimator::mark_gap() {
+    if (origin_time < 0.0) return;
+    // Descarta a janela em andamento e espera o relógio estabilizar, como
+    // no início (o dispositivo volta enchendo o próprio buffer)
+    window_start = -1.0;
+    resume_time = -1.0;
+    anchor_pending = true;
+}
+
+double ClockDriftEstimator::slope() const {
+    if (windows < DRIFT_MIN_WINDOWS) return 0.0;
+    const double denominator = weight * sum_xx - sum_x * sum_x;
+    if (denominator <= 0.0) return 0.0;
+    const double slope = (weight * sum_xy - sum_x * sum_y) / denominator;
+    return std::clamp(slope, -DRIFT_MAX_SLOPE, DRIFT_MAX_SLOPE);
+}
+
+DriftCompensator::DriftCompensator()
+    : resampler(FRAMES_PER_BUFFER),
+      input(FRAMES_PER_BUFFER),
+      output(2 * FRAMES_PER_BUFFER) {}
+
+void DriftCompensator::on_packet(uint32_t timestamp) {
+    // Desenrola o timestamp de 32 bits (volta a zero a cada ~24 horas)
+    if (has_timestamp) {
+        const int64_t delta = static_cast<int32_t>(timestamp - last_timestamp);
+        if (delta > DRIFT_RESET_SAMPLES || delta < -DRIFT_RESET_SAMPLES) {
+            sender_clock.reset();
+            media_samples = 0;
+            sender_reset.store(true, std::memory_order_relaxed);
+        } else {
+            media_samples += delta;
+        }
+    }
+    has_timestamp = true;
+    last_timestamp = timestamp;
+
+    sender_clock.add(now_seconds(),
+                     static_cast<double>(media_samples) / SAMPLE_RATE);
+    sender_slope.store(sender_clock.slope(), std::memory_order_relaxed);
+}
+
+void PlaybackClock::on_played(int frames) {
+    // A escrita bloqueia até o dispositivo ter espaço, então o tempo de
+    // retorno acompanha o consumo real do dispositivo
+    const double now = now_seconds();
+    if (last_played >= 0.0 &&
+        now - last_played > static_cast<double>(last_frames) / SAMPLE_RATE +
+                                DRIFT_PLAYBACK_GAP_SEC) {
+        clock.mark_gap();
+    }
+    last_played = now;
+    last_frames = frames;
+    played_samples += frames;
+    clock.add(now, static_cast<double>(played_samples) / SAMPLE_RATE);
+}
+
+int DriftCompensator::process(const char* in, char* out, int max_out,
+                              int depth, double playback_slope) {
+    // Um novo emissor no fluxo (o slot foi reaproveitado ou o cliente
+    // reiniciou) começa uma nova referência de profundidade
+    if (sender_reset.exchange(false, std::memory_order_relaxed)) {
+        average_depth = baseline_depth = -1.0;
+    }
+
+    // Profundidade média do jitter buffer; a referência é fixada quando a
+    // estimativa de deriva fica pronta
+    if (average_depth < 0.0) average_depth = depth;
+    average_depth += DRIFT_DEPTH_SMOOTHING * (depth - average_depth);
+    min_depth = (min_depth < 0) ? depth : std::min(min_depth, depth);
+    max_depth = std::max(max_depth, depth);
+
+    // Inclinação -e significa relógio e vezes mais rápido que o local:
+    // razão = taxa do dispositivo / taxa do emissor
+    const double sender = sender_slope.load(std::memory_order_relaxed);
+    const double playback = playback_slope;
+    ratio = (1.0 - playback) / (1.0 - sender);
+
+    if (sender != 0.0 && playback != 0.0) {
+        if (baseline_depth < 0.0) baseline_depth = average_depth;
+        const double correction =
+            std::clamp(-DRIFT_DEPTH_GAIN * (average_depth - baseline_depth),
+                       -DRIFT_DEPTH_LIMIT, DRIFT_DEPTH_LIMIT);
+        ratio += correction;
+    }
+    resampler.set_ratio(ratio);
+
+    for (int i = 0; i < FRAMES_PER_BUFFER; ++i) {
+        int16_t sample;
+        std::memcpy(&sample, in + i * SAMPLE_SIZE, sizeof(sample));
+        input[i] = sample;
+    }
+    const int produced = resampler.process(
+        input.data(), FRAMES_PER_BUFFER, output.data(),
+        std::min(max_out, static_cast<int>(output.size())));
+    for (int i = 0; i < produced; ++i) {
+        float clamped = std::clamp(output[i], -32768.0f, 32767.0f);
+        int16_t sample = static_cast<int16_t>(std::lrint(clamped));
+        std::memcpy(out + i * SAMPLE_SIZE, &sample, sizeof(sample));
+    }
+    return produced;
+}
+
+void DriftCompensator::print_stats(int stream, double playback_slope) const {
+    std::cout << "Deriva de relógio do fluxo " << stream << ": emissor "
+              << (0.0 - sender_slope.load(std::memory_order_relaxed)) * 1e6
+              << " ppm, saída " << (0.0 - playback_slope) * 1e6
+              << " ppm, razão aplicada " << ratio << ", jitter buffer entre "
+              << std::max(min_depth, 0) << " e " << max_depth << " quadros"
+              << std::endl;
+}
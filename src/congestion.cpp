@@ -0,0 +1,209 @@
+#include "congestion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+// Níveis de envio, do melhor ao mais econômico, para cada SimulcastMode.
+// Fora o nível 0 com as três camadas, todo pacote cabe na MTU de 1500
+// (dois quadros de 16 kHz com o de 8 kHz já passariam). Os quadros por
+// pacote de cada nível são os mesmos nas três tabelas.
+constexpr int LEVEL_COUNT = 4;
+constexpr SendMode SINGLE_LEVELS[LEVEL_COUNT] = {
+    {LAYER_PCM48, 1},
+    {LAYER_PCM16K, 1},
+    {LAYER_PCM16K, 2},
+    {LAYER_ULAW8K, 3},
+};
+constexpr SendMode SIMULCAST_16K_LEVELS[LEVEL_COUNT] = {
+    {LAYER_SIMULCAST_16K, 1},  // 320 kbit/s, 50 pacotes/s, 815 bytes
+    {LAYER_PCM16K, 1},         // 256 kbit/s
+    {LAYER_PCM16K, 2},         // 256 kbit/s, 25 pacotes/s
+    {LAYER_ULAW8K, 3},         // 64 kbit/s, 16,7 pacotes/s
+};
+constexpr SendMode SIMULCAST_48K_LEVELS[LEVEL_COUNT] = {
+    {LAYER_SIMULCAST, 1},      // 1088 kbit/s, 2735 bytes (fragmentado)
+    {LAYER_SIMULCAST_16K, 1},  // 320 kbit/s
+    {LAYER_PCM16K, 2},         // 256 kbit/s, 25 pacotes/s
+    {LAYER_ULAW8K, 3},         // 64 kbit/s, 16,7 pacotes/s
+};
+constexpr const SendMode* LEVELS[] = {SINGLE_LEVELS, SIMULCAST_16K_LEVELS,
+                                      SIMULCAST_48K_LEVELS};
+
+// Espera mínima entre duas descidas de nível: o efeito de uma mudança só
+// aparece no relatório seguinte
+constexpr auto LEVEL_HOLD = std::chrono::seconds(2);
+
+// Intervalos seguidos com a rede livre para subir um nível
+constexpr int CLEAR_WINDOWS_TO_RAISE = 5;
+
+// Crescimento da banda estimada por relatório sem perda, e o piso
+constexpr double ESTIMATE_GROWTH = 1.05;
+constexpr double MIN_ESTIMATE_KBPS = 64.0;
+
+// Acima disso a estimativa não limita mais nada e volta a "sem limite"
+constexpr double ESTIMATE_CEILING_KBPS = 2.0 * 768.0 * MAX_STREAMS;
+
+// Converte com saturação para os campos do relatório
+int clamp_field(double value, int low, int high) {
+    return static_cast<int>(
+        std::lround(std::clamp(value, double(low), double(high))));
+}
+}  // namespace
+
+void write_feedback(const StreamFeedback& feedback, char* out) {
+    const int loss = clamp_field(feedback.loss * 255.0, 0, 255);
+    const int jitter = clamp_field(feedback.jitter_ms * 10.0, 0, 65535);
+    const int gradient =
+        clamp_field(feedback.gradient_ms * 10.0, -32768, 32767) & 0xFFFF;
+    out[0] = static_cast<char>(feedback.stream);
+    out[1] = static_cast<char>(loss);
+    out[2] = static_cast<char>(jitter >> 8);
+    out[3] = static_cast<char>(jitter);
+    out[4] = static_cast<char>(gradient >> 8);
+    out[5] = static_cast<char>(gradient);
+}
+
+StreamFeedback read_feedback(const char* in) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(in);
+    StreamFeedback feedback;
+    feedback.stream = bytes[0];
+    feedback.loss = bytes[1] / 255.0;
+    feedback.jitter_ms = ((bytes[2] << 8) | bytes[3]) / 10.0;
+    feedback.gradient_ms =
+        static_cast<int16_t>((bytes[4] << 8) | bytes[5]) / 10.0;
+    return feedback;
+}
+
+void ReceiveStats::on_packet(uint32_t timestamp, int frames,
+                             double arrival_ms) {
+    // Um salto de mais de 2 s é outro participante no mesmo fluxo (ou o
+    // mesmo reconectado): as estatísticas recomeçam
+    const int32_t jump = static_cast<int32_t>(timestamp - next_timestamp);
+    if (!started || std::abs(jump) > 2 * SAMPLE_RATE) {
+        started = true;
+        base_timestamp = timestamp;
+        next_timestamp = timestamp;
+        interval_start = timestamp;
+        received = 0;
+        jitter = 0.0;
+        transit_sum = 0.0;
+        has_previous = false;
+        last_transit = arrival_ms;
+    }
+
+    const double transit =
+        arrival_ms -
+        static_cast<int32_t>(timestamp - base_timestamp) * 1000.0 / SAMPLE_RATE;
+    jitter += (std::abs(transit - last_transit) - jitter) / 16.0;
+    last_transit = transit;
+    transit_sum += transit;
+
+    received += frames;
+    const uint32_t end = timestamp + frames * FRAMES_PER_BUFFER;
+    if (static_cast<int32_t>(end - next_timestamp) > 0) next_timestamp = end;
+}
+
+bool ReceiveStats::take_report(int stream, StreamFeedback& report) {
+    if (!started || received == 0) return false;
+
+    const int expected = static_cast<int32_t>(next_timestamp - interval_start) /
+                         FRAMES_PER_BUFFER;
+    const double mean = transit_sum / received;
+    report.stream = stream;
+    report.loss =
+        expected > 0 ? std::max(0.0, 1.0 - double(received) / expected) : 0.0;
+    report.jitter_ms = jitter;
+    report.gradient_ms = has_previous ? mean - previous_mean : 0.0;
+
+    previous_mean = mean;
+    has_previous = true;
+    interval_start = next_timestamp;
+    received = 0;
+    transit_sum = 0.0;
+    return true;
+}
+
+void CongestionController::on_feedback(
+    const StreamFeedback& feedback, std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (window_has_report &&
+        now - window_start >= std::chrono::milliseconds(FEEDBACK_INTERVAL_MS)) {
+        // Fecha o intervalo anterior e decide
+        const bool congested = window_loss > CONGESTION_LOSS ||
+                               window_gradient > OVERUSE_GRADIENT_MS;
+        const bool clear = window_loss < CLEAR_LOSS &&
+                           window_gradient <= OVERUSE_GRADIENT_MS;
+        const int current = level.load();
+        int next = current;
+
+        if (congested) {
+            clear_windows = 0;
+            if (current < LEVEL_COUNT - 1 && now - last_change >= LEVEL_HOLD) {
+                next = current + 1;
+            }
+        } else if (clear) {
+            if (++clear_windows >= CLEAR_WINDOWS_TO_RAISE && current > 0) {
+                next = current - 1;
+                clear_windows = 0;
+            }
+        } else {
+            clear_windows = 0;
+        }
+
+        if (next != current) {
+            level = next;
+            last_change = now;
+            std::cout << "[congestionamento] Perda "
+                      << clamp_field(window_loss * 100.0, 0, 100)
+                      << "%, gradiente " << window_gradient
+                      << " ms: envio no nível " << next << " ("
+                      << SINGLE_LEVELS[next].frames * 20
+                      << " ms por pacote)." << std::endl;
+        }
+        window_has_report = false;
+    }
+
+    if (!window_has_report) {
+        window_has_report = true;
+        window_start = now;
+        window_loss = feedback.loss;
+        window_gradient = feedback.gradient_ms;
+    } else {
+        window_loss = std::min(window_loss, feedback.loss);
+        window_gradient = std::min(window_gradient, feedback.gradient_ms);
+    }
+}
+
+SendMode CongestionController::mode(SimulcastMode simulcast) const {
+    const int current = level.load(std::memory_order_relaxed);
+    return LEVELS[simulcast][current];
+}
+
+void CapacityEstimator::on_report(double loss, double gradient_ms,
+                                  std::chrono::steady_clock::time_point now) {
+    const double elapsed_ms =
+        std::chrono::duration<double, std::milli>(now - interval_start).count();
+    const double sent_kbps =
+        elapsed_ms > 0 ? bytes_sent * 8.0 / elapsed_ms : 0.0;
+    bytes_sent = 0;
+    interval_start = now;
+
+    if (loss > CONGESTION_LOSS || gradient_ms > OVERUSE_GRADIENT_MS) {
+        // O que chegou ao ouvinte é o que ele suporta
+        double target = sent_kbps * (1.0 - loss);
+        if (estimate_kbps > 0) target = std::min(target, estimate_kbps);
+        estimate_kbps = std::max(target, MIN_ESTIMATE_KBPS);
+    } else if (loss < CLEAR_LOSS && estimate_kbps > 0) {
+        estimate_kbps *= ESTIMATE_GROWTH;
+        if (estimate_kbps > ESTIMATE_CEILING_KBPS) estimate_kbps = 0.0;
+    }
+}
+
+void CapacityEstimator::reset() {
+    estimate_kbps = 0.0;
+    bytes_sent = 0;
+    interval_start = std::chrono::steady_clock::now();
+}
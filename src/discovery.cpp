@@ -0,0 +1,285 @@
+#include "discovery.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using socklen_t = int;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "common.h"
+
+namespace {
+// Atualização do cache em segundo plano, iniciada por
+// discover_server_on_network(). O destrutor aguarda a thread caso o cliente
+// saia sem chamar wait_for_discovery_refresh().
+struct RefreshThread {
+    std::thread thread;
+    ~RefreshThread() {
+        if (thread.joinable()) thread.join();
+    }
+} refresh;
+
+// Tempo máximo da atualização em segundo plano, para não atrasar o
+// encerramento do cliente se nenhum servidor responder
+constexpr int DISCOVERY_REFRESH_TIMEOUT_MS = 1000;
+
+// Espera pela resposta dos servidores em cache antes de procurar na rede
+constexpr int DISCOVERY_PROBE_TIMEOUT_MS = 300;
+
+// Fecha um socket nas duas plataformas
+void close_socket(int sock) {
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - since)
+        .count();
+}
+
+// Caminho do arquivo de cache, vazio se não houver onde gravá-lo
+std::string server_cache_path() {
+    if (const char* path = std::getenv("VOIP_SERVER_CACHE")) return path;
+#ifdef _WIN32
+    if (const char* dir = std::getenv("APPDATA")) {
+        return std::string(dir) + "\\simple_voip_servers.txt";
+    }
+#else
+    if (const char* dir = std::getenv("HOME")) {
+        return std::string(dir) + "/.simple_voip_servers";
+    }
+#endif
+    return "";
+}
+
+void print_servers(const std::vector<DiscoveredServer>& servers) {
+    for (const auto& server : servers) {
+        std::cout << "  " << server.ip << " (RTT " << server.rtt_ms << " ms)"
+                  << std::endl;
+    }
+}
+
+// Envia um DISCOVERY_REQUEST para cada destino e coleta as respostas: até
+// timeout_ms pela primeira, e mais window_ms para as demais. Retorna os
+// servidores que responderam, ordenados pelo RTT.
+std::vector<DiscoveredServer> query_servers(
+    const std::vector<sockaddr_in>& destinations, int timeout_ms,
+    int window_ms) {
+    std::vector<DiscoveredServer> servers;
+
+    // Cria um socket para enviar os pedidos de descoberta
+    int discovery_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (discovery_sock < 0) {
+        perror("Erro ao criar socket de descoberta");
+        return servers;
+    }
+
+    // Habilitar a opção de broadcast no socket
+    int broadcast_enable = 1;
+#ifdef _WIN32
+    if (setsockopt(discovery_sock, SOL_SOCKET, SO_BROADCAST,
+                   (const char*)&broadcast_enable,
+                   sizeof(broadcast_enable)) < 0) {
+#else
+    if (setsockopt(discovery_sock, SOL_SOCKET, SO_BROADCAST, &broadcast_enable,
+                   sizeof(broadcast_enable)) < 0) {
+#endif
+        perror("Erro ao configurar socket para broadcast");
+    }
+
+    // O pedido leva um identificador aleatório que o servidor devolve na
+    // resposta, para ignorar respostas de pedidos anteriores
+    char request[1 + DISCOVERY_NONCE_SIZE];
+    request[0] = DISCOVERY_REQUEST;
+    std::random_device random;
+    for (int i = 0; i < DISCOVERY_NONCE_SIZE; ++i) {
+        request[1 + i] = static_cast<char>(random());
+    }
+
+    const auto sent_at = std::chrono::steady_clock::now();
+    for (const sockaddr_in& destination : destinations) {
+        sendto(discovery_sock, request, sizeof(request), 0,
+               (const sockaddr*)&destination, sizeof(destination));
+    }
+
+    // Coleta as respostas: até timeout_ms pela primeira, e mais
+    // window_ms para as demais
+    double deadline_ms = timeout_ms;
+    while (true) {
+        const double remaining_ms = deadline_ms - elapsed_ms(sent_at);
+        if (remaining_ms <= 0.0) break;
+
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(discovery_sock, &read_fds);
+        struct timeval tv;
+        tv.tv_sec = static_cast<long>(remaining_ms / 1000.0);
+        tv.tv_usec = static_cast<long>(
+            (remaining_ms - tv.tv_sec * 1000.0) * 1000.0);
+        int ready = select(discovery_sock + 1, &read_fds, nullptr, nullptr, &tv);
+        if (ready <= 0) break;
+
+        char response[1 + DISCOVERY_NONCE_SIZE];
+        sockaddr_in server_addr{};
+        socklen_t server_addr_len = sizeof(server_addr);
+        ssize_t n = recvfrom(discovery_sock, response, sizeof(response), 0,
+                             (sockaddr*)&server_addr, &server_addr_len);
+        const double rtt_ms = elapsed_ms(sent_at);
+
+        // Aceita só respostas ao nosso pedido
+        if (n != sizeof(response) || response[0] != DISCOVERY_RESPONSE ||
+            std::memcmp(response + 1, request + 1, DISCOVERY_NONCE_SIZE)) {
+            continue;
+        }
+
+        if (servers.empty()) {
+            deadline_ms = std::min(deadline_ms, rtt_ms + window_ms);
+        }
+
+        // O mesmo servidor responde ao multicast e ao broadcast; fica a
+        // primeira resposta, que é a de menor RTT
+        char ip_str[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &server_addr.sin_addr, ip_str, INET_ADDRSTRLEN);
+        bool known = std::any_of(
+            servers.begin(), servers.end(),
+            [&](const DiscoveredServer& s) { return s.ip == ip_str; });
+        if (!known) servers.push_back(DiscoveredServer{ip_str, rtt_ms});
+    }
+
+    close_socket(discovery_sock);
+
+    std::sort(servers.begin(), servers.end(),
+              [](const DiscoveredServer& a, const DiscoveredServer& b) {
+                  return a.rtt_ms < b.rtt_ms;
+              });
+    return servers;
+}
+}  // namespace
+
+std::vector<DiscoveredServer> discover_servers(int timeout_ms) {
+    // Envia para o grupo multicast e para o endereço de broadcast
+    sockaddr_in multicast_addr{};
+    multicast_addr.sin_family = AF_INET;
+    multicast_addr.sin_port = htons(PORT);
+    inet_pton(AF_INET, DISCOVERY_MULTICAST_GROUP, &multicast_addr.sin_addr);
+
+    sockaddr_in broadcast_addr{};
+    broadcast_addr.sin_family = AF_INET;
+    broadcast_addr.sin_port = htons(PORT);
+    broadcast_addr.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+
+    return query_servers({multicast_addr, broadcast_addr}, timeout_ms,
+                         DISCOVERY_WINDOW_MS);
+}
+
+std::vector<DiscoveredServer> probe_servers(
+    const std::vector<DiscoveredServer>& servers, int timeout_ms) {
+    std::vector<sockaddr_in> destinations;
+    for (const auto& server : servers) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(PORT);
+        if (inet_pton(AF_INET, server.ip.c_str(), &addr.sin_addr) == 1) {
+            destinations.push_back(addr);
+        }
+    }
+    if (destinations.empty()) return {};
+    return query_servers(destinations, timeout_ms, 0);
+}
+
+std::vector<DiscoveredServer> load_server_cache() {
+    std::vector<DiscoveredServer> servers;
+    const std::string path = server_cache_path();
+    if (path.empty()) return servers;
+
+    // Uma linha por servidor: "<ip> <rtt em ms>", do melhor para o pior
+    std::ifstream file(path);
+    DiscoveredServer server;
+    while (file >> server.ip >> server.rtt_ms) {
+        sockaddr_in addr{};
+        if (inet_pton(AF_INET, server.ip.c_str(), &addr.sin_addr) == 1) {
+            servers.push_back(server);
+        }
+    }
+    return servers;
+}
+
+bool save_server_cache(const std::vector<DiscoveredServer>& servers) {
+    const std::string path = server_cache_path();
+    if (path.empty()) return false;
+
+    std::ofstream file(path, std::ios::trunc);
+    for (const auto& server : servers) {
+        file << server.ip << " " << server.rtt_ms << "\n";
+    }
+    if (!file) {
+        std::cerr << "Não foi possível gravar o cache de servidores em "
+                  << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string discover_server_on_network() {
+    // Com servidores em cache, pergunta diretamente a eles e conecta ao
+    // primeiro que responder; a lista é atualizada em segundo plano para a
+    // próxima execução. Se nenhum responder (o cache ficou velho), faz a
+    // descoberta completa.
+    std::vector<DiscoveredServer> servers = load_server_cache();
+    if (!servers.empty()) {
+        std::vector<DiscoveredServer> alive =
+            probe_servers(servers, DISCOVERY_PROBE_TIMEOUT_MS);
+        if (!alive.empty()) {
+            std::cout << "IP do servidor não fornecido. Usando o cache: "
+                      << alive.front().ip << std::endl;
+            refresh.thread = std::thread([] {
+                std::vector<DiscoveredServer> found =
+                    discover_servers(DISCOVERY_REFRESH_TIMEOUT_MS);
+                if (!found.empty()) save_server_cache(found);
+            });
+            return alive.front().ip;
+        }
+        std::cout << "Nenhum servidor do cache respondeu." << std::endl;
+    }
+
+    std::cout << "IP do servidor não fornecido. Procurando na rede local..."
+              << std::endl;
+    servers = discover_servers();
+
+    // Se não foi recebido nenhum pacote válido, imprime uma mensagem de erro.
+    if (servers.empty()) {
+        std::cerr << "Nenhum servidor encontrado na rede." << std::endl;
+        return "";
+    }
+
+    std::cout << "Servidores encontrados:" << std::endl;
+    print_servers(servers);
+    save_server_cache(servers);
+
+    std::cout << "Servidor escolhido: " << servers.front().ip << std::endl;
+    return servers.front().ip;
+}
+
+void wait_for_discovery_refresh() {
+    if (refresh.thread.joinable()) refresh.thread.join();
+}
@@ -0,0 +1,381 @@
+#include "echo_canceller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "dsp_simd.h"
+
+namespace {
+// Passo de adaptação do NLMS, normalizado pela potência de cada raia somada
+// sobre todas as partições. Normalizar só pela potência recente faz o passo
+// explodir quando a referência silencia e as partições antigas ainda têm
+// energia, e o filtro diverge.
+constexpr float AEC_STEP_SIZE = 0.5f;
+
+// Regularização da normalização, evita passos enormes em raias silenciosas
+constexpr float AEC_REGULARIZATION = 1e-3f * AEC_FFT_SIZE * AEC_PARTITIONS;
+
+// Limiar do detector Geigel: fala dupla se |microfone| > limiar * |referência|
+constexpr float AEC_GEIGEL_THRESHOLD = 0.5f;
+
+// Blocos em que a adaptação segue congelada após detectar fala dupla (~40 ms)
+constexpr int AEC_DOUBLE_TALK_HOLD = 30;
+
+// Abaixo deste pico a referência é considerada silêncio
+constexpr float AEC_SILENCE_LEVEL = 1e-4f;
+
+// Blocos de referência cuja energia fica guardada para o estimador de
+// atraso: cobre a fila de referência e AEC_DELAY_MAX_BLOCKS já consumidos
+constexpr int AEC_ENVELOPE_HISTORY = 1024;
+static_assert(AEC_ENVELOPE_HISTORY >=
+                  2 * AEC_DELAY_MAX_BLOCKS + 2 * AEC_FRAME_BLOCKS,
+              "Histórico de energia menor que a janela do estimador");
+
+// Média recente da energia, retirada antes da correlação (~65 ms): sobram
+// as variações, como o início e o fim das sílabas
+constexpr float AEC_ENVELOPE_MEAN_DECAY = 0.98f;
+
+// Memória da correlação entre microfone e referência (~2 s)
+constexpr float AEC_DELAY_DECAY = 1.0f - 1.0f / 1500.0f;
+
+// Blocos observados antes de confiar na correlação (~1 s)
+constexpr long AEC_DELAY_MIN_OBSERVATIONS = 750;
+
+// Correlação normalizada mínima do pico para ele ser considerado o eco
+constexpr float AEC_DELAY_MIN_CORRELATION = 0.3f;
+
+// Quadros seguidos com o mesmo atraso antes de realinhar a referência
+constexpr int AEC_DELAY_CONFIRMATIONS = 10;
+
+// Blocos no fim do filtro reservados para a reverberação: um eco que chega
+// depois deles também é realinhado
+constexpr int AEC_DELAY_GUARD_BLOCKS = 16;
+
+float block_envelope(const float* samples) {
+    float energy = 0.0f;
+    for (int i = 0; i < AEC_BLOCK_SIZE; ++i) energy += samples[i] * samples[i];
+    return std::sqrt(energy / AEC_BLOCK_SIZE);
+}
+}  // namespace
+
+EchoCanceller::EchoCanceller()
+    : reference_ring(AEC_REFERENCE_CAPACITY),
+      far_envelope(AEC_ENVELOPE_HISTORY),
+      envelope_window(2 * AEC_DELAY_MAX_BLOCKS + AEC_FRAME_BLOCKS),
+      lag_correlation(2 * AEC_DELAY_MAX_BLOCKS),
+      fft(AEC_FFT_SIZE),
+      bins(AEC_FFT_SIZE / 2 + 1),
+      far_frame(FRAMES_PER_BUFFER),
+      far_previous(AEC_BLOCK_SIZE),
+      far_re(AEC_PARTITIONS * bins),
+      far_im(AEC_PARTITIONS * bins),
+      far_magnitude(AEC_PARTITIONS * bins),
+      far_power(bins),
+      weight_re(AEC_PARTITIONS * bins),
+      weight_im(AEC_PARTITIONS * bins),
+      echo_re(bins),
+      echo_im(bins),
+      error_re(bins),
+      error_im(bins),
+      step(bins),
+      time_buffer(AEC_FFT_SIZE),
+      error_block(AEC_BLOCK_SIZE),
+      far_peaks(AEC_PARTITIONS) {}
+
+// Thread de reprodução: guarda a referência, descartando a mais antiga se a
+// fila encher (a captura parou de consumir), e a energia de cada bloco.
+void EchoCanceller::push_reference(const float* samples) {
+    std::lock_guard<std::mutex> lock(reference_mutex);
+    const size_t capacity = reference_ring.size();
+    for (int i = 0; i < FRAMES_PER_BUFFER; ++i) {
+        size_t write_pos = (reference_read + reference_count) % capacity;
+        reference_ring[write_pos] = samples[i];
+        if (reference_count < capacity) {
+            ++reference_count;
+        } else {
+            reference_read = (reference_read + 1) % capacity;
+        }
+    }
+
+    for (int b = 0; b < AEC_FRAME_BLOCKS; ++b) {
+        const float envelope = block_envelope(samples + b * AEC_BLOCK_SIZE);
+        const uint64_t block = reference_pushed / AEC_BLOCK_SIZE + b;
+        far_envelope[block % AEC_ENVELOPE_HISTORY] =
+            envelope - far_envelope_mean;
+        far_envelope_mean += (1.0f - AEC_ENVELOPE_MEAN_DECAY) *
+                             (envelope - far_envelope_mean);
+    }
+    reference_pushed += FRAMES_PER_BUFFER;
+}
+
+void EchoCanceller::pull_reference() {
+    std::lock_guard<std::mutex> lock(reference_mutex);
+    const size_t capacity = reference_ring.size();
+
+    // Realinhamento: descarta a referência adiantada (o que ainda não
+    // chegou é descartado ao chegar) ou a atrasa com silêncio
+    const size_t skipped = std::min(reference_skip, reference_count);
+    reference_read = (reference_read + skipped) % capacity;
+    reference_count -= skipped;
+    reference_skip -= skipped;
+    const int stall = static_cast<int>(
+        std::min(reference_stall, static_cast<size_t>(FRAMES_PER_BUFFER)));
+    reference_stall -= stall;
+    std::fill(far_frame.begin(), far_frame.begin() + stall, 0.0f);
+
+    // Posição absoluta do início do quadro na referência. Todas as
+    // quantidades são múltiplas de AEC_BLOCK_SIZE.
+    const int64_t start =
+        static_cast<int64_t>(reference_pushed - reference_count) - stall;
+
+    int available = static_cast<int>(std::min(
+        reference_count, static_cast<size_t>(FRAMES_PER_BUFFER - stall)));
+    for (int i = 0; i < available; ++i) {
+        far_frame[stall + i] = reference_ring[reference_read];
+        reference_read = (reference_read + 1) % capacity;
+    }
+    reference_count -= available;
+    // Sem referência suficiente: nada está tocando, completa com silêncio
+    std::fill(far_frame.begin() + stall + available, far_frame.end(), 0.0f);
+
+    // Energia da referência até AEC_DELAY_MAX_BLOCKS antes e depois do
+    // quadro; blocos ainda não entregues contam como sem variação
+    const int64_t frame_block = start / AEC_BLOCK_SIZE;
+    const int64_t pushed_blocks = reference_pushed / AEC_BLOCK_SIZE;
+    for (size_t i = 0; i < envelope_window.size(); ++i) {
+        const int64_t block =
+            frame_block - AEC_DELAY_MAX_BLOCKS + static_cast<int64_t>(i);
+        const bool stored = block >= 0 && block < pushed_blocks &&
+                            block >= pushed_blocks - AEC_ENVELOPE_HISTORY;
+        envelope_window[i] =
+            stored ? far_envelope[block % AEC_ENVELOPE_HISTORY] : 0.0f;
+    }
+}
+
+// Correlação entre a energia do bloco 'block' do microfone e a da
+// referência em cada atraso: o eco aparece como um pico no atraso dele
+void EchoCanceller::observe_delay(int block, const float* near) {
+    const float envelope = block_envelope(near);
+    const float near_deviation = envelope - near_envelope_mean;
+    near_envelope_mean +=
+        (1.0f - AEC_ENVELOPE_MEAN_DECAY) * (envelope - near_envelope_mean);
+
+    // far[i] é o bloco de referência i - AEC_DELAY_MAX_BLOCKS blocos depois
+    // do bloco do microfone
+    const float* far = envelope_window.data() + block;
+    for (int i = 0; i < 2 * AEC_DELAY_MAX_BLOCKS; ++i) {
+        lag_correlation[i] =
+            AEC_DELAY_DECAY * lag_correlation[i] + near_deviation * far[i];
+    }
+    near_envelope_power = AEC_DELAY_DECAY * near_envelope_power +
+                          near_deviation * near_deviation;
+    far_envelope_power =
+        AEC_DELAY_DECAY * far_envelope_power +
+        far[AEC_DELAY_MAX_BLOCKS] * far[AEC_DELAY_MAX_BLOCKS];
+    ++delay_observations;
+}
+
+void EchoCanceller::update_alignment() {
+    if (delay_observations < AEC_DELAY_MIN_OBSERVATIONS) return;
+    const auto peak =
+        std::max_element(lag_correlation.begin(), lag_correlation.end());
+    const float normalization =
+        std::sqrt(near_envelope_power * far_envelope_power);
+    if (normalization <= 0.0f ||
+        *peak < AEC_DELAY_MIN_CORRELATION * normalization) {
+        return;
+    }
+
+    // Atraso da referência em relação ao eco: positivo se o eco está em
+    // uma referência que o filtro ainda não usou
+    const int lag =
+        static_cast<int>(peak - lag_correlation.begin()) - AEC_DELAY_MAX_BLOCKS;
+    if (lag != delay_candidate) {
+        delay_candidate = lag;
+        delay_confirmations = 0;
+    }
+    if (++delay_confirmations < AEC_DELAY_CONFIRMATIONS) return;
+    echo_delay_blocks = -lag;
+    if (-lag >= 1 && -lag < AEC_PARTITIONS - AEC_DELAY_GUARD_BLOCKS) return;
+
+    // Eco fora do filtro: desloca a referência para ele cair em
+    // AEC_DELAY_TARGET_BLOCKS
+    const int shift = lag + AEC_DELAY_TARGET_BLOCKS;
+    {
+        std::lock_guard<std::mutex> lock(reference_mutex);
+        if (shift > 0) {
+            reference_skip += static_cast<size_t>(shift) * AEC_BLOCK_SIZE;
+        } else {
+            reference_stall += static_cast<size_t>(-shift) * AEC_BLOCK_SIZE;
+        }
+    }
+    reference_shift_blocks += shift;
+    ++delay_adjustments;
+    echo_delay_blocks = AEC_DELAY_TARGET_BLOCKS;
+    reset_filter();
+}
+
+void EchoCanceller::reset_filter() {
+    std::fill(weight_re.begin(), weight_re.end(), 0.0f);
+    std::fill(weight_im.begin(), weight_im.end(), 0.0f);
+    std::fill(far_re.begin(), far_re.end(), 0.0f);
+    std::fill(far_im.begin(), far_im.end(), 0.0f);
+    std::fill(far_magnitude.begin(), far_magnitude.end(), 0.0f);
+    std::fill(far_power.begin(), far_power.end(), 0.0f);
+    std::fill(far_previous.begin(), far_previous.end(), 0.0f);
+    std::fill(far_peaks.begin(), far_peaks.end(), 0.0f);
+    double_talk_hold = 0;
+
+    std::fill(lag_correlation.begin(), lag_correlation.end(), 0.0f);
+    near_envelope_power = 0.0f;
+    far_envelope_power = 0.0f;
+    delay_observations = 0;
+    delay_confirmations = 0;
+}
+
+// Thread de envio: cancela o eco de um quadro inteiro
+void EchoCanceller::process(float* samples) {
+    pull_reference();
+
+    for (int b = 0; b < AEC_FRAME_BLOCKS; ++b) {
+        const int offset = b * AEC_BLOCK_SIZE;
+        observe_delay(b, samples + offset);
+        process_block(far_frame.data() + offset, samples + offset,
+                      error_block.data());
+        std::copy(error_block.begin(), error_block.end(), samples + offset);
+    }
+    update_alignment();
+}
+
+void EchoCanceller::process_block(const float* far, const float* near,
+                                  float* out) {
+    // Janela de referência [bloco anterior | bloco atual] vira a partição
+    // mais recente do filtro
+    far_head = (far_head + AEC_PARTITIONS - 1) % AEC_PARTITIONS;
+    std::copy(far_previous.begin(), far_previous.end(), time_buffer.begin());
+    std::copy(far, far + AEC_BLOCK_SIZE, time_buffer.begin() + AEC_BLOCK_SIZE);
+    std::copy(far, far + AEC_BLOCK_SIZE, far_previous.begin());
+    float* head_re = far_re.data() + far_head * bins;
+    float* head_im = far_im.data() + far_head * bins;
+    fft.forward(time_buffer.data(), head_re, head_im);
+
+    // Troca a potência da partição que saiu do filtro pela da nova; a soma
+    // é refeita a cada volta da fila para não acumular erro de arredondamento
+    float* head_magnitude = far_magnitude.data() + far_head * bins;
+    for (int k = 0; k < bins; ++k) {
+        const float magnitude = head_re[k] * head_re[k] + head_im[k] * head_im[k];
+        far_power[k] += magnitude - head_magnitude[k];
+        head_magnitude[k] = magnitude;
+    }
+    if (far_head == 0) {
+        std::fill(far_power.begin(), far_power.end(), 0.0f);
+        for (int p = 0; p < AEC_PARTITIONS; ++p) {
+            for (int k = 0; k < bins; ++k) {
+                far_power[k] += far_magnitude[p * bins + k];
+            }
+        }
+    }
+
+    // Estimativa do eco: soma de W_p * X_(atual - p) sobre as partições
+    std::fill(echo_re.begin(), echo_re.end(), 0.0f);
+    std::fill(echo_im.begin(), echo_im.end(), 0.0f);
+    for (int p = 0; p < AEC_PARTITIONS; ++p) {
+        const int slot = (far_head + p) % AEC_PARTITIONS;
+        complex_mac(echo_re.data(), echo_im.data(),
+                    weight_re.data() + p * bins, weight_im.data() + p * bins,
+                    far_re.data() + slot * bins, far_im.data() + slot * bins,
+                    bins);
+    }
+    fft.inverse(echo_re.data(), echo_im.data(), time_buffer.data());
+
+    // Erro = microfone - eco estimado (somente a metade válida da janela)
+    float near_peak = 0.0f, far_peak_block = 0.0f;
+    double block_near = 0.0, block_error = 0.0;
+    for (int i = 0; i < AEC_BLOCK_SIZE; ++i) {
+        out[i] = near[i] - time_buffer[AEC_BLOCK_SIZE + i];
+        near_peak = std::max(near_peak, std::fabs(near[i]));
+        far_peak_block = std::max(far_peak_block, std::fabs(far[i]));
+        block_near += near[i] * near[i];
+        block_error += out[i] * out[i];
+    }
+
+    // Detector de fala dupla Geigel: compara o pico do microfone com o pico
+    // da referência dentro da janela coberta pelo filtro
+    far_peaks[far_peak_index] = far_peak_block;
+    far_peak_index = (far_peak_index + 1) % AEC_PARTITIONS;
+    const float far_peak =
+        *std::max_element(far_peaks.begin(), far_peaks.end());
+    if (near_peak > AEC_GEIGEL_THRESHOLD * far_peak) {
+        double_talk_hold = AEC_DOUBLE_TALK_HOLD;
+    }
+    const bool double_talk = double_talk_hold > 0;
+    if (double_talk) {
+        --double_talk_hold;
+        ++double_talk_blocks;
+    }
+
+    if (far_peak > AEC_SILENCE_LEVEL) {
+        near_energy += block_near;
+        error_energy += std::min(block_error, block_near);
+    }
+
+    // Adaptação NLMS: W_p += mu / P_x * conj(X_p) * E
+    if (!double_talk && far_peak > AEC_SILENCE_LEVEL) {
+        std::fill(time_buffer.begin(), time_buffer.begin() + AEC_BLOCK_SIZE,
+                  0.0f);
+        std::copy(out, out + AEC_BLOCK_SIZE,
+                  time_buffer.begin() + AEC_BLOCK_SIZE);
+        fft.forward(time_buffer.data(), error_re.data(), error_im.data());
+
+        for (int k = 0; k < bins; ++k) {
+            step[k] = AEC_STEP_SIZE /
+                      (std::max(far_power[k], 0.0f) + AEC_REGULARIZATION);
+        }
+        for (int p = 0; p < AEC_PARTITIONS; ++p) {
+            const int slot = (far_head + p) % AEC_PARTITIONS;
+            complex_conj_mac_scaled(
+                weight_re.data() + p * bins, weight_im.data() + p * bins,
+                far_re.data() + slot * bins, far_im.data() + slot * bins,
+                error_re.data(), error_im.data(), step.data(), bins);
+        }
+
+        // Restrição do gradiente (zera a metade final da resposta ao
+        // impulso) em uma partição por bloco, para diluir o custo das FFTs
+        float* w_re = weight_re.data() + constrain_index * bins;
+        float* w_im = weight_im.data() + constrain_index * bins;
+        fft.inverse(w_re, w_im, time_buffer.data());
+        std::fill(time_buffer.begin() + AEC_BLOCK_SIZE, time_buffer.end(),
+                  0.0f);
+        fft.forward(time_buffer.data(), w_re, w_im);
+        constrain_index = (constrain_index + 1) % AEC_PARTITIONS;
+    }
+
+    // Se o filtro divergiu (erro maior que o próprio microfone), envia o sinal
+    // original em vez de piorar o áudio
+    if (block_error > block_near) {
+        std::copy(near, near + AEC_BLOCK_SIZE, out);
+    }
+}
+
+void EchoCanceller::print_stats() const {
+    if (error_energy > 0.0) {
+        std::cout << "AEC: atenuação média do eco (ERLE) "
+                  << 10.0 * std::log10(near_energy / error_energy)
+                  << " dB, fala dupla em " << double_talk_blocks << " blocos"
+                  << std::endl;
+    }
+    const double block_ms = 1000.0 * AEC_BLOCK_SIZE / SAMPLE_RATE;
+    if (echo_delay_blocks < 0) {
+        std::cout << "AEC: atraso do eco não estimado (sem correlação com a "
+                     "referência)"
+                  << std::endl;
+        return;
+    }
+    std::cout << "AEC: eco " << echo_delay_blocks * block_ms
+              << " ms depois da referência no filtro; referência "
+              << (reference_shift_blocks >= 0 ? "adiantada" : "atrasada")
+              << " em " << std::abs(reference_shift_blocks) * block_ms
+              << " ms (" << delay_adjustments << " realinhamento(s))"
+              << std::endl;
+}
@@ -0,0 +1,125 @@
+#include "fft.h"
+
+#include <cmath>
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+}
+
+// Pré-calcula as tabelas da transformada
+FFT::FFT(int size)
+    : n(size),
+      half(size / 2),
+      bit_reverse(size / 2),
+      twiddle_re(size / 4),
+      twiddle_im(size / 4),
+      split_re(size / 2 + 1),
+      split_im(size / 2 + 1),
+      work_re(size / 2),
+      work_im(size / 2) {
+    // Tabela de inversão de bits para a FFT complexa de 'half' pontos
+    int bits = 0;
+    while ((1 << bits) < half) ++bits;
+    for (int i = 0; i < half; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        bit_reverse[i] = r;
+    }
+
+    // W_half^k = e^(-2*pi*i*k/half)
+    for (int k = 0; k < half / 2; ++k) {
+        twiddle_re[k] = static_cast<float>(std::cos(2.0 * PI * k / half));
+        twiddle_im[k] = static_cast<float>(-std::sin(2.0 * PI * k / half));
+    }
+
+    // W_n^k = e^(-2*pi*i*k/n), usado para separar as partes par e ímpar
+    for (int k = 0; k <= half; ++k) {
+        split_re[k] = static_cast<float>(std::cos(2.0 * PI * k / n));
+        split_im[k] = static_cast<float>(-std::sin(2.0 * PI * k / n));
+    }
+}
+
+// FFT complexa iterativa (decimação no tempo), entrada em ordem natural
+void FFT::complex_fft(float* re, float* im) const {
+    // Reordena a entrada pela inversão de bits
+    for (int i = 0; i < half; ++i) {
+        int j = bit_reverse[i];
+        if (j > i) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+
+    // Estágios de borboletas. O laço interno percorre as borboletas do mesmo
+    // grupo com passos contíguos, o que o compilador consegue vetorizar.
+    for (int len = 2; len <= half; len <<= 1) {
+        const int span = len / 2;
+        const int step = half / len;
+        for (int start = 0; start < half; start += len) {
+            float* a_re = re + start;
+            float* a_im = im + start;
+            float* b_re = a_re + span;
+            float* b_im = a_im + span;
+            for (int k = 0; k < span; ++k) {
+                const float w_re = twiddle_re[k * step];
+                const float w_im = twiddle_im[k * step];
+                const float t_re = b_re[k] * w_re - b_im[k] * w_im;
+                const float t_im = b_re[k] * w_im + b_im[k] * w_re;
+                b_re[k] = a_re[k] - t_re;
+                b_im[k] = a_im[k] - t_im;
+                a_re[k] += t_re;
+                a_im[k] += t_im;
+            }
+        }
+    }
+}
+
+// Espectro de um sinal real usando uma FFT complexa de n/2 pontos:
+// z[k] = x[2k] + i*x[2k+1], X[k] = Par[k] + W_n^k * Impar[k]
+void FFT::forward(const float* in, float* re, float* im) {
+    for (int i = 0; i < half; ++i) {
+        work_re[i] = in[2 * i];
+        work_im[i] = in[2 * i + 1];
+    }
+    complex_fft(work_re.data(), work_im.data());
+
+    for (int k = 0; k <= half; ++k) {
+        const int a = k % half;
+        const int b = (half - k) % half;
+        // Par = (Z[k] + conj(Z[half-k])) / 2
+        const float even_re = 0.5f * (work_re[a] + work_re[b]);
+        const float even_im = 0.5f * (work_im[a] - work_im[b]);
+        // Impar = (Z[k] - conj(Z[half-k])) / 2i
+        const float odd_re = 0.5f * (work_im[a] + work_im[b]);
+        const float odd_im = -0.5f * (work_re[a] - work_re[b]);
+        re[k] = even_re + split_re[k] * odd_re - split_im[k] * odd_im;
+        im[k] = even_im + split_re[k] * odd_im + split_im[k] * odd_re;
+    }
+}
+
+// Caminho inverso: reconstrói Z[k] = Par[k] + i*Impar[k] e aplica a FFT
+// complexa inversa (via conjugação) de n/2 pontos.
+void FFT::inverse(const float* re, const float* im, float* out) {
+    for (int k = 0; k < half; ++k) {
+        const int b = half - k;
+        const float even_re = 0.5f * (re[k] + re[b]);
+        const float even_im = 0.5f * (im[k] - im[b]);
+        const float diff_re = 0.5f * (re[k] - re[b]);
+        const float diff_im = 0.5f * (im[k] + im[b]);
+        // Impar = diff * conj(W_n^k)
+        const float odd_re = diff_re * split_re[k] + diff_im * split_im[k];
+        const float odd_im = diff_im * split_re[k] - diff_re * split_im[k];
+        // Conjugado de Z[k], para calcular a inversa com a FFT direta
+        work_re[k] = even_re - odd_im;
+        work_im[k] = -(even_im + odd_re);
+    }
+    complex_fft(work_re.data(), work_im.data());
+
+    const float scale = 1.0f / half;
+    for (int i = 0; i < half; ++i) {
+        out[2 * i] = work_re[i] * scale;
+        out[2 * i + 1] = -work_im[i] * scale;
+    }
+}
@@ -0,0 +1,195 @@
+#include "frame_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Nunca destruído: os jitter buffers do cliente são globais e ainda soltam
+// quadros durante o encerramento do programa
+FramePool& frame_pool = *new FramePool;
+
+// Cache de blocos livres da thread. Fica ligado a um pool por vez: se a
+// thread passa a usar outro pool, os blocos voltam para o anterior. Não tem
+// destrutor, para continuar utilizável por quadros soltos depois que a
+// thread começou a terminar (o FramePoolCacheGuard o esvazia).
+struct FramePoolCache {
+    FramePool* owner;
+    int count;
+    bool exiting;  // Thread terminando: sem cache, direto na lista global
+    FrameBlock* items[FRAME_POOL_CACHE_SIZE];
+
+    // Devolve 'n' blocos do cache à lista global do dono
+    void flush(int n) {
+        for (; n > 0 && count > 0; --n) owner->push_global(items[--count]);
+    }
+
+    // Liga o cache a 'pool', devolvendo os blocos do pool anterior
+    void bind(FramePool* pool);
+};
+
+static thread_local FramePoolCache cache;
+
+// Devolve os blocos do cache quando a thread termina
+struct FramePoolCacheGuard {
+    ~FramePoolCacheGuard() {
+        if (cache.owner) cache.flush(cache.count);
+        cache.exiting = true;
+    }
+};
+
+void FramePoolCache::bind(FramePool* pool) {
+    if (owner == pool) return;
+    if (owner) {
+        flush(count);
+    } else {
+        // Primeiro uso na thread: registra a devolução no fim dela
+        static thread_local FramePoolCacheGuard guard;
+        (void)guard;
+    }
+    owner = pool;
+}
+
+FrameRef::FrameRef(const FrameRef& other) : block(other.block) {
+    if (block) block->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameRef& FrameRef::operator=(const FrameRef& other) {
+    if (other.block) other.block->refs.fetch_add(1, std::memory_order_relaxed);
+    reset();
+    block = other.block;
+    return *this;
+}
+
+FrameRef& FrameRef::operator=(FrameRef&& other) noexcept {
+    if (this != &other) {
+        reset();
+        block = other.block;
+        other.block = nullptr;
+    }
+    return *this;
+}
+
+void FrameRef::reset() {
+    if (!block) return;
+    // acq_rel: quem solta por último vê as escritas de todas as referências
+    if (block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (block->pool) {
+            block->pool->release(block);
+        } else {
+            delete block;
+        }
+    }
+    block = nullptr;
+}
+
+bool FrameRef::append(std::string_view bytes) {
+    const size_t room = capacity() - block->size;
+    const size_t count = std::min(room, bytes.size());
+    std::memcpy(block->data + block->size, bytes.data(), count);
+    block->size += static_cast<uint32_t>(count);
+    return count == bytes.size();
+}
+
+FramePool::FramePool(uint32_t count)
+    : blocks(new FrameBlock[count]), block_count(count) {
+    // Monta a lista livre com todos os blocos, o primeiro no topo
+    for (uint32_t i = 0; i < count; ++i) {
+        blocks[i].index = i;
+        blocks[i].pool = this;
+        blocks[i].next.store(i + 1 < count ? i + 2 : 0,
+                             std::memory_order_relaxed);
+    }
+    free_head.store(count > 0 ? 1 : 0, std::memory_order_relaxed);
+}
+
+FramePool::~FramePool() {
+    // Os blocos no cache desta thread não podem voltar a um pool destruído
+    if (cache.owner == this) {
+        cache.count = 0;
+        cache.owner = nullptr;
+    }
+    delete[] blocks;
+}
+
+void FramePool::push_global(FrameBlock* block) {
+    uint64_t head = free_head.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        block->next.store(static_cast<uint32_t>(head),
+                          std::memory_order_relaxed);
+        next = ((head >> 32) + 1) << 32 | (block->index + 1);
+    } while (!free_head.compare_exchange_weak(head, next,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+}
+
+FrameBlock* FramePool::pop_global() {
+    uint64_t head = free_head.load(std::memory_order_acquire);
+    uint64_t next;
+    do {
+        const uint32_t top = static_cast<uint32_t>(head);
+        if (top == 0) return nullptr;
+        // O bloco pode ter sido retirado por outra thread entre a leitura e
+        // a troca; a versão no topo faz a troca falhar nesse caso.
+        const uint32_t after =
+            blocks[top - 1].next.load(std::memory_order_relaxed);
+        next = ((head >> 32) + 1) << 32 | after;
+    } while (!free_head.compare_exchange_weak(head, next,
+                                              std::memory_order_acquire,
+                                              std::memory_order_acquire));
+    return &blocks[static_cast<uint32_t>(head) - 1];
+}
+
+void FramePool::release(FrameBlock* block) {
+    if (cache.exiting) {
+        push_global(block);
+        return;
+    }
+    cache.bind(this);
+    // Cache cheio: metade volta para a lista global, para não trocar bloco
+    // a bloco quando a thread só libera
+    if (cache.count == FRAME_POOL_CACHE_SIZE) {
+        cache.flush(FRAME_POOL_CACHE_SIZE / 2);
+    }
+    cache.items[cache.count++] = block;
+}
+
+FrameRef FramePool::allocate() {
+    FrameBlock* block = nullptr;
+    if (cache.exiting) {
+        block = pop_global();
+    } else {
+        cache.bind(this);
+        // Cache vazio: busca metade dele na lista global
+        if (cache.count == 0) {
+            while (cache.count < FRAME_POOL_CACHE_SIZE / 2) {
+                FrameBlock* free_block = pop_global();
+                if (!free_block) break;
+                cache.items[cache.count++] = free_block;
+            }
+        }
+        if (cache.count > 0) block = cache.items[--cache.count];
+    }
+
+    // Pool esgotado: o quadro vem do heap e é liberado com delete
+    if (!block) {
+        block = new FrameBlock;
+        heap_blocks.fetch_add(1, std::memory_order_relaxed);
+    }
+    block->size = 0;
+    block->refs.store(1, std::memory_order_relaxed);
+    return FrameRef(block);
+}
+
+FrameRef FramePool::copy(std::string_view bytes) {
+    FrameRef frame = allocate();
+    frame.append(bytes);
+    return frame;
+}
+
+void FramePool::print_stats() const {
+    if (fallbacks() == 0) return;
+    std::cout << "Pool de quadros esgotado: " << fallbacks()
+              << " quadro(s) alocado(s) no heap (" << block_count
+              << " blocos no pool)." << std::endl;
+}
@@ -0,0 +1,429 @@
+#include "handoff.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "session_token.h"
+
+namespace {
+// Identifica o formato da cópia da tabela de sessões
+constexpr char HANDOFF_MAGIC[4] = {'V', 'H', 'O', '2'};
+
+// Bytes de cada sessão antes do nome
+constexpr size_t HANDOFF_SESSION_SIZE = 12 + SESSION_TOKEN_SIZE;
+
+// Confirmação enviada pelo processo novo após receber o socket, e a
+// resposta do processo antigo, que só então deixa de servir
+constexpr char HANDOFF_ACK = 0x01;
+constexpr char HANDOFF_COMMIT = 0x02;
+
+// Maior mensagem aceita (a tabela cheia ocupa menos de 1 KiB)
+constexpr size_t HANDOFF_MAX_MESSAGE = 64 * 1024;
+
+// Tempo máximo de espera do processo novo pela mensagem e pela resposta
+constexpr int HANDOFF_TIMEOUT_MS = 1000;
+
+// Tempo máximo que o processo antigo espera pela confirmação. A espera
+// acontece na thread do servidor, então fica bem abaixo de um quadro; o
+// processo novo só conecta depois de pronto para servir e confirma logo
+// após ler a mensagem.
+constexpr int HANDOFF_ACK_TIMEOUT_MS = 5;
+
+// Sufixo do caminho em que o processo novo abre o seu socket de troca
+// antes de assumir; ele troca de nome quando a troca termina
+constexpr const char* HANDOFF_STAGING_SUFFIX = ".novo";
+
+// Sem SIGPIPE se o outro lado fechou a conexão
+#ifdef MSG_NOSIGNAL
+constexpr int HANDOFF_SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int HANDOFF_SEND_FLAGS = 0;
+#endif
+
+// Anexa inteiros big-endian à cópia
+void put_u16(std::vector<char>& out, uint16_t value) {
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value));
+}
+
+void put_u32(std::vector<char>& out, uint32_t value) {
+    put_u16(out, static_cast<uint16_t>(value >> 16));
+    put_u16(out, static_cast<uint16_t>(value));
+}
+
+uint32_t get_u32(const char* in) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(in);
+    return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) |
+           (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+}
+
+// Serializa as sessões ativas. Por sessão: slot (1 byte), IPv4 e porta (na
+// ordem da rede), tempo desde o último pacote em ms (4 bytes), token da
+// sessão (8 bytes), tamanho do nome (1 byte) e o nome. O token segue junto
+// para que os participantes continuem podendo trocar de endereço.
+std::vector<char> serialize_sessions(const ClientInfo clients[MAX_CLIENTS]) {
+    std::vector<char> out(std::begin(HANDOFF_MAGIC), std::end(HANDOFF_MAGIC));
+    const auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (!clients[i].is_active) continue;
+        out.push_back(static_cast<char>(i));
+        const char* ip = reinterpret_cast<const char*>(
+            &clients[i].address.sin_addr.s_addr);
+        out.insert(out.end(), ip, ip + 4);
+        const char* port =
+            reinterpret_cast<const char*>(&clients[i].address.sin_port);
+        out.insert(out.end(), port, port + 2);
+        const auto idle =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                now - clients[i].last_packet_time);
+        put_u32(out, static_cast<uint32_t>(idle.count()));
+        char token[SESSION_TOKEN_SIZE];
+        write_session_token(clients[i].session_token, token);
+        out.insert(out.end(), token, token + SESSION_TOKEN_SIZE);
+        out.push_back(static_cast<char>(clients[i].name.size()));
+        out.insert(out.end(), clients[i].name.begin(), clients[i].name.end());
+    }
+    return out;
+}
+
+// Restaura as sessões; retorna o número de sessões ou -1 se a cópia for
+// inválida
+int deserialize_sessions(const std::vector<char>& in,
+                         ClientInfo clients[MAX_CLIENTS]) {
+    if (in.size() < sizeof(HANDOFF_MAGIC) ||
+        std::memcmp(in.data(), HANDOFF_MAGIC, sizeof(HANDOFF_MAGIC)) != 0) {
+        return -1;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    size_t pos = sizeof(HANDOFF_MAGIC);
+    int count = 0;
+    while (pos < in.size()) {
+        if (in.size() - pos < HANDOFF_SESSION_SIZE) return -1;
+        const int slot = static_cast<uint8_t>(in[pos]);
+        const size_t name_length =
+            static_cast<uint8_t>(in[pos + HANDOFF_SESSION_SIZE - 1]);
+        if (slot >= MAX_CLIENTS || name_length > MAX_NAME_LENGTH ||
+            in.size() - pos - HANDOFF_SESSION_SIZE < name_length) {
+            return -1;
+        }
+
+        ClientInfo& client = clients[slot];
+        client = ClientInfo{};
+        client.address.sin_family = AF_INET;
+        std::memcpy(&client.address.sin_addr.s_addr, &in[pos + 1], 4);
+        std::memcpy(&client.address.sin_port, &in[pos + 5], 2);
+        client.address_len = sizeof(client.address);
+        client.last_packet_time =
+            now - std::chrono::milliseconds(get_u32(&in[pos + 7]));
+        client.session_token = read_session_token(&in[pos + 11]);
+        client.name.assign(&in[pos + HANDOFF_SESSION_SIZE], name_length);
+        client.is_active = true;
+
+        pos += HANDOFF_SESSION_SIZE + name_length;
+        ++count;
+    }
+    return count;
+}
+
+#ifndef _WIN32
+// Preenche o endereço do socket Unix; false se o caminho for longo demais
+bool make_unix_address(const std::string& path, sockaddr_un& addr) {
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Caminho do socket de troca longo demais: " << path
+                  << std::endl;
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Define o tempo máximo das leituras e escritas de um socket
+void set_timeouts(int sock, int timeout_ms) {
+    struct timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+// O socket de troca entrega o socket UDP do servidor: o diretório dele
+// precisa ser só do usuário (ou do root, com o bit sticky se outros podem
+// escrever nele, como /tmp). O diretório padrão fora de XDG_RUNTIME_DIR é
+// criado aqui com permissão 0700.
+bool check_socket_directory(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    const std::string directory =
+        slash == std::string::npos ? "." : path.substr(0, slash);
+    if (!directory.empty()) mkdir(directory.c_str(), 0700);
+
+    struct stat info;
+    const std::string checked = directory.empty() ? "/" : directory;
+    if (lstat(checked.c_str(), &info) < 0) {
+        perror("Erro ao verificar o diretório do socket de troca");
+        return false;
+    }
+    const bool owner_ok = info.st_uid == geteuid() || info.st_uid == 0;
+    const bool shared = (info.st_mode & (S_IWGRP | S_IWOTH)) != 0;
+    if (!S_ISDIR(info.st_mode) || !owner_ok ||
+        (shared && !(info.st_mode & S_ISVTX))) {
+        std::cerr << "[troca] Diretório inseguro para o socket de troca: "
+                  << checked << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Só um processo do mesmo usuário pode assumir ou entregar o servidor
+bool peer_is_same_user(int sock) {
+#ifdef SO_PEERCRED
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &credentials, &length) < 0) {
+        return false;
+    }
+    return credentials.uid == geteuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(sock, &uid, &gid) < 0) return false;
+    return uid == geteuid();
+#endif
+}
+#endif
+}  // namespace
+
+std::string handoff_socket_path() {
+    const char* path = std::getenv("VOIP_HANDOFF_SOCKET");
+    if (path && *path) return path;
+#ifndef _WIN32
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        return std::string(runtime) + "/simple_voip_relay.sock";
+    }
+    return "/tmp/simple_voip_relay-" + std::to_string(geteuid()) +
+           "/relay.sock";
+#else
+    return "";
+#endif
+}
+
+std::string handoff_staging_path(const std::string& path) {
+    return path + HANDOFF_STAGING_SUFFIX;
+}
+
+#ifndef _WIN32
+
+int handoff_listen(const std::string& path) {
+    sockaddr_un addr;
+    if (!make_unix_address(path, addr) || !check_socket_directory(path)) {
+        return -1;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("Erro ao criar o socket de troca");
+        return -1;
+    }
+
+    // Um arquivo antigo no caminho (do processo anterior) é substituído
+    unlink(path.c_str());
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listener, 1) < 0) {
+        perror("Erro ao abrir o socket de troca");
+        close(listener);
+        return -1;
+    }
+    chmod(path.c_str(), 0600);
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+    return listener;
+}
+
+bool handoff_activate(const std::string& staging, const std::string& path) {
+    // rename() substitui o arquivo do processo antigo de uma vez: não há
+    // instante sem socket de troca no caminho
+    if (rename(staging.c_str(), path.c_str()) < 0) {
+        perror("Erro ao publicar o socket de troca");
+        return false;
+    }
+    return true;
+}
+
+bool handoff_send(int listener, int udp_sock,
+                  const ClientInfo clients[MAX_CLIENTS]) {
+    int peer = accept(listener, nullptr, nullptr);
+    if (peer < 0) return false;
+    if (!peer_is_same_user(peer)) {
+        std::cerr << "[troca] Conexão de outro usuário recusada." << std::endl;
+        close(peer);
+        return false;
+    }
+    // Em alguns sistemas o socket aceito herda o O_NONBLOCK do listener
+    fcntl(peer, F_SETFL, fcntl(peer, F_GETFL) & ~O_NONBLOCK);
+    set_timeouts(peer, HANDOFF_ACK_TIMEOUT_MS);
+
+    // Uma mensagem: tamanho da cópia (4 bytes) + cópia, com o socket UDP
+    // anexado como SCM_RIGHTS
+    std::vector<char> snapshot = serialize_sessions(clients);
+    std::vector<char> message;
+    put_u32(message, static_cast<uint32_t>(snapshot.size()));
+    message.insert(message.end(), snapshot.begin(), snapshot.end());
+
+    iovec iov{message.data(), message.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &udp_sock, sizeof(int));
+
+    bool ok = sendmsg(peer, &msg, HANDOFF_SEND_FLAGS) ==
+              static_cast<ssize_t>(message.size());
+
+    // Só encerra depois que o sucessor confirmar que assumiu o socket; sem
+    // confirmação este processo continua servindo. A resposta final avisa
+    // o sucessor de que a confirmação chegou a tempo: sem ela, ele desiste
+    // e os dois processos nunca servem ao mesmo tempo.
+    char ack = 0;
+    ok = ok && recv(peer, &ack, 1, 0) == 1 && ack == HANDOFF_ACK;
+    ok = ok && send(peer, &HANDOFF_COMMIT, 1, HANDOFF_SEND_FLAGS) == 1;
+    close(peer);
+
+    if (!ok) {
+        std::cerr << "[troca] O sucessor não confirmou; continuando."
+                  << std::endl;
+    }
+    return ok;
+}
+
+int handoff_receive(const std::string& path, ClientInfo clients[MAX_CLIENTS]) {
+    sockaddr_un addr;
+    if (!make_unix_address(path, addr) || !check_socket_directory(path)) {
+        return -1;
+    }
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("Erro ao criar o socket de troca");
+        return -1;
+    }
+    set_timeouts(sock, HANDOFF_TIMEOUT_MS);
+    if (connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("Erro ao conectar ao servidor em execução");
+        close(sock);
+        return -1;
+    }
+    if (!peer_is_same_user(sock)) {
+        std::cerr << "[troca] O servidor em execução é de outro usuário."
+                  << std::endl;
+        close(sock);
+        return -1;
+    }
+
+    // O descritor chega junto com os primeiros bytes; o resto da mensagem
+    // pode vir em leituras seguintes
+    std::vector<char> message;
+    int udp_sock = -1;
+    size_t expected = 4;
+    while (message.size() < expected) {
+        char buffer[2048];
+        iovec iov{buffer, sizeof(buffer)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(sock, &msg, 0);
+        if (n <= 0) break;
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_RIGHTS) {
+                std::memcpy(&udp_sock, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+        message.insert(message.end(), buffer, buffer + n);
+        if (message.size() >= 4) expected = 4 + get_u32(message.data());
+        if (expected > HANDOFF_MAX_MESSAGE) break;
+    }
+
+    int sessions = -1;
+    if (udp_sock >= 0 && message.size() >= expected &&
+        expected <= HANDOFF_MAX_MESSAGE) {
+        const std::vector<char> snapshot(message.begin() + 4, message.end());
+        sessions = deserialize_sessions(snapshot, clients);
+    }
+    if (sessions < 0) {
+        std::cerr << "[troca] Resposta inválida do servidor em execução."
+                  << std::endl;
+        if (udp_sock >= 0) close(udp_sock);
+        close(sock);
+        return -1;
+    }
+
+    // Confirma e espera a resposta: a partir dela o processo antigo parou
+    // de ler o socket
+    char commit = 0;
+    if (send(sock, &HANDOFF_ACK, 1, HANDOFF_SEND_FLAGS) != 1 ||
+        recv(sock, &commit, 1, 0) != 1 || commit != HANDOFF_COMMIT) {
+        std::cerr << "[troca] O servidor em execução não aceitou a "
+                     "confirmação."
+                  << std::endl;
+        close(udp_sock);
+        close(sock);
+        return -1;
+    }
+    close(sock);
+
+    std::cout << "[troca] Socket e " << sessions
+              << " sessão(ões) recebidos do servidor em execução." << std::endl;
+    return udp_sock;
+}
+
+void handoff_close(int listener, const std::string& path, bool remove_path) {
+    if (listener < 0) return;
+    close(listener);
+    if (remove_path) unlink(path.c_str());
+}
+
+#else
+
+int handoff_listen(const std::string&) { return -1; }
+
+bool handoff_activate(const std::string&, const std::string&) {
+    return false;
+}
+
+bool handoff_send(int, int, const ClientInfo[MAX_CLIENTS]) { return false; }
+
+int handoff_receive(const std::string&, ClientInfo[MAX_CLIENTS]) {
+    std::cerr << "A troca do servidor sem interrupção não está disponível "
+                 "no Windows."
+              << std::endl;
+    return -1;
+}
+
+void handoff_close(int, const std::string&, bool) {}
+
+#endif
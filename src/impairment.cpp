@@ -0,0 +1,181 @@
+#include "impairment.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+const ImpairmentPreset IMPAIRMENT_PRESETS[] = {
+    {"limpa", ""},
+    {"wifi", "atraso=3,jitter=6,perda=0.5,dup=0.2"},
+    {"rajadas", "atraso=10,rajada=3:25"},
+    {"movel", "atraso=50,jitter=20,perda=1,rajada=1:40,reordem=1,banda=1500"},
+    {"congestionada", "atraso=20,jitter=5,banda=900,fila=150"},
+    {"ruim", "atraso=80,jitter=40,perda=3,rajada=2:30,reordem=2,dup=1"},
+    {"nat", "atraso=30,jitter=5,perda=0.5,nat=2"},
+};
+const int IMPAIRMENT_PRESET_COUNT =
+    sizeof(IMPAIRMENT_PRESETS) / sizeof(IMPAIRMENT_PRESETS[0]);
+
+namespace {
+// Lê um número não negativo; false se 'text' não for um
+bool read_value(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && end && *end == '\0' && value >= 0;
+}
+
+bool read_percent(const std::string& text, double& value) {
+    if (!read_value(text, value) || value > 100) return false;
+    value /= 100.0;
+    return true;
+}
+}  // namespace
+
+bool parse_impairment_profile(const std::string& text,
+                              ImpairmentProfile& profile) {
+    profile = ImpairmentProfile{};
+    profile.name = text;
+    std::string spec = text;
+    for (int i = 0; i < IMPAIRMENT_PRESET_COUNT; ++i) {
+        if (text == IMPAIRMENT_PRESETS[i].name) {
+            spec = IMPAIRMENT_PRESETS[i].spec;
+            break;
+        }
+    }
+
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (item.empty()) continue;
+        const size_t equals = item.find('=');
+        const std::string key = item.substr(0, equals);
+        const std::string value =
+            equals == std::string::npos ? "" : item.substr(equals + 1);
+        bool valid;
+        if (key == "perda") {
+            valid = read_percent(value, profile.loss);
+        } else if (key == "rajada") {
+            // Entrada e saída do estado ruim: a rajada média tem
+            // 1 / saída pacotes
+            const size_t colon = value.find(':');
+            valid = colon != std::string::npos &&
+                    read_percent(value.substr(0, colon), profile.burst_enter) &&
+                    read_percent(value.substr(colon + 1), profile.burst_exit) &&
+                    profile.burst_exit > 0;
+        } else if (key == "perda_rajada") {
+            valid = read_percent(value, profile.burst_loss);
+        } else if (key == "atraso") {
+            valid = read_value(value, profile.delay_ms);
+        } else if (key == "jitter") {
+            valid = read_value(value, profile.jitter_ms);
+        } else if (key == "reordem") {
+            valid = read_percent(value, profile.reorder);
+        } else if (key == "dup") {
+            valid = read_percent(value, profile.duplicate);
+        } else if (key == "banda") {
+            valid = read_value(value, profile.rate_kbps);
+        } else if (key == "fila") {
+            valid = read_value(value, profile.queue_ms);
+        } else if (key == "nat") {
+            valid = read_value(value, profile.nat_s);
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            std::cerr << "Perfil de rede inválido: '" << item << "' em '"
+                      << text << "'." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+ImpairedLink::ImpairedLink(const ImpairmentProfile& profile, uint64_t seed)
+    : profile(profile), random(seed) {}
+
+void ImpairedLink::schedule(Clock::time_point due, int tag,
+                            std::string_view data) {
+    pending.push(Packet{due, next_order++, tag,
+                        std::vector<char>(data.begin(), data.end())});
+}
+
+void ImpairedLink::submit(std::string_view data, int tag,
+                          Clock::time_point now) {
+    ++counters.packets;
+
+    // Todos os sorteios de um pacote são feitos antes das decisões, sempre
+    // na mesma quantidade: a sequência do gerador não depende do que
+    // aconteceu com os pacotes anteriores (a fila do gargalo depende do
+    // relógio)
+    const double state_draw = uniform(random);
+    const double loss_draw = uniform(random);
+    const double jitter_draw = normal(random);
+    const double reorder_draw = uniform(random);
+    const double duplicate_draw = uniform(random);
+
+    // Gilbert-Elliott: muda de estado e perde com a probabilidade dele
+    bad_state = bad_state ? state_draw >= profile.burst_exit
+                          : state_draw < profile.burst_enter;
+    if (bad_state && loss_draw < profile.burst_loss) {
+        ++counters.burst_drops;
+        return;
+    }
+    if (!bad_state && loss_draw < profile.loss) {
+        ++counters.random_drops;
+        return;
+    }
+
+    // Gargalo: o pacote sai quando o link termina os anteriores
+    Clock::time_point departure = now;
+    if (profile.rate_kbps > 0) {
+        const auto transmission = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(data.size() * 8.0 /
+                                          (profile.rate_kbps * 1000.0)));
+        departure = std::max(now, link_free) + transmission;
+        if (departure - now > std::chrono::duration<double, std::milli>(
+                                  profile.queue_ms)) {
+            ++counters.queue_drops;
+            return;
+        }
+        link_free = departure;
+    }
+
+    // Propagação com jitter; sem reordenação, um pacote nunca passa o
+    // anterior
+    const double delay_ms =
+        std::max(0.0, profile.delay_ms + profile.jitter_ms * jitter_draw);
+    Clock::time_point due =
+        departure + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double, std::milli>(delay_ms));
+    if (reorder_draw < profile.reorder) {
+        due += std::chrono::milliseconds(IMPAIR_REORDER_MS);
+        ++counters.reordered;
+    } else {
+        due = std::max(due, last_due);
+        last_due = due;
+    }
+
+    schedule(due, tag, data);
+    counters.added_delay_ms.push_back(
+        std::chrono::duration<double, std::milli>(due - now).count());
+    if (duplicate_draw < profile.duplicate) {
+        schedule(due + std::chrono::milliseconds(IMPAIR_DUPLICATE_MS), tag,
+                 data);
+        ++counters.duplicated;
+    }
+}
+
+bool ImpairedLink::pop_due(Clock::time_point now, Packet& packet) {
+    if (pending.empty() || pending.top().due > now) return false;
+    // O pacote sai da fila em seguida: pode ser movido
+    packet = std::move(const_cast<Packet&>(pending.top()));
+    pending.pop();
+    ++counters.delivered;
+    counters.bytes += packet.data.size();
+    return true;
+}
+
+ImpairedLink::Clock::time_point ImpairedLink::next_due() const {
+    return pending.empty() ? Clock::time_point::max() : pending.top().due;
+}
@@ -0,0 +1,295 @@
+// Gravador de salas: consumidor local do anel de memória compartilhada
+// (shm_ring.h). Cada anel é uma sala (um servidor); o gravador grava a
+// mixagem da sala e/ou uma trilha por participante (recording.h) e imprime
+// as mensagens do servidor, sem passar pela rede.
+//
+// O servidor precisa ter sido iniciado com VOIP_SHM=<nome>. Se o servidor
+// for substituído (troca sem interrupção), o gravador abre o anel novo e
+// continua. VOIP_RECORD_MODE escolhe o que é gravado: mix, tracks ou both
+// (padrão).
+//
+// Uso: gravador_local [anéis separados por vírgula] [segundos] [prefixo]
+//      gravador_local --bench <salas> [segundos] [prefixo]
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "recording.h"
+#include "shm_ring.h"
+#include "simulcast.h"
+
+// Espera entre consultas aos anéis quando não há pacote novo
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds(2);
+
+// Tempo máximo esperando um servidor substituto abrir o anel
+constexpr auto REOPEN_TIMEOUT = std::chrono::seconds(2);
+
+// Intervalo entre tentativas de abrir um anel
+constexpr auto REOPEN_INTERVAL = std::chrono::milliseconds(100);
+
+// Participantes falando em cada sala do benchmark
+constexpr int BENCH_SPEAKERS = 4;
+
+// Uma sala gravada a partir de um anel
+struct Room {
+    std::string ring_name;
+    ShmRingReader ring;
+    std::unique_ptr<RoomRecorder> recorder;
+    // Enquanto o anel está fechado: prazo para o substituto aparecer
+    bool reopening = false;
+    std::chrono::steady_clock::time_point reopen_deadline;
+    std::chrono::steady_clock::time_point next_attempt;
+};
+
+// Tenta abrir o anel até o prazo
+static bool open_ring(ShmRingReader& ring, const std::string& name,
+                      std::chrono::steady_clock::time_point deadline) {
+    while (!ring.open(name)) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(REOPEN_INTERVAL);
+    }
+    return true;
+}
+
+static int read_record_mode() {
+    const char* mode = std::getenv("VOIP_RECORD_MODE");
+    if (!mode || std::strcmp(mode, "both") == 0) return RECORD_BOTH;
+    if (std::strcmp(mode, "mix") == 0) return RECORD_MIX;
+    if (std::strcmp(mode, "tracks") == 0) return RECORD_TRACKS;
+    std::cerr << "VOIP_RECORD_MODE inválido (use mix, tracks ou both); "
+              << "gravando ambos." << std::endl;
+    return RECORD_BOTH;
+}
+
+// Lê todos os pacotes disponíveis no anel da sala. Retorna false se a sala
+// deve ser encerrada (o anel não voltou ou um arquivo não pôde ser criado).
+static bool drain_room(Room& room, std::vector<char>& packet, bool& any) {
+    const auto now = std::chrono::steady_clock::now();
+    if (room.reopening) {
+        if (now < room.next_attempt) return true;
+        // O anel novo é lido desde o início: o servidor que o criou já
+        // pode ter publicado pacotes enquanto este procurava
+        if (room.ring.open(room.ring_name, true)) {
+            room.reopening = false;
+        } else if (now >= room.reopen_deadline) {
+            return false;
+        } else {
+            room.next_attempt = now + REOPEN_INTERVAL;
+            return true;
+        }
+    }
+
+    while (true) {
+        const int n = room.ring.read(packet.data(), packet.size());
+        if (n == 0) return true;
+        if (n < 0) {
+            // O servidor fechou o anel: encerrou ou foi substituído
+            std::cout << "Anel " << room.ring_name
+                      << " fechado pelo servidor; procurando outro..."
+                      << std::endl;
+            room.reopening = true;
+            room.reopen_deadline = now + REOPEN_TIMEOUT;
+            room.next_attempt = now + REOPEN_INTERVAL;
+            return true;
+        }
+        any = true;
+
+        const PacketType type = static_cast<PacketType>(packet[0]);
+        if (type == SERVER_MESSAGE) {
+            std::cout << std::string_view(packet.data() + 1, n - 1)
+                      << std::endl;
+        } else if (type == AUDIO_DATA &&
+                   !room.recorder->on_packet(packet.data(), n)) {
+            return false;
+        }
+    }
+}
+
+// Grava 'room_count' salas sintéticas, cada uma com BENCH_SPEAKERS
+// participantes enviando simulcast, e mede o tempo gasto a cada 20 ms e se
+// a thread de escrita acompanhou o disco
+static int run_bench(int room_count, double seconds, const std::string& prefix,
+                     int mode) {
+    DiskWriter disk;
+    disk.start();
+
+    std::vector<std::unique_ptr<RoomRecorder>> rooms;
+    for (int r = 0; r < room_count; ++r) {
+        rooms.push_back(std::make_unique<RoomRecorder>(
+            disk, prefix + "_sala" + std::to_string(r), mode));
+    }
+
+    // Um pacote por participante, com um tom diferente em cada um
+    std::vector<std::vector<char>> packets(BENCH_SPEAKERS,
+                                           std::vector<char>(MAX_PACKET_SIZE));
+    std::vector<SimulcastEncoder> encoders(BENCH_SPEAKERS);
+    std::vector<int16_t> tone(FRAMES_PER_BUFFER);
+    std::vector<int> lengths(BENCH_SPEAKERS);
+    for (int s = 0; s < BENCH_SPEAKERS; ++s) {
+        for (int i = 0; i < FRAMES_PER_BUFFER; ++i) {
+            // Onda quadrada de 200 Hz + 100 Hz por participante
+            const int period = SAMPLE_RATE / (200 + 100 * s);
+            tone[i] = (i % period) < period / 2 ? 4000 : -4000;
+        }
+        char* packet = packets[s].data();
+        packet[0] = AUDIO_DATA;
+        packet[1] = static_cast<char>(s);
+        packet[AUDIO_LAYER_OFFSET] = LAYER_SIMULCAST;
+        std::memcpy(packet + AUDIO_HEADER_SIZE, tone.data(), AUDIO_BUFFER_SIZE);
+        lengths[s] =
+            AUDIO_HEADER_SIZE + encoders[s].encode(packet + AUDIO_HEADER_SIZE);
+    }
+
+    std::cout << "Gravando " << room_count << " salas com " << BENCH_SPEAKERS
+              << " participantes por " << seconds << " s..." << std::endl;
+
+    // Em tempo real, como na gravação de verdade: a cada 20 ms chegam os
+    // pacotes de todas as salas e cada sala grava um quadro
+    const auto frame = std::chrono::microseconds(1000000LL * FRAMES_PER_BUFFER /
+                                                 SAMPLE_RATE);
+    const int ticks = static_cast<int>(seconds * SAMPLE_RATE / FRAMES_PER_BUFFER);
+    const auto start = std::chrono::steady_clock::now();
+    // O primeiro quadro cria os arquivos e é contado à parte
+    double first_ms = 0.0, busy_sum = 0.0, busy_max = 0.0;
+    for (int t = 0; t < ticks; ++t) {
+        const auto tick_start = std::chrono::steady_clock::now();
+        const uint32_t timestamp =
+            htonl(static_cast<uint32_t>(t) * FRAMES_PER_BUFFER);
+        for (auto& room : rooms) {
+            for (int s = 0; s < BENCH_SPEAKERS; ++s) {
+                std::memcpy(packets[s].data() + AUDIO_TIMESTAMP_OFFSET,
+                            &timestamp, sizeof(timestamp));
+                room->on_packet(packets[s].data(), lengths[s]);
+            }
+            room->tick();
+        }
+        const double busy = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - tick_start)
+                                .count();
+        if (t == 0) {
+            first_ms = busy;
+        } else {
+            busy_sum += busy;
+            busy_max = std::max(busy_max, busy);
+        }
+        std::this_thread::sleep_until(start + (t + 1) * frame);
+    }
+
+    for (auto& room : rooms) room->close();
+    const auto close_start = std::chrono::steady_clock::now();
+    disk.stop();
+    const double flush_ms = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - close_start)
+                                .count();
+
+    std::cout << "Criação dos arquivos: " << first_ms << " ms." << std::endl
+              << "Recepção e mixagem de todas as salas a cada 20 ms: média "
+              << busy_sum / std::max(ticks - 1, 1) << " ms, máximo "
+              << busy_max << " ms." << std::endl
+              << "Gravado: " << disk.written() / (1024.0 * 1024.0) << " MiB ("
+              << disk.written() / (1024.0 * 1024.0) / seconds << " MiB/s)."
+              << std::endl
+              << "Fila de escrita: pico de " << disk.pending_peak()
+              << " blocos, " << disk.dropped() << " descartados; "
+              << flush_ms << " ms para esvaziar no fim." << std::endl;
+    return disk.dropped() == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    const int mode = read_record_mode();
+
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+        const int rooms = argc > 2 ? std::atoi(argv[2]) : 100;
+        const double seconds = argc > 3 ? std::atof(argv[3]) : 10.0;
+        const std::string prefix = argc > 4 ? argv[4] : "bench";
+        if (rooms <= 0 || seconds <= 0) {
+            std::cerr << "Uso: gravador_local --bench <salas> [segundos] "
+                         "[prefixo]"
+                      << std::endl;
+            return 1;
+        }
+        return run_bench(rooms, seconds, prefix, mode);
+    }
+
+    const std::string ring_list = argc > 1 ? argv[1] : "/simple_voip";
+    const double seconds = argc > 2 ? std::atof(argv[2]) : 0.0;
+    const std::string prefix = argc > 3 ? argv[3] : "gravacao";
+
+    DiskWriter disk;
+    disk.start();
+
+    // Uma sala por anel; com mais de um anel, cada sala ganha um sufixo
+    std::vector<std::unique_ptr<Room>> rooms;
+    std::stringstream names(ring_list);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        auto room = std::make_unique<Room>();
+        room->ring_name = name;
+        rooms.push_back(std::move(room));
+    }
+    for (size_t r = 0; r < rooms.size(); ++r) {
+        Room& room = *rooms[r];
+        if (!open_ring(room.ring, room.ring_name,
+                       std::chrono::steady_clock::now() + REOPEN_TIMEOUT)) {
+            return 1;
+        }
+        const std::string room_prefix =
+            rooms.size() == 1 ? prefix : prefix + "_sala" + std::to_string(r);
+        room.recorder = std::make_unique<RoomRecorder>(disk, room_prefix, mode);
+    }
+    std::cout << "Gravando " << rooms.size() << " sala(s)"
+              << (seconds > 0 ? " por " + std::to_string(seconds) + " s"
+                              : std::string(" (Ctrl+C para parar)"))
+              << "." << std::endl;
+
+    // As salas avançam 20 ms a cada 20 ms do relógio local
+    const auto frame = std::chrono::microseconds(1000000LL * FRAMES_PER_BUFFER /
+                                                 SAMPLE_RATE);
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration_cast<
+                                 std::chrono::steady_clock::duration>(
+                                 std::chrono::duration<double>(seconds));
+    auto next_tick = start + frame;
+    std::vector<char> packet(MAX_PACKET_SIZE);
+    bool running = true;
+    while (running && (seconds <= 0 || std::chrono::steady_clock::now() < end)) {
+        bool any = false;
+        for (auto& room : rooms) {
+            if (!drain_room(*room, packet, any)) {
+                running = false;
+            }
+        }
+
+        for (auto now = std::chrono::steady_clock::now(); now >= next_tick;
+             next_tick += frame) {
+            for (auto& room : rooms) room->recorder->tick();
+        }
+        if (!any) std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+
+    uint64_t lost = 0;
+    for (auto& room : rooms) {
+        room->recorder->close();
+        lost += room->ring.lost_packets();
+    }
+    disk.stop();
+    std::cout << "Pacotes perdidos pelo gravador: " << lost << std::endl;
+    if (disk.dropped() > 0) {
+        std::cout << "Blocos descartados por atraso do disco: " << disk.dropped()
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "log.h"
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+
+LogLevel log_level = LOG_INFO;
+
+namespace {
+// Um registro, copiado por inteiro para o anel: nada aponta para a memória
+// de quem registrou
+struct LogRecord {
+    std::chrono::system_clock::time_point time;
+    LogLevel level;
+    bool has_address;
+    uint16_t port;  // Na ordem da rede
+    uint32_t ip;    // Na ordem da rede
+    uint8_t text_length;
+    uint8_t name_length;
+    char text[LOG_TEXT_SIZE];
+    char name[MAX_NAME_LENGTH];
+};
+
+// Anel de uma thread: só ela escreve (head) e só a thread de escrita lê
+// (tail)
+struct LogRing {
+    LogRecord records[LOG_RING_SIZE];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+// Anéis de todas as threads que já registraram algo. A trava só é usada
+// quando uma thread registra pela primeira vez e pela thread de escrita.
+std::mutex rings_mutex;
+std::vector<std::unique_ptr<LogRing>> rings;
+
+// Anel da thread atual, criado no primeiro registro
+thread_local LogRing* local_ring = nullptr;
+
+std::thread writer;
+std::atomic<bool> writer_running{false};
+
+// Intervalo entre as escritas no terminal
+constexpr auto LOG_FLUSH_INTERVAL = std::chrono::milliseconds(10);
+
+const char* const LEVEL_NAMES[] = {"DEBUG", "INFO ", "AVISO", "ERRO "};
+
+LogRing* register_ring() {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    rings.push_back(std::make_unique<LogRing>());
+    return rings.back().get();
+}
+
+// Formata um registro como "HH:MM:SS.mmm NIVEL texto ip:porta (Nome: x)"
+void format_record(const LogRecord& record, std::string& out) {
+    const std::time_t seconds =
+        std::chrono::system_clock::to_time_t(record.time);
+    const auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            record.time.time_since_epoch())
+                            .count() %
+                        1000;
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char prefix[32];
+    std::snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d %s ",
+                  local.tm_hour, local.tm_min, local.tm_sec,
+                  static_cast<int>(millis), LEVEL_NAMES[record.level]);
+    out += prefix;
+    out.append(record.text, record.text_length);
+
+    if (record.has_address) {
+        in_addr ip{};
+        ip.s_addr = record.ip;
+        char ip_str[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &ip, ip_str, INET_ADDRSTRLEN);
+        out += ' ';
+        out += ip_str;
+        out += ':';
+        out += std::to_string(ntohs(record.port));
+    }
+    if (record.name_length > 0) {
+        out += " (Nome: ";
+        out.append(record.name, record.name_length);
+        out += ')';
+    }
+    out += '\n';
+}
+
+// Esvazia todos os anéis e escreve o resultado de uma vez
+void drain_rings(std::string& out) {
+    // Copia a lista de anéis para não segurar a trava durante a escrita
+    // (os anéis só são liberados no fim do programa)
+    std::vector<LogRing*> current;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (auto& ring : rings) current.push_back(ring.get());
+    }
+
+    for (LogRing* ring : current) {
+        const uint32_t head = ring->head.load(std::memory_order_acquire);
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail) {
+            format_record(ring->records[tail % LOG_RING_SIZE], out);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+
+        const uint64_t dropped = ring->dropped.exchange(0);
+        if (dropped > 0) {
+            out += "[log] " + std::to_string(dropped) +
+                   " mensagens descartadas (anel cheio)\n";
+        }
+    }
+    if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+        out.clear();
+    }
+}
+
+void writer_func() {
+    std::string out;
+    while (writer_running) {
+        drain_rings(out);
+        std::this_thread::sleep_for(LOG_FLUSH_INTERVAL);
+    }
+    drain_rings(out);
+}
+}  // namespace
+
+void log_init() {
+    if (const char* level = std::getenv("VOIP_LOG_LEVEL")) {
+        const char* const names[] = {"debug", "info", "warn", "error", "off"};
+        for (int i = 0; i <= LOG_OFF; ++i) {
+            if (std::strcmp(level, names[i]) == 0) {
+                log_level = static_cast<LogLevel>(i);
+            }
+        }
+    }
+    if (writer_running.exchange(true)) return;
+    writer = std::thread(writer_func);
+}
+
+void log_shutdown() {
+    if (!writer_running.exchange(false)) return;
+    writer.join();
+}
+
+void log_push(LogLevel level, std::string_view text,
+              const sockaddr_in* address, std::string_view name) {
+    LogRing* ring = local_ring;
+    if (!ring) ring = local_ring = register_ring();
+
+    // Anel cheio: descarta em vez de esperar a thread de escrita
+    const uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_SIZE) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LogRecord& record = ring->records[head % LOG_RING_SIZE];
+    record.time = std::chrono::system_clock::now();
+    record.level = level;
+    record.has_address = address != nullptr;
+    if (address) {
+        record.ip = address->sin_addr.s_addr;
+        record.port = address->sin_port;
+    }
+    record.text_length = static_cast<uint8_t>(
+        std::min<size_t>(text.size(), LOG_TEXT_SIZE));
+    std::memcpy(record.text, text.data(), record.text_length);
+    record.name_length = static_cast<uint8_t>(
+        std::min<size_t>(name.size(), MAX_NAME_LENGTH));
+    std::memcpy(record.name, name.data(), record.name_length);
+
+    ring->head.store(head + 1, std::memory_order_release);
+}
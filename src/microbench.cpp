@@ -0,0 +1,204 @@
+#include "microbench.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+namespace {
+// Escapa aspas e barras para uma string JSON
+std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle]
+                             : (values[middle - 1] + values[middle]) / 2;
+}
+
+// Lê o tempo de relógio por operação de cada benchmark de um JSON gravado
+// por write_json() (um benchmark por linha)
+std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> times;
+    std::ifstream file(path);
+    std::string line;
+    const std::string name_key = "\"name\": \"";
+    const std::string time_key = "\"real_time\": ";
+    while (std::getline(file, line)) {
+        const size_t name_at = line.find(name_key);
+        const size_t time_at = line.find(time_key);
+        if (name_at == std::string::npos || time_at == std::string::npos) {
+            continue;
+        }
+        const size_t start = name_at + name_key.size();
+        const size_t end = line.find('"', start);
+        if (end == std::string::npos) continue;
+        times[line.substr(start, end - start)] =
+            std::atof(line.c_str() + time_at + time_key.size());
+    }
+    return times;
+}
+}  // namespace
+
+double BenchRunner::cpu_seconds() {
+    timespec now{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+bool BenchRunner::parse(int argc, char* argv[]) {
+    executable = argc > 0 ? argv[0] : "";
+    for (int i = 1; i < argc; ++i) {
+        const std::string option = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (option == "--filter" && has_value) {
+            filter = argv[++i];
+        } else if (option == "--min-time" && has_value) {
+            min_time = std::atof(argv[++i]);
+        } else if (option == "--json" && has_value) {
+            json_path = argv[++i];
+        } else if (option == "--baseline" && has_value) {
+            baseline_path = argv[++i];
+        } else if (option == "--threshold" && has_value) {
+            threshold = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Uso: " << executable
+                      << " [--filter <texto>] [--min-time <s>] [--json "
+                         "<arquivo>] [--baseline <arquivo>] [--threshold <%>]"
+                      << std::endl;
+            return false;
+        }
+    }
+    if (min_time <= 0 || threshold <= 0) {
+        std::cerr << "--min-time e --threshold devem ser positivos."
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void BenchRunner::report(const std::string& name, uint64_t iterations,
+                         std::vector<double>& real, std::vector<double>& cpu,
+                         uint64_t allocations, bool steady_state) {
+    BenchResult result{name,
+                       iterations,
+                       median(real),
+                       median(cpu),
+                       *std::min_element(real.begin(), real.end()),
+                       static_cast<double>(allocations) /
+                           (static_cast<double>(iterations) * BENCH_REPETITIONS),
+                       steady_state};
+    results.push_back(result);
+    std::cout << std::left << std::setw(60) << name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(12)
+              << result.real_ns << " ns" << std::setw(12) << result.cpu_ns
+              << " ns CPU" << std::setw(12) << iterations << " iterações"
+              << std::setprecision(2) << std::setw(9) << result.allocs_per_op
+              << " aloc/op"
+              << (steady_state && allocations > 0 ? "  ALOCA" : "")
+              << std::endl;
+}
+
+bool BenchRunner::write_json() const {
+    std::ofstream file(json_path);
+    if (!file) {
+        std::cerr << "Erro ao criar " << json_path << std::endl;
+        return false;
+    }
+
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z",
+                  std::localtime(&now));
+
+    file << "{\n  \"context\": {\n"
+         << "    \"date\": \"" << date << "\",\n"
+         << "    \"executable\": \"" << json_escape(executable) << "\",\n"
+         << "    \"num_cpus\": " << sysconf(_SC_NPROCESSORS_ONLN) << ",\n"
+         << "    \"repetitions\": " << BENCH_REPETITIONS << "\n"
+         << "  },\n  \"benchmarks\": [\n";
+    file << std::setprecision(6);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        file << "    {\"name\": \"" << json_escape(r.name)
+             << "\", \"run_name\": \"" << json_escape(r.name)
+             << "\", \"run_type\": \"iteration\", \"iterations\": "
+             << r.iterations << ", \"real_time\": " << r.real_ns
+             << ", \"cpu_time\": " << r.cpu_ns
+             << ", \"min_time\": " << r.min_ns
+             << ", \"allocs_per_iter\": " << r.allocs_per_op
+             << ", \"time_unit\": \"ns\"}"
+             << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+int BenchRunner::compare() const {
+    const std::map<std::string, double> baseline = read_baseline(baseline_path);
+    if (baseline.empty()) {
+        std::cerr << "Nenhum resultado lido de " << baseline_path << std::endl;
+        return -1;
+    }
+
+    std::cout << std::endl << "Comparação com " << baseline_path << ":"
+              << std::endl;
+    int regressions = 0;
+    for (const BenchResult& r : results) {
+        const auto old = baseline.find(r.name);
+        if (old == baseline.end() || old->second <= 0) continue;
+        const double change = 100.0 * (r.real_ns - old->second) / old->second;
+        const bool slower = change > threshold;
+        regressions += slower;
+        std::cout << std::left << std::setw(60) << r.name << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(12)
+                  << old->second << " ->" << std::setw(10) << r.real_ns
+                  << " ns" << std::showpos << std::setw(9) << change << "%"
+                  << std::noshowpos << (slower ? "  REGRESSÃO" : "")
+                  << std::endl;
+    }
+    return regressions;
+}
+
+int BenchRunner::finish() {
+    if (results.empty()) {
+        std::cerr << "Nenhum benchmark corresponde ao filtro '" << filter
+                  << "'." << std::endl;
+        return 1;
+    }
+    if (!json_path.empty() && !write_json()) return 1;
+
+    // Os caminhos de regime permanente não podem usar o heap
+    int allocating = 0;
+    for (const BenchResult& r : results) {
+        allocating += r.steady_state && r.allocs_per_op > 0;
+    }
+    if (allocating > 0) {
+        std::cout << allocating << " benchmark(s) de regime permanente "
+                  << "alocando no heap." << std::endl;
+        return 1;
+    }
+
+    if (!baseline_path.empty()) {
+        const int regressions = compare();
+        if (regressions < 0) return 1;
+        if (regressions > 0) {
+            std::cout << regressions << " benchmark(s) mais lento(s) que a "
+                      << "referência (limite de " << threshold << "%)."
+                      << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,673 @@
+// Emulador de rede: proxy UDP entre os clientes e o servidor que aplica um
+// perfil de rede ruim (impairment.h) nos dois sentidos, para ajustar jitter
+// buffer, ocultação de perdas e controle de congestionamento sem depender
+// de uma WAN de verdade.
+//
+// Cada cliente que envia para o proxy ganha um socket próprio até o
+// servidor (o servidor vê um endereço por cliente, como atrás de um NAT) e
+// um par de links emulados, com sementes derivadas da semente dada: a mesma
+// semente reproduz as mesmas perdas. Com a chave nat=<s> no perfil, o
+// socket de cada cliente é trocado a cada <s> segundos, como um NAT que
+// refaz o mapeamento: o servidor passa a ver o cliente em outra porta, e
+// os pacotes que ele ainda manda para a porta antiga se perdem.
+//
+// No modo --scorecard, o emulador roda uma chamada com dois
+// cliente_headless (VOIP_CLIENT_BIN, padrão ./cliente_headless) através do
+// proxy para cada perfil: um fala o WAV dado e o outro ouve. Os rastreios
+// de latência (VOIP_TRACE) dos dois dão a latência boca-ouvido e os
+// quadros que não chegaram a tocar, e o modelo E (ITU-T G.107) resume
+// perda e atraso numa nota R e num MOS estimado. A gravação de quem ouve é
+// comparada com o WAV falado (quality.h), o que dá o SNR segmentado e o MOS
+// perceptual do áudio que de fato tocou. Com VOIP_QUALITY_JSON=<arquivo>,
+// cada perfil acrescenta uma linha JSON com todas as notas ao arquivo.
+//
+// Uso: emulador_rede <porta local> <servidor[:porta]> <perfil> [segundos]
+//                    [semente]
+//      emulador_rede --scorecard <servidor[:porta]> <voz.wav>
+//                    [perfis separados por ';'] [semente]
+//      emulador_rede --perfis
+//
+// Disponível apenas em sistemas Unix.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "impairment.h"
+#include "quality.h"
+#include "trace.h"
+
+extern char** environ;
+
+// Clientes atendidos por um proxy
+constexpr int EMULATOR_MAX_PEERS = 64;
+
+// Maior espera no select(), para conferir o pedido de parada
+constexpr auto EMULATOR_POLL = std::chrono::milliseconds(50);
+
+// Semente padrão
+constexpr uint64_t EMULATOR_DEFAULT_SEED = 1;
+
+// Perfis do scorecard quando nenhum é dado. A lista é separada por ';',
+// porque as descrições "chave=valor" usam vírgulas.
+constexpr const char* SCORECARD_DEFAULT_PROFILES =
+    "limpa;wifi;rajadas;movel;congestionada;ruim;nat";
+
+// Espera entre o ouvinte e o locutor entrarem na chamada
+constexpr auto SCORECARD_JOIN_DELAY = std::chrono::milliseconds(500);
+
+// Modelo E para PCM com ocultação de perdas (G.113, G.711 com PLC): fator
+// de equipamento e robustez à perda
+constexpr double EMODEL_IE = 0.0;
+constexpr double EMODEL_BPL = 25.1;
+
+namespace {
+// Lê "ip[:porta]"
+bool parse_endpoint(const std::string& text, sockaddr_in& address) {
+    std::string ip = text;
+    int port = PORT;
+    const size_t colon = text.find(':');
+    if (colon != std::string::npos) {
+        ip = text.substr(0, colon);
+        port = std::atoi(text.c_str() + colon + 1);
+    }
+    address = sockaddr_in{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (port <= 0 || port > 65535 ||
+        inet_pton(AF_INET, ip.c_str(), &address.sin_addr) != 1) {
+        std::cerr << "Endereço inválido: " << text << std::endl;
+        return false;
+    }
+    return true;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p * (values.size() - 1))];
+}
+
+// Proxy com um par de links emulados por cliente
+class ImpairmentProxy {
+   private:
+    struct Peer {
+        sockaddr_in client;
+        int upstream;
+        std::unique_ptr<ImpairedLink> up;
+        std::unique_ptr<ImpairedLink> down;
+        ImpairedLink::Clock::time_point rebind_at;  // Próxima troca do NAT
+    };
+
+    int listener = -1;
+    sockaddr_in server{};
+    ImpairmentProfile profile;
+    uint64_t seed = EMULATOR_DEFAULT_SEED;
+    std::vector<Peer> peers;
+    uint64_t rebinds = 0;
+
+    // Intervalo entre as trocas do mapeamento do NAT
+    ImpairedLink::Clock::duration nat_interval() const {
+        return std::chrono::duration_cast<ImpairedLink::Clock::duration>(
+            std::chrono::duration<double>(profile.nat_s));
+    }
+
+    // Troca o socket do cliente até o servidor, como um novo mapeamento do
+    // NAT; o antigo é fechado com o que ainda estiver chegando nele
+    void rebind(Peer& peer, ImpairedLink::Clock::time_point now) {
+        const int upstream = socket(AF_INET, SOCK_DGRAM, 0);
+        if (upstream < 0) {
+            perror("Erro ao trocar o socket do proxy");
+            return;
+        }
+        close(peer.upstream);
+        peer.upstream = upstream;
+        peer.rebind_at = now + nat_interval();
+        ++rebinds;
+    }
+
+    int find_peer(const sockaddr_in& address) {
+        for (size_t i = 0; i < peers.size(); ++i) {
+            if (peers[i].client.sin_addr.s_addr == address.sin_addr.s_addr &&
+                peers[i].client.sin_port == address.sin_port) {
+                return static_cast<int>(i);
+            }
+        }
+        if (peers.size() >= EMULATOR_MAX_PEERS) return -1;
+
+        // Cliente novo: socket próprio até o servidor e links com sementes
+        // derivadas da ordem de chegada
+        const int upstream = socket(AF_INET, SOCK_DGRAM, 0);
+        if (upstream < 0) {
+            perror("Erro ao criar o socket do proxy");
+            return -1;
+        }
+        const uint64_t index = peers.size();
+        peers.push_back(Peer{
+            address, upstream,
+            std::make_unique<ImpairedLink>(profile, seed * 1000 + 2 * index),
+            std::make_unique<ImpairedLink>(profile,
+                                           seed * 1000 + 2 * index + 1),
+            ImpairedLink::Clock::now() + nat_interval()});
+        return static_cast<int>(index);
+    }
+
+    // Soma os contadores de um sentido de todos os clientes
+    ImpairmentStats total(bool upstream_direction) const {
+        ImpairmentStats sum;
+        for (const Peer& peer : peers) {
+            const ImpairmentStats& s =
+                (upstream_direction ? peer.up : peer.down)->stats();
+            sum.packets += s.packets;
+            sum.delivered += s.delivered;
+            sum.random_drops += s.random_drops;
+            sum.burst_drops += s.burst_drops;
+            sum.queue_drops += s.queue_drops;
+            sum.reordered += s.reordered;
+            sum.duplicated += s.duplicated;
+            sum.bytes += s.bytes;
+            sum.added_delay_ms.insert(sum.added_delay_ms.end(),
+                                      s.added_delay_ms.begin(),
+                                      s.added_delay_ms.end());
+        }
+        return sum;
+    }
+
+   public:
+    ~ImpairmentProxy() {
+        for (Peer& peer : peers) close(peer.upstream);
+        if (listener >= 0) close(listener);
+    }
+
+    // Abre o proxy em 'port' (0 = porta livre), repassando para 'target'
+    bool open(int port, const sockaddr_in& target,
+              const ImpairmentProfile& conditions, uint64_t random_seed) {
+        server = target;
+        profile = conditions;
+        seed = random_seed;
+        listener = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        if (listener < 0 ||
+            bind(listener, (sockaddr*)&address, sizeof(address)) < 0) {
+            perror("Erro ao abrir a porta do proxy");
+            return false;
+        }
+        return true;
+    }
+
+    int port() const {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        getsockname(listener, (sockaddr*)&address, &length);
+        return ntohs(address.sin_port);
+    }
+
+    // Repassa os pacotes até 'stop'
+    void run(const std::atomic<bool>& stop) {
+        std::vector<char> buffer(65536);
+        ImpairedLink::Packet packet;
+        while (!stop) {
+            // Dorme até o próximo pacote a entregar ou até chegar um novo
+            auto now = ImpairedLink::Clock::now();
+            auto wake = now + EMULATOR_POLL;
+            for (const Peer& peer : peers) {
+                wake = std::min({wake, peer.up->next_due(),
+                                 peer.down->next_due()});
+            }
+            fd_set read_fds;
+            FD_ZERO(&read_fds);
+            FD_SET(listener, &read_fds);
+            int max_fd = listener;
+            for (const Peer& peer : peers) {
+                FD_SET(peer.upstream, &read_fds);
+                max_fd = std::max(max_fd, peer.upstream);
+            }
+            const auto wait = std::chrono::duration_cast<
+                std::chrono::microseconds>(std::max(wake - now,
+                                                    ImpairedLink::Clock::duration(0)));
+            timeval tv = {static_cast<time_t>(wait.count() / 1000000),
+                          static_cast<suseconds_t>(wait.count() % 1000000)};
+            const int activity =
+                select(max_fd + 1, &read_fds, nullptr, nullptr, &tv);
+            now = ImpairedLink::Clock::now();
+
+            if (activity > 0 && FD_ISSET(listener, &read_fds)) {
+                sockaddr_in sender{};
+                socklen_t length = sizeof(sender);
+                const ssize_t n = recvfrom(listener, buffer.data(),
+                                           buffer.size(), 0,
+                                           (sockaddr*)&sender, &length);
+                const int index = n > 0 ? find_peer(sender) : -1;
+                if (index >= 0) {
+                    peers[index].up->submit(
+                        std::string_view(buffer.data(), n), index, now);
+                }
+            }
+            for (size_t i = 0; activity > 0 && i < peers.size(); ++i) {
+                if (!FD_ISSET(peers[i].upstream, &read_fds)) continue;
+                const ssize_t n =
+                    recv(peers[i].upstream, buffer.data(), buffer.size(), 0);
+                if (n > 0) {
+                    peers[i].down->submit(std::string_view(buffer.data(), n),
+                                          static_cast<int>(i), now);
+                }
+            }
+
+            for (Peer& peer : peers) {
+                if (profile.nat_s > 0 && now >= peer.rebind_at) {
+                    rebind(peer, now);
+                }
+                while (peer.up->pop_due(now, packet)) {
+                    sendto(peer.upstream, packet.data.data(),
+                           packet.data.size(), 0, (sockaddr*)&server,
+                           sizeof(server));
+                }
+                while (peer.down->pop_due(now, packet)) {
+                    sendto(listener, packet.data.data(), packet.data.size(), 0,
+                           (sockaddr*)&peer.client, sizeof(peer.client));
+                }
+            }
+        }
+    }
+
+    // Perda realizada (0 a 1) de um sentido
+    double realized_loss(bool upstream_direction) const {
+        const ImpairmentStats s = total(upstream_direction);
+        return s.packets ? double(s.random_drops + s.burst_drops +
+                                  s.queue_drops) /
+                               s.packets
+                         : 0.0;
+    }
+
+    void print_stats() const {
+        for (bool up : {true, false}) {
+            const ImpairmentStats s = total(up);
+            std::cout << (up ? "Cliente -> servidor: " : "Servidor -> cliente: ")
+                      << s.packets << " pacotes, " << s.random_drops
+                      << " perdidos, " << s.burst_drops << " em rajadas, "
+                      << s.queue_drops << " na fila, " << s.reordered
+                      << " reordenados, " << s.duplicated
+                      << " duplicados; atraso somado p50 "
+                      << percentile(s.added_delay_ms, 0.5) << " ms, p95 "
+                      << percentile(s.added_delay_ms, 0.95) << " ms."
+                      << std::endl;
+        }
+        if (profile.nat_s > 0) {
+            std::cout << "Trocas do mapeamento do NAT: " << rebinds << "."
+                      << std::endl;
+        }
+    }
+};
+
+// Resultado de uma chamada do scorecard
+struct Score {
+    std::string profile;
+    double loss_up = 0, loss_down = 0;
+    uint64_t frames = 0, missing = 0;
+    double burst_ratio = 1.0;
+    double latency_p50 = 0, latency_p95 = 0, latency_max = 0;
+    double r_factor = 0, mos = 0;
+    QualityScores quality;
+};
+
+// Instante (ms) da etapa 'stage' de cada quadro num arquivo de rastreio
+std::map<uint32_t, double> read_trace(const std::string& path,
+                                      TraceStage stage) {
+    std::map<uint32_t, double> times;
+    std::ifstream file(path);
+    std::string line;
+    const std::string stage_key = ",\"tid\":" + std::to_string(int(stage)) + ",";
+    while (std::getline(file, line)) {
+        const size_t ts = line.find("\"ts\":");
+        const size_t frame = line.find("\"frame\":");
+        if (ts == std::string::npos || frame == std::string::npos ||
+            line.find(stage_key) == std::string::npos) {
+            continue;
+        }
+        times[static_cast<uint32_t>(std::strtoul(line.c_str() + frame + 8,
+                                                 nullptr, 10))] =
+            std::strtod(line.c_str() + ts + 5, nullptr) / 1000.0;
+    }
+    return times;
+}
+
+// Modelo E simplificado (G.107): R = 93,2 - Id - Ie,eff, com o atraso
+// boca-ouvido 'delay_ms', a perda 'loss' (0 a 1) e a razão de rajada
+void emodel(double delay_ms, double loss, double burst_ratio, Score& score) {
+    const double id = 0.024 * delay_ms +
+                      (delay_ms > 177.3 ? 0.11 * (delay_ms - 177.3) : 0.0);
+    const double ppl = 100.0 * loss;
+    const double ie_eff = EMODEL_IE + (95.0 - EMODEL_IE) * ppl /
+                                          (ppl / burst_ratio + EMODEL_BPL);
+    const double r = std::max(0.0, std::min(100.0, 93.2 - id - ie_eff));
+    score.r_factor = r;
+    score.mos = 1.0 + 0.035 * r + r * (r - 60.0) * (100.0 - r) * 7e-6;
+}
+
+// Compara o rastreio de quem fala com o de quem ouve
+void score_traces(const std::string& speaker_trace,
+                  const std::string& listener_trace, Score& score) {
+    const auto captured = read_trace(speaker_trace, TRACE_CAPTURE);
+    const auto dequeued = read_trace(listener_trace, TRACE_DEQUEUE);
+    const auto played = read_trace(listener_trace, TRACE_PLAYBACK);
+    if (dequeued.empty()) return;
+
+    // Só os quadros entre o primeiro e o último que tocaram contam: antes
+    // o ouvinte ainda não estava na chamada, depois ela já terminava
+    const uint32_t first = dequeued.begin()->first;
+    const uint32_t last = dequeued.rbegin()->first;
+    std::vector<double> latency;
+    std::vector<int> bursts;
+    int run = 0;
+    for (auto it = captured.lower_bound(first);
+         it != captured.end() && it->first <= last; ++it) {
+        ++score.frames;
+        if (!dequeued.count(it->first)) {
+            ++score.missing;
+            ++run;
+            continue;
+        }
+        if (run > 0) bursts.push_back(run);
+        run = 0;
+        const auto play = played.find(it->first);
+        if (play != played.end()) latency.push_back(play->second - it->second);
+    }
+    if (run > 0) bursts.push_back(run);
+
+    // Razão de rajada: tamanho médio das rajadas de perda dividido pelo
+    // esperado com perdas independentes
+    const double loss = score.frames ? double(score.missing) / score.frames : 0.0;
+    if (!bursts.empty() && loss < 1.0) {
+        double mean = 0;
+        for (int b : bursts) mean += b;
+        mean /= bursts.size();
+        score.burst_ratio = std::max(1.0, mean * (1.0 - loss));
+    }
+    score.latency_p50 = percentile(latency, 0.5);
+    score.latency_p95 = percentile(latency, 0.95);
+    score.latency_max = percentile(latency, 1.0);
+    emodel(score.latency_p50, loss, score.burst_ratio, score);
+}
+
+// Inicia um cliente_headless com as variáveis de ambiente dadas e a saída
+// em 'log_path'. Retorna o pid, ou -1.
+pid_t spawn_client(const std::string& binary, const std::string& name,
+                   const std::string& server,
+                   const std::vector<std::string>& variables,
+                   const std::string& log_path) {
+    std::vector<std::string> environment(variables);
+    for (char** entry = environ; *entry; ++entry) {
+        environment.push_back(*entry);
+    }
+    std::vector<char*> envp;
+    for (std::string& entry : environment) envp.push_back(&entry[0]);
+    envp.push_back(nullptr);
+    std::string arg0 = binary, arg1 = name, arg2 = server;
+    char* argv[] = {&arg0[0], &arg1[0], &arg2[0], nullptr};
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                     O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, log_path.c_str(),
+                                     O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    pid_t pid = -1;
+    const int error =
+        posix_spawn(&pid, binary.c_str(), &actions, nullptr, argv, envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) {
+        std::cerr << "Erro ao iniciar " << binary << ": " << std::strerror(error)
+                  << std::endl;
+        return -1;
+    }
+    return pid;
+}
+
+// Uma chamada através do proxy com o perfil dado
+bool run_call(const sockaddr_in& server, const std::string& voice,
+              double seconds, const ImpairmentProfile& profile, uint64_t seed,
+              const std::string& directory, Score& score) {
+    ImpairmentProxy proxy;
+    if (!proxy.open(0, server, profile, seed)) return false;
+    std::atomic<bool> stop{false};
+    std::thread proxy_thread([&] { proxy.run(stop); });
+
+    const char* configured = std::getenv("VOIP_CLIENT_BIN");
+    const std::string binary = configured ? configured : "./cliente_headless";
+    const std::string target = "127.0.0.1:" + std::to_string(proxy.port());
+    const std::string listener_trace = directory + "/ouvinte.json";
+    const std::string speaker_trace = directory + "/locutor.json";
+    std::ostringstream listener_duration, speaker_duration;
+    listener_duration << seconds + 1.5;
+    speaker_duration << seconds + 0.5;
+
+    const pid_t listener = spawn_client(
+        binary, "ouvinte", target,
+        {"VOIP_AUDIO=wav:," + directory + "/ouvinte.wav",
+         "VOIP_DURATION_SEC=" + listener_duration.str(),
+         "VOIP_TRACE=" + listener_trace},
+        directory + "/ouvinte.log");
+    std::this_thread::sleep_for(SCORECARD_JOIN_DELAY);
+    const pid_t speaker = spawn_client(
+        binary, "locutor", target,
+        {"VOIP_AUDIO=wav:" + voice + "," + directory + "/locutor.wav",
+         "VOIP_DURATION_SEC=" + speaker_duration.str(),
+         "VOIP_TRACE=" + speaker_trace},
+        directory + "/locutor.log");
+
+    bool ok = listener > 0 && speaker > 0;
+    for (pid_t pid : {listener, speaker}) {
+        int status = 0;
+        if (pid > 0 && (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+                        WEXITSTATUS(status) != 0)) {
+            ok = false;
+        }
+    }
+    stop = true;
+    proxy_thread.join();
+    if (!ok) {
+        std::cerr << "Um dos clientes falhou; veja os registros em "
+                  << directory << std::endl;
+        return false;
+    }
+
+    score.profile = profile.name;
+    score.loss_up = proxy.realized_loss(true);
+    score.loss_down = proxy.realized_loss(false);
+    score_traces(speaker_trace, listener_trace, score);
+    return true;
+}
+
+// Compara o que o ouvinte gravou com a fala de referência
+void score_recording(const std::vector<float>& voice, int sample_rate,
+                     const std::string& directory, Score& score) {
+    std::vector<float> heard;
+    int heard_rate = 0;
+    if (read_wav_samples(directory + "/ouvinte.wav", heard, heard_rate) &&
+        heard_rate == sample_rate) {
+        score.quality = score_quality(voice, heard, sample_rate);
+    }
+}
+
+void write_score_json(std::ostream& out, const Score& s) {
+    out << "{\"perfil\":";
+    write_json_string(out, s.profile);
+    out << ",\"perda_subida\":" << s.loss_up
+        << ",\"perda_descida\":" << s.loss_down
+        << ",\"quadros\":" << s.frames << ",\"perdidos\":" << s.missing
+        << ",\"razao_rajada\":" << s.burst_ratio
+        << ",\"latencia_p50_ms\":" << s.latency_p50
+        << ",\"latencia_p95_ms\":" << s.latency_p95
+        << ",\"latencia_max_ms\":" << s.latency_max
+        << ",\"r\":" << s.r_factor << ",\"mos_modelo_e\":" << s.mos
+        << ",\"qualidade\":";
+    write_quality_json(out, s.quality);
+    out << "}\n";
+}
+
+int run_scorecard(const sockaddr_in& server, const std::string& voice,
+                  const std::string& profile_list, uint64_t seed) {
+    std::vector<float> voice_samples;
+    int sample_rate = 0;
+    if (!read_wav_samples(voice, voice_samples, sample_rate)) return 1;
+    if (sample_rate != SAMPLE_RATE || voice_samples.empty()) {
+        std::cerr << "A voz deve ser um WAV de " << SAMPLE_RATE << " Hz."
+                  << std::endl;
+        return 1;
+    }
+    const double seconds = double(voice_samples.size()) / sample_rate;
+
+    std::vector<ImpairmentProfile> profiles;
+    std::stringstream names(profile_list);
+    std::string name;
+    while (std::getline(names, name, ';')) {
+        ImpairmentProfile profile;
+        if (!parse_impairment_profile(name, profile)) return 1;
+        profiles.push_back(profile);
+    }
+
+    std::vector<Score> scores;
+    for (size_t i = 0; i < profiles.size(); ++i) {
+        char directory[] = "/tmp/emulador_rede_XXXXXX";
+        if (!mkdtemp(directory)) {
+            perror("Erro ao criar o diretório temporário");
+            return 1;
+        }
+        std::cout << "Perfil " << profiles[i].name << " (" << seconds
+                  << " s, arquivos em " << directory << ")..." << std::endl;
+        Score score;
+        if (!run_call(server, voice, seconds, profiles[i], seed, directory,
+                      score)) {
+            return 1;
+        }
+        score_recording(voice_samples, sample_rate, directory, score);
+        scores.push_back(score);
+    }
+
+    std::printf("\n%-16s %7s %7s %8s %7s %9s %9s %9s %6s %5s %8s %5s\n",
+                "perfil", "sobe %", "desce %", "perdidos", "rajada",
+                "p50 (ms)", "p95 (ms)", "máx (ms)", "R", "MOS", "SNRseg",
+                "MOSp");
+    for (const Score& s : scores) {
+        std::printf("%-16s %7.1f %7.1f %7.1f%% %7.2f %9.1f %9.1f %9.1f %6.1f "
+                    "%5.2f %8.1f %5.2f\n",
+                    s.profile.substr(0, 16).c_str(), 100 * s.loss_up,
+                    100 * s.loss_down,
+                    s.frames ? 100.0 * s.missing / s.frames : 0.0,
+                    s.burst_ratio, s.latency_p50, s.latency_p95,
+                    s.latency_max, s.r_factor, s.mos, s.quality.seg_snr_db,
+                    s.quality.mos);
+    }
+
+    const char* json_path = std::getenv("VOIP_QUALITY_JSON");
+    if (json_path) {
+        std::ofstream json(json_path, std::ios::app);
+        if (!json) {
+            std::cerr << "Erro ao abrir " << json_path << std::endl;
+            return 1;
+        }
+        for (const Score& s : scores) write_score_json(json, s);
+    }
+    return 0;
+}
+
+void print_presets() {
+    for (int i = 0; i < IMPAIRMENT_PRESET_COUNT; ++i) {
+        std::cout << std::left << std::setw(16) << IMPAIRMENT_PRESETS[i].name
+                  << (*IMPAIRMENT_PRESETS[i].spec ? IMPAIRMENT_PRESETS[i].spec
+                                                  : "(sem degradação)")
+                  << std::endl;
+    }
+}
+
+void print_usage(const char* program) {
+    std::cerr << "Uso: " << program
+              << " <porta local> <servidor[:porta]> <perfil> [segundos] "
+                 "[semente]\n"
+              << "     " << program
+              << " --scorecard <servidor[:porta]> <voz.wav> [perfis separados "
+                 "por ';'] [semente]\n"
+              << "     " << program << " --perfis" << std::endl;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--perfis") == 0) {
+        print_presets();
+        return 0;
+    }
+
+    if (argc > 3 && std::strcmp(argv[1], "--scorecard") == 0) {
+        sockaddr_in server;
+        if (!parse_endpoint(argv[2], server)) return 1;
+        const uint64_t seed =
+            argc > 5 ? std::strtoull(argv[5], nullptr, 10) : EMULATOR_DEFAULT_SEED;
+        return run_scorecard(server, argv[3],
+                             argc > 4 ? argv[4] : SCORECARD_DEFAULT_PROFILES,
+                             seed);
+    }
+
+    if (argc < 4) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const int port = std::atoi(argv[1]);
+    sockaddr_in server;
+    ImpairmentProfile profile;
+    if (port <= 0 || port > 65535 || !parse_endpoint(argv[2], server) ||
+        !parse_impairment_profile(argv[3], profile)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const double seconds = argc > 4 ? std::atof(argv[4]) : 0.0;
+    const uint64_t seed =
+        argc > 5 ? std::strtoull(argv[5], nullptr, 10) : EMULATOR_DEFAULT_SEED;
+
+    ImpairmentProxy proxy;
+    if (!proxy.open(port, server, profile, seed)) return 1;
+    std::cout << "Emulando '" << profile.name << "' na porta " << port
+              << " até " << argv[2];
+    if (seconds > 0) {
+        std::cout << " por " << seconds << " s." << std::endl;
+    } else {
+        std::cout << " (Enter para parar)." << std::endl;
+    }
+
+    std::atomic<bool> stop{false};
+    std::thread proxy_thread([&] { proxy.run(stop); });
+    if (seconds > 0) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    } else {
+        std::cin.get();
+    }
+    stop = true;
+    proxy_thread.join();
+    proxy.print_stats();
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "noise_suppressor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "dsp_simd.h"
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+
+// Suavização temporal da potência usada no rastreio do ruído
+constexpr float NS_POWER_DECAY = 0.8f;
+
+// Compensa o mínimo ficar abaixo da média da potência do ruído
+constexpr float NS_MIN_BIAS = 1.5f;
+
+// Peso do SNR do hop anterior na estimativa "decision-directed"
+constexpr float NS_DD_ALPHA = 0.98f;
+
+// Ganho mínimo (-20 dB), limita a distorção e o "ruído musical"
+constexpr float NS_MIN_GAIN = 0.1f;
+
+// Evita divisões por zero em raias silenciosas
+constexpr float NS_EPSILON = 1e-10f;
+}  // namespace
+
+NoiseSuppressor::NoiseSuppressor()
+    : fft(NS_FFT_SIZE),
+      bins(NS_FFT_SIZE / 2 + 1),
+      window(NS_WINDOW_SIZE),
+      input_history(NS_HOP_SIZE),
+      overlap(NS_HOP_SIZE),
+      frame(NS_FFT_SIZE),
+      spectrum_re(bins),
+      spectrum_im(bins),
+      power(bins),
+      smoothed_power(bins),
+      previous_snr(bins),
+      gain(bins, 1.0f),
+      current_min(bins, FLT_MAX),
+      subwindow_min(bins * NS_SUBWINDOWS, FLT_MAX),
+      window_min(bins, FLT_MAX) {
+    // Raiz da janela de Hann periódica: análise * síntese = Hann, que soma
+    // 1 com 50% de sobreposição (reconstrução perfeita com ganho unitário)
+    for (int i = 0; i < NS_WINDOW_SIZE; ++i) {
+        window[i] = static_cast<float>(
+            std::sqrt(0.5 - 0.5 * std::cos(2.0 * PI * i / NS_WINDOW_SIZE)));
+    }
+}
+
+void NoiseSuppressor::process(float* samples) {
+    for (int offset = 0; offset < FRAMES_PER_BUFFER; offset += NS_HOP_SIZE) {
+        process_hop(samples + offset);
+    }
+}
+
+void NoiseSuppressor::process_hop(float* samples) {
+    // Janela de análise [hop anterior | hop atual], completada com zeros
+    for (int i = 0; i < NS_HOP_SIZE; ++i) {
+        frame[i] = input_history[i] * window[i];
+        frame[NS_HOP_SIZE + i] = samples[i] * window[NS_HOP_SIZE + i];
+    }
+    std::fill(frame.begin() + NS_WINDOW_SIZE, frame.end(), 0.0f);
+    std::copy(samples, samples + NS_HOP_SIZE, input_history.begin());
+
+    fft.forward(frame.data(), spectrum_re.data(), spectrum_im.data());
+    for (int k = 0; k < bins; ++k) {
+        power[k] = spectrum_re[k] * spectrum_re[k] +
+                   spectrum_im[k] * spectrum_im[k];
+    }
+
+    if (hops++ == 0) {
+        std::copy(power.begin(), power.end(), smoothed_power.begin());
+    }
+
+    // Piso de ruído e ganho de Wiener. Laço sem desvios para que o
+    // compilador o vetorize.
+    for (int k = 0; k < bins; ++k) {
+        const float smoothed = NS_POWER_DECAY * smoothed_power[k] +
+                               (1.0f - NS_POWER_DECAY) * power[k];
+        smoothed_power[k] = smoothed;
+        current_min[k] = std::min(current_min[k], smoothed);
+        const float noise =
+            NS_MIN_BIAS * std::min(window_min[k], current_min[k]) +
+            NS_EPSILON;
+
+        // SNR a posteriori e a priori ("decision-directed")
+        const float posterior = power[k] / noise;
+        const float prior = NS_DD_ALPHA * previous_snr[k] +
+                            (1.0f - NS_DD_ALPHA) *
+                                std::max(posterior - 1.0f, 0.0f);
+        const float g = std::max(prior / (1.0f + prior), NS_MIN_GAIN);
+        gain[k] = g;
+        previous_snr[k] = g * g * posterior;
+    }
+
+    // Fim da sub-janela: o mínimo dela substitui o da mais antiga
+    if (hops % NS_SUBWINDOW_HOPS == 0) {
+        float* oldest = subwindow_min.data() + subwindow * bins;
+        std::copy(current_min.begin(), current_min.end(), oldest);
+        subwindow = (subwindow + 1) % NS_SUBWINDOWS;
+        std::copy(subwindow_min.begin(), subwindow_min.begin() + bins,
+                  window_min.begin());
+        for (int w = 1; w < NS_SUBWINDOWS; ++w) {
+            const float* values = subwindow_min.data() + w * bins;
+            for (int k = 0; k < bins; ++k) {
+                window_min[k] = std::min(window_min[k], values[k]);
+            }
+        }
+        std::fill(current_min.begin(), current_min.end(), FLT_MAX);
+    }
+
+    apply_spectral_gain(spectrum_re.data(), spectrum_im.data(), gain.data(),
+                        bins);
+    fft.inverse(spectrum_re.data(), spectrum_im.data(), frame.data());
+
+    // Síntese: janela e overlap-add com a cauda do hop anterior
+    for (int i = 0; i < NS_HOP_SIZE; ++i) {
+        samples[i] = overlap[i] + frame[i] * window[i];
+        overlap[i] = frame[NS_HOP_SIZE + i] * window[NS_HOP_SIZE + i];
+    }
+}
@@ -0,0 +1,479 @@
+#include "quality.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include "fft.h"
+#include "wav.h"
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+
+// Blocos da referência com menos energia que isto (em relação à média)
+// são silêncio: não dão uma correlação confiável e herdam o atraso anterior
+constexpr double ALIGN_SILENCE_RATIO = 0.01;
+
+// Correlação normalizada mínima para aceitar o atraso de um bloco, quando
+// procurado perto do anterior e quando procurado no sinal inteiro
+constexpr double ALIGN_MIN_CORRELATION = 0.3;
+constexpr double ALIGN_LOCK_CORRELATION = 0.5;
+
+// Trechos da referência mais de 40 dB abaixo do mais forte são silêncio
+// no SNR segmentado
+constexpr double SEGMENT_SILENCE_RATIO = 1e-4;
+
+// Quadro do modelo perceptual (arredondado para potência de dois)
+constexpr double PERCEPTUAL_FRAME_MS = 32.0;
+
+// Limiar de audição: 50 dB abaixo da potência média da fala
+constexpr double HEARING_THRESHOLD_RATIO = 1e-5;
+
+// Quadros que participam da nota: acima de 30 dB abaixo da fala média
+constexpr double ACTIVE_FRAME_RATIO = 1e-3;
+
+// Expoente e escala da sonoridade de Zwicker. A escala foi ajustada para
+// que ruído branco a 20 dB de SNR e 5% dos quadros perdidos fiquem perto de
+// MOS 3,5 numa fala sintética.
+constexpr double LOUDNESS_EXPONENT = 0.23;
+constexpr double LOUDNESS_SCALE = 1.5;
+
+// Máscara: diferenças menores que esta fração da sonoridade não contam
+constexpr double DEADZONE_FRACTION = 0.25;
+
+// Assimetria do PESQ: razão entre as potências elevada a 1,2, ignorada
+// abaixo de 3 e limitada a 12. As potências ganham um piso 35 dB abaixo da
+// fala média, para que ruído baixo em bandas vazias não domine a nota.
+constexpr double ASYMMETRY_FLOOR_RATIO = 3e-4;
+constexpr double ASYMMETRY_EXPONENT = 1.2;
+constexpr double ASYMMETRY_MIN = 3.0;
+constexpr double ASYMMETRY_MAX = 12.0;
+
+// Quadros agregados pela norma L6 antes da média L2 (cerca de 320 ms)
+constexpr int DISTURBANCE_GROUP_FRAMES = 20;
+
+// Bordas das bandas críticas de Zwicker (uma por Bark), em Hz
+constexpr double BARK_EDGES[] = {0,    100,  200,  300,  400,  510,  630,
+                                 770,  920,  1080, 1270, 1480, 1720, 2000,
+                                 2320, 2700, 3150, 3700, 4400, 5300, 6400,
+                                 7700, 9500, 12000, 15500};
+constexpr int BARK_BANDS = sizeof(BARK_EDGES) / sizeof(BARK_EDGES[0]) - 1;
+
+int next_power_of_two(long n) {
+    int size = 4;
+    while (size < n) size *= 2;
+    return size;
+}
+
+// Correlação cruzada por FFT: c[k] = soma de a[n] * b[first + n + k], para
+// k de 0 a span - 1 (amostras de 'b' fora do vetor valem zero)
+std::vector<float> correlate(const float* a, long na, const float* b, long nb,
+                             long first, long span) {
+    const int size = next_power_of_two(na + span);
+    FFT fft(size);
+    std::vector<float> pa(size, 0.0f), pb(size, 0.0f), out(size);
+    std::copy(a, a + na, pa.begin());
+    for (long m = 0; m < na + span - 1; ++m) {
+        const long index = first + m;
+        if (index >= 0 && index < nb) pb[m] = b[index];
+    }
+    std::vector<float> are(fft.bins()), aim(fft.bins()), bre(fft.bins()),
+        bim(fft.bins());
+    fft.forward(pa.data(), are.data(), aim.data());
+    fft.forward(pb.data(), bre.data(), bim.data());
+    // conj(A) * B
+    for (int k = 0; k < fft.bins(); ++k) {
+        const float re = are[k] * bre[k] + aim[k] * bim[k];
+        const float im = are[k] * bim[k] - aim[k] * bre[k];
+        are[k] = re;
+        aim[k] = im;
+    }
+    fft.inverse(are.data(), aim.data(), out.data());
+    out.resize(span);
+    return out;
+}
+
+double energy(const float* x, long n) {
+    double sum = 0.0;
+    for (long i = 0; i < n; ++i) sum += double(x[i]) * x[i];
+    return sum;
+}
+
+// Alinhamento do sinal recebido à referência, amostra a amostra
+class Aligner {
+   private:
+    const std::vector<float>& reference;
+    const std::vector<float>& degraded;
+    long total, available;
+    double mean_energy;
+    long min_block;
+
+    // Procura o trecho [start, start + length) da referência no sinal
+    // recebido com atrasos de 'first' a 'first + span - 1'. Retorna false se
+    // o trecho for silêncio ou a correlação normalizada ficar abaixo de
+    // 'minimum'.
+    bool find_lag(long start, long length, long first, long span,
+                  double minimum, long& lag) const {
+        const float* ref = reference.data() + start;
+        const double ref_energy = energy(ref, length);
+        if (ref_energy <= ALIGN_SILENCE_RATIO * mean_energy * length) {
+            return false;
+        }
+        const std::vector<float> fine = correlate(
+            ref, length, degraded.data(), available, start + first, span);
+        const long peak =
+            std::max_element(fine.begin(), fine.end()) - fine.begin();
+        const long from = std::max(0L, start + first + peak);
+        const long to = std::min(available, start + first + peak + length);
+        const double deg_energy =
+            to > from ? energy(degraded.data() + from, to - from) : 0.0;
+        if (fine[peak] <= minimum * std::sqrt(ref_energy * deg_energy)) {
+            return false;
+        }
+        lag = first + peak;
+        return true;
+    }
+
+    double error(long i, long lag) const {
+        const long index = i + lag;
+        const double d = index >= 0 && index < available ? degraded[index] : 0;
+        return (reference[i] - d) * (reference[i] - d);
+    }
+
+    // Uma única mudança de 'before' para 'after' em [from, to): no ponto
+    // que minimiza o erro (como o PESQ separa trechos com atrasos
+    // diferentes)
+    void split(long from, long before, long to, long after) {
+        double cost = 0.0;
+        for (long i = from; i < to; ++i) cost += error(i, after);
+        double best_cost = cost;
+        long point = from;
+        for (long i = from; i < to; ++i) {
+            cost += error(i, before) - error(i, after);
+            if (cost < best_cost) {
+                best_cost = cost;
+                point = i + 1;
+            }
+        }
+        std::fill(sample_lag.begin() + from, sample_lag.begin() + point,
+                  before);
+        std::fill(sample_lag.begin() + point, sample_lag.begin() + to, after);
+    }
+
+   public:
+    std::vector<long> sample_lag;
+
+    Aligner(const std::vector<float>& reference,
+            const std::vector<float>& degraded, int sample_rate)
+        : reference(reference),
+          degraded(degraded),
+          total(reference.size()),
+          available(degraded.size()),
+          mean_energy(energy(reference.data(), reference.size()) /
+                      reference.size()),
+          min_block(static_cast<long>(sample_rate) * QUALITY_SEGMENT_MS /
+                    1000),
+          sample_lag(reference.size(), 0) {}
+
+    // Atraso de cada bloco com fala. O primeiro é procurado no sinal
+    // inteiro; os outros perto do atraso do anterior, porque ele anda aos
+    // poucos, numa janela que cresce a cada bloco sem correspondência.
+    std::vector<std::pair<long, long>> anchors(long block, long search) const {
+        std::vector<std::pair<long, long>> found;
+        long lag = 0;
+        long window = search;
+        for (long start = 0; start < total; start += block) {
+            const long length = std::min(block, total - start);
+            const bool matched =
+                found.empty()
+                    ? find_lag(start, length, -start, available,
+                               ALIGN_LOCK_CORRELATION, lag)
+                    : find_lag(start, length, lag - window, 2 * window + 1,
+                               ALIGN_MIN_CORRELATION, lag);
+            if (matched) {
+                found.push_back({start + length / 2, lag});
+                window = search;
+            } else if (!found.empty()) {
+                window += search;
+            }
+        }
+        return found;
+    }
+
+    // Preenche [from, to), que começa com o atraso 'before' e termina com
+    // 'after'. Com vários quadros perdidos entre os dois, o atraso muda
+    // várias vezes: o trecho do meio é procurado entre os dois atrasos e,
+    // se achado, cada metade é resolvida da mesma forma.
+    void place(long from, long before, long to, long after) {
+        if (before == after) {
+            std::fill(sample_lag.begin() + from, sample_lag.begin() + to,
+                      before);
+            return;
+        }
+        const long length = (to - from) / 2;
+        const long middle = from + (to - from) / 2;
+        long lag;
+        if (length >= min_block &&
+            find_lag(middle - length / 2, length, std::min(before, after),
+                     std::abs(after - before) + 1, ALIGN_MIN_CORRELATION,
+                     lag) &&
+            lag != before && lag != after) {
+            place(from, before, middle, lag);
+            place(middle, lag, to, after);
+            return;
+        }
+        split(from, before, to, after);
+    }
+};
+
+// Alinha 'degraded' à referência. Retorna o sinal alinhado (zero onde não
+// há sinal recebido) e preenche o atraso e a variação dele, ou um vetor
+// vazio se nenhum trecho da referência foi encontrado.
+std::vector<float> align(const std::vector<float>& reference,
+                         const std::vector<float>& degraded, int sample_rate,
+                         QualityScores& scores) {
+    Aligner aligner(reference, degraded, sample_rate);
+    const auto anchors = aligner.anchors(
+        static_cast<long>(sample_rate) * QUALITY_ALIGN_BLOCK_MS / 1000,
+        static_cast<long>(sample_rate) * QUALITY_ALIGN_SEARCH_MS / 1000);
+    if (anchors.empty()) return {};
+
+    const long total = reference.size();
+    aligner.place(0, anchors.front().second, anchors.front().first,
+                  anchors.front().second);
+    for (size_t a = 0; a + 1 < anchors.size(); ++a) {
+        aligner.place(anchors[a].first, anchors[a].second,
+                      anchors[a + 1].first, anchors[a + 1].second);
+    }
+    aligner.place(anchors.back().first, anchors.back().second, total,
+                  anchors.back().second);
+
+    std::vector<float> aligned(total, 0.0f);
+    for (long i = 0; i < total; ++i) {
+        const long index = i + aligner.sample_lag[i];
+        if (index >= 0 && index < static_cast<long>(degraded.size())) {
+            aligned[i] = degraded[index];
+        }
+    }
+    const auto range = std::minmax_element(aligner.sample_lag.begin(),
+                                           aligner.sample_lag.end());
+    scores.delay_ms = 1000.0 * anchors.front().second / sample_rate;
+    scores.delay_spread_ms = 1000.0 * (*range.second - *range.first) /
+                             sample_rate;
+    return aligned;
+}
+
+void score_snr(const std::vector<float>& reference,
+               const std::vector<float>& aligned, int sample_rate,
+               QualityScores& scores) {
+    // Ganho de mínimos quadrados: o nível de saída não conta como ruído
+    double cross = 0.0, deg_energy = 0.0;
+    for (size_t i = 0; i < reference.size(); ++i) {
+        cross += double(reference[i]) * aligned[i];
+        deg_energy += double(aligned[i]) * aligned[i];
+    }
+    const double gain = deg_energy > 0 ? cross / deg_energy : 0.0;
+
+    const long segment =
+        static_cast<long>(sample_rate) * QUALITY_SEGMENT_MS / 1000;
+    const long segments = reference.size() / segment;
+    std::vector<double> signal(segments), noise(segments);
+    double loudest = 0.0, total_signal = 0.0, total_noise = 0.0;
+    for (long s = 0; s < segments; ++s) {
+        for (long i = s * segment; i < (s + 1) * segment; ++i) {
+            const double error = reference[i] - gain * aligned[i];
+            signal[s] += double(reference[i]) * reference[i];
+            noise[s] += error * error;
+        }
+        loudest = std::max(loudest, signal[s]);
+        total_signal += signal[s];
+        total_noise += noise[s];
+    }
+    scores.snr_db = std::min(
+        QUALITY_SNR_MAX,
+        10.0 * std::log10(total_signal / (total_noise + 1e-20)));
+
+    double sum = 0.0;
+    int counted = 0;
+    for (long s = 0; s < segments; ++s) {
+        if (signal[s] < SEGMENT_SILENCE_RATIO * loudest) continue;
+        const double snr = 10.0 * std::log10(signal[s] / (noise[s] + 1e-20));
+        sum += std::max(QUALITY_SEG_SNR_MIN, std::min(QUALITY_SEG_SNR_MAX, snr));
+        ++counted;
+    }
+    scores.seg_snr_db = counted ? sum / counted : QUALITY_SEG_SNR_MIN;
+}
+
+// Potência por banda crítica de cada quadro do modelo perceptual
+std::vector<std::vector<double>> band_powers(const std::vector<float>& x,
+                                             int sample_rate, double gain) {
+    const int size = next_power_of_two(
+        static_cast<long>(sample_rate * PERCEPTUAL_FRAME_MS / 1000.0));
+    const int hop = size / 2;
+    FFT fft(size);
+    std::vector<float> window(size), frame(size), re(fft.bins()),
+        im(fft.bins());
+    for (int i = 0; i < size; ++i) {
+        window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2 * PI * i / size));
+    }
+    std::vector<std::vector<double>> powers;
+    for (size_t start = 0; start + size <= x.size(); start += hop) {
+        for (int i = 0; i < size; ++i) {
+            frame[i] = static_cast<float>(gain * x[start + i] * window[i]);
+        }
+        fft.forward(frame.data(), re.data(), im.data());
+        std::vector<double> bands(BARK_BANDS, 0.0);
+        for (int k = 1; k < fft.bins(); ++k) {
+            const double hz = double(k) * sample_rate / size;
+            const int band = static_cast<int>(
+                std::upper_bound(BARK_EDGES, BARK_EDGES + BARK_BANDS + 1, hz) -
+                BARK_EDGES) - 1;
+            if (band < 0 || band >= BARK_BANDS) continue;
+            bands[band] += double(re[k]) * re[k] + double(im[k]) * im[k];
+        }
+        powers.push_back(bands);
+    }
+    return powers;
+}
+
+double loudness(double power, double threshold) {
+    return LOUDNESS_SCALE * std::pow(threshold / 0.5, LOUDNESS_EXPONENT) *
+           std::max(0.0, std::pow(0.5 + 0.5 * power / threshold,
+                                  LOUDNESS_EXPONENT) -
+                             1.0);
+}
+
+// Agrega as perturbações de cada quadro: L6 em grupos, L2 entre os grupos
+double aggregate(const std::vector<double>& frames) {
+    if (frames.empty()) return 0.0;
+    double sum_groups = 0.0;
+    int groups = 0;
+    for (size_t start = 0; start < frames.size();
+         start += DISTURBANCE_GROUP_FRAMES) {
+        const size_t end =
+            std::min(frames.size(), start + DISTURBANCE_GROUP_FRAMES);
+        double sum = 0.0;
+        for (size_t i = start; i < end; ++i) sum += std::pow(frames[i], 6.0);
+        const double group = std::pow(sum / (end - start), 1.0 / 6.0);
+        sum_groups += group * group;
+        ++groups;
+    }
+    return std::sqrt(sum_groups / groups);
+}
+
+void score_perceptual(const std::vector<float>& reference,
+                      const std::vector<float>& aligned, int sample_rate,
+                      QualityScores& scores) {
+    // Nível igualado pela potência, como o PESQ faz antes da comparação
+    const double ref_energy = energy(reference.data(), reference.size());
+    const double deg_energy = energy(aligned.data(), aligned.size());
+    const double gain = deg_energy > 0 ? std::sqrt(ref_energy / deg_energy) : 0;
+    const auto ref_bands = band_powers(reference, sample_rate, 1.0);
+    const auto deg_bands = band_powers(aligned, sample_rate, gain);
+
+    // Potência média da fala: dá o limiar de audição e os quadros ativos
+    std::vector<double> ref_total(ref_bands.size()),
+        deg_total(deg_bands.size());
+    double mean = 0.0;
+    for (size_t f = 0; f < ref_bands.size(); ++f) {
+        for (int b = 0; b < BARK_BANDS; ++b) {
+            ref_total[f] += ref_bands[f][b];
+            deg_total[f] += deg_bands[f][b];
+        }
+        mean += ref_total[f];
+    }
+    mean /= std::max<size_t>(1, ref_bands.size());
+    const double threshold = HEARING_THRESHOLD_RATIO * mean;
+    const double asymmetry_floor = ASYMMETRY_FLOOR_RATIO * mean;
+
+    std::vector<double> symmetric, asymmetric;
+    for (size_t f = 0; f < ref_bands.size(); ++f) {
+        if (ref_total[f] < ACTIVE_FRAME_RATIO * mean &&
+            deg_total[f] < ACTIVE_FRAME_RATIO * mean) {
+            continue;
+        }
+        double sym = 0.0, asym = 0.0;
+        for (int b = 0; b < BARK_BANDS; ++b) {
+            const double pr = ref_bands[f][b], pd = deg_bands[f][b];
+            const double lr = loudness(pr, threshold);
+            const double ld = loudness(pd, threshold);
+            const double d = std::max(
+                0.0, std::fabs(ld - lr) - DEADZONE_FRACTION * std::min(lr, ld));
+            sym += d * d;
+            double h = std::pow((pd + asymmetry_floor) / (pr + asymmetry_floor),
+                                ASYMMETRY_EXPONENT);
+            h = h < ASYMMETRY_MIN ? 0.0 : std::min(h, ASYMMETRY_MAX);
+            asym += d * h;
+        }
+        symmetric.push_back(std::sqrt(sym));
+        asymmetric.push_back(asym);
+    }
+    if (symmetric.empty()) return;
+
+    // Mapeamento do PESQ e conversão para MOS-LQO (P.862.1)
+    scores.symmetric_disturbance = aggregate(symmetric);
+    scores.asymmetric_disturbance = aggregate(asymmetric);
+    const double raw = std::max(
+        -0.5, std::min(4.5, 4.5 - 0.1 * scores.symmetric_disturbance -
+                                0.0309 * scores.asymmetric_disturbance));
+    scores.mos = 0.999 + 4.0 / (1.0 + std::exp(-1.4945 * raw + 4.6607));
+    scores.valid = true;
+}
+}  // namespace
+
+bool read_wav_samples(const std::string& path, std::vector<float>& samples,
+                      int& sample_rate) {
+    WavReader reader;
+    if (!reader.open(path)) return false;
+    sample_rate = reader.sample_rate();
+    const int channels = reader.channels();
+    constexpr int BLOCK = 4096;
+    std::vector<int16_t> buffer(BLOCK * channels);
+    samples.clear();
+    for (int n; (n = reader.read(reinterpret_cast<char*>(buffer.data()),
+                                 BLOCK)) > 0;) {
+        for (int i = 0; i < n; ++i) {
+            float sum = 0.0f;
+            for (int c = 0; c < channels; ++c) sum += buffer[i * channels + c];
+            samples.push_back(sum / (32768.0f * channels));
+        }
+    }
+    return true;
+}
+
+QualityScores score_quality(const std::vector<float>& reference,
+                            const std::vector<float>& degraded,
+                            int sample_rate) {
+    QualityScores scores;
+    if (reference.empty() || degraded.empty() || sample_rate <= 0 ||
+        energy(reference.data(), reference.size()) <= 0) {
+        return scores;
+    }
+    const std::vector<float> aligned =
+        align(reference, degraded, sample_rate, scores);
+    if (aligned.empty()) return scores;
+    score_snr(reference, aligned, sample_rate, scores);
+    score_perceptual(reference, aligned, sample_rate, scores);
+    return scores;
+}
+
+void write_json_string(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+    out << '"';
+}
+
+void write_quality_json(std::ostream& out, const QualityScores& scores) {
+    out << "{\"valido\":" << (scores.valid ? "true" : "false")
+        << ",\"atraso_ms\":" << scores.delay_ms
+        << ",\"variacao_atraso_ms\":" << scores.delay_spread_ms
+        << ",\"snr_db\":" << scores.snr_db
+        << ",\"snr_segmentado_db\":" << scores.seg_snr_db
+        << ",\"perturbacao_simetrica\":" << scores.symmetric_disturbance
+        << ",\"perturbacao_assimetrica\":" << scores.asymmetric_disturbance
+        << ",\"mos\":" << scores.mos << "}";
+}
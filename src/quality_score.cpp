@@ -0,0 +1,153 @@
+// Avaliador de qualidade (quality.h): compara a fala de referência com a
+// gravação do que saiu do outro lado da chamada, por exemplo a saída de um
+// cliente_headless com VOIP_AUDIO=wav:,saida.wav enquanto outro fala a
+// referência, e imprime o atraso, o SNR, o SNR segmentado e o MOS
+// perceptual.
+//
+// Com --json as notas são acrescentadas como uma linha ao arquivo dado,
+// identificadas por --rotulo (por padrão o nome do arquivo recebido), para
+// acompanhar a qualidade de um commit ou configuração para outro.
+//
+// Com --monotonia o avaliador confere a si mesmo: retira da referência
+// quadros de 20 ms com perdas crescentes (como a gravação do cliente, em
+// que um quadro perdido some) e falha se alguma nota subir com a perda. A
+// semente é fixa e os quadros perdidos em uma taxa também se perdem nas
+// maiores, então a única diferença entre dois passos é a perda a mais.
+//
+// Uso: avaliador_qualidade <referencia.wav> <recebido.wav> [--rotulo texto]
+//                          [--json arquivo]
+//      avaliador_qualidade --monotonia <referencia.wav> [semente]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "quality.h"
+
+// Perdas (%) conferidas por --monotonia e a duração de cada quadro
+static const double MONOTONIC_LOSSES[] = {0.0, 0.5, 1.0, 2.0, 5.0, 10.0, 20.0};
+constexpr int MONOTONIC_FRAME_MS = 20;
+
+// Tolerância para duas notas iguais diferirem por arredondamento
+constexpr double MONOTONIC_TOLERANCE = 1e-6;
+
+// Confere que o MOS perceptual e o SNR segmentado não sobem com a perda
+static int check_monotonic(const std::string& path, uint64_t seed) {
+    std::vector<float> reference;
+    int sample_rate = 0;
+    if (!read_wav_samples(path, reference, sample_rate)) return 1;
+
+    // Um número aleatório por quadro: o quadro se perde nas taxas acima dele
+    const size_t frame = static_cast<size_t>(sample_rate) *
+                         MONOTONIC_FRAME_MS / 1000;
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 100.0);
+    std::vector<double> draw(reference.size() / frame);
+    for (double& value : draw) value = uniform(random);
+
+    std::printf("%8s %9s %9s\n", "perda %", "SNRseg", "MOSp");
+    bool ok = true;
+    QualityScores previous;
+    for (double loss : MONOTONIC_LOSSES) {
+        std::vector<float> degraded;
+        degraded.reserve(reference.size());
+        for (size_t i = 0; i < draw.size(); ++i) {
+            if (draw[i] < loss) continue;
+            degraded.insert(degraded.end(), reference.begin() + i * frame,
+                            reference.begin() + (i + 1) * frame);
+        }
+        const QualityScores scores =
+            score_quality(reference, degraded, sample_rate);
+        std::printf("%8.1f %9.2f %9.2f\n", loss, scores.seg_snr_db,
+                    scores.mos);
+        if (!scores.valid) {
+            std::cerr << "Não há fala na referência." << std::endl;
+            return 1;
+        }
+        if (previous.valid &&
+            (scores.mos > previous.mos + MONOTONIC_TOLERANCE ||
+             scores.seg_snr_db > previous.seg_snr_db + MONOTONIC_TOLERANCE)) {
+            std::cerr << "A nota subiu com a perda de " << loss << "%."
+                      << std::endl;
+            ok = false;
+        }
+        previous = scores;
+    }
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2 && std::strcmp(argv[1], "--monotonia") == 0) {
+        return check_monotonic(argv[2],
+                               argc > 3 ? std::strtoull(argv[3], nullptr, 10)
+                                        : 1);
+    }
+
+    std::vector<std::string> paths;
+    std::string label, json_path;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--rotulo") == 0 && i + 1 < argc) {
+            label = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2) {
+        std::cerr << "Uso: " << argv[0]
+                  << " <referencia.wav> <recebido.wav> [--rotulo texto] "
+                     "[--json arquivo]\n"
+                  << "     " << argv[0]
+                  << " --monotonia <referencia.wav> [semente]" << std::endl;
+        return 1;
+    }
+    if (label.empty()) label = paths[1];
+
+    std::vector<float> reference, degraded;
+    int reference_rate = 0, degraded_rate = 0;
+    if (!read_wav_samples(paths[0], reference, reference_rate) ||
+        !read_wav_samples(paths[1], degraded, degraded_rate)) {
+        return 1;
+    }
+    if (reference_rate != degraded_rate) {
+        std::cerr << "As taxas de amostragem são diferentes (" << reference_rate
+                  << " e " << degraded_rate << " Hz)." << std::endl;
+        return 1;
+    }
+
+    const QualityScores scores =
+        score_quality(reference, degraded, reference_rate);
+    if (!scores.valid) {
+        std::cerr << "Não há fala da referência no sinal recebido."
+                  << std::endl;
+        return 1;
+    }
+    std::printf("Atraso no arquivo:    %8.1f ms (variação %.1f ms)\n",
+                scores.delay_ms, scores.delay_spread_ms);
+    std::printf("SNR:                  %8.2f dB\n", scores.snr_db);
+    std::printf("SNR segmentado:       %8.2f dB\n", scores.seg_snr_db);
+    std::printf("Perturbação:          %8.2f (simétrica) %.2f (assimétrica)\n",
+                scores.symmetric_disturbance, scores.asymmetric_disturbance);
+    std::printf("MOS perceptual:       %8.2f\n", scores.mos);
+
+    if (!json_path.empty()) {
+        std::ofstream json(json_path, std::ios::app);
+        if (!json) {
+            std::cerr << "Erro ao abrir " << json_path << std::endl;
+            return 1;
+        }
+        json << "{\"rotulo\":";
+        write_json_string(json, label);
+        json << ",\"qualidade\":";
+        write_quality_json(json, scores);
+        json << "}\n";
+    }
+    return 0;
+}
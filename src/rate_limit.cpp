@@ -0,0 +1,153 @@
+#include "rate_limit.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <time.h>
+#if defined(__linux__)
+#include <linux/sock_diag.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <random>
+
+#include "session_token.h"
+
+namespace {
+// Lê um limite em porcentagem de uma variável de ambiente
+double read_percent(const char* name, double fallback) {
+    const char* value = std::getenv(name);
+    if (!value || !*value) return fallback;
+    char* end = nullptr;
+    double percent = std::strtod(value, &end);
+    return (end != value && percent > 0) ? percent : fallback;
+}
+
+// Período do cookie de login que contém 'now'
+int64_t cookie_period(std::chrono::steady_clock::time_point now) {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               now.time_since_epoch())
+               .count() /
+           LOGIN_COOKIE_PERIOD_SEC;
+}
+
+// Tempo de CPU gasto pela thread atual, em segundos (-1 se indisponível)
+double thread_cpu_seconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return -1.0;
+    }
+    // FILETIME conta intervalos de 100 ns
+    const auto to_seconds = [](const FILETIME& time) {
+        return ((uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime) *
+               1e-7;
+    };
+    return to_seconds(kernel) + to_seconds(user);
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return -1.0;
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Ocupação do buffer de recepção do socket, em porcentagem (0 se
+// indisponível)
+double receive_queue_percent(int sock) {
+#if defined(__linux__) && defined(SO_MEMINFO)
+    // Memória usada pelos pacotes na fila e tamanho do buffer de recepção
+    uint32_t meminfo[SK_MEMINFO_VARS] = {};
+    socklen_t len = sizeof(meminfo);
+    if (getsockopt(sock, SOL_SOCKET, SO_MEMINFO, meminfo, &len) == 0 &&
+        meminfo[SK_MEMINFO_RCVBUF] > 0) {
+        return 100.0 * meminfo[SK_MEMINFO_RMEM_ALLOC] /
+               meminfo[SK_MEMINFO_RCVBUF];
+    }
+#else
+    (void)sock;
+#endif
+    return 0.0;
+}
+}  // namespace
+
+bool TokenBucket::consume(std::chrono::steady_clock::time_point now) {
+    const double elapsed =
+        std::chrono::duration<double>(now - last_refill).count();
+    tokens = std::min(burst, tokens + elapsed * rate);
+    last_refill = now;
+    if (tokens < 1.0) return false;
+    tokens -= 1.0;
+    return true;
+}
+
+SourceRateLimiter::SourceRateLimiter() {
+    std::fill(std::begin(buckets), std::end(buckets),
+              TokenBucket(SOURCE_PACKET_RATE, SOURCE_PACKET_BURST));
+}
+
+bool SourceRateLimiter::consume(uint32_t ip,
+                                std::chrono::steady_clock::time_point now) {
+    // Mistura os bits do endereço (hash multiplicativo) para espalhar IPs
+    // vizinhos por baldes diferentes
+    const uint32_t hash = ip * 2654435761u;
+    return buckets[(hash >> 16) % SOURCE_BUCKETS].consume(now);
+}
+
+LoginCookie::LoginCookie() {
+    std::random_device random;
+    for (int i = 0; i < 16; i += 4) {
+        const uint32_t word = random();
+        std::memcpy(key + i, &word, sizeof(word));
+    }
+}
+
+uint64_t LoginCookie::compute(uint32_t ip, uint16_t port,
+                              int64_t period) const {
+    // Mensagem: IP (4 bytes), porta (2) e período (8)
+    uint8_t message[14];
+    std::memcpy(message, &ip, sizeof(ip));
+    std::memcpy(message + 4, &port, sizeof(port));
+    for (int i = 0; i < 8; ++i) {
+        message[6 + i] = static_cast<uint8_t>(period >> (8 * i));
+    }
+    return siphash24(key, message, sizeof(message));
+}
+
+uint64_t LoginCookie::issue(uint32_t ip, uint16_t port,
+                            std::chrono::steady_clock::time_point now) const {
+    return compute(ip, port, cookie_period(now));
+}
+
+bool LoginCookie::check(uint64_t cookie, uint32_t ip, uint16_t port,
+                        std::chrono::steady_clock::time_point now) const {
+    // Aceita o período atual e o anterior, para um cookie emitido perto do
+    // fim de um período
+    const int64_t period = cookie_period(now);
+    return cookie == compute(ip, port, period) ||
+           cookie == compute(ip, port, period - 1);
+}
+
+RelayLoad::RelayLoad()
+    : max_cpu_percent(read_percent("VOIP_MAX_CPU", DEFAULT_MAX_CPU_PERCENT)),
+      max_queue_percent(
+          read_percent("VOIP_MAX_QUEUE", DEFAULT_MAX_QUEUE_PERCENT)) {}
+
+void RelayLoad::sample(int sock, std::chrono::steady_clock::time_point now) {
+    const double wall = std::chrono::duration<double>(now - last_sample).count();
+    if (last_cpu_seconds >= 0.0 && wall < 1.0) return;
+
+    const double cpu_seconds = thread_cpu_seconds();
+    if (last_cpu_seconds >= 0.0 && cpu_seconds >= 0.0) {
+        cpu = 100.0 * (cpu_seconds - last_cpu_seconds) / wall;
+    }
+    last_cpu_seconds = std::max(cpu_seconds, 0.0);
+    last_sample = now;
+
+    queue = receive_queue_percent(sock);
+}
@@ -0,0 +1,171 @@
+#include "realtime.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+bool low_latency_enabled = false;
+
+namespace {
+// CPUs em que as threads são fixadas (VOIP_CPUS), vazio para não fixar
+std::vector<int> pinned_cpus;
+
+// Tempo máximo girando na recepção antes de dormir (VOIP_BUSY_POLL_US)
+int busy_poll_us = 50;
+
+// Lê uma lista de inteiros separados por vírgula
+std::vector<int> parse_cpu_list(const char* text) {
+    std::vector<int> cpus;
+    std::stringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        char* end = nullptr;
+        long cpu = std::strtol(item.c_str(), &end, 10);
+        if (end != item.c_str() && cpu >= 0) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+// Aplica a política de tempo real à thread atual e descreve o resultado
+std::string apply_priority(int priority) {
+#if defined(__linux__)
+    sched_param param{};
+    param.sched_priority = priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+        return "SCHED_FIFO " + std::to_string(priority);
+    }
+    if (pthread_setschedparam(pthread_self(), SCHED_RR, &param) == 0) {
+        return "SCHED_RR " + std::to_string(priority);
+    }
+    // Sem CAP_SYS_NICE nem RLIMIT_RTPRIO: tenta ao menos um nice menor,
+    // que no Linux vale por thread
+    const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, tid, -10) == 0) return "nice -10";
+    return "prioridade padrão (sem permissão para tempo real)";
+#elif defined(_WIN32)
+    (void)priority;
+    if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        return "THREAD_PRIORITY_TIME_CRITICAL";
+    }
+    return "prioridade padrão";
+#else
+    (void)priority;
+    return "prioridade padrão (não suportado)";
+#endif
+}
+
+// Fixa a thread atual em uma CPU e descreve o resultado
+std::string apply_affinity(int cpu_slot) {
+    if (pinned_cpus.empty()) return "";
+    const int cpu = pinned_cpus[cpu_slot % pinned_cpus.size()];
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        return ", CPU " + std::to_string(cpu);
+    }
+#elif defined(_WIN32)
+    if (cpu < 64 && SetThreadAffinityMask(GetCurrentThread(),
+                                          DWORD_PTR(1) << cpu) != 0) {
+        return ", CPU " + std::to_string(cpu);
+    }
+#endif
+    return ", CPU " + std::to_string(cpu) + " indisponível";
+}
+}  // namespace
+
+void realtime_init() {
+    const char* enabled = std::getenv("VOIP_LOW_LATENCY");
+    if (!enabled || !*enabled || std::strcmp(enabled, "0") == 0) return;
+    low_latency_enabled = true;
+
+    if (const char* cpus = std::getenv("VOIP_CPUS")) {
+        pinned_cpus = parse_cpu_list(cpus);
+    }
+    if (const char* budget = std::getenv("VOIP_BUSY_POLL_US")) {
+        busy_poll_us = std::max(0, std::atoi(budget));
+    }
+
+#if defined(__linux__)
+    // Trava a memória atual e futura: nenhuma página do caminho do áudio
+    // pode ir para o swap ou causar page fault no meio de um quadro
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        std::cerr << "[tempo real] mlockall falhou: " << std::strerror(errno)
+                  << " (aumente o RLIMIT_MEMLOCK ou use CAP_IPC_LOCK)"
+                  << std::endl;
+    }
+#endif
+    std::cout << "[tempo real] Modo de baixa latência ativo (giro de "
+              << busy_poll_us << " us na recepção)." << std::endl;
+}
+
+void realtime_thread(const char* name, int priority, int cpu_slot) {
+#if defined(__linux__)
+    // O nome da thread tem no máximo 15 caracteres no Linux
+    const std::string short_name = std::string(name).substr(0, 15);
+    pthread_setname_np(pthread_self(), short_name.c_str());
+#endif
+    if (!low_latency_enabled) return;
+
+    const std::string policy = apply_priority(priority);
+    const std::string affinity = apply_affinity(cpu_slot);
+    std::cout << "[tempo real] Thread '" << name << "': " << policy << affinity
+              << std::endl;
+}
+
+void enable_busy_poll(int sock) {
+    if (!low_latency_enabled) return;
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+    // O driver da placa de rede é consultado diretamente por até
+    // busy_poll_us em cada leitura, sem esperar a interrupção
+    int budget = busy_poll_us;
+    if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &budget, sizeof(budget)) <
+        0) {
+        std::cerr << "[tempo real] SO_BUSY_POLL falhou: "
+                  << std::strerror(errno) << std::endl;
+    }
+#else
+    (void)sock;
+#endif
+}
+
+ssize_t spin_recvfrom(int sock, char* buffer, size_t size, sockaddr* from,
+                      socklen_t* from_len) {
+#if defined(__linux__)
+    if (!low_latency_enabled || busy_poll_us <= 0) return -1;
+
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::microseconds(busy_poll_us);
+    const socklen_t capacity = from_len ? *from_len : 0;
+    do {
+        if (from_len) *from_len = capacity;
+        ssize_t n = recvfrom(sock, buffer, size, MSG_DONTWAIT, from, from_len);
+        if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) return n;
+    } while (std::chrono::steady_clock::now() < deadline);
+    return -1;
+#else
+    (void)sock, (void)buffer, (void)size, (void)from, (void)from_len;
+    return -1;
+#endif
+}
@@ -0,0 +1,385 @@
+#include "recording.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+// Cabeçalho canônico do WAV (o mesmo do WavWriter)
+constexpr int WAV_HEADER_SIZE = 44;
+
+// Um salto de timestamp maior que isso é outro participante no fluxo (ou o
+// mesmo reconectado)
+constexpr int32_t RECORD_RESET_SAMPLES = 2 * SAMPLE_RATE;
+
+// Quadros atrasados seguidos que indicam que o relógio do emissor anda mais
+// devagar que o do gravador: o buffer de jitter recomeça
+constexpr int RECORD_LATE_LIMIT = 5;
+
+void put_u32(char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+void put_u16(char* p, uint16_t v) {
+    p[0] = static_cast<char>(v & 0xFF);
+    p[1] = static_cast<char>(v >> 8);
+}
+
+// Escreve tudo, repetindo em escritas parciais
+bool write_all(int fd, const char* data, size_t length, long offset) {
+    while (length > 0) {
+        const ssize_t n = offset >= 0 ? pwrite(fd, data, length, offset)
+                                      : write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+        if (offset >= 0) offset += n;
+    }
+    return true;
+}
+}  // namespace
+
+DiskWriter::~DiskWriter() {
+    stop();
+    for (char* block : free_blocks) std::free(block);
+}
+
+void DiskWriter::start() {
+    running = true;
+    thread = std::thread(&DiskWriter::run, this);
+}
+
+void DiskWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_one();
+    if (thread.joinable()) thread.join();
+}
+
+char* DiskWriter::acquire_block() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!free_blocks.empty()) {
+            char* block = free_blocks.back();
+            free_blocks.pop_back();
+            return block;
+        }
+    }
+    void* block = nullptr;
+    if (posix_memalign(&block, RECORD_BLOCK_ALIGNMENT, RECORD_BLOCK_SIZE) != 0) {
+        return nullptr;
+    }
+    return static_cast<char*>(block);
+}
+
+bool DiskWriter::submit(int fd, char* block, size_t length, bool keep) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs.size() >= RECORD_MAX_PENDING && !keep) {
+            if (blocks_dropped++ == 0) {
+                std::cerr << "[gravação] Disco atrasado: descartando blocos."
+                          << std::endl;
+            }
+            free_blocks.push_back(block);
+
+            // O trecho fica no arquivo como silêncio: um bloco descartado
+            // logo após outro do mesmo arquivo só aumenta o salto
+            if (!jobs.empty() && jobs.back().fd == fd && !jobs.back().block &&
+                !jobs.back().last) {
+                jobs.back().length += length;
+            } else {
+                jobs.push_back(Job{fd, nullptr, length, false});
+            }
+            return false;
+        }
+        jobs.push_back(Job{fd, block, length, false});
+        max_pending = std::max(max_pending, jobs.size());
+    }
+    wake.notify_one();
+    return true;
+}
+
+void DiskWriter::finish(int fd, char* block, size_t length) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(Job{fd, block, length, true});
+        max_pending = std::max(max_pending, jobs.size());
+    }
+    wake.notify_one();
+}
+
+void DiskWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return !jobs.empty() || !running; });
+        if (jobs.empty()) break;
+
+        Job job = jobs.front();
+        jobs.pop_front();
+        lock.unlock();
+
+        if (!job.block && !job.last) {
+            // Bloco descartado: pula o trecho, que o sistema de arquivos lê
+            // como zeros
+            if (lseek(job.fd, static_cast<off_t>(job.length), SEEK_CUR) < 0) {
+                perror("Erro ao gravar no disco");
+            }
+        } else if (job.block && job.length > 0 &&
+                   !write_all(job.fd, job.block, job.length, -1)) {
+            perror("Erro ao gravar no disco");
+        }
+        if (job.last) {
+            // Corrige os tamanhos do RIFF e do bloco "data" no cabeçalho com
+            // a posição final, contando os trechos pulados; um salto no fim
+            // do arquivo só existe depois do ftruncate()
+            const off_t end = lseek(job.fd, 0, SEEK_CUR);
+            if (end > 0 && ftruncate(job.fd, end) != 0) {
+                perror("Erro ao gravar no disco");
+            }
+            const uint32_t data_bytes =
+                end > WAV_HEADER_SIZE ? uint32_t(end - WAV_HEADER_SIZE) : 0;
+            char size[4];
+            put_u32(size, WAV_HEADER_SIZE - 8 + data_bytes);
+            write_all(job.fd, size, 4, 4);
+            put_u32(size, data_bytes);
+            write_all(job.fd, size, 4, 40);
+            ::close(job.fd);
+        }
+
+        lock.lock();
+        if (job.block) {
+            free_blocks.push_back(job.block);
+            bytes_written += job.length;
+        }
+    }
+}
+
+RecordingFile::~RecordingFile() { close(); }
+
+bool RecordingFile::open(DiskWriter& disk, const std::string& path,
+                         int sample_rate, int channels) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(("Erro ao criar " + path).c_str());
+        return false;
+    }
+    writer = &disk;
+    channel_count = channels;
+    block = writer->acquire_block();
+    if (!block) {
+        std::cerr << "Sem memória para a gravação." << std::endl;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    // Cabeçalho provisório: os tamanhos são corrigidos em close()
+    char* header = block;
+    std::memset(header, 0, WAV_HEADER_SIZE);
+    std::memcpy(header, "RIFF", 4);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    put_u32(header + 16, 16);
+    put_u16(header + 20, 1);
+    put_u16(header + 22, static_cast<uint16_t>(channels));
+    put_u32(header + 24, static_cast<uint32_t>(sample_rate));
+    put_u32(header + 28, static_cast<uint32_t>(sample_rate * channels * 2));
+    put_u16(header + 32, static_cast<uint16_t>(channels * 2));
+    put_u16(header + 34, 16);
+    std::memcpy(header + 36, "data", 4);
+    used = WAV_HEADER_SIZE;
+    first_block = true;
+    return true;
+}
+
+void RecordingFile::submit_block() {
+    // Sem o cabeçalho, a correção dos tamanhos em close() cairia no áudio
+    writer->submit(fd, block, used, first_block);
+    first_block = false;
+    used = 0;
+    block = writer->acquire_block();
+}
+
+void RecordingFile::write(const int16_t* samples, int frames) {
+    if (fd < 0) return;
+    const char* data = reinterpret_cast<const char*>(samples);
+    size_t bytes = static_cast<size_t>(frames) * SAMPLE_SIZE * channel_count;
+
+    // Enche o bloco atual e entrega cada bloco completo à thread de escrita
+    while (bytes > 0 && block) {
+        const size_t chunk = std::min(bytes, RECORD_BLOCK_SIZE - used);
+        std::memcpy(block + used, data, chunk);
+        used += chunk;
+        data += chunk;
+        bytes -= chunk;
+        if (used == RECORD_BLOCK_SIZE) submit_block();
+    }
+}
+
+void RecordingFile::close() {
+    if (fd < 0) return;
+    writer->finish(fd, block, block ? used : 0);
+    block = nullptr;
+    fd = -1;
+}
+
+RoomRecorder::RoomRecorder(DiskWriter& disk, std::string prefix, int mode)
+    : disk(disk),
+      prefix(std::move(prefix)),
+      mode(mode),
+      decoded(MAX_FRAMES_PER_PACKET * AUDIO_BUFFER_SIZE),
+      accumulator(FRAMES_PER_BUFFER),
+      mixed(FRAMES_PER_BUFFER) {}
+
+void RoomRecorder::anchor(Track& track, uint32_t timestamp) {
+    track.next_timestamp = timestamp - RECORD_DELAY_FRAMES * FRAMES_PER_BUFFER;
+    track.late_in_row = 0;
+    std::fill(std::begin(track.slot_full), std::end(track.slot_full), false);
+}
+
+void RoomRecorder::store(Track& track, uint32_t timestamp, const char* pcm) {
+    // Amostras à frente da posição atual da sala
+    int32_t ahead = static_cast<int32_t>(timestamp - track.next_timestamp);
+    if (ahead < 0) {
+        ++track.late;
+        if (++track.late_in_row < RECORD_LATE_LIMIT) return;
+        anchor(track, timestamp);
+    } else if (ahead / FRAMES_PER_BUFFER >= RECORD_SLOTS) {
+        // O emissor está adiantado demais (relógio mais rápido ou uma
+        // pausa longa): recomeça a partir deste quadro
+        anchor(track, timestamp);
+    } else {
+        track.late_in_row = 0;
+    }
+
+    ahead = static_cast<int32_t>(timestamp - track.next_timestamp);
+    const int slot = static_cast<int>(
+        (position + ahead / FRAMES_PER_BUFFER) % RECORD_SLOTS);
+    track.slot_timestamp[slot] = timestamp;
+    track.slot_full[slot] = true;
+    std::memcpy(track.samples.data() + slot * FRAMES_PER_BUFFER, pcm,
+                AUDIO_BUFFER_SIZE);
+}
+
+bool RoomRecorder::on_packet(const char* packet, size_t length) {
+    if (length <= AUDIO_HEADER_SIZE) return true;
+    const int stream = static_cast<uint8_t>(packet[1]);
+    if (stream >= MAX_STREAMS) return true;
+
+    if (!tracks[stream]) {
+        auto track = std::make_unique<Track>();
+        track->samples.resize(RECORD_SLOTS * FRAMES_PER_BUFFER);
+        if (mode & RECORD_TRACKS) {
+            const std::string path =
+                prefix + "_fluxo" + std::to_string(stream) + ".wav";
+            if (!track->file.open(disk, path, SAMPLE_RATE, NUM_CHANNELS)) {
+                return false;
+            }
+            std::cout << "Fluxo " << stream << " -> " << path << " (a partir de "
+                      << position * FRAMES_PER_BUFFER / double(SAMPLE_RATE)
+                      << " s)" << std::endl;
+        }
+        tracks[stream] = std::move(track);
+    }
+    Track& track = *tracks[stream];
+
+    const int count = track.decoder.decode(
+        static_cast<uint8_t>(packet[AUDIO_LAYER_OFFSET]),
+        std::string_view(packet + AUDIO_HEADER_SIZE, length - AUDIO_HEADER_SIZE),
+        decoded.data());
+    if (count == 0) return true;
+
+    uint32_t network_timestamp;
+    std::memcpy(&network_timestamp, packet + AUDIO_TIMESTAMP_OFFSET,
+                sizeof(network_timestamp));
+    const uint32_t timestamp = ntohl(network_timestamp);
+
+    // Primeiro pacote do fluxo ou outro participante no mesmo slot
+    const int32_t jump = static_cast<int32_t>(timestamp - track.last_timestamp);
+    if (!track.started || jump > RECORD_RESET_SAMPLES ||
+        jump < -RECORD_RESET_SAMPLES) {
+        anchor(track, timestamp);
+        track.started = true;
+    }
+    track.last_timestamp = timestamp;
+
+    for (int i = 0; i < count; ++i) {
+        store(track, timestamp + i * FRAMES_PER_BUFFER,
+              decoded.data() + i * AUDIO_BUFFER_SIZE);
+    }
+    return true;
+}
+
+void RoomRecorder::tick() {
+    std::fill(accumulator.begin(), accumulator.end(), 0);
+    const int slot = static_cast<int>(position % RECORD_SLOTS);
+
+    for (auto& pointer : tracks) {
+        if (!pointer) continue;
+        Track& track = *pointer;
+        const int16_t* frame = track.samples.data() + slot * FRAMES_PER_BUFFER;
+        const bool present = track.slot_full[slot] &&
+                             track.slot_timestamp[slot] == track.next_timestamp;
+        if (present) {
+            ++track.frames;
+            for (int i = 0; i < FRAMES_PER_BUFFER; ++i) {
+                accumulator[i] += frame[i];
+            }
+        } else {
+            // Quadro perdido ou participante calado: silêncio, para a
+            // trilha continuar alinhada com a sala
+            ++track.missing;
+            std::fill(track.samples.begin() + slot * FRAMES_PER_BUFFER,
+                      track.samples.begin() + (slot + 1) * FRAMES_PER_BUFFER,
+                      0);
+        }
+        if (mode & RECORD_TRACKS) track.file.write(frame, FRAMES_PER_BUFFER);
+        track.slot_full[slot] = false;
+        track.next_timestamp += FRAMES_PER_BUFFER;
+    }
+
+    if (mode & RECORD_MIX) {
+        if (!mix_open) {
+            mix_open = mix_file.open(disk, prefix + "_mix.wav", SAMPLE_RATE,
+                                     NUM_CHANNELS);
+            if (mix_open) {
+                std::cout << "Mixagem -> " << prefix << "_mix.wav" << std::endl;
+            } else {
+                mode &= ~RECORD_MIX;
+            }
+        }
+        for (int i = 0; i < FRAMES_PER_BUFFER; ++i) {
+            mixed[i] = static_cast<int16_t>(
+                std::clamp(accumulator[i], -32768, 32767));
+        }
+        if (mix_open) mix_file.write(mixed.data(), FRAMES_PER_BUFFER);
+    }
+    ++position;
+}
+
+void RoomRecorder::close() {
+    if (mix_open) {
+        mix_file.close();
+        mix_open = false;
+    }
+    for (int stream = 0; stream < MAX_STREAMS; ++stream) {
+        if (!tracks[stream]) continue;
+        Track& track = *tracks[stream];
+        track.file.close();
+        std::cout << prefix << ", fluxo " << stream << ": "
+                  << track.frames * FRAMES_PER_BUFFER / double(SAMPLE_RATE)
+                  << " s de áudio, " << track.late << " quadros atrasados."
+                  << std::endl;
+    }
+}
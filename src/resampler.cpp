@@ -0,0 +1,172 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "dsp_simd.h"
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+
+// Cruzamentos por zero do sinc em cada lado do filtro (qualidade x custo)
+constexpr int RESAMPLER_ZERO_CROSSINGS = 16;
+
+// Frequência de corte como fração da menor frequência de Nyquist
+constexpr double RESAMPLER_CUTOFF = 0.9;
+
+// Parâmetro da janela de Kaiser (~80 dB de atenuação)
+constexpr double RESAMPLER_KAISER_BETA = 8.0;
+
+// Coeficientes e fases da tabela do conversor assíncrono
+constexpr int RESAMPLER_ASYNC_TAPS = 16;
+constexpr int RESAMPLER_ASYNC_PHASES = 128;
+
+// Corte do conversor assíncrono (a razão é sempre muito próxima de 1)
+constexpr double RESAMPLER_ASYNC_CUTOFF = 0.45;
+
+// Função de Bessel modificada de ordem zero, usada pela janela de Kaiser
+double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+}  // namespace
+
+Resampler::Resampler(int input_rate, int output_rate, int max_input) {
+    const int divisor = std::gcd(input_rate, output_rate);
+    up = output_rate / divisor;
+    down = input_rate / divisor;
+
+    // O filtro roda na taxa intermediária input_rate * L, com corte abaixo
+    // da menor das duas frequências de Nyquist
+    const double cutoff =
+        RESAMPLER_CUTOFF * 0.5 * std::min(input_rate, output_rate) /
+        (static_cast<double>(input_rate) * up);
+    const int half_length =
+        static_cast<int>(std::ceil(RESAMPLER_ZERO_CROSSINGS / (2.0 * cutoff)));
+    taps = (2 * half_length + up) / up;
+    const int length = taps * up;
+    const double center = (length - 1) / 2.0;
+
+    // Protótipo sinc com janela de Kaiser e ganho L (compensa a
+    // interpolação), distribuído nas fases: fase p, coeficiente j = h[p + jL]
+    phases.assign(length, 0.0f);
+    const double window_norm = bessel_i0(RESAMPLER_KAISER_BETA);
+    for (int i = 0; i < length; ++i) {
+        const double t = i - center;
+        const double x = 2.0 * cutoff * t;
+        const double sinc = (t == 0.0) ? 1.0 : std::sin(PI * x) / (PI * x);
+        const double r = t / (center + 1.0);
+        const double window =
+            bessel_i0(RESAMPLER_KAISER_BETA * std::sqrt(1.0 - r * r)) /
+            window_norm;
+        const double h = 2.0 * cutoff * sinc * window * up;
+        const int phase = i % up;
+        const int j = i / up;
+        phases[phase * taps + (taps - 1 - j)] = static_cast<float>(h);
+    }
+
+    delay = center / (static_cast<double>(input_rate) * up);
+    buffer.assign(taps - 1 + max_input, 0.0f);
+}
+
+int Resampler::process(const float* in, int count, float* out) {
+    count = std::min(count, static_cast<int>(buffer.size()) - (taps - 1));
+    std::copy(in, in + count, buffer.begin() + (taps - 1));
+
+    // Saída k usa a fase (k*M) % L e as entradas até (k*M) / L
+    int produced = 0;
+    const long end = static_cast<long>(count) * up;
+    while (position < end) {
+        const long index = position / up;
+        const int phase = static_cast<int>(position % up);
+        out[produced++] = dot_product(phases.data() + phase * taps,
+                                      buffer.data() + index, taps);
+        position += down;
+    }
+    position -= end;
+
+    // Guarda as últimas 'taps - 1' amostras como histórico do próximo bloco
+    std::copy(buffer.begin() + count, buffer.begin() + count + (taps - 1),
+              buffer.begin());
+    return produced;
+}
+
+AsyncResampler::AsyncResampler(int max_input)
+    : table((RESAMPLER_ASYNC_PHASES + 1) * RESAMPLER_ASYNC_TAPS),
+      buffer(RESAMPLER_ASYNC_TAPS - 1 + 2 * max_input, 0.0f) {
+    // Fase 'i' interpola o ponto a uma fração f = i / fases após a amostra
+    // central da janela: coeficiente j = h(f + taps/2 - 1 - j)
+    const double half = RESAMPLER_ASYNC_TAPS / 2.0;
+    const double window_norm = bessel_i0(RESAMPLER_KAISER_BETA);
+    for (int i = 0; i <= RESAMPLER_ASYNC_PHASES; ++i) {
+        const double fraction =
+            static_cast<double>(i) / RESAMPLER_ASYNC_PHASES;
+        for (int j = 0; j < RESAMPLER_ASYNC_TAPS; ++j) {
+            const double t = fraction + half - 1.0 - j;
+            const double x = 2.0 * RESAMPLER_ASYNC_CUTOFF * t;
+            const double sinc =
+                (t == 0.0) ? 1.0 : std::sin(PI * x) / (PI * x);
+            const double r = std::min(1.0, std::fabs(t) / half);
+            const double window =
+                bessel_i0(RESAMPLER_KAISER_BETA * std::sqrt(1.0 - r * r)) /
+                window_norm;
+            table[i * RESAMPLER_ASYNC_TAPS + j] = static_cast<float>(
+                2.0 * RESAMPLER_ASYNC_CUTOFF * sinc * window);
+        }
+    }
+}
+
+int AsyncResampler::process(const float* in, int count, float* out,
+                            int max_out) {
+    // O buffer guarda até 'max_input' amostras de sobra mais um bloco
+    constexpr int history = RESAMPLER_ASYNC_TAPS - 1;
+    const int capacity = static_cast<int>(buffer.size()) - history;
+    count = std::min(count, capacity / 2);
+    if (pending + count > capacity) {
+        const int drop = pending + count - capacity;
+        std::copy(buffer.begin() + drop, buffer.begin() + history + pending,
+                  buffer.begin());
+        pending -= drop;
+        position = std::max(0.0, position - drop);
+    }
+    std::copy(in, in + count, buffer.begin() + history + pending);
+    const int available = pending + count;
+
+    // A janela começa em 'start' e interpola o ponto start + taps/2 - 1 + f
+    int produced = 0;
+    const int last_start = available - 1;
+    while (produced < max_out) {
+        const int start = static_cast<int>(position);
+        if (start > last_start) break;
+        const double scaled = (position - start) * RESAMPLER_ASYNC_PHASES;
+        const int phase = static_cast<int>(scaled);
+        const float weight = static_cast<float>(scaled - phase);
+        const float* window = buffer.data() + start;
+        const float* a = table.data() + phase * RESAMPLER_ASYNC_TAPS;
+        const float* b = a + RESAMPLER_ASYNC_TAPS;
+        out[produced++] =
+            (1.0f - weight) * dot_product(a, window, RESAMPLER_ASYNC_TAPS) +
+            weight * dot_product(b, window, RESAMPLER_ASYNC_TAPS);
+        position += step;
+    }
+
+    // Descarta a entrada já usada por todas as janelas; com a saída
+    // limitada por 'max_out', o restante fica para a próxima chamada
+    const int consumed = std::min(static_cast<int>(position), available);
+    position -= consumed;
+    pending = available - consumed;
+    std::copy(buffer.begin() + consumed,
+              buffer.begin() + consumed + history + pending, buffer.begin());
+    return produced;
+}
+
+// O ponto interpolado está 'taps/2 - 1' amostras após o início da janela,
+// e a janela começa 'taps - 1' amostras antes da entrada atual
+double AsyncResampler::delay_samples() const {
+    return RESAMPLER_ASYNC_TAPS / 2.0;
+}
@@ -8,18 +8,27 @@
 
 using socklen_t = int;
 #else
+#include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #endif
 
 #include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "common.h"
+#include "frame_pool.h"
+#include "handoff.h"
+#include "log.h"
+#include "realtime.h"
 #include "server_handler.h"
+#include "trace.h"
 
 // Função principal do servidor
 int main() {
@@ -32,42 +41,149 @@ int main() {
     }
 #endif
 
-    // Cria o socket
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        perror("Erro ao criar o socket");
-        return 1;
+    // Lê a configuração do modo de baixa latência (VOIP_LOW_LATENCY).
+    realtime_init();
+
+    // Lê a configuração dos servidores interligados (VOIP_RELAY_ID e
+    // VOIP_PEERS).
+    if (!trunk.configure()) return 1;
+
+    // Tabela de sessões do servidor (vazia, ou recebida do processo anterior)
+    static ClientInfo clients[MAX_CLIENTS];
+    const std::string handoff_path = handoff_socket_path();
+
+    // Na troca sem interrupção, tudo o que pode demorar fica pronto antes
+    // de assumir: o processo antigo continua servindo até a confirmação, que
+    // sai logo após receber o socket. O socket de troca do sucessor fica
+    // num caminho próprio até a troca terminar.
+    const bool takeover = std::getenv("VOIP_TAKEOVER") != nullptr;
+    const std::string listen_path =
+        takeover ? handoff_staging_path(handoff_path) : handoff_path;
+
+    // Aceita um sucessor (VOIP_TAKEOVER) pelo socket Unix de troca
+    int handoff_listener = handoff_listen(listen_path);
+
+    // Publica o áudio para consumidores locais se VOIP_SHM estiver definida.
+    if (const char* ring_name = std::getenv("VOIP_SHM")) {
+        if (local_ring.create(ring_name)) {
+            std::cout << "Publicando o áudio na memória compartilhada '"
+                      << ring_name << "'." << std::endl;
+        }
+    }
+
+    // Recebe e repassa o áudio por AF_XDP se VOIP_XDP=<interface> estiver
+    // definida (servidor compilado com -DVOIP_XDP). O sucessor de uma troca
+    // sem interrupção carrega o programa de novo na mesma interface.
+    if (const char* interface = std::getenv("VOIP_XDP")) {
+        xdp_path.open(interface, relay_port());
     }
 
-    // Define a estrutura sockaddr_in para o servidor
-    sockaddr_in server_addr{};
-    server_addr.sin_family = AF_INET;  // Define o tipo de endereço (IPv4)
-    server_addr.sin_addr.s_addr = INADDR_ANY;  // Ouve qualquer IP da máquina
-    server_addr.sin_port = htons(PORT);        // Define a porta do servidor
+    // Inicia o registro assíncrono de mensagens (VOIP_LOG_LEVEL).
+    log_init();
+
+    int sock = -1;
+    if (takeover) {
+        // Troca sem interrupção: assume o socket já vinculado, já no grupo
+        // multicast e já configurado, junto com as sessões do servidor atual
+        const auto takeover_start = std::chrono::steady_clock::now();
+        sock = handoff_receive(handoff_path, clients);
+        if (sock < 0) {
+            log_shutdown();
+            handoff_close(handoff_listener, listen_path, true);
+            local_ring.close(true);
+            xdp_path.close();
+            return 1;
+        }
+        const auto elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - takeover_start);
+        std::cout << "[troca] Servidor assumido em " << elapsed.count() / 1000.0
+                  << " ms." << std::endl;
+        if (handoff_listener >= 0 &&
+            !handoff_activate(listen_path, handoff_path)) {
+            handoff_close(handoff_listener, listen_path, true);
+            handoff_listener = -1;
+        }
+    } else {
+        // Cria o socket
+        sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sock < 0) {
+            perror("Erro ao criar o socket");
+            log_shutdown();
+            return 1;
+        }
+
+        // Define a estrutura sockaddr_in para o servidor
+        sockaddr_in server_addr{};
+        server_addr.sin_family = AF_INET;          // Tipo de endereço (IPv4)
+        server_addr.sin_addr.s_addr = INADDR_ANY;  // Ouve qualquer IP
+        server_addr.sin_port = htons(relay_port());  // VOIP_PORT ou PORT
 
-    // Tenta bindar o socket ao endereço e porta especificados
-    if (bind(sock, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        perror("Erro ao vincular o socket");
+        // Tenta bindar o socket ao endereço e porta especificados
+        if (bind(sock, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+            perror("Erro ao vincular o socket");
 #ifdef _WIN32
-        closesocket(sock);
+            closesocket(sock);
 #else
-        close(sock);
+            close(sock);
 #endif
-        return 1;
+            log_shutdown();
+            handoff_close(handoff_listener, listen_path, true);
+            local_ring.close(true);
+            xdp_path.close();
+            return 1;
+        }
+
+        // Entra no grupo multicast de descoberta, para responder clientes que
+        // procuram servidores sem depender de broadcast. Sem multicast (por
+        // exemplo, sem rota para o grupo) a descoberta continua por broadcast.
+        ip_mreq discovery_group{};
+        inet_pton(AF_INET, DISCOVERY_MULTICAST_GROUP,
+                  &discovery_group.imr_multiaddr);
+        discovery_group.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                       (const char*)&discovery_group,
+                       sizeof(discovery_group)) < 0) {
+            perror("Aviso: não foi possível entrar no grupo multicast");
+        }
     }
 
+    // Recepção com busy polling no modo de baixa latência
+    enable_busy_poll(sock);
+
+    // Ativa o rastreamento de latência se VOIP_TRACE estiver definida.
+    trace_init("servidor");
+
     // Inicia o loop do servidor em uma thread separada
     running = true;
-    std::thread server_thread(server_loop, sock);
-
-    // Aguarda o Enter do utilizador
-    std::cin.get();
+    std::thread server_thread(server_loop, sock, handoff_listener, clients);
 
-    std::cout << "A encerrar o servidor..." << std::endl;
-    running = false;
+    // Aguarda o Enter do utilizador em outra thread: o loop também pode
+    // terminar sozinho, quando o servidor é entregue a um sucessor
+    std::thread([] {
+        std::cin.get();
+        running = false;
+    }).detach();
 
-    // Aguarda a thread do servidor terminar
+    // Aguarda a thread do servidor terminar e escreve as mensagens pendentes
     server_thread.join();
+    log_shutdown();
+    trunk.print_stats();
+    xdp_path.print_stats();
+    frame_pool.print_stats();
+
+    if (handed_off) {
+        std::cout << "Servidor entregue; a encerrar este processo..."
+                  << std::endl;
+    } else {
+        std::cout << "A encerrar o servidor..." << std::endl;
+    }
+
+    // Sem sucessor, remove o arquivo do socket de troca e o nome do anel
+    // de memória compartilhada (um sucessor já criou o seu)
+    handoff_close(handoff_listener, handoff_path, !handed_off);
+    local_ring.close(!handed_off);
+    xdp_path.close();
 
 // Fecha o socket antes de sair
 #ifdef _WIN32
@@ -77,6 +193,9 @@ int main() {
     close(sock);
 #endif
 
+    // Exporta o rastreamento de latência (se ativo).
+    trace_finish();
+
     std::cout << "Servidor encerrado." << std::endl;
 
     return 0;
@@ -7,62 +7,453 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstring>
+#include <initializer_list>
 #include <iostream>
+#include <string>
 #include <string_view>
 #include <vector>
 
+#include "congestion.h"
+#include "frame_pool.h"
+#include "handoff.h"
+#include "log.h"
+#include "realtime.h"
+#include "session_token.h"
+#include "shm_ring.h"
+#include "simulcast.h"
+#include "trace.h"
+#include "trunk.h"
+#include "xdp_path.h"
+
 std::atomic<bool> running;
+std::atomic<bool> handed_off(false);
+ShmRingWriter local_ring;
+Trunk trunk;
+XdpPath xdp_path;
+
+namespace {
+// Limites dos pacotes de quem ainda não tem sessão, por IP de origem
+SourceRateLimiter source_limiter;
+LoginCookie login_cookies;
+
+// Carga da thread do servidor, usada na admissão de novos logins
+RelayLoad relay_load;
+
+// Emite os tokens de retomada de sessão entregues no LOGIN_OK
+SessionTokenIssuer session_tokens;
+
+// Pacotes descartados desde o último relatório: por sessão e de origens
+// sem sessão
+uint64_t session_drops[MAX_CLIENTS] = {};
+uint64_t source_drops = 0;
+std::chrono::steady_clock::time_point last_drop_report;
+
+// Intervalo entre relatórios de pacotes descartados. Um aviso por pacote
+// transformaria a inundação em uma inundação de escritas no terminal.
+constexpr auto DROP_REPORT_INTERVAL = std::chrono::seconds(5);
+
+// Último pacote de cada fluxo (locais e de servidores interligados): um
+// fluxo sem pacotes há STREAM_ACTIVE_WINDOW não conta na banda dos ouvintes
+std::chrono::steady_clock::time_point stream_last_seen[MAX_STREAMS];
+constexpr auto STREAM_ACTIVE_WINDOW = std::chrono::seconds(1);
+
+// Intervalo entre as escolhas de camada dos ouvintes
+constexpr auto LAYER_UPDATE_INTERVAL = std::chrono::seconds(1);
+std::chrono::steady_clock::time_point last_layer_update;
+
+// Um pacote com várias camadas recortado por camada. Cada camada é montada
+// só quando o primeiro ouvinte que precisa dela aparece, e no máximo uma
+// vez por pacote: a troca de camada de um ouvinte sempre cai entre quadros.
+struct LayerPackets {
+    char packets[LAYER_COUNT][AUDIO_HEADER_SIZE + MAX_AUDIO_PAYLOAD];
+    size_t lengths[LAYER_COUNT] = {};
+};
+
+// Monta o texto de uma mensagem do servidor num bloco do frame_pool, sem
+// passar pelo heap
+FrameRef compose_message(std::initializer_list<std::string_view> parts) {
+    FrameRef text = frame_pool.allocate();
+    for (std::string_view part : parts) text.append(part);
+    return text;
+}
+
+// Confirma o login da sessão 'slot': o identificador do fluxo que ela deve
+// usar no áudio (o slot, dentro do bloco de fluxos deste servidor) e o
+// token que vai no final de cada pacote de áudio
+void send_login_ok(int sock, int slot, const ClientInfo& client) {
+    char login_ok_packet[2 + SESSION_TOKEN_SIZE] = {
+        LOGIN_OK, static_cast<char>(trunk.stream_base() + slot)};
+    write_session_token(client.session_token, login_ok_packet + 2);
+    sendto(sock, login_ok_packet, sizeof(login_ok_packet), 0,
+           (const sockaddr*)&client.address, client.address_len);
+}
+
+// Verifica se o pacote de áudio termina com o token da sessão
+bool has_session_token(std::string_view audio_packet,
+                       const ClientInfo& client) {
+    return audio_packet.size() >= AUDIO_HEADER_SIZE + SESSION_TOKEN_SIZE &&
+           read_session_token(audio_packet.data() + audio_packet.size() -
+                              SESSION_TOKEN_SIZE) == client.session_token;
+}
+
+// Áudio de um endereço sem sessão: o identificador do fluxo aponta o slot
+// e, se o token no final do pacote for o da sessão, o NAT do participante
+// trocou o mapeamento. A sessão passa para o novo endereço já neste pacote.
+// Retorna o slot, ou -1 se o pacote não for de nenhuma sessão.
+int resume_session(std::string_view audio_packet,
+                   const sockaddr_in& sender_addr, socklen_t sender_len,
+                   ClientInfo clients[MAX_CLIENTS]) {
+    if (audio_packet.size() < AUDIO_HEADER_SIZE) return -1;
+    const int slot =
+        static_cast<uint8_t>(audio_packet[1]) - trunk.stream_base();
+    if (slot < 0 || slot >= MAX_CLIENTS) return -1;
+    ClientInfo& client = clients[slot];
+    if (!client.is_active || !has_session_token(audio_packet, client)) {
+        return -1;
+    }
+
+    log_client(LOG_INFO, "Sessão retomada em novo endereço:", sender_addr,
+               client.name);
+    client.address = sender_addr;
+    client.address_len = sender_len;
+    return slot;
+}
+
+// Interpreta as camadas e quadros do áudio do pacote; false se o tamanho
+// não corresponder ao formato do cabeçalho
+bool read_audio_layout(std::string_view audio_packet, AudioLayout& layout) {
+    return parse_audio_layout(
+        static_cast<uint8_t>(audio_packet[AUDIO_LAYER_OFFSET]),
+        audio_packet.size() - AUDIO_HEADER_SIZE, layout);
+}
+
+// Pacote a enviar a um ouvinte que recebe a camada 'layer' (ou a melhor
+// presente, se quem fala reduziu as camadas). Pacotes de uma camada só
+// seguem como chegaram.
+std::string_view layer_packet(std::string_view audio_packet,
+                              const AudioLayout& layout, int layer,
+                              LayerPackets& cache) {
+    if (layout.first_layer == layout.last_layer) return audio_packet;
+    layer = std::max(layer, layout.first_layer);
+    if (cache.lengths[layer] == 0) {
+        char* packet = cache.packets[layer];
+        std::memcpy(packet, audio_packet.data(), AUDIO_HEADER_SIZE);
+        packet[AUDIO_LAYER_OFFSET] = static_cast<char>(layer);
+        cache.lengths[layer] =
+            AUDIO_HEADER_SIZE +
+            extract_layer(layout, audio_packet.substr(AUDIO_HEADER_SIZE), layer,
+                          packet + AUDIO_HEADER_SIZE);
+    }
+    return std::string_view(cache.packets[layer], cache.lengths[layer]);
+}
+
+// Registra um evento de rastreamento para cada quadro do pacote
+void trace_frames(TraceStage stage, int stream, uint32_t timestamp,
+                  int frames) {
+    for (int i = 0; i < frames; ++i) {
+        trace_event(stage, stream, timestamp + i * FRAMES_PER_BUFFER);
+    }
+}
+
+// Recepção de cada fluxo nos ouvintes deste servidor desde o último envio
+// de SENDER_FEEDBACK: a menor perda e o menor gradiente (o trecho comum a
+// todos os ouvintes é o de quem fala até o servidor) e o maior jitter
+StreamFeedback stream_feedback[MAX_STREAMS];
+bool stream_feedback_pending[MAX_STREAMS] = {};
+std::chrono::steady_clock::time_point last_feedback_sent;
+
+// Junta a entrada de um RECEIVER_REPORT à recepção do fluxo
+void merge_stream_feedback(const StreamFeedback& feedback) {
+    StreamFeedback& merged = stream_feedback[feedback.stream];
+    if (!stream_feedback_pending[feedback.stream]) {
+        merged = feedback;
+        stream_feedback_pending[feedback.stream] = true;
+        return;
+    }
+    merged.loss = std::min(merged.loss, feedback.loss);
+    merged.gradient_ms = std::min(merged.gradient_ms, feedback.gradient_ms);
+    merged.jitter_ms = std::max(merged.jitter_ms, feedback.jitter_ms);
+}
+
+// Envia a SENDER_FEEDBACK de um fluxo a quem fala: um participante local
+// diretamente, um de outro servidor pelo servidor de origem
+void send_sender_feedback(int sock, const StreamFeedback& feedback,
+                          ClientInfo clients[MAX_CLIENTS]) {
+    char packet[1 + FEEDBACK_ENTRY_SIZE];
+    packet[0] = SENDER_FEEDBACK;
+    write_feedback(feedback, packet + 1);
+
+    const int origin = feedback.stream / MAX_CLIENTS;
+    if (origin != trunk.id()) {
+        trunk.send_to_relay(sock, origin, packet, sizeof(packet));
+        return;
+    }
+    const ClientInfo& sender = clients[feedback.stream % MAX_CLIENTS];
+    if (!sender.is_active) return;
+    sendto(sock, packet, sizeof(packet), 0, (const sockaddr*)&sender.address,
+           sender.address_len);
+}
+
+// Uma vez por intervalo, devolve a cada locutor a recepção do seu fluxo
+void flush_sender_feedback(int sock, ClientInfo clients[MAX_CLIENTS],
+                           std::chrono::steady_clock::time_point now) {
+    if (now - last_feedback_sent <
+        std::chrono::milliseconds(FEEDBACK_INTERVAL_MS)) {
+        return;
+    }
+    last_feedback_sent = now;
+    for (int stream = 0; stream < MAX_STREAMS; ++stream) {
+        if (!stream_feedback_pending[stream]) continue;
+        stream_feedback_pending[stream] = false;
+        send_sender_feedback(sock, stream_feedback[stream], clients);
+    }
+}
+
+// Processa o RECEIVER_REPORT de um ouvinte
+void process_receiver_report(std::string_view data, ClientInfo& client,
+                             std::chrono::steady_clock::time_point now) {
+    if (data.size() < RECEIVER_REPORT_HEADER_SIZE - 1) return;
+    uint32_t capacity;
+    std::memcpy(&capacity, data.data(), sizeof(capacity));
+    client.capacity_kbps =
+        static_cast<int>(std::min<uint32_t>(ntohl(capacity), 1u << 30));
+
+    const int count = static_cast<uint8_t>(data[sizeof(capacity)]);
+    std::string_view entries = data.substr(RECEIVER_REPORT_HEADER_SIZE - 1);
+    if (entries.size() < static_cast<size_t>(count) * FEEDBACK_ENTRY_SIZE) {
+        return;
+    }
+
+    // A média entre os locutores estima o trecho servidor -> ouvinte. Não
+    // a menor perda: uma fila cheia no caminho pode descartar sempre o
+    // pacote do mesmo locutor, e a dos outros ficaria zerada.
+    double loss_sum = 0.0;
+    double gradient_sum = 0.0;
+    int streams = 0;
+    for (int i = 0; i < count; ++i) {
+        const StreamFeedback feedback =
+            read_feedback(entries.data() + i * FEEDBACK_ENTRY_SIZE);
+        if (feedback.stream >= MAX_STREAMS) continue;
+        merge_stream_feedback(feedback);
+        loss_sum += feedback.loss;
+        gradient_sum += feedback.gradient_ms;
+        ++streams;
+    }
+    if (streams > 0) {
+        client.estimator.on_report(loss_sum / streams, gradient_sum / streams,
+                                   now);
+    }
+}
+
+// Uma vez por segundo, escolhe a camada de cada ouvinte: a melhor que cabe
+// na banda dele com todos os locutores ativos (menos ele mesmo)
+void update_receiver_layers(ClientInfo clients[MAX_CLIENTS],
+                            std::chrono::steady_clock::time_point now) {
+    if (now - last_layer_update < LAYER_UPDATE_INTERVAL) return;
+    last_layer_update = now;
+
+    int active_streams = 0;
+    for (const auto& last_seen : stream_last_seen) {
+        if (now - last_seen < STREAM_ACTIVE_WINDOW) ++active_streams;
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        ClientInfo& client = clients[i];
+        if (!client.is_active) continue;
+        const bool speaking =
+            now - stream_last_seen[trunk.stream_base() + i] <
+            STREAM_ACTIVE_WINDOW;
+        const int streams = active_streams - (speaking ? 1 : 0);
+
+        // Banda do ouvinte: a menor entre a informada e a estimada pelas
+        // perdas (0 é sem limite)
+        int capacity = client.capacity_kbps;
+        const int estimate = client.estimator.kbps();
+        if (estimate > 0 && (capacity == 0 || estimate < capacity)) {
+            capacity = estimate;
+        }
+        const int layer = choose_layer(capacity, streams, client.layer);
+        if (layer == client.layer) continue;
+
+        log_client(LOG_INFO,
+                   "[simulcast] Camada " + std::to_string(layer) + " (" +
+                       std::to_string(layer_kbps(layer)) + " kbit/s por " +
+                       "locutor, " + std::to_string(streams) +
+                       " locutor(es), banda " + std::to_string(capacity) +
+                       " kbit/s) para",
+                   client.address, client.name);
+        client.layer = layer;
+    }
+
+    // Camadas que o tronco deve trazer dos vizinhos: da melhor à pior entre
+    // os ouvintes daqui. Os consumidores locais querem a melhor, e sem
+    // ninguém ouvindo basta a menor.
+    int first = local_ring.is_open() ? LAYER_PCM48 : LAYER_COUNT;
+    int last = LAYER_PCM48;
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (!clients[i].is_active) continue;
+        first = std::min(first, clients[i].layer);
+        last = std::max(last, clients[i].layer);
+    }
+    if (first == LAYER_COUNT) first = last = LAYER_ULAW8K;
+    trunk.set_wanted_format(layers_format(first, last));
+}
+
+// Imprime (no máximo a cada DROP_REPORT_INTERVAL) quantos pacotes foram
+// descartados pelos limites e de quem
+void report_dropped_packets(ClientInfo clients[MAX_CLIENTS],
+                            std::chrono::steady_clock::time_point now) {
+    if (now - last_drop_report < DROP_REPORT_INTERVAL) return;
+    last_drop_report = now;
+
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (session_drops[i] == 0) continue;
+        log_client(LOG_WARN,
+                   "[limite] " + std::to_string(session_drops[i]) +
+                       " pacotes descartados da sessão",
+                   clients[i].address, clients[i].name);
+        session_drops[i] = 0;
+    }
+    if (source_drops > 0) {
+        log_message(LOG_WARN, "[limite] " + std::to_string(source_drops) +
+                                  " pacotes descartados de origens sem sessão");
+        source_drops = 0;
+    }
+}
+
+// Envia um pacote de áudio ao participante do slot 'slot': pelo caminho
+// AF_XDP, quando ativo e com a rota do cliente conhecida, ou pelo socket UDP
+void send_to_client(int sock, std::string_view packet, int slot,
+                    ClientInfo& client) {
+    if (!xdp_path.send(slot, client.address, packet)) {
+        sendto(sock, packet.data(), packet.size(), 0,
+               (sockaddr*)&client.address, client.address_len);
+    }
+    client.estimator.on_sent(packet.size());
+}
+}  // namespace
 
 // Gerencia o loop principal do servidor
-void server_loop(int sock) {
-    std::cout << "Servidor de áudio iniciado na porta " << PORT
+void server_loop(int sock, int handoff_listener,
+                 ClientInfo clients[MAX_CLIENTS]) {
+    std::cout << "Servidor de áudio iniciado na porta " << relay_port()
               << ". Pressione Enter para encerrar." << std::endl;
 
-    // Vetor para armazenar informações dos clientes
-    ClientInfo clients[2] = {};
-
     // Buffer para receber pacotes de áudio
-    // (O primeiro byte é usado para indicar o tipo de pacote)
-    std::vector<char> buffer(1 + AUDIO_BUFFER_SIZE);
+    // (O primeiro byte é usado para indicar o tipo de pacote). Os
+    // datagramas do tronco, com vários quadros, são os maiores.
+    std::vector<char> buffer(TRUNK_MAX_SIZE);
+
+    // Com o modo de baixa latência, a thread do servidor roda em tempo real
+    realtime_thread("voip-servidor", RT_PRIORITY_NETWORK, 0);
+
+    // Última verificação do socket de troca quando o select() não é usado
+    auto last_handoff_check = std::chrono::steady_clock::now();
 
     // Loop principal do servidor
     while (running) {
-        // fd_set é uma estrutura usada pela função select() para monitorar
-        // sockets
-        fd_set read_fds;
-        FD_ZERO(&read_fds);       // Limpa o conjunto de sockets
-        FD_SET(sock, &read_fds);  // Adiciona o socket do servidor ao conjunto
-
-        // Define o tempo de espera para a função select()
-        // Se nada acontecer em 1 segundo, a função retorna
-        struct timeval tv = {1, 0};
-
-        // Select aguarda atividade no socket do servidor
-        // ou até que o tempo limite expire
-        int activity = select(sock + 1, &read_fds, nullptr, nullptr, &tv);
-
-        // Se houver atividade no socket do servidor
-        if (activity > 0) {
-            // Armazena as informaçÕes de quem enviou o pacote
-            sockaddr_in sender_addr{};
-            socklen_t len = sizeof(sender_addr);
-
-            // Recebe o pacote de áudio do cliente e armazena no buffer
-            ssize_t n = recvfrom(sock, buffer.data(), buffer.size(), 0,
-                                 (sockaddr*)&sender_addr, &len);
-
-            // Se recebeu um pacote envia para a função de tratamento
-            if (n > 0) {
-                std::string_view packet_view(buffer.data(), n);
-                handle_received_packet(sock, packet_view, sender_addr, len,
+        // Com o caminho AF_XDP (xdp_path.h), o áudio chega pelos quadros
+        // da UMEM; o socket recebe só o resto
+        const int xdp_received = xdp_path.receive(
+            [&](std::string_view packet, const sockaddr_in& sender) {
+                handle_received_packet(sock, packet, sender, sizeof(sender),
                                        clients);
+            });
+
+        // Armazena as informaçÕes de quem enviou o pacote
+        sockaddr_in sender_addr{};
+        socklen_t len = sizeof(sender_addr);
+
+        // No modo de baixa latência, gira um pouco esperando o próximo
+        // pacote antes de dormir no select()
+        ssize_t n = xdp_received > 0
+                        ? -1
+                        : spin_recvfrom(sock, buffer.data(), buffer.size(),
+                                        (sockaddr*)&sender_addr, &len);
+        bool handoff_ready = false;
+
+        if (n < 0) {
+            // fd_set é uma estrutura usada pela função select() para
+            // monitorar sockets
+            fd_set read_fds;
+            FD_ZERO(&read_fds);       // Limpa o conjunto de sockets
+            FD_SET(sock, &read_fds);  // Adiciona o socket do servidor
+            if (handoff_listener >= 0) FD_SET(handoff_listener, &read_fds);
+            if (xdp_path.is_open()) FD_SET(xdp_path.fd(), &read_fds);
+            const int max_fd =
+                std::max({sock, handoff_listener, xdp_path.fd()});
+
+            // Define o tempo de espera para a função select()
+            // Se nada acontecer em 1 segundo, a função retorna; com um
+            // datagrama do tronco em montagem, espera só até o prazo dele
+            struct timeval tv = {1, 0};
+            const int flush_ms =
+                trunk.ms_until_flush(std::chrono::steady_clock::now());
+            if (flush_ms >= 0) tv = {0, flush_ms * 1000};
+            // Com quadros AF_XDP ainda na fila, só confere o socket
+            if (xdp_received > 0) tv = {0, 0};
+
+            // Select aguarda atividade no socket do servidor (ou um novo
+            // processo pedindo a troca) ou até que o tempo limite expire
+            int activity = select(max_fd + 1, &read_fds, nullptr, nullptr, &tv);
+
+            // Se houver atividade no socket do servidor, recebe o pacote de
+            // áudio do cliente e armazena no buffer
+            if (activity > 0 && FD_ISSET(sock, &read_fds)) {
+                len = sizeof(sender_addr);
+                n = recvfrom(sock, buffer.data(), buffer.size(), 0,
+                             (sockaddr*)&sender_addr, &len);
             }
+            handoff_ready = activity > 0 && handoff_listener >= 0 &&
+                            FD_ISSET(handoff_listener, &read_fds);
+            last_handoff_check = std::chrono::steady_clock::now();
+        } else if (handoff_listener >= 0 &&
+                   std::chrono::steady_clock::now() - last_handoff_check >
+                       std::chrono::milliseconds(100)) {
+            // Com tráfego contínuo o select() não roda; o listener (não
+            // bloqueante) é verificado algumas vezes por segundo
+            handoff_ready = true;
+            last_handoff_check = std::chrono::steady_clock::now();
+        }
+
+        // Se recebeu um pacote envia para a função de tratamento
+        if (n > 0) {
+            std::string_view packet_view(buffer.data(), n);
+            handle_received_packet(sock, packet_view, sender_addr, len,
+                                   clients);
+        }
+
+        // Um novo processo pediu a troca: entrega o socket e as sessões e
+        // encerra sem avisar os clientes, que nem percebem a troca
+        if (handoff_ready && handoff_send(handoff_listener, sock, clients)) {
+            log_message(LOG_INFO, "[troca] Servidor entregue ao novo processo.");
+            // Solta a interface para o sucessor anexar o programa XDP dele
+            xdp_path.flush();
+            xdp_path.close();
+            handed_off = true;
+            running = false;
+            break;
         }
 
         // Verifica se os clientes estão inativos e desconecta se necessário
         check_client_timeouts(sock, clients);
+
+        // Envia o datagrama do tronco cujo prazo passou, mede a carga (uma
+        // vez por segundo) e relata os descartes
+        const auto now = std::chrono::steady_clock::now();
+        trunk.poll(sock, now);
+        relay_load.sample(sock, now);
+        report_dropped_packets(clients, now);
+        update_receiver_layers(clients, now);
+        flush_sender_feedback(sock, clients, now);
+
+        // Entrega ao kernel, de uma vez, os pacotes montados nesta rodada
+        xdp_path.flush();
     }
 }
 
@@ -72,33 +463,63 @@ bool are_addresses_equal(const sockaddr_in& addr1, const sockaddr_in& addr2) {
            addr1.sin_port == addr2.sin_port;
 }
 
+// Encontra o slot da sessão com o endereço dado (-1 se não houver)
+int find_client(const sockaddr_in& address, ClientInfo clients[MAX_CLIENTS]) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients[i].is_active &&
+            are_addresses_equal(clients[i].address, address)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 // Função para notificar todos os clientes
-void broadcast_server_message(int sock, const std::string& message,
-                              ClientInfo clients[2],
-                              int exclude_client_index = -1) {
-    // Declara um pacote de mensagem do servidor
-    std::vector<char> msg_packet;
-    msg_packet.reserve(1 + message.size());
-    msg_packet.push_back(SERVER_MESSAGE);  // Tipo de pacote
+void broadcast_server_message(int sock, std::string_view message,
+                              ClientInfo clients[MAX_CLIENTS],
+                              int exclude_client_index) {
+    // Declara um pacote de mensagem do servidor, num bloco do frame_pool
+    FrameRef msg_packet = frame_pool.allocate();
+    msg_packet.append(SERVER_MESSAGE);  // Tipo de pacote
     // Insere a mensagem no pacote, a partir do segundo byte
-    msg_packet.insert(msg_packet.end(), message.begin(), message.end());
+    msg_packet.append(message);
 
     // Envia a mensagem para todos os clientes, exceto o cliente excluído
-    for (int i = 0; i < 2; ++i) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
         if (i != exclude_client_index && clients[i].is_active) {
             sendto(sock, msg_packet.data(), msg_packet.size(), 0,
                    (sockaddr*)&clients[i].address, clients[i].address_len);
         }
     }
+
+    // Os consumidores locais também recebem as entradas e saídas
+    local_ring.publish(msg_packet.data(), msg_packet.size());
 }
 
 // Lida com uma tentativa de conexão de um novo cliente
 void process_login(int sock, std::string_view name,
                    const sockaddr_in& sender_addr, socklen_t sender_len,
-                   ClientInfo clients[2]) {
+                   ClientInfo clients[MAX_CLIENTS]) {
+    // Controle de admissão: com a thread do servidor sobrecarregada, uma
+    // nova chamada pioraria todas as outras; o login é recusado
+    if (relay_load.overloaded()) {
+        const char server_busy_packet = SERVER_BUSY;
+        sendto(sock, &server_busy_packet, sizeof(server_busy_packet), 0,
+               (sockaddr*)&sender_addr, sender_len);
+        log_client(
+            LOG_WARN,
+            "Tentativa de conexão rejeitada (servidor sobrecarregado, CPU " +
+                std::to_string(static_cast<int>(relay_load.cpu_percent())) +
+                "%, fila " +
+                std::to_string(static_cast<int>(relay_load.queue_percent())) +
+                "%):",
+            sender_addr, name);
+        return;
+    }
+
     // Verifica se há slot disponível e atribui o slot livre ao novo cliente
     int free_slot = -1;
-    for (int i = 0; i < 2; ++i) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
         if (!clients[i].is_active) {
             free_slot = i;
             break;
@@ -111,30 +532,43 @@ void process_login(int sock, std::string_view name,
         clients[free_slot].address_len = sender_len;
         clients[free_slot].name = name;
         clients[free_slot].last_packet_time = std::chrono::steady_clock::now();
+        clients[free_slot].packet_bucket.reset();
+        clients[free_slot].capacity_kbps = 0;
+        clients[free_slot].layer = LAYER_PCM48;
+        clients[free_slot].estimator.reset();
+        clients[free_slot].session_token =
+            session_tokens.issue(trunk.stream_base() + free_slot);
         clients[free_slot].is_active = true;
+        session_drops[free_slot] = 0;
 
-        print_client_info("Cliente conectado:", sender_addr, std::string(name));
+        log_client(LOG_INFO, "Cliente conectado:", sender_addr, name);
 
-        // Envia um pacote de confirmação de login para o novo cliente
-        const char login_ok_packet = LOGIN_OK;
-        sendto(sock, &login_ok_packet, sizeof(login_ok_packet), 0,
-               (sockaddr*)&sender_addr, sender_len);
+        // Envia um pacote de confirmação de login para o novo cliente, com
+        // o identificador do fluxo e o token da sessão
+        const int stream = trunk.stream_base() + free_slot;
+        send_login_ok(sock, free_slot, clients[free_slot]);
 
         // Envia uma mensagem para todos os clientes informando sobre a nova
         // conexão
-        std::string join_msg =
-            "[SERVER] '" + std::string(name) + "' entrou na chamada.";
-        broadcast_server_message(sock, join_msg, clients, free_slot);
+        const FrameRef join_msg =
+            compose_message({"[SERVER] '", name, "' entrou na chamada (fluxo ",
+                             std::to_string(stream), ")."});
+        broadcast_server_message(sock, join_msg.view(), clients, free_slot);
 
         // Envia para o novo cliente que conectou quem está na chamada
-        int other_client_idx = 1 - free_slot;
-        if (clients[other_client_idx].is_active) {
-            std::string current_user_msg =
-                "[SERVER] Na chamada: '" + clients[other_client_idx].name + "'";
-            std::vector<char> msg_packet;
-            msg_packet.push_back(SERVER_MESSAGE);
-            msg_packet.insert(msg_packet.end(), current_user_msg.begin(),
-                              current_user_msg.end());
+        FrameRef msg_packet = frame_pool.allocate();
+        msg_packet.append(SERVER_MESSAGE);
+        for (int i = 0; i < MAX_CLIENTS; ++i) {
+            if (i == free_slot || !clients[i].is_active) continue;
+            msg_packet.append(msg_packet.size() == 1 ? "[SERVER] Na chamada: "
+                                                     : ", ");
+            msg_packet.append("'");
+            msg_packet.append(clients[i].name);
+            msg_packet.append("' (fluxo ");
+            msg_packet.append(std::to_string(trunk.stream_base() + i));
+            msg_packet.append(")");
+        }
+        if (msg_packet.size() > 1) {
             sendto(sock, msg_packet.data(), msg_packet.size(), 0,
                    (sockaddr*)&sender_addr, sender_len);
         }
@@ -144,49 +578,128 @@ void process_login(int sock, std::string_view name,
         const char server_full_packet = SERVER_FULL;
         sendto(sock, &server_full_packet, sizeof(server_full_packet), 0,
                (sockaddr*)&sender_addr, sender_len);
-        print_client_info("Tentativa de conexão rejeitada (servidor cheio):",
-                          sender_addr, std::string(name));
+        log_client(LOG_WARN, "Tentativa de conexão rejeitada (servidor cheio):",
+                   sender_addr, name);
     }
 }
 
-// Processa um pacote de áudio
+// Processa um pacote de áudio da sessão 'sender_idx'
 void process_audio_data(int sock, std::string_view audio_packet,
-                        const sockaddr_in& sender_addr, ClientInfo clients[2]) {
-    // Encontra o índice do cliente que enviou o pacote de áudio
-    int sender_idx = -1;
-    for (int i = 0; i < 2; ++i) {
-        if (clients[i].is_active &&
-            are_addresses_equal(clients[i].address, sender_addr)) {
-            sender_idx = i;
-            break;
-        }
+                        int sender_idx, ClientInfo clients[MAX_CLIENTS]) {
+    // O identificador do fluxo e o token no final do pacote têm que ser os
+    // do emissor, recebidos no LOGIN_OK; assim um cliente não consegue se
+    // passar por outro. Pacotes sem o token (ou com o de outra sessão) são
+    // descartados.
+    const int stream = trunk.stream_base() + sender_idx;
+    if (!has_session_token(audio_packet, clients[sender_idx]) ||
+        static_cast<uint8_t>(audio_packet[1]) != stream) {
+        return;
     }
+    audio_packet.remove_suffix(SESSION_TOKEN_SIZE);
+    AudioLayout layout;
+    if (!read_audio_layout(audio_packet, layout)) return;
 
-    // O pacote veio de um cliente desconhecido ou inativo
-    if (sender_idx == -1) return;
+    // Pacote aceito para a sessão: se veio pelo caminho AF_XDP, a rota de
+    // volta ao cliente passa a ser a dele
+    xdp_path.learn_route(sender_idx);
 
     // Atualiza o tempo do último pacote recebido do cliente
-    clients[sender_idx].last_packet_time = std::chrono::steady_clock::now();
+    const auto now = std::chrono::steady_clock::now();
+    clients[sender_idx].last_packet_time = now;
+    stream_last_seen[stream] = now;
+
+    // Timestamp de mídia do quadro, usado no rastreamento de latência
+    uint32_t timestamp = 0;
+    if (trace_enabled) {
+        std::memcpy(&timestamp, audio_packet.data() + AUDIO_TIMESTAMP_OFFSET,
+                    sizeof(timestamp));
+        timestamp = ntohl(timestamp);
+        trace_frames(TRACE_RELAY_RECEIVE, stream, timestamp, layout.frames);
+    }
+
+    // Retransmite o pacote de áudio para todos os outros clientes ativos,
+    // cada um na sua camada
+    bool forwarded = false;
+    uint32_t active_slots = 0;
+    LayerPackets layers;
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (!clients[i].is_active) continue;
+        active_slots |= 1u << i;
+        if (i == sender_idx) continue;
+        const std::string_view packet =
+            layer_packet(audio_packet, layout, clients[i].layer, layers);
+        send_to_client(sock, packet, i, clients[i]);
+        forwarded = true;
+    }
 
-    // Encontra o índice do outro cliente para retransmitir o áudio
-    int receiver_idx = 1 - sender_idx;
+    // Publica para os consumidores locais (uma cópia, qualquer que seja o
+    // número deles) o pacote completo, com todas as camadas
+    local_ring.publish(audio_packet.data(), audio_packet.size());
 
-    // Se o outro cliente está ativo, retransmite o pacote de áudio
-    if (clients[receiver_idx].is_active) {
-        sendto(sock, audio_packet.data(), audio_packet.size(), 0,
-               (sockaddr*)&clients[receiver_idx].address,
-               clients[receiver_idx].address_len);
+    // No tronco ele segue só com as camadas que os vizinhos pedem,
+    // agrupado com os quadros dos outros participantes locais
+    trunk.add_frame(sock, sender_idx, audio_packet, layout, active_slots, now);
+
+    // Sozinho na chamada: responde com um ping para manter a conexão ativa
+    if (forwarded) {
+        trace_frames(TRACE_RELAY_FORWARD, stream, timestamp, layout.frames);
     } else {
         char pong_packet = KEEPALIVE_PONG;
         sendto(sock, &pong_packet, sizeof(pong_packet), 0,
-               (sockaddr*)&sender_addr, sizeof(sender_addr));
+               (sockaddr*)&clients[sender_idx].address,
+               clients[sender_idx].address_len);
+    }
+}
+
+// Processa um datagrama do tronco de outro servidor: separa os quadros em
+// pacotes AUDIO_DATA e repassa aos participantes locais
+void process_trunk_data(int sock, std::string_view datagram,
+                        ClientInfo clients[MAX_CLIENTS]) {
+    if (datagram.size() < TRUNK_HEADER_SIZE) return;
+
+    // Cada servidor só envia fluxos do próprio bloco
+    const int origin = static_cast<uint8_t>(datagram[1]);
+    if (origin >= MAX_RELAYS || origin == trunk.id()) return;
+
+    char packet[MAX_PACKET_SIZE];
+    std::string_view rest = datagram.substr(TRUNK_HEADER_SIZE);
+    TrunkFrame frame;
+    while (read_trunk_frame(rest, frame)) {
+        if (frame.stream / MAX_CLIENTS != origin ||
+            frame.payload.size() > MAX_AUDIO_PAYLOAD) {
+            break;
+        }
+
+        // Remonta o pacote como o participante de origem o enviou
+        packet[0] = AUDIO_DATA;
+        packet[1] = static_cast<char>(frame.stream);
+        packet[AUDIO_LAYER_OFFSET] = static_cast<char>(frame.layer);
+        const uint32_t timestamp = htonl(frame.timestamp);
+        std::memcpy(packet + AUDIO_TIMESTAMP_OFFSET, &timestamp,
+                    sizeof(timestamp));
+        std::memcpy(packet + AUDIO_HEADER_SIZE, frame.payload.data(),
+                    frame.payload.size());
+        const std::string_view audio_packet(
+            packet, AUDIO_HEADER_SIZE + frame.payload.size());
+        AudioLayout layout;
+        if (!read_audio_layout(audio_packet, layout)) break;
+        stream_last_seen[frame.stream] = std::chrono::steady_clock::now();
+
+        LayerPackets layers;
+        for (int i = 0; i < MAX_CLIENTS; ++i) {
+            if (!clients[i].is_active) continue;
+            const std::string_view client_packet =
+                layer_packet(audio_packet, layout, clients[i].layer, layers);
+            send_to_client(sock, client_packet, i, clients[i]);
+        }
+        local_ring.publish(audio_packet.data(), audio_packet.size());
     }
 }
 
 // Lida com pacotes recebidos e retransmite para os clientes conectados
 void handle_received_packet(int sock, const std::string_view& buffer,
                             const sockaddr_in& sender_addr,
-                            socklen_t sender_len, ClientInfo clients[2]) {
+                            socklen_t sender_len, ClientInfo clients[MAX_CLIENTS]) {
     // Pacote vazio ou inválido
     if (buffer.size() < 1) {
         return;
@@ -196,44 +709,146 @@ void handle_received_packet(int sock, const std::string_view& buffer,
     PacketType type = static_cast<PacketType>(buffer[0]);
     std::string_view data(buffer.data() + 1, buffer.size() - 1);
 
+    // Descarte antes de qualquer processamento. Pacotes de uma sessão gastam
+    // o balde da sessão; de quem não tem sessão, só login e descoberta são
+    // aceitos, limitados por IP de origem. Quem passar do limite perde os
+    // próprios pacotes sem atrasar as outras chamadas.
+    const auto now = std::chrono::steady_clock::now();
+
+    // O tronco só é aceito dos servidores em VOIP_PEERS, com a marca da
+    // chave do tronco (conferida antes do balde do vizinho, que um
+    // endereço forjado não pode gastar)
+    if (type == TRUNK_DATA) {
+        const int peer = trunk.find_peer(sender_addr);
+        std::string_view datagram = buffer;
+        if (peer < 0 || !trunk.verify(datagram) || !trunk.accept(peer, now)) {
+            ++source_drops;
+            return;
+        }
+        if (datagram.size() >= TRUNK_HEADER_SIZE) {
+            trunk.learn_relay(peer, static_cast<uint8_t>(datagram[1]),
+                              static_cast<uint8_t>(datagram[3]));
+        }
+        process_trunk_data(sock, datagram, clients);
+        return;
+    }
+
+    // Recepção de um fluxo local medida nos ouvintes de outro servidor
+    if (type == SENDER_FEEDBACK) {
+        const int peer = trunk.find_peer(sender_addr);
+        std::string_view datagram = buffer;
+        if (peer < 0 || !trunk.verify(datagram) || !trunk.accept(peer, now) ||
+            datagram.size() < 1 + FEEDBACK_ENTRY_SIZE) {
+            ++source_drops;
+            return;
+        }
+        const StreamFeedback feedback = read_feedback(datagram.data() + 1);
+        if (feedback.stream / MAX_CLIENTS == trunk.id()) {
+            send_sender_feedback(sock, feedback, clients);
+        }
+        return;
+    }
+
+    int sender_idx = find_client(sender_addr, clients);
+    if (sender_idx < 0 && type == AUDIO_DATA) {
+        sender_idx = resume_session(buffer, sender_addr, sender_len, clients);
+    }
+    if (sender_idx >= 0) {
+        if (!clients[sender_idx].packet_bucket.consume(now)) {
+            ++session_drops[sender_idx];
+            return;
+        }
+    } else if (type == LOGIN_WITH_COOKIE) {
+        // O cookie prova que o endereço de origem é de quem o recebeu;
+        // o login não depende dos baldes por IP, que uma inundação com
+        // endereços forjados pode ter esvaziado
+        if (data.size() <= LOGIN_COOKIE_SIZE ||
+            !login_cookies.check(read_session_token(data.data()),
+                                 sender_addr.sin_addr.s_addr,
+                                 sender_addr.sin_port, now)) {
+            ++source_drops;
+            return;
+        }
+        data.remove_prefix(LOGIN_COOKIE_SIZE);
+        type = LOGIN_REQUEST;
+    } else if ((type != LOGIN_REQUEST && type != DISCOVERY_REQUEST) ||
+               !source_limiter.consume(sender_addr.sin_addr.s_addr, now)) {
+        // Login recusado pelo balde: responde com o cookie, sem guardar
+        // nada. A resposta tem no máximo LOGIN_COOKIE_SIZE bytes a mais que
+        // o pedido.
+        if (type == LOGIN_REQUEST) {
+            char cookie_packet[1 + LOGIN_COOKIE_SIZE] = {LOGIN_COOKIE};
+            write_session_token(
+                login_cookies.issue(sender_addr.sin_addr.s_addr,
+                                    sender_addr.sin_port, now),
+                cookie_packet + 1);
+            sendto(sock, cookie_packet, sizeof(cookie_packet), 0,
+                   (sockaddr*)&sender_addr, sender_len);
+        }
+        ++source_drops;
+        return;
+    }
+
     // Com base no tipo de pacote, processa a ação correspondente
     switch (type) {
         // Pacote de solicitação de login
         case LOGIN_REQUEST:
-            if (!data.empty() && data.size() <= MAX_NAME_LENGTH) {
+            if (sender_idx >= 0) {
+                // Login repetido (a confirmação se perdeu): reenvia o
+                // LOGIN_OK em vez de ocupar um segundo slot
+                send_login_ok(sock, sender_idx, clients[sender_idx]);
+            } else if (!data.empty() && data.size() <= MAX_NAME_LENGTH) {
                 process_login(sock, data, sender_addr, sender_len, clients);
             }
             break;
+        // Login com cookie repetido depois de a sessão já existir
+        case LOGIN_WITH_COOKIE:
+            if (sender_idx >= 0) {
+                send_login_ok(sock, sender_idx, clients[sender_idx]);
+            }
+            break;
         // Pacote de áudio
         case AUDIO_DATA:
-            process_audio_data(sock, buffer, sender_addr, clients);
+            if (sender_idx >= 0) {
+                process_audio_data(sock, buffer, sender_idx, clients);
+            }
+            break;
+        // Banda e recepção do ouvinte (congestion.h)
+        case RECEIVER_REPORT:
+            if (sender_idx >= 0) {
+                process_receiver_report(data, clients[sender_idx], now);
+            }
             break;
         // Pacote de descobrimento
         case DISCOVERY_REQUEST: {
-            std::cout << "Recebido pedido de descoberta de ";
-            print_client_info("", sender_addr);
-
-            char response_packet = DISCOVERY_RESPONSE;
-            sendto(sock, &response_packet, sizeof(response_packet), 0,
+            // A resposta tem o mesmo tamanho do pedido: o servidor não
+            // amplifica pedidos com endereço de origem forjado
+            if (data.size() != DISCOVERY_NONCE_SIZE) break;
+
+            log_client(LOG_DEBUG, "Recebido pedido de descoberta de",
+                       sender_addr);
+
+            // Devolve o identificador do pedido, que o cliente usa para
+            // reconhecer a resposta e medir o RTT
+            char response_packet[1 + DISCOVERY_NONCE_SIZE] = {
+                DISCOVERY_RESPONSE};
+            std::memcpy(response_packet + 1, data.data(), DISCOVERY_NONCE_SIZE);
+            sendto(sock, response_packet, sizeof(response_packet), 0,
                    (sockaddr*)&sender_addr, sender_len);
             break;
         }
         // Pacote de logout
         case LOGOUT_NOTICE: {
-            for (int i = 0; i < 2; ++i) {
-                if (clients[i].is_active &&
-                    are_addresses_equal(clients[i].address, sender_addr)) {
-                    print_client_info("Cliente desconectado (logout):",
-                                      clients[i].address, clients[i].name);
-
-                    std::string leave_msg =
-                        "[SERVER] '" + clients[i].name + "' saiu da chamada.";
-                    clients[i].is_active = false;
-
-                    broadcast_server_message(sock, leave_msg, clients);
-                    break;
-                }
-            }
+            if (sender_idx < 0) break;
+            ClientInfo& client = clients[sender_idx];
+            log_client(LOG_INFO, "Cliente desconectado (logout):",
+                       client.address, client.name);
+
+            const FrameRef leave_msg = compose_message(
+                {"[SERVER] '", client.name, "' saiu da chamada."});
+            client.is_active = false;
+
+            broadcast_server_message(sock, leave_msg.view(), clients);
             break;
         }
         default:
@@ -242,32 +857,19 @@ void handle_received_packet(int sock, const std::string_view& buffer,
 }
 
 // Verifica se o cliente está inativo e desconecta se necessário
-void check_client_timeouts(int sock, ClientInfo clients[2]) {
+void check_client_timeouts(int sock, ClientInfo clients[MAX_CLIENTS]) {
     auto now = std::chrono::steady_clock::now();
-    for (int i = 0; i < 2; ++i) {
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
         if (clients[i].is_active) {
             if (now - clients[i].last_packet_time >
                 std::chrono::seconds(CLIENT_TIMEOUT_SEC)) {
-                print_client_info("Cliente desconectado por inatividade:",
-                                  clients[i].address, clients[i].name);
-                std::string leave_msg =
-                    "[SERVER] '" + clients[i].name + "' saiu da chamada.";
+                log_client(LOG_INFO, "Cliente desconectado por inatividade:",
+                           clients[i].address, clients[i].name);
+                const FrameRef leave_msg = compose_message(
+                    {"[SERVER] '", clients[i].name, "' saiu da chamada."});
                 clients[i].is_active = false;
-                broadcast_server_message(sock, leave_msg, clients);
+                broadcast_server_message(sock, leave_msg.view(), clients);
             }
         }
     }
 }
-
-// Imprime informações do cliente
-void print_client_info(const std::string& message,
-                       const sockaddr_in& client_addr,
-                       const std::string& name) {
-    char ip_str[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &client_addr.sin_addr, ip_str, INET_ADDRSTRLEN);
-    std::cout << message << " " << ip_str << ":" << ntohs(client_addr.sin_port);
-    if (!name.empty()) {
-        std::cout << " (Nome: " << name << ")";
-    }
-    std::cout << std::endl;
-}
\ No newline at end of file
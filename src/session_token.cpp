@@ -0,0 +1,102 @@
+#include "session_token.h"
+
+#include <cstring>
+#include <random>
+
+namespace {
+uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Lê 8 bytes little-endian, como na especificação do SipHash
+uint64_t load_le64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) value = (value << 8) | in[i];
+    return value;
+}
+
+// Uma rodada do SipHash sobre o estado v0..v3
+void sip_round(uint64_t v[4]) {
+    v[0] += v[1];
+    v[1] = rotate_left(v[1], 13);
+    v[1] ^= v[0];
+    v[0] = rotate_left(v[0], 32);
+    v[2] += v[3];
+    v[3] = rotate_left(v[3], 16);
+    v[3] ^= v[2];
+    v[0] += v[3];
+    v[3] = rotate_left(v[3], 21);
+    v[3] ^= v[0];
+    v[2] += v[1];
+    v[1] = rotate_left(v[1], 17);
+    v[1] ^= v[2];
+    v[2] = rotate_left(v[2], 32);
+}
+}  // namespace
+
+uint64_t siphash24(const uint8_t key[16], const void* data, size_t size) {
+    const uint64_t k0 = load_le64(key);
+    const uint64_t k1 = load_le64(key + 8);
+    uint64_t v[4] = {k0 ^ 0x736f6d6570736575ULL, k1 ^ 0x646f72616e646f6dULL,
+                     k0 ^ 0x6c7967656e657261ULL, k1 ^ 0x7465646279746573ULL};
+
+    // Blocos de 8 bytes: duas rodadas de compressão cada
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    const size_t full = size - size % 8;
+    for (size_t i = 0; i < full; i += 8) {
+        const uint64_t m = load_le64(bytes + i);
+        v[3] ^= m;
+        sip_round(v);
+        sip_round(v);
+        v[0] ^= m;
+    }
+
+    // Último bloco: os bytes restantes e o tamanho no byte mais alto
+    uint64_t last = static_cast<uint64_t>(size) << 56;
+    for (size_t i = 0; i < size % 8; ++i) {
+        last |= static_cast<uint64_t>(bytes[full + i]) << (8 * i);
+    }
+    v[3] ^= last;
+    sip_round(v);
+    sip_round(v);
+    v[0] ^= last;
+
+    // Finalização: quatro rodadas
+    v[2] ^= 0xff;
+    for (int i = 0; i < 4; ++i) sip_round(v);
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+SessionTokenIssuer::SessionTokenIssuer() {
+    std::random_device random;
+    for (int i = 0; i < 16; i += 4) {
+        const uint32_t word = random();
+        std::memcpy(key + i, &word, sizeof(word));
+    }
+}
+
+uint64_t SessionTokenIssuer::issue(int stream) {
+    // Mensagem: fluxo (1 byte) e contador de logins (8 bytes)
+    uint8_t message[9];
+    message[0] = static_cast<uint8_t>(stream);
+    ++counter;
+    for (int i = 0; i < 8; ++i) {
+        message[1 + i] = static_cast<uint8_t>(counter >> (8 * i));
+    }
+    const uint64_t token = siphash24(key, message, sizeof(message));
+    return token ? token : 1;
+}
+
+void write_session_token(uint64_t token, char* out) {
+    for (int i = 0; i < SESSION_TOKEN_SIZE; ++i) {
+        out[i] = static_cast<char>(token >> (8 * (SESSION_TOKEN_SIZE - 1 - i)));
+    }
+}
+
+uint64_t read_session_token(const char* in) {
+    uint64_t token = 0;
+    for (int i = 0; i < SESSION_TOKEN_SIZE; ++i) {
+        token = (token << 8) | static_cast<uint8_t>(in[i]);
+    }
+    return token;
+}
@@ -0,0 +1,242 @@
+#include "shm_ring.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <grp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+namespace {
+// Tamanho total da memória compartilhada
+constexpr size_t SHM_RING_BYTES =
+    sizeof(ShmRingHeader) + sizeof(ShmSlot) * SHM_RING_SLOTS;
+
+// Posição do anel onde fica o pacote de número 'sequence'
+inline size_t slot_index(uint64_t sequence) {
+    return static_cast<size_t>(sequence % SHM_RING_SLOTS);
+}
+}  // namespace
+
+#ifndef _WIN32
+
+namespace {
+// O anel leva o áudio de todas as chamadas: só o usuário do servidor o lê,
+// a menos que VOIP_SHM_GROUP indique um grupo (nome ou número) cujos
+// membros também podem lê-lo, como o usuário de um gravador. Retorna false
+// se o grupo não existir ou não puder ser atribuído.
+bool restrict_ring_access(int fd) {
+    const char* group = std::getenv("VOIP_SHM_GROUP");
+    if (!group || !*group) return fchmod(fd, 0600) == 0;
+
+    char* end = nullptr;
+    gid_t gid = static_cast<gid_t>(std::strtoul(group, &end, 10));
+    if (end == group || *end) {
+        const struct group* entry = getgrnam(group);
+        if (!entry) {
+            std::cerr << "Grupo de VOIP_SHM_GROUP não encontrado: " << group
+                      << std::endl;
+            return false;
+        }
+        gid = entry->gr_gid;
+    }
+    if (fchown(fd, static_cast<uid_t>(-1), gid) < 0) {
+        perror("Erro ao atribuir o grupo da memória compartilhada");
+        return false;
+    }
+    return fchmod(fd, 0640) == 0;
+}
+}  // namespace
+
+bool ShmRingWriter::create(const std::string& ring_name) {
+    close();
+
+    // Um anel antigo com o mesmo nome (de um servidor anterior) continua
+    // existindo para quem ainda o mapeia, mas novos consumidores abrem este
+    shm_unlink(ring_name.c_str());
+    int fd = shm_open(ring_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        perror("Erro ao criar a memória compartilhada");
+        return false;
+    }
+    if (!restrict_ring_access(fd)) {
+        ::close(fd);
+        shm_unlink(ring_name.c_str());
+        return false;
+    }
+    if (ftruncate(fd, SHM_RING_BYTES) < 0) {
+        perror("Erro ao dimensionar a memória compartilhada");
+        ::close(fd);
+        shm_unlink(ring_name.c_str());
+        return false;
+    }
+    void* memory =
+        mmap(nullptr, SHM_RING_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        perror("Erro ao mapear a memória compartilhada");
+        shm_unlink(ring_name.c_str());
+        return false;
+    }
+
+    // A memória nova vem zerada: todas as sequências começam em 0 (vazias)
+    header = new (memory) ShmRingHeader{};
+    slots = reinterpret_cast<ShmSlot*>(static_cast<char*>(memory) +
+                                       sizeof(ShmRingHeader));
+    header->slot_count = SHM_RING_SLOTS;
+    header->slot_size = sizeof(ShmSlot);
+    header->version = SHM_RING_VERSION;
+    name = ring_name;
+    next = 0;
+    // O magic por último: um consumidor só aceita o anel já preenchido
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SHM_RING_MAGIC;
+    return true;
+}
+
+void ShmRingWriter::publish(const char* data, size_t length) {
+    if (!header) return;
+    length = std::min<size_t>(length, MAX_PACKET_SIZE);
+
+    // Sequência ímpar enquanto escreve, par (2n + 2) quando completo
+    ShmSlot& slot = slots[slot_index(next)];
+    slot.sequence.store(2 * next + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(slot.data, data, length);
+    slot.length = static_cast<uint32_t>(length);
+    slot.sequence.store(2 * next + 2, std::memory_order_release);
+
+    ++next;
+    header->next_sequence.store(next, std::memory_order_release);
+}
+
+void ShmRingWriter::close(bool remove) {
+    if (!header) return;
+    header->closed.store(1, std::memory_order_release);
+    munmap(header, SHM_RING_BYTES);
+    if (remove) shm_unlink(name.c_str());
+    header = nullptr;
+    slots = nullptr;
+}
+
+bool ShmRingReader::open(const std::string& ring_name, bool from_oldest) {
+    close();
+
+    int fd = shm_open(ring_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        perror("Erro ao abrir a memória compartilhada");
+        return false;
+    }
+    void* memory = mmap(nullptr, SHM_RING_BYTES, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        perror("Erro ao mapear a memória compartilhada");
+        return false;
+    }
+
+    const auto* mapped = static_cast<const ShmRingHeader*>(memory);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (mapped->magic != SHM_RING_MAGIC ||
+        mapped->version != SHM_RING_VERSION ||
+        mapped->slot_count != SHM_RING_SLOTS ||
+        mapped->slot_size != sizeof(ShmSlot)) {
+        std::cerr << "Anel de memória compartilhada incompatível: "
+                  << ring_name << std::endl;
+        munmap(memory, SHM_RING_BYTES);
+        return false;
+    }
+
+    // Um anel já fechado é o do servidor anterior, que ainda não foi
+    // substituído pelo nome: quem reabre tenta de novo mais tarde
+    if (mapped->closed.load(std::memory_order_acquire)) {
+        munmap(memory, SHM_RING_BYTES);
+        return false;
+    }
+
+    header = mapped;
+    slots = reinterpret_cast<const ShmSlot*>(
+        static_cast<const char*>(memory) + sizeof(ShmRingHeader));
+    const uint64_t head = header->next_sequence.load(std::memory_order_acquire);
+    cursor = head;
+    if (from_oldest) {
+        cursor = head > SHM_RING_SLOTS ? head - SHM_RING_SLOTS : 0;
+        lost += cursor;
+    }
+    return true;
+}
+
+int ShmRingReader::read(char* out, size_t capacity) {
+    if (!header) return -1;
+
+    while (true) {
+        const ShmSlot& slot = slots[slot_index(cursor)];
+        const uint64_t expected = 2 * cursor + 2;
+        const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+
+        if (before < expected) {
+            // Nada novo. O anel só é dado como fechado depois de lido todo.
+            return header->closed.load(std::memory_order_acquire) ? -1 : 0;
+        }
+
+        if (before == expected) {
+            const size_t length =
+                std::min<size_t>({slot.length, capacity, MAX_PACKET_SIZE});
+            std::memcpy(out, slot.data, length);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // Se a sequência mudou durante a cópia o servidor já escreveu
+            // outro pacote por cima, e a cópia não vale
+            if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+                ++cursor;
+                return static_cast<int>(length);
+            }
+        }
+
+        // Ultrapassado pelo servidor: pula para meio anel atrás do pacote
+        // mais recente, para ter folga antes de ser ultrapassado de novo
+        const uint64_t head =
+            header->next_sequence.load(std::memory_order_acquire);
+        const uint64_t resume =
+            head > SHM_RING_SLOTS / 2 ? head - SHM_RING_SLOTS / 2 : 0;
+        lost += resume > cursor ? resume - cursor : 1;
+        cursor = std::max(resume, cursor + 1);
+    }
+}
+
+void ShmRingReader::close() {
+    if (!header) return;
+    munmap(const_cast<ShmRingHeader*>(header), SHM_RING_BYTES);
+    header = nullptr;
+    slots = nullptr;
+}
+
+#else
+
+bool ShmRingWriter::create(const std::string&) {
+    std::cerr << "A memória compartilhada não está disponível no Windows."
+              << std::endl;
+    return false;
+}
+
+void ShmRingWriter::publish(const char*, size_t) {}
+
+void ShmRingWriter::close(bool) {}
+
+bool ShmRingReader::open(const std::string&, bool) {
+    std::cerr << "A memória compartilhada não está disponível no Windows."
+              << std::endl;
+    return false;
+}
+
+int ShmRingReader::read(char*, size_t) { return -1; }
+
+void ShmRingReader::close() {}
+
+#endif
@@ -0,0 +1,215 @@
+#include "simulcast.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+// Amostras de um quadro em cada camada
+constexpr int FRAMES_16K = FRAMES_PER_BUFFER / 3;
+constexpr int FRAMES_8K = FRAMES_PER_BUFFER / 6;
+
+// Posição de cada camada no áudio de um pacote LAYER_SIMULCAST
+constexpr int LAYER_OFFSET[LAYER_COUNT] = {
+    0, LAYER_BYTES[LAYER_PCM48],
+    LAYER_BYTES[LAYER_PCM48] + LAYER_BYTES[LAYER_PCM16K]};
+
+// Parâmetros do µ-law: deslocamento somado antes do logaritmo e o maior
+// valor representável
+constexpr int ULAW_BIAS = 0x84;
+constexpr int ULAW_CLIP = 32635;
+
+void pcm_to_float(const char* in, float* out, int count) {
+    for (int i = 0; i < count; ++i) {
+        int16_t sample;
+        std::memcpy(&sample, in + i * SAMPLE_SIZE, sizeof(sample));
+        out[i] = sample * (1.0f / 32768.0f);
+    }
+}
+
+void float_to_pcm(const float* in, char* out, int count) {
+    for (int i = 0; i < count; ++i) {
+        const float scaled = std::clamp(in[i] * 32768.0f, -32768.0f, 32767.0f);
+        const int16_t sample = static_cast<int16_t>(std::lrint(scaled));
+        std::memcpy(out + i * SAMPLE_SIZE, &sample, sizeof(sample));
+    }
+}
+}  // namespace
+
+bool format_layers(int format, int& first, int& last) {
+    if (format < LAYER_COUNT) {
+        first = last = format;
+        return true;
+    }
+    if (format != LAYER_SIMULCAST && format != LAYER_SIMULCAST_16K) {
+        return false;
+    }
+    first = format == LAYER_SIMULCAST ? LAYER_PCM48 : LAYER_PCM16K;
+    last = LAYER_ULAW8K;
+    return true;
+}
+
+int layers_format(int first, int last) {
+    if (first == last) return first;
+    return first == LAYER_PCM16K ? LAYER_SIMULCAST_16K : LAYER_SIMULCAST;
+}
+
+uint8_t ulaw_encode(int16_t sample) {
+    int value = sample;
+    const int sign = value < 0 ? 0x80 : 0;
+    if (sign) value = -value;
+    value = std::min(value, ULAW_CLIP) + ULAW_BIAS;
+
+    // Segmento: posição do bit mais alto acima do bit 7
+    int exponent = 7;
+    for (int mask = 0x4000; (value & mask) == 0 && exponent > 0; mask >>= 1) {
+        --exponent;
+    }
+    const int mantissa = (value >> (exponent + 3)) & 0x0F;
+    return static_cast<uint8_t>(~(sign | (exponent << 4) | mantissa));
+}
+
+int16_t ulaw_decode(uint8_t code) {
+    code = static_cast<uint8_t>(~code);
+    const int exponent = (code >> 4) & 0x07;
+    const int mantissa = code & 0x0F;
+    const int value = (((mantissa << 3) + ULAW_BIAS) << exponent) - ULAW_BIAS;
+    return static_cast<int16_t>((code & 0x80) ? -value : value);
+}
+
+bool parse_audio_layout(int format, size_t payload_size, AudioLayout& layout) {
+    if (!format_layers(format, layout.first_layer, layout.last_layer)) {
+        return false;
+    }
+
+    layout.frame_bytes = 0;
+    for (int layer = layout.first_layer; layer <= layout.last_layer; ++layer) {
+        layout.frame_bytes += LAYER_BYTES[layer];
+    }
+    if (payload_size == 0 || payload_size > MAX_AUDIO_PAYLOAD ||
+        payload_size % layout.frame_bytes != 0) {
+        return false;
+    }
+    layout.frames = static_cast<int>(payload_size / layout.frame_bytes);
+    return layout.frames <= MAX_FRAMES_PER_PACKET;
+}
+
+int extract_layer(const AudioLayout& layout, std::string_view payload,
+                  int layer, char* out) {
+    return extract_layers(layout, payload, layer, out);
+}
+
+int extract_layers(const AudioLayout& layout, std::string_view payload,
+                   int format, char* out) {
+    int first, last;
+    if (!format_layers(format, first, last) || first < layout.first_layer ||
+        last > layout.last_layer) {
+        return 0;
+    }
+    const int offset = LAYER_OFFSET[first] - LAYER_OFFSET[layout.first_layer];
+    const int length = LAYER_OFFSET[last] + LAYER_BYTES[last] - LAYER_OFFSET[first];
+    for (int frame = 0; frame < layout.frames; ++frame) {
+        std::memcpy(out + frame * length,
+                    payload.data() + frame * layout.frame_bytes + offset,
+                    length);
+    }
+    return layout.frames * length;
+}
+
+int copy_layers(int format, const char* bundle, char* out) {
+    int first, last;
+    if (!format_layers(format, first, last)) return 0;
+    const int length = LAYER_OFFSET[last] + LAYER_BYTES[last] - LAYER_OFFSET[first];
+    std::memcpy(out, bundle + LAYER_OFFSET[first], length);
+    return length;
+}
+
+int choose_layer(int capacity_kbps, int streams, int current) {
+    if (capacity_kbps <= 0 || streams <= 0) return LAYER_PCM48;
+    for (int layer = LAYER_PCM48; layer < LAYER_COUNT - 1; ++layer) {
+        const double needed = double(layer_kbps(layer)) * streams *
+                              (layer < current ? LAYER_UPGRADE_MARGIN : 1.0);
+        if (needed <= capacity_kbps) return layer;
+    }
+    // A pior camada é o mínimo: abaixo dela o ouvinte perde pacotes
+    return LAYER_COUNT - 1;
+}
+
+SimulcastEncoder::SimulcastEncoder()
+    : to_16k(SAMPLE_RATE, SAMPLE_RATE / 3, FRAMES_PER_BUFFER),
+      to_8k(SAMPLE_RATE, SAMPLE_RATE / 6, FRAMES_PER_BUFFER),
+      input(FRAMES_PER_BUFFER),
+      output(to_16k.max_output(FRAMES_PER_BUFFER)) {}
+
+int SimulcastEncoder::encode(char* payload) {
+    pcm_to_float(payload, input.data(), FRAMES_PER_BUFFER);
+
+    // 960 amostras viram exatamente 320 e 160: cada quadro fica completo
+    int produced = to_16k.process(input.data(), FRAMES_PER_BUFFER, output.data());
+    std::fill(output.begin() + std::min(produced, FRAMES_16K),
+              output.begin() + FRAMES_16K, 0.0f);
+    float_to_pcm(output.data(), payload + LAYER_OFFSET[LAYER_PCM16K], FRAMES_16K);
+
+    produced = to_8k.process(input.data(), FRAMES_PER_BUFFER, output.data());
+    std::fill(output.begin() + std::min(produced, FRAMES_8K),
+              output.begin() + FRAMES_8K, 0.0f);
+    char* ulaw = payload + LAYER_OFFSET[LAYER_ULAW8K];
+    for (int i = 0; i < FRAMES_8K; ++i) {
+        const float scaled =
+            std::clamp(output[i] * 32768.0f, -32768.0f, 32767.0f);
+        ulaw[i] = static_cast<char>(
+            ulaw_encode(static_cast<int16_t>(std::lrint(scaled))));
+    }
+    return MAX_AUDIO_PAYLOAD;
+}
+
+LayerDecoder::LayerDecoder()
+    : input(FRAMES_16K), output(FRAMES_PER_BUFFER + 1) {}
+
+int LayerDecoder::decode(int format, std::string_view payload, char* pcm48) {
+    AudioLayout layout;
+    if (!parse_audio_layout(format, payload.size(), layout)) return 0;
+
+    // De um pacote com várias camadas usa sempre a melhor, que é a primeira
+    // de cada quadro
+    const int layer = layout.first_layer;
+
+    // Ao trocar de camada o conversor recomeça sem histórico, em vez de
+    // continuar de um quadro antigo
+    if (layer != last_layer) {
+        if (layer == LAYER_PCM16K) {
+            from_16k = std::make_unique<Resampler>(SAMPLE_RATE / 3, SAMPLE_RATE,
+                                                   FRAMES_16K);
+        } else if (layer == LAYER_ULAW8K) {
+            from_8k = std::make_unique<Resampler>(SAMPLE_RATE / 6, SAMPLE_RATE,
+                                                  FRAMES_8K);
+        }
+        last_layer = layer;
+    }
+
+    for (int frame = 0; frame < layout.frames; ++frame) {
+        const char* data = payload.data() + frame * layout.frame_bytes;
+        char* out = pcm48 + frame * AUDIO_BUFFER_SIZE;
+        if (layer == LAYER_PCM48) {
+            std::memcpy(out, data, AUDIO_BUFFER_SIZE);
+            continue;
+        }
+
+        int produced;
+        if (layer == LAYER_PCM16K) {
+            pcm_to_float(data, input.data(), FRAMES_16K);
+            produced =
+                from_16k->process(input.data(), FRAMES_16K, output.data());
+        } else {
+            for (int i = 0; i < FRAMES_8K; ++i) {
+                input[i] = ulaw_decode(static_cast<uint8_t>(data[i])) *
+                           (1.0f / 32768.0f);
+            }
+            produced = from_8k->process(input.data(), FRAMES_8K, output.data());
+        }
+        std::fill(output.begin() + std::min(produced, FRAMES_PER_BUFFER),
+                  output.begin() + FRAMES_PER_BUFFER, 0.0f);
+        float_to_pcm(output.data(), out, FRAMES_PER_BUFFER);
+    }
+    return layout.frames;
+}
@@ -0,0 +1,149 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+const char* const TRACE_STAGE_NAMES[TRACE_STAGE_COUNT] = {
+    "capture", "send",    "relay_receive", "relay_forward",
+    "receive", "dequeue", "playback",
+};
+
+bool trace_enabled = false;
+
+namespace {
+// Capacidade do anel (potência de dois). Com 4 eventos por quadro de 20 ms,
+// guarda os últimos ~20 minutos de cada sentido da chamada.
+constexpr uint64_t TRACE_CAPACITY = 1 << 18;
+
+// Evento do anel. 'sequence' é publicado por último: o leitor só considera
+// o evento se ele corresponde à volta atual do anel.
+struct TraceEvent {
+    std::atomic<uint64_t> sequence{0};
+    int64_t time_ns;
+    uint32_t stream;
+    uint32_t frame;
+    uint8_t stage;
+};
+
+std::unique_ptr<TraceEvent[]> ring;
+std::atomic<uint64_t> head{0};
+std::string output_path;
+std::string process_label;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+}  // namespace
+
+void trace_init(const char* process_name) {
+    const char* path = std::getenv("VOIP_TRACE");
+    if (!path || !*path) return;
+    output_path = path;
+    process_label = process_name;
+    ring.reset(new TraceEvent[TRACE_CAPACITY]);
+    trace_enabled = true;
+}
+
+// Várias threads escrevem ao mesmo tempo: cada uma reserva uma posição com
+// fetch_add e publica o evento com a sequência, sem travas. Se o anel der
+// a volta, os eventos mais antigos são sobrescritos.
+void trace_record(TraceStage stage, uint32_t stream, uint32_t frame) {
+    const uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& event = ring[index & (TRACE_CAPACITY - 1)];
+    event.time_ns = now_ns();
+    event.stream = stream;
+    event.frame = frame;
+    event.stage = stage;
+    event.sequence.store(index + 1, std::memory_order_release);
+}
+
+void trace_finish() {
+    if (!trace_enabled) return;
+    trace_enabled = false;
+
+    // Eventos válidos, do mais antigo ao mais recente
+    const uint64_t end = head.load(std::memory_order_acquire);
+    const uint64_t begin = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    std::vector<const TraceEvent*> events;
+    events.reserve(end - begin);
+    for (uint64_t i = begin; i < end; ++i) {
+        const TraceEvent& event = ring[i & (TRACE_CAPACITY - 1)];
+        if (event.sequence.load(std::memory_order_acquire) == i + 1) {
+            events.push_back(&event);
+        }
+    }
+
+    // Chrome Trace: um evento instantâneo por linha, a etapa vira a "thread"
+    // para que cada etapa apareça numa faixa própria
+    std::ofstream file(output_path);
+    if (!file) {
+        std::cerr << "Erro ao criar o arquivo de rastreio " << output_path
+                  << std::endl;
+        return;
+    }
+    const int pid = static_cast<int>(getpid());
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+         << ",\"args\":{\"name\":\"" << process_label << "\"}}";
+    for (const TraceEvent* event : events) {
+        file << ",\n{\"name\":\"" << TRACE_STAGE_NAMES[event->stage]
+             << "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":"
+             << event->time_ns / 1000 << "." << (event->time_ns % 1000) / 100
+             << ",\"pid\":" << pid << ",\"tid\":" << int(event->stage)
+             << ",\"args\":{\"stream\":" << event->stream
+             << ",\"frame\":" << event->frame << "}}";
+    }
+    file << "\n]}\n";
+    std::cout << "Rastreio: " << events.size() << " eventos gravados em "
+              << output_path << std::endl;
+
+    // Percentis entre etapas consecutivas observadas neste processo
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<int64_t>> frames;
+    std::map<std::pair<int, int>, std::vector<double>> deltas;
+    for (const TraceEvent* event : events) {
+        auto& stages = frames[{event->stream, event->frame}];
+        stages.resize(TRACE_STAGE_COUNT, -1);
+        stages[event->stage] = event->time_ns;
+    }
+    for (const auto& entry : frames) {
+        const std::vector<int64_t>& stages = entry.second;
+        int previous = -1;
+        for (int stage = 0; stage < TRACE_STAGE_COUNT; ++stage) {
+            if (stages[stage] < 0) continue;
+            if (previous >= 0) {
+                deltas[{previous, stage}].push_back(
+                    (stages[stage] - stages[previous]) / 1e6);
+            }
+            previous = stage;
+        }
+    }
+    for (auto& entry : deltas) {
+        std::vector<double>& values = entry.second;
+        std::sort(values.begin(), values.end());
+        auto percentile = [&](double p) {
+            return values[static_cast<size_t>(p * (values.size() - 1))];
+        };
+        std::cout << "  " << TRACE_STAGE_NAMES[entry.first.first] << " -> "
+                  << TRACE_STAGE_NAMES[entry.first.second] << ": p50 "
+                  << percentile(0.5) << " ms, p90 " << percentile(0.9)
+                  << " ms, p99 " << percentile(0.99) << " ms, máx "
+                  << values.back() << " ms (" << values.size()
+                  << " quadros)" << std::endl;
+    }
+}
@@ -0,0 +1,135 @@
+// Junta os arquivos de rastreio (VOIP_TRACE) do cliente que fala, do
+// servidor e do cliente que ouve e imprime a latência de cada etapa com
+// percentis. Os quadros são casados pelo timestamp de mídia, que começa em
+// um valor aleatório em cada cliente. As etapas a partir do recebimento
+// no cliente que ouve acontecem uma vez por ouvinte, então são guardadas
+// por (timestamp, arquivo): com vários ouvintes cada um conta como uma
+// entrega do quadro, e a latência total de cada ouvinte também é impressa.
+//
+// Os instantes vêm do relógio monotônico de cada processo, então as etapas
+// entre processos só são válidas se eles rodam na mesma máquina (ou com
+// relógios sincronizados); as etapas dentro de um processo são sempre
+// válidas.
+//
+// Uso: trace_report <cliente_a.json> <servidor.json> <cliente_b.json> ...
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "trace.h"
+
+// Extrai o número que segue 'key' na linha, retorna false se não existir
+static bool read_number(const std::string& line, const char* key,
+                        double& value) {
+    size_t pos = line.find(key);
+    if (pos == std::string::npos) return false;
+    value = std::strtod(line.c_str() + pos + std::strlen(key), nullptr);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Uso: " << argv[0] << " <rastreio.json> [...]"
+                  << std::endl;
+        return 1;
+    }
+
+    // Instante (ms) de cada etapa de cada quadro até o repasse no servidor,
+    // e das etapas de cada ouvinte, por (timestamp, arquivo)
+    std::map<uint32_t, std::vector<double>> frames;
+    std::map<std::pair<uint32_t, int>, std::vector<double>> deliveries;
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i]);
+        if (!file) {
+            std::cerr << "Não foi possível abrir " << argv[i] << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            double ts, stage, frame;
+            if (!read_number(line, "\"ts\":", ts) ||
+                !read_number(line, "\"tid\":", stage) ||
+                !read_number(line, "\"frame\":", frame)) {
+                continue;
+            }
+            if (stage < 0 || stage >= TRACE_STAGE_COUNT) continue;
+            const uint32_t timestamp = static_cast<uint32_t>(frame);
+            auto& stages = stage < TRACE_RECEIVE
+                               ? frames[timestamp]
+                               : deliveries[{timestamp, i}];
+            stages.resize(TRACE_STAGE_COUNT, -1.0);
+            stages[static_cast<int>(stage)] = ts / 1000.0;
+        }
+    }
+
+    // Latência de cada etapa em relação à etapa anterior presente. As
+    // etapas até o repasse contam uma vez por quadro; as do ouvinte, uma
+    // vez por entrega, continuando das etapas do quadro.
+    std::vector<std::vector<double>> deltas(TRACE_STAGE_COUNT);
+    auto add_deltas = [&](const std::vector<double>& stages, int first,
+                          int last) {
+        int previous = -1;
+        for (int stage = 0; stage < last; ++stage) {
+            if (stages[stage] < 0) continue;
+            if (previous >= 0 && stage >= first) {
+                deltas[stage].push_back(stages[stage] - stages[previous]);
+            }
+            previous = stage;
+        }
+    };
+    for (const auto& entry : frames) {
+        add_deltas(entry.second, 0, TRACE_RECEIVE);
+    }
+
+    // Latência total de todas as entregas e de cada ouvinte
+    std::vector<double> total;
+    std::map<int, std::vector<double>> listener_total;
+    const std::vector<double> missing(TRACE_STAGE_COUNT, -1.0);
+    for (const auto& entry : deliveries) {
+        auto frame = frames.find(entry.first.first);
+        std::vector<double> stages =
+            frame != frames.end() ? frame->second : missing;
+        for (int stage = TRACE_RECEIVE; stage < TRACE_STAGE_COUNT; ++stage) {
+            stages[stage] = entry.second[stage];
+        }
+        add_deltas(stages, TRACE_RECEIVE, TRACE_STAGE_COUNT);
+        if (stages[TRACE_CAPTURE] >= 0 && stages[TRACE_PLAYBACK] >= 0) {
+            const double latency =
+                stages[TRACE_PLAYBACK] - stages[TRACE_CAPTURE];
+            total.push_back(latency);
+            listener_total[entry.first.second].push_back(latency);
+        }
+    }
+
+    auto print = [](const std::string& name, std::vector<double>& values) {
+        if (values.empty()) return;
+        std::sort(values.begin(), values.end());
+        auto percentile = [&](double p) {
+            return values[static_cast<size_t>(p * (values.size() - 1))];
+        };
+        std::printf("%-28s %8zu %9.3f %9.3f %9.3f %9.3f\n", name.c_str(),
+                    values.size(), percentile(0.5), percentile(0.9),
+                    percentile(0.99), values.back());
+    };
+
+    std::printf("%-28s %8s %9s %9s %9s %9s\n", "etapa (ms)", "quadros", "p50",
+                "p90", "p99", "máx");
+    for (int stage = 1; stage < TRACE_STAGE_COUNT; ++stage) {
+        print(std::string("-> ") + TRACE_STAGE_NAMES[stage], deltas[stage]);
+    }
+    print("capture -> playback", total);
+    if (listener_total.size() > 1) {
+        for (auto& entry : listener_total) {
+            print(std::string("   ouvinte ") + argv[entry.first],
+                  entry.second);
+        }
+    }
+    return 0;
+}
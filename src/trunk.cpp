@@ -0,0 +1,321 @@
+#include "trunk.h"
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include "session_token.h"
+
+namespace {
+// Pacotes por segundo aceitos de um vizinho: todos os participantes dele
+// falando, sem agrupamento
+constexpr double TRUNK_PACKET_RATE = MAX_CLIENTS * SESSION_PACKET_RATE;
+constexpr double TRUNK_PACKET_BURST = MAX_CLIENTS * SESSION_PACKET_BURST;
+
+// Lê "ip:porta" (a porta é opcional); false se o endereço for inválido
+bool parse_address(const std::string& text, sockaddr_in& address) {
+    address = sockaddr_in{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(PORT);
+
+    std::string ip = text;
+    const size_t colon = text.find(':');
+    if (colon != std::string::npos) {
+        ip = text.substr(0, colon);
+        const int port = std::atoi(text.c_str() + colon + 1);
+        if (port <= 0 || port > 65535) return false;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+    }
+    return inet_pton(AF_INET, ip.c_str(), &address.sin_addr) == 1;
+}
+
+// Lê a chave do tronco: 32 dígitos hexadecimais (16 bytes); false se for
+// inválida
+bool parse_key(const std::string& text, uint8_t key[16]) {
+    if (text.size() != 32) return false;
+    for (int i = 0; i < 16; ++i) {
+        int byte = 0;
+        for (int j = 0; j < 2; ++j) {
+            const char c = text[2 * i + j];
+            int digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+            } else {
+                return false;
+            }
+            byte = byte * 16 + digit;
+        }
+        key[i] = static_cast<uint8_t>(byte);
+    }
+    return true;
+}
+}  // namespace
+
+int relay_port() {
+    const char* port = std::getenv("VOIP_PORT");
+    const int value = port ? std::atoi(port) : 0;
+    return (value > 0 && value <= 65535) ? value : PORT;
+}
+
+bool read_trunk_frame(std::string_view& rest, TrunkFrame& frame) {
+    if (rest.size() < TRUNK_FRAME_HEADER_SIZE) return false;
+    const auto* bytes = reinterpret_cast<const uint8_t*>(rest.data());
+    const size_t length = (size_t(bytes[6]) << 8) | bytes[7];
+    if (rest.size() - TRUNK_FRAME_HEADER_SIZE < length) return false;
+
+    frame.stream = bytes[0];
+    frame.layer = bytes[1];
+    frame.timestamp = (uint32_t(bytes[2]) << 24) | (uint32_t(bytes[3]) << 16) |
+                      (uint32_t(bytes[4]) << 8) | uint32_t(bytes[5]);
+    frame.payload = rest.substr(TRUNK_FRAME_HEADER_SIZE, length);
+    rest.remove_prefix(TRUNK_FRAME_HEADER_SIZE + length);
+    return true;
+}
+
+bool Trunk::configure() {
+    std::fill(std::begin(relay_peers), std::end(relay_peers), -1);
+
+    if (const char* id = std::getenv("VOIP_RELAY_ID")) {
+        relay_id = std::atoi(id);
+        if (relay_id < 0 || relay_id >= MAX_RELAYS) {
+            std::cerr << "VOIP_RELAY_ID deve estar entre 0 e "
+                      << MAX_RELAYS - 1 << "." << std::endl;
+            return false;
+        }
+    }
+
+    if (const char* mtu = std::getenv("VOIP_TRUNK_MTU")) {
+        const int value = std::atoi(mtu);
+        if (value < 576 || value > 65535) {
+            std::cerr << "VOIP_TRUNK_MTU deve estar entre 576 e 65535."
+                      << std::endl;
+            return false;
+        }
+        batch_budget = static_cast<size_t>(value - TRUNK_IP_UDP_OVERHEAD);
+    }
+
+    const char* list = std::getenv("VOIP_PEERS");
+    if (!list || !*list) return true;
+
+    // Sem chave, qualquer um que forje o endereço de um vizinho injetaria
+    // áudio na chamada: o tronco não sobe
+    const char* key_text = std::getenv("VOIP_TRUNK_KEY");
+    if (!key_text || !parse_key(key_text, key)) {
+        std::cerr << "VOIP_TRUNK_KEY deve ter 32 dígitos hexadecimais (a "
+                  << "mesma chave em todos os servidores)." << std::endl;
+        return false;
+    }
+
+    std::stringstream peers_text(list);
+    std::string item;
+    while (std::getline(peers_text, item, ',')) {
+        sockaddr_in address;
+        if (!parse_address(item, address)) {
+            std::cerr << "Endereço inválido em VOIP_PEERS: " << item
+                      << std::endl;
+            return false;
+        }
+        peers.push_back(address);
+        peer_buckets.emplace_back(TRUNK_PACKET_RATE, TRUNK_PACKET_BURST);
+        peer_formats.push_back(LAYER_SIMULCAST);
+    }
+    batch.reserve(TRUNK_MAX_SIZE);
+
+    std::cout << "Servidor " << relay_id << " (fluxos " << stream_base()
+              << " a " << stream_base() + MAX_CLIENTS - 1 << ") interligado a "
+              << peers.size() << " servidor(es)." << std::endl;
+    return true;
+}
+
+int Trunk::find_peer(const sockaddr_in& address) const {
+    for (size_t i = 0; i < peers.size(); ++i) {
+        if (peers[i].sin_addr.s_addr == address.sin_addr.s_addr &&
+            peers[i].sin_port == address.sin_port) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+size_t Trunk::sign(char* datagram, size_t length) const {
+    write_session_token(siphash24(key, datagram, length), datagram + length);
+    return length + TRUNK_TAG_SIZE;
+}
+
+bool Trunk::verify(std::string_view& datagram) const {
+    if (datagram.size() < TRUNK_TAG_SIZE) return false;
+    const size_t length = datagram.size() - TRUNK_TAG_SIZE;
+    if (read_session_token(datagram.data() + length) !=
+        siphash24(key, datagram.data(), length)) {
+        return false;
+    }
+    datagram.remove_suffix(TRUNK_TAG_SIZE);
+    return true;
+}
+
+bool Trunk::accept(int peer, std::chrono::steady_clock::time_point now) {
+    return peer_buckets[peer].consume(now);
+}
+
+void Trunk::learn_relay(int peer, int relay, int format) {
+    if (relay >= 0 && relay < MAX_RELAYS) relay_peers[relay] = peer;
+    int first, last;
+    if (format_layers(format, first, last)) peer_formats[peer] = format;
+}
+
+int Trunk::send_format(const AudioLayout& layout) const {
+    // União dos pedidos: da melhor camada pedida por algum vizinho à pior,
+    // limitada às que o pacote tem
+    int first = LAYER_COUNT, last = 0;
+    for (int format : peer_formats) {
+        int peer_first, peer_last;
+        format_layers(format, peer_first, peer_last);
+        first = std::min(first, peer_first);
+        last = std::max(last, peer_last);
+    }
+    first = std::clamp(first, layout.first_layer, layout.last_layer);
+    last = std::clamp(last, first, layout.last_layer);
+    return layers_format(first, last);
+}
+
+bool Trunk::send_to_relay(int sock, int relay, const char* packet,
+                          size_t length) {
+    if (relay < 0 || relay >= MAX_RELAYS || relay_peers[relay] < 0) {
+        return false;
+    }
+    char signed_packet[MAX_PACKET_SIZE + TRUNK_TAG_SIZE];
+    if (length > MAX_PACKET_SIZE) return false;
+    std::memcpy(signed_packet, packet, length);
+    length = sign(signed_packet, length);
+
+    const sockaddr_in& peer = peers[relay_peers[relay]];
+    sendto(sock, signed_packet, length, 0, (const sockaddr*)&peer,
+           sizeof(peer));
+    return true;
+}
+
+void Trunk::add_frame(int sock, int slot, std::string_view audio_packet,
+                      const AudioLayout& layout, uint32_t active_slots,
+                      std::chrono::steady_clock::time_point now) {
+    if (!enabled() || audio_packet.size() < AUDIO_HEADER_SIZE) return;
+
+    // Tamanho do quadro só com as camadas pedidas
+    const int format = send_format(layout);
+    int first, last;
+    format_layers(format, first, last);
+    size_t length = 0;
+    for (int layer = first; layer <= last; ++layer) {
+        length += LAYER_BYTES[layer];
+    }
+    length *= layout.frames;
+
+    // Um segundo quadro do mesmo locutor não espera: o anterior sai antes.
+    // O mesmo vale para um quadro que passaria da MTU.
+    const uint32_t bit = 1u << slot;
+    if ((batch_slots & bit) || batch.size() + TRUNK_FRAME_HEADER_SIZE +
+                                       length + TRUNK_TAG_SIZE >
+                                   batch_budget) {
+        flush(sock);
+    }
+
+    if (batch_frames == 0) {
+        batch.assign({TRUNK_DATA, static_cast<char>(relay_id), 0,
+                      static_cast<char>(wanted_format)});
+        batch_start = now;
+        last_announce = now;
+    }
+
+    // Subcabeçalho: fluxo e timestamp copiados do cabeçalho do pacote, o
+    // formato recortado e o tamanho do áudio
+    batch.push_back(audio_packet[1]);
+    batch.push_back(static_cast<char>(format));
+    batch.insert(batch.end(), audio_packet.begin() + AUDIO_TIMESTAMP_OFFSET,
+                 audio_packet.begin() + AUDIO_HEADER_SIZE);
+    batch.push_back(static_cast<char>(length >> 8));
+    batch.push_back(static_cast<char>(length));
+    const size_t offset = batch.size();
+    batch.resize(offset + length);
+    extract_layers(layout, audio_packet.substr(AUDIO_HEADER_SIZE), format,
+                   batch.data() + offset);
+    batch_slots |= bit;
+    ++batch_frames;
+
+    // Todos os participantes ativos já estão no datagrama, ou não cabe
+    // mais nenhum quadro
+    if ((batch_slots & active_slots) == active_slots ||
+        batch_frames == TRUNK_MAX_FRAMES ||
+        batch.size() + TRUNK_FRAME_HEADER_SIZE >= batch_budget) {
+        flush(sock);
+    }
+}
+
+void Trunk::poll(int sock, std::chrono::steady_clock::time_point now) {
+    if (batch_frames > 0 &&
+        now - batch_start >= std::chrono::milliseconds(TRUNK_FLUSH_MS)) {
+        flush(sock);
+    }
+
+    // Cabeçalho sozinho, depois de um segundo sem datagramas: o formato
+    // pedido chega aos vizinhos mesmo sem ninguém falando aqui
+    if (enabled() && now - last_announce >=
+                         std::chrono::milliseconds(TRUNK_ANNOUNCE_MS)) {
+        char header[TRUNK_HEADER_SIZE + TRUNK_TAG_SIZE] = {
+            TRUNK_DATA, static_cast<char>(relay_id), 0,
+            static_cast<char>(wanted_format)};
+        const size_t length = sign(header, TRUNK_HEADER_SIZE);
+        for (const sockaddr_in& peer : peers) {
+            sendto(sock, header, length, 0, (const sockaddr*)&peer,
+                   sizeof(peer));
+        }
+        last_announce = now;
+    }
+}
+
+int Trunk::ms_until_flush(std::chrono::steady_clock::time_point now) const {
+    if (batch_frames == 0) return -1;
+    const auto left = std::chrono::milliseconds(TRUNK_FLUSH_MS) -
+                      std::chrono::duration_cast<std::chrono::milliseconds>(
+                          now - batch_start);
+    return std::max<int>(0, static_cast<int>(left.count()));
+}
+
+void Trunk::flush(int sock) {
+    if (batch_frames == 0) return;
+    batch[2] = static_cast<char>(batch_frames);
+    const size_t length = batch.size();
+    batch.resize(length + TRUNK_TAG_SIZE);
+    sign(batch.data(), length);
+    for (const sockaddr_in& peer : peers) {
+        sendto(sock, batch.data(), batch.size(), 0, (const sockaddr*)&peer,
+               sizeof(peer));
+    }
+    ++datagrams_sent;
+    frames_sent += batch_frames;
+    bytes_sent += batch.size();
+    batch_frames = 0;
+    batch_slots = 0;
+}
+
+void Trunk::print_stats() const {
+    if (!enabled() || datagrams_sent == 0) return;
+    std::cout << "Tronco: " << frames_sent << " quadros em " << datagrams_sent
+              << " datagramas por vizinho ("
+              << static_cast<double>(frames_sent) / datagrams_sent
+              << " quadros por datagrama, " << bytes_sent / datagrams_sent
+              << " bytes em média)." << std::endl;
+}
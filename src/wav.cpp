@@ -0,0 +1,132 @@
+#include "wav.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+// Campos do WAV são little-endian; as funções abaixo não dependem da
+// ordem de bytes da máquina
+uint32_t read_u32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+uint16_t read_u16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+
+void put_u32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+void put_u16(unsigned char* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+// Tamanho do cabeçalho canônico gerado pelo WavWriter
+constexpr int WAV_HEADER_SIZE = 44;
+}  // namespace
+
+WavReader::~WavReader() {
+    if (file) std::fclose(file);
+}
+
+bool WavReader::open(const std::string& path) {
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Erro ao abrir o arquivo WAV " << path << std::endl;
+        return false;
+    }
+
+    unsigned char riff[12];
+    if (std::fread(riff, 1, sizeof(riff), file) != sizeof(riff) ||
+        std::memcmp(riff, "RIFF", 4) != 0 ||
+        std::memcmp(riff + 8, "WAVE", 4) != 0) {
+        std::cerr << "Arquivo WAV inválido: " << path << std::endl;
+        return false;
+    }
+
+    // Percorre os blocos até encontrar "fmt " e "data"
+    bool has_format = false;
+    unsigned char header[8];
+    while (std::fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        const uint32_t size = read_u32(header + 4);
+        if (std::memcmp(header, "fmt ", 4) == 0 && size >= 16) {
+            unsigned char format[16];
+            if (std::fread(format, 1, sizeof(format), file) != sizeof(format)) {
+                break;
+            }
+            std::fseek(file, size - 16 + (size & 1), SEEK_CUR);
+            if (read_u16(format) != 1 || read_u16(format + 14) != 16) {
+                std::cerr << "O arquivo WAV deve ser PCM de 16 bits: " << path
+                          << std::endl;
+                return false;
+            }
+            channel_count = read_u16(format + 2);
+            rate = static_cast<int>(read_u32(format + 4));
+            has_format = true;
+        } else if (std::memcmp(header, "data", 4) == 0 && has_format) {
+            remaining_bytes = size;
+            return true;
+        } else {
+            std::fseek(file, size + (size & 1), SEEK_CUR);
+        }
+    }
+
+    std::cerr << "Arquivo WAV sem áudio: " << path << std::endl;
+    return false;
+}
+
+int WavReader::read(char* buffer, int frames) {
+    if (!file || channel_count == 0) return 0;
+    const long frame_bytes = 2L * channel_count;
+    long wanted = std::min(static_cast<long>(frames) * frame_bytes,
+                           remaining_bytes - remaining_bytes % frame_bytes);
+    size_t got = std::fread(buffer, 1, wanted, file);
+    remaining_bytes -= static_cast<long>(got);
+    return static_cast<int>(got / frame_bytes);
+}
+
+WavWriter::~WavWriter() { close(); }
+
+bool WavWriter::open(const std::string& path, int sample_rate, int channels) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Erro ao criar o arquivo WAV " << path << std::endl;
+        return false;
+    }
+    channel_count = channels;
+    data_bytes = 0;
+
+    unsigned char header[WAV_HEADER_SIZE] = {};
+    std::memcpy(header, "RIFF", 4);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    put_u32(header + 16, 16);
+    put_u16(header + 20, 1);
+    put_u16(header + 22, static_cast<uint16_t>(channels));
+    put_u32(header + 24, static_cast<uint32_t>(sample_rate));
+    put_u32(header + 28, static_cast<uint32_t>(sample_rate * channels * 2));
+    put_u16(header + 32, static_cast<uint16_t>(channels * 2));
+    put_u16(header + 34, 16);
+    std::memcpy(header + 36, "data", 4);
+    std::fwrite(header, 1, sizeof(header), file);
+    return true;
+}
+
+void WavWriter::write(const char* buffer, int frames) {
+    if (!file) return;
+    const size_t bytes = static_cast<size_t>(frames) * 2 * channel_count;
+    data_bytes += static_cast<uint32_t>(std::fwrite(buffer, 1, bytes, file));
+}
+
+void WavWriter::close() {
+    if (!file) return;
+    unsigned char size[4];
+    put_u32(size, WAV_HEADER_SIZE - 8 + data_bytes);
+    std::fseek(file, 4, SEEK_SET);
+    std::fwrite(size, 1, 4, file);
+    put_u32(size, data_bytes);
+    std::fseek(file, 40, SEEK_SET);
+    std::fwrite(size, 1, 4, file);
+    std::fclose(file);
+    file = nullptr;
+}
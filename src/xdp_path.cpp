@@ -0,0 +1,554 @@
+#include "xdp_path.h"
+
+#include <iostream>
+
+#if defined(VOIP_XDP) && defined(__linux__)
+
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "common.h"
+
+namespace {
+// Cabeçalhos montados e lidos pelo caminho AF_XDP (IPv4 sem opções)
+constexpr int ETH_HEADER_SIZE = 14;
+constexpr int IP_HEADER_SIZE = 20;
+constexpr int UDP_HEADER_SIZE = 8;
+constexpr int FRAME_HEADERS = ETH_HEADER_SIZE + IP_HEADER_SIZE + UDP_HEADER_SIZE;
+
+// Maior quadro desviado pelo programa XDP: o resto do quadro da UMEM fica
+// para a folga que o kernel reserva antes do pacote
+constexpr int XDP_MAX_PACKET = XDP_FRAME_SIZE - 256;
+
+// Entradas do mapa de sockets (uma por fila de recepção da interface)
+constexpr int XSK_MAP_ENTRIES = 64;
+
+long bpf(int command, bpf_attr& attr) {
+    return syscall(__NR_bpf, command, &attr, sizeof(attr));
+}
+
+bpf_insn instruction(uint8_t code, uint8_t dst, uint8_t src, int16_t off,
+                     int32_t imm) {
+    bpf_insn insn{};
+    insn.code = code;
+    insn.dst_reg = dst;
+    insn.src_reg = src;
+    insn.off = off;
+    insn.imm = imm;
+    return insn;
+}
+
+// Programa XDP: pacotes IPv4 UDP inteiros (sem fragmentação) para a porta
+// do servidor, cujo primeiro byte é AUDIO_DATA, vão para o socket AF_XDP
+// da fila em que chegaram; todo o resto segue para a pilha de rede. Os
+// valores comparados estão na ordem da rede, como lidos da memória.
+std::vector<bpf_insn> build_program(int map_fd, uint16_t port) {
+    enum { R0, R1, R2, R3, R4, R5, R6 };
+    std::vector<bpf_insn> p;
+    std::vector<size_t> to_pass;
+    auto load = [&](uint8_t size, uint8_t dst, uint8_t src, int16_t off) {
+        p.push_back(instruction(BPF_LDX | BPF_MEM | size, dst, src, off, 0));
+    };
+    auto pass_if_not = [&](uint8_t reg, int32_t value) {
+        to_pass.push_back(p.size());
+        p.push_back(instruction(BPF_JMP | BPF_JNE | BPF_K, reg, 0, 0, value));
+    };
+
+    p.push_back(instruction(BPF_ALU64 | BPF_MOV | BPF_X, R6, R1, 0, 0));
+    load(BPF_W, R2, R6, offsetof(xdp_md, data));
+    load(BPF_W, R3, R6, offsetof(xdp_md, data_end));
+
+    // Cabeçalhos e o byte de tipo cabem no pacote; o pacote cabe no quadro
+    p.push_back(instruction(BPF_ALU64 | BPF_MOV | BPF_X, R4, R2, 0, 0));
+    p.push_back(instruction(BPF_ALU64 | BPF_ADD | BPF_K, R4, 0, 0,
+                            FRAME_HEADERS + 1));
+    to_pass.push_back(p.size());
+    p.push_back(instruction(BPF_JMP | BPF_JGT | BPF_X, R4, R3, 0, 0));
+    p.push_back(instruction(BPF_ALU64 | BPF_MOV | BPF_X, R4, R3, 0, 0));
+    p.push_back(instruction(BPF_ALU64 | BPF_SUB | BPF_X, R4, R2, 0, 0));
+    to_pass.push_back(p.size());
+    p.push_back(instruction(BPF_JMP | BPF_JGT | BPF_K, R4, 0, 0, XDP_MAX_PACKET));
+
+    load(BPF_H, R5, R2, 12);  // EtherType
+    pass_if_not(R5, htons(0x0800));
+    load(BPF_B, R5, R2, 14);  // Versão 4, cabeçalho de 20 bytes
+    pass_if_not(R5, 0x45);
+    load(BPF_H, R5, R2, 20);  // Fragmentação: MF e deslocamento
+    p.push_back(instruction(BPF_ALU64 | BPF_AND | BPF_K, R5, 0, 0,
+                            htons(0x3FFF)));
+    pass_if_not(R5, 0);
+    load(BPF_B, R5, R2, 23);  // Protocolo
+    pass_if_not(R5, IPPROTO_UDP);
+    load(BPF_H, R5, R2, 36);  // Porta de destino
+    pass_if_not(R5, htons(port));
+    load(BPF_B, R5, R2, FRAME_HEADERS);  // Tipo do pacote
+    pass_if_not(R5, AUDIO_DATA);
+
+    // return bpf_redirect_map(&xsks, ctx->rx_queue_index, XDP_PASS);
+    load(BPF_W, R2, R6, offsetof(xdp_md, rx_queue_index));
+    p.push_back(instruction(BPF_LD | BPF_DW | BPF_IMM, R1, BPF_PSEUDO_MAP_FD,
+                            0, map_fd));
+    p.push_back(instruction(0, 0, 0, 0, 0));
+    p.push_back(instruction(BPF_ALU64 | BPF_MOV | BPF_K, R3, 0, 0, XDP_PASS));
+    p.push_back(instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+    p.push_back(instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+    const size_t pass = p.size();
+    p.push_back(instruction(BPF_ALU64 | BPF_MOV | BPF_K, R0, 0, 0, XDP_PASS));
+    p.push_back(instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+    for (size_t jump : to_pass) {
+        p[jump].off = static_cast<int16_t>(pass - jump - 1);
+    }
+    return p;
+}
+
+uint32_t load_acquire(const uint32_t* value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+void store_release(uint32_t* value, uint32_t data) {
+    __atomic_store_n(value, data, __ATOMIC_RELEASE);
+}
+
+// Soma de verificação do cabeçalho IP
+uint16_t ip_checksum(const unsigned char* header) {
+    uint32_t sum = 0;
+    for (int i = 0; i < IP_HEADER_SIZE; i += 2) {
+        sum += (header[i] << 8) | header[i + 1];
+    }
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(~sum);
+}
+}  // namespace
+
+bool XdpPath::load_program(int ifindex) {
+    bpf_attr attr{};
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(uint32_t);
+    attr.max_entries = XSK_MAP_ENTRIES;
+    map = static_cast<int>(bpf(BPF_MAP_CREATE, attr));
+    if (map < 0) {
+        perror("AF_XDP: erro ao criar o mapa de sockets");
+        return false;
+    }
+
+    const std::vector<bpf_insn> code = build_program(map, port);
+    static char log[16384];
+    attr = bpf_attr{};
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = reinterpret_cast<uint64_t>(code.data());
+    attr.insn_cnt = static_cast<uint32_t>(code.size());
+    attr.license = reinterpret_cast<uint64_t>("GPL");
+    attr.log_buf = reinterpret_cast<uint64_t>(log);
+    attr.log_size = sizeof(log);
+    attr.log_level = 1;
+    program = static_cast<int>(bpf(BPF_PROG_LOAD, attr));
+    if (program < 0) {
+        perror("AF_XDP: erro ao carregar o programa XDP");
+        std::cerr << log << std::endl;
+        return false;
+    }
+
+    // O vínculo (bpf_link) solta o programa sozinho quando o processo
+    // termina, mesmo se ele cair
+    attr = bpf_attr{};
+    attr.link_create.prog_fd = static_cast<uint32_t>(program);
+    attr.link_create.target_ifindex = static_cast<uint32_t>(ifindex);
+    attr.link_create.attach_type = BPF_XDP;
+    attr.link_create.flags = XDP_FLAGS_SKB_MODE;
+    link = static_cast<int>(bpf(BPF_LINK_CREATE, attr));
+    if (link < 0) {
+        perror("AF_XDP: erro ao anexar o programa XDP");
+        return false;
+    }
+    return true;
+}
+
+bool XdpPath::create_socket(int ifindex) {
+    xsk = socket(AF_XDP, SOCK_RAW, 0);
+    if (xsk < 0) {
+        perror("AF_XDP: erro ao criar o socket");
+        return false;
+    }
+
+    const size_t umem_size = size_t(XDP_FRAME_SIZE) * XDP_FRAME_COUNT;
+    void* memory = mmap(nullptr, umem_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("AF_XDP: erro ao alocar a UMEM");
+        return false;
+    }
+    umem = static_cast<char*>(memory);
+
+    xdp_umem_reg registration{};
+    registration.addr = reinterpret_cast<uint64_t>(umem);
+    registration.len = umem_size;
+    registration.chunk_size = XDP_FRAME_SIZE;
+    const int ring_size = XDP_RING_SIZE;
+    if (setsockopt(xsk, SOL_XDP, XDP_UMEM_REG, &registration,
+                   sizeof(registration)) < 0 ||
+        setsockopt(xsk, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size,
+                   sizeof(ring_size)) < 0 ||
+        setsockopt(xsk, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size,
+                   sizeof(ring_size)) < 0 ||
+        setsockopt(xsk, SOL_XDP, XDP_RX_RING, &ring_size, sizeof(ring_size)) <
+            0 ||
+        setsockopt(xsk, SOL_XDP, XDP_TX_RING, &ring_size, sizeof(ring_size)) <
+            0) {
+        perror("AF_XDP: erro ao configurar a UMEM e os anéis");
+        return false;
+    }
+
+    xdp_mmap_offsets offsets{};
+    socklen_t length = sizeof(offsets);
+    if (getsockopt(xsk, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &length) < 0) {
+        perror("AF_XDP: erro ao consultar os anéis");
+        return false;
+    }
+
+    // Mapeia um anel do kernel
+    auto map_ring = [&](Ring& ring, const xdp_ring_offset& offset,
+                        size_t entry_size, off_t page_offset) {
+        ring.map_size = offset.desc + XDP_RING_SIZE * entry_size;
+        ring.map = mmap(nullptr, ring.map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, xsk, page_offset);
+        if (ring.map == MAP_FAILED) {
+            ring.map = nullptr;
+            return false;
+        }
+        char* base = static_cast<char*>(ring.map);
+        ring.producer = reinterpret_cast<uint32_t*>(base + offset.producer);
+        ring.consumer = reinterpret_cast<uint32_t*>(base + offset.consumer);
+        ring.flags = reinterpret_cast<uint32_t*>(base + offset.flags);
+        ring.entries = base + offset.desc;
+        return true;
+    };
+    if (!map_ring(rx, offsets.rx, sizeof(xdp_desc), XDP_PGOFF_RX_RING) ||
+        !map_ring(tx, offsets.tx, sizeof(xdp_desc), XDP_PGOFF_TX_RING) ||
+        !map_ring(fill, offsets.fr, sizeof(uint64_t),
+                  XDP_UMEM_PGOFF_FILL_RING) ||
+        !map_ring(completion, offsets.cr, sizeof(uint64_t),
+                  XDP_UMEM_PGOFF_COMPLETION_RING)) {
+        perror("AF_XDP: erro ao mapear os anéis");
+        return false;
+    }
+
+    // Todos os quadros começam livres; metade vai para o anel de
+    // preenchimento, o resto fica para os envios
+    free_frames.clear();
+    for (uint32_t i = XDP_FRAME_COUNT; i > 0; --i) {
+        free_frames.push_back(uint64_t(i - 1) * XDP_FRAME_SIZE);
+    }
+    refill();
+
+    sockaddr_xdp address{};
+    address.sxdp_family = AF_XDP;
+    address.sxdp_ifindex = static_cast<uint32_t>(ifindex);
+    address.sxdp_queue_id = 0;
+    address.sxdp_flags = XDP_COPY;
+    // Logo depois de uma troca sem interrupção, o socket do processo
+    // anterior ainda pode estar sendo liberado pelo kernel (EBUSY)
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (bind(xsk, reinterpret_cast<sockaddr*>(&address), sizeof(address)) <
+           0) {
+        if (errno != EBUSY || std::chrono::steady_clock::now() >= deadline) {
+            perror("AF_XDP: erro ao vincular o socket à interface");
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Registra o socket para a fila 0 no mapa do programa
+    const uint32_t key = 0;
+    const uint32_t value = static_cast<uint32_t>(xsk);
+    bpf_attr attr{};
+    attr.map_fd = static_cast<uint32_t>(map);
+    attr.key = reinterpret_cast<uint64_t>(&key);
+    attr.value = reinterpret_cast<uint64_t>(&value);
+    attr.flags = BPF_ANY;
+    if (bpf(BPF_MAP_UPDATE_ELEM, attr) < 0) {
+        perror("AF_XDP: erro ao registrar o socket no mapa");
+        return false;
+    }
+    return true;
+}
+
+bool XdpPath::open(const std::string& interface, int udp_port) {
+    const int ifindex = static_cast<int>(if_nametoindex(interface.c_str()));
+    if (ifindex == 0) {
+        std::cerr << "AF_XDP: interface desconhecida: " << interface
+                  << std::endl;
+        return false;
+    }
+    port = static_cast<uint16_t>(udp_port);
+
+    // MTU da interface, para não enviar por aqui o que precisa fragmentar
+    const int probe = socket(AF_INET, SOCK_DGRAM, 0);
+    ifreq request{};
+    std::strncpy(request.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+    if (probe >= 0 && ioctl(probe, SIOCGIFMTU, &request) == 0) {
+        mtu = request.ifr_mtu;
+    }
+    if (probe >= 0) ::close(probe);
+
+    if (!load_program(ifindex) || !create_socket(ifindex)) {
+        close();
+        return false;
+    }
+    std::cout << "AF_XDP: áudio da porta " << port << " pela interface "
+              << interface << " (modo genérico, MTU " << mtu << ")."
+              << std::endl;
+    return true;
+}
+
+void XdpPath::refill() {
+    const uint32_t producer = *fill.producer;
+    const uint32_t consumer = load_acquire(fill.consumer);
+    uint32_t space = XDP_RING_SIZE - (producer - consumer);
+    // Metade dos quadros fica sempre para os envios
+    if (free_frames.size() <= XDP_FRAME_COUNT / 2) return;
+    space = std::min<uint32_t>(
+        space, static_cast<uint32_t>(free_frames.size() - XDP_FRAME_COUNT / 2));
+
+    auto* entries = static_cast<uint64_t*>(fill.entries);
+    for (uint32_t i = 0; i < space; ++i) {
+        entries[(producer + i) & (XDP_RING_SIZE - 1)] = free_frames.back();
+        free_frames.pop_back();
+    }
+    if (space > 0) store_release(fill.producer, producer + space);
+}
+
+void XdpPath::reclaim() {
+    const uint32_t consumer = *completion.consumer;
+    const uint32_t producer = load_acquire(completion.producer);
+    const auto* entries = static_cast<const uint64_t*>(completion.entries);
+    for (uint32_t i = consumer; i != producer; ++i) {
+        free_frames.push_back(entries[i & (XDP_RING_SIZE - 1)]);
+    }
+    if (producer != consumer) store_release(completion.consumer, producer);
+}
+
+int XdpPath::receive(
+    const std::function<void(std::string_view, const sockaddr_in&)>& handler) {
+    if (!is_open()) return 0;
+
+    const uint32_t consumer = *rx.consumer;
+    const uint32_t producer = load_acquire(rx.producer);
+    const uint32_t available =
+        std::min<uint32_t>(producer - consumer, XDP_RX_BATCH);
+    const auto* descriptors = static_cast<const xdp_desc*>(rx.entries);
+
+    for (uint32_t i = 0; i < available; ++i) {
+        const xdp_desc& descriptor =
+            descriptors[(consumer + i) & (XDP_RING_SIZE - 1)];
+        const auto* frame =
+            reinterpret_cast<const unsigned char*>(umem + descriptor.addr);
+
+        // O programa XDP já conferiu Ethernet, IPv4 sem opções, UDP e a
+        // porta; aqui só o tamanho declarado no UDP
+        const int udp_length = (frame[38] << 8) | frame[39];
+        if (descriptor.len >= FRAME_HEADERS &&
+            udp_length >= UDP_HEADER_SIZE &&
+            udp_length <=
+                static_cast<int>(descriptor.len) - ETH_HEADER_SIZE -
+                    IP_HEADER_SIZE) {
+            sockaddr_in sender{};
+            sender.sin_family = AF_INET;
+            std::memcpy(&sender.sin_addr.s_addr, frame + 26, 4);
+            std::memcpy(&sender.sin_port, frame + 34, 2);
+
+            // A rota de volta só é aprendida se o servidor aceitar o
+            // pacote (learn_route(), chamada de dentro do handler)
+            current_frame = frame;
+            handler(std::string_view(
+                        reinterpret_cast<const char*>(frame) + FRAME_HEADERS,
+                        udp_length - UDP_HEADER_SIZE),
+                    sender);
+            current_frame = nullptr;
+        }
+        free_frames.push_back(descriptor.addr & ~uint64_t(XDP_FRAME_SIZE - 1));
+    }
+    if (available > 0) {
+        store_release(rx.consumer, consumer + available);
+        received += available;
+    }
+    reclaim();
+    refill();
+    return static_cast<int>(available);
+}
+
+void XdpPath::learn_route(int slot) {
+    if (!current_frame || slot < 0 || slot >= MAX_CLIENTS) return;
+
+    // Rota de volta: os endereços Ethernet trocados, o nosso IP e o
+    // endereço do cliente
+    Route& route = routes[slot];
+    std::memcpy(route.local_mac, current_frame, 6);
+    std::memcpy(route.peer_mac, current_frame + 6, 6);
+    std::memcpy(&route.local_ip, current_frame + 30, 4);
+    std::memcpy(&route.peer_ip, current_frame + 26, 4);
+    std::memcpy(&route.peer_port, current_frame + 34, 2);
+    route.known = true;
+}
+
+bool XdpPath::send(int slot, const sockaddr_in& to, std::string_view payload) {
+    if (!is_open() || slot < 0 || slot >= MAX_CLIENTS) return false;
+    const size_t total = FRAME_HEADERS + payload.size();
+
+    // Um slot reaproveitado ou uma sessão que mudou de endereço ainda tem
+    // a rota antiga: até o próximo pacote aceito, vai pelo socket
+    const Route& r = routes[slot];
+    if (!r.known || r.peer_ip != to.sin_addr.s_addr ||
+        r.peer_port != to.sin_port || total > XDP_FRAME_SIZE ||
+        total - ETH_HEADER_SIZE > static_cast<size_t>(mtu)) {
+        ++send_fallbacks;
+        return false;
+    }
+
+    if (free_frames.empty()) reclaim();
+    const uint32_t producer = *tx.producer;
+    if (free_frames.empty() ||
+        producer - load_acquire(tx.consumer) >= XDP_RING_SIZE) {
+        ++send_fallbacks;
+        return false;
+    }
+    const uint64_t address = free_frames.back();
+    free_frames.pop_back();
+
+    auto* frame = reinterpret_cast<unsigned char*>(umem + address);
+
+    // Ethernet
+    std::memcpy(frame, r.peer_mac, 6);
+    std::memcpy(frame + 6, r.local_mac, 6);
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+
+    // IPv4, sem fragmentação
+    unsigned char* ip = frame + ETH_HEADER_SIZE;
+    const uint16_t ip_length = static_cast<uint16_t>(total - ETH_HEADER_SIZE);
+    ip[0] = 0x45;
+    ip[1] = 0;
+    ip[2] = static_cast<unsigned char>(ip_length >> 8);
+    ip[3] = static_cast<unsigned char>(ip_length);
+    ip[4] = static_cast<unsigned char>(ip_id >> 8);
+    ip[5] = static_cast<unsigned char>(ip_id);
+    ++ip_id;
+    ip[6] = 0x40;  // Don't Fragment
+    ip[7] = 0;
+    ip[8] = 64;
+    ip[9] = IPPROTO_UDP;
+    ip[10] = ip[11] = 0;
+    std::memcpy(ip + 12, &r.local_ip, 4);
+    std::memcpy(ip + 16, &to.sin_addr.s_addr, 4);
+    const uint16_t checksum = ip_checksum(ip);
+    ip[10] = static_cast<unsigned char>(checksum >> 8);
+    ip[11] = static_cast<unsigned char>(checksum);
+
+    // UDP, sem soma de verificação (opcional no IPv4)
+    unsigned char* udp = ip + IP_HEADER_SIZE;
+    const uint16_t local_port = htons(port);
+    const uint16_t udp_length = static_cast<uint16_t>(ip_length - IP_HEADER_SIZE);
+    std::memcpy(udp, &local_port, 2);
+    std::memcpy(udp + 2, &to.sin_port, 2);
+    udp[4] = static_cast<unsigned char>(udp_length >> 8);
+    udp[5] = static_cast<unsigned char>(udp_length);
+    udp[6] = udp[7] = 0;
+    std::memcpy(udp + UDP_HEADER_SIZE, payload.data(), payload.size());
+
+    auto* descriptors = static_cast<xdp_desc*>(tx.entries);
+    xdp_desc& descriptor = descriptors[producer & (XDP_RING_SIZE - 1)];
+    descriptor.addr = address;
+    descriptor.len = static_cast<uint32_t>(total);
+    descriptor.options = 0;
+    store_release(tx.producer, producer + 1);
+    ++tx_pending;
+    ++sent;
+    return true;
+}
+
+void XdpPath::flush() {
+    if (tx_pending == 0) return;
+    // No modo de cópia o kernel só transmite quando avisado
+    if (sendto(xsk, nullptr, 0, MSG_DONTWAIT, nullptr, 0) < 0 &&
+        errno != EAGAIN && errno != EBUSY && errno != ENOBUFS) {
+        perror("AF_XDP: erro ao enviar");
+    }
+    ++kicks;
+    tx_pending = 0;
+    reclaim();
+}
+
+void XdpPath::print_stats() const {
+    if (!is_open()) return;
+    std::cout << "AF_XDP: " << received << " pacotes recebidos, " << sent
+              << " enviados em " << kicks << " lotes, " << send_fallbacks
+              << " enviados pelo socket." << std::endl;
+}
+
+void XdpPath::close() {
+    if (link >= 0) ::close(link);
+    if (xsk >= 0) ::close(xsk);
+    if (program >= 0) ::close(program);
+    if (map >= 0) ::close(map);
+    link = xsk = program = map = -1;
+    for (Ring* ring : {&rx, &tx, &fill, &completion}) {
+        if (ring->map) munmap(ring->map, ring->map_size);
+        *ring = Ring{};
+    }
+    if (umem) {
+        munmap(umem, size_t(XDP_FRAME_SIZE) * XDP_FRAME_COUNT);
+        umem = nullptr;
+    }
+    for (Route& route : routes) route.known = false;
+}
+
+#else
+
+bool XdpPath::open(const std::string&, int) {
+    std::cerr << "AF_XDP indisponível: o servidor foi compilado sem "
+                 "-DVOIP_XDP (ou não é Linux)."
+              << std::endl;
+    return false;
+}
+
+int XdpPath::receive(
+    const std::function<void(std::string_view, const sockaddr_in&)>&) {
+    return 0;
+}
+
+void XdpPath::learn_route(int) {}
+
+bool XdpPath::send(int, const sockaddr_in&, std::string_view) { return false; }
+
+void XdpPath::flush() {}
+
+void XdpPath::print_stats() const {}
+
+void XdpPath::close() {}
+
+bool XdpPath::load_program(int) { return false; }
+
+bool XdpPath::create_socket(int) { return false; }
+
+void XdpPath::refill() {}
+
+void XdpPath::reclaim() {}
+
+#endif